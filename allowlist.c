@@ -0,0 +1,406 @@
+/*
+ * Allowlist of known DHCP servers, each identified by its IPv4 address,
+ * its MAC address and, optionally, the network interface through which
+ * it is expected to respond.
+ *
+ * The allowlist file is a text file with one entry per line, like this:
+ *
+ *     # IPv4 address   MAC address         Interface (optional)
+ *     192.168.0.1      01:02:03:04:05:06
+ *     10.0.10.1        0a:0b:0c:0d:0e:0f   eth0.10
+ *
+ * Empty lines and text following a '#' character are ignored. VLANs
+ * are identified by the name of the respective VLAN interface.
+ *
+ * The entries are stored in an open addressing hash table with linear
+ * probing, so that each lookup takes constant time regardless of how
+ * many entries the allowlist contains.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <net/if.h>
+#include <arpa/inet.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <errno.h>
+#include <assert.h>
+
+/****************************************************************************/
+
+#include "allowlist.h"
+#include "fnv_hash.h"
+
+/****************************************************************************/
+
+/* A single allowlist entry. An empty interface name matches
+ * any network interface.
+ */
+struct allowlist_entry
+{
+	uint8_t		server_ipv4_address[4];
+	uint8_t		server_mac_address[6];
+	bool		in_use;
+	char		interface_name[IF_NAMESIZE];
+};
+
+struct allowlist
+{
+	struct allowlist_entry *	table;
+	size_t						table_size;	/* Always a power of 2 */
+	size_t						num_entries;
+};
+
+/****************************************************************************/
+
+/* The hash table is never filled to more than half its capacity. */
+#define INITIAL_TABLE_SIZE 64
+
+/****************************************************************************/
+
+/* Calculate the hash value for an allowlist entry key. */
+static uint64_t
+hash_allowlist_key(const uint8_t * server_ipv4_address,const uint8_t * server_mac_address,const char * interface_name)
+{
+	uint64_t result;
+
+	result = fnv1a_64(FNV1A_64_OFFSET_BASIS,server_ipv4_address,4);
+	result = fnv1a_64(result,server_mac_address,6);
+	result = fnv1a_64(result,interface_name,strlen(interface_name));
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Find the table slot which either holds the entry with the given key
+ * or which is the free slot where it would have to go.
+ */
+static struct allowlist_entry *
+find_allowlist_slot(const struct allowlist_entry * table,size_t table_size,
+	const uint8_t * server_ipv4_address,const uint8_t * server_mac_address,const char * interface_name)
+{
+	const struct allowlist_entry * entry;
+	size_t mask = table_size - 1;
+	size_t i;
+
+	assert( table_size > 0 && (table_size & mask) == 0 );
+
+	for(i = hash_allowlist_key(server_ipv4_address,server_mac_address,interface_name) & mask ;
+		;
+		i = (i + 1) & mask)
+	{
+		entry = &table[i];
+
+		if(!entry->in_use)
+			break;
+
+		if(memcmp(entry->server_ipv4_address,server_ipv4_address,sizeof(entry->server_ipv4_address)) == 0 &&
+		   memcmp(entry->server_mac_address,server_mac_address,sizeof(entry->server_mac_address)) == 0 &&
+		   strcmp(entry->interface_name,interface_name) == 0)
+		{
+			break;
+		}
+	}
+
+	return((struct allowlist_entry *)entry);
+}
+
+/****************************************************************************/
+
+/* Double the size of the hash table. Returns -1 if not enough memory
+ * is available, 0 otherwise.
+ */
+static int
+grow_allowlist(struct allowlist * allowlist)
+{
+	struct allowlist_entry * table;
+	struct allowlist_entry * slot;
+	size_t table_size;
+	int result = -1;
+	size_t i;
+
+	table_size = allowlist->table_size * 2;
+
+	table = calloc(table_size,sizeof(*table));
+	if(table == NULL)
+		goto out;
+
+	for(i = 0 ; i < allowlist->table_size ; i++)
+	{
+		if(allowlist->table[i].in_use)
+		{
+			slot = find_allowlist_slot(table,table_size,
+				allowlist->table[i].server_ipv4_address,
+				allowlist->table[i].server_mac_address,
+				allowlist->table[i].interface_name);
+
+			(*slot) = allowlist->table[i];
+		}
+	}
+
+	free(allowlist->table);
+
+	allowlist->table = table;
+	allowlist->table_size = table_size;
+
+	result = 0;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Parse a single allowlist file line. Returns 1 if an entry was found,
+ * 0 if the line is empty and -1 if the line could not be parsed.
+ */
+static int
+parse_allowlist_line(char * line,struct allowlist_entry * entry)
+{
+	unsigned int mac[6];
+	char trailing;
+	char * fields[4];
+	int num_fields = 0;
+	int result = -1;
+	char * saved;
+	char * s;
+	int i;
+
+	/* Strip the comment, if any. */
+	s = strchr(line,'#');
+	if(s != NULL)
+		(*s) = '\0';
+
+	/* Break the line into fields separated by blank spaces. */
+	for(s = strtok_r(line," \t\r\n",&saved) ; s != NULL ; s = strtok_r(NULL," \t\r\n",&saved))
+	{
+		if(num_fields == 4)
+			goto out;
+
+		fields[num_fields++] = s;
+	}
+
+	if(num_fields == 0)
+	{
+		result = 0;
+		goto out;
+	}
+
+	if(num_fields < 2 || num_fields > 3)
+		goto out;
+
+	memset(entry,0,sizeof(*entry));
+
+	if(inet_pton(AF_INET,fields[0],entry->server_ipv4_address) != 1)
+		goto out;
+
+	if(sscanf(fields[1],"%2x:%2x:%2x:%2x:%2x:%2x%c",
+		&mac[0],&mac[1],&mac[2],&mac[3],&mac[4],&mac[5],&trailing) != 6)
+	{
+		goto out;
+	}
+
+	for(i = 0 ; i < 6 ; i++)
+		entry->server_mac_address[i] = mac[i];
+
+	if(num_fields == 3)
+	{
+		if(strlen(fields[2]) >= sizeof(entry->interface_name))
+			goto out;
+
+		strcpy(entry->interface_name,fields[2]);
+	}
+
+	entry->in_use = true;
+
+	result = 1;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Read the allowlist from a file. Returns NULL in case of error, with a
+ * description of the problem in the error buffer provided.
+ */
+struct allowlist *
+load_allowlist(const char * file_name,char * error_buffer,size_t error_buffer_size)
+{
+	struct allowlist * result = NULL;
+	struct allowlist * allowlist;
+	struct allowlist_entry entry;
+	struct allowlist_entry * slot;
+	char line[256];
+	int line_number = 0;
+	FILE * file = NULL;
+
+	assert( file_name != NULL && error_buffer != NULL && error_buffer_size > 0 );
+
+	allowlist = calloc(1,sizeof(*allowlist));
+	if(allowlist == NULL)
+	{
+		snprintf(error_buffer,error_buffer_size,"%s",strerror(errno));
+		goto out;
+	}
+
+	allowlist->table_size = INITIAL_TABLE_SIZE;
+
+	allowlist->table = calloc(allowlist->table_size,sizeof(*allowlist->table));
+	if(allowlist->table == NULL)
+	{
+		snprintf(error_buffer,error_buffer_size,"%s",strerror(errno));
+		goto out;
+	}
+
+	file = fopen(file_name,"r");
+	if(file == NULL)
+	{
+		snprintf(error_buffer,error_buffer_size,"%s",strerror(errno));
+		goto out;
+	}
+
+	/* Large input buffers make a difference when reading
+	 * many thousands of entries.
+	 */
+	setvbuf(file,NULL,_IOFBF,65536);
+
+	while(fgets(line,sizeof(line),file) != NULL)
+	{
+		line_number++;
+
+		switch(parse_allowlist_line(line,&entry))
+		{
+			case 0:
+
+				continue;
+
+			case 1:
+
+				break;
+
+			default:
+
+				snprintf(error_buffer,error_buffer_size,"line %d is not valid",line_number);
+				goto out;
+		}
+
+		/* Keep the table at most half full. */
+		if(2 * (allowlist->num_entries + 1) > allowlist->table_size)
+		{
+			if(grow_allowlist(allowlist) < 0)
+			{
+				snprintf(error_buffer,error_buffer_size,"%s",strerror(errno));
+				goto out;
+			}
+		}
+
+		slot = find_allowlist_slot(allowlist->table,allowlist->table_size,
+			entry.server_ipv4_address,entry.server_mac_address,entry.interface_name);
+
+		/* Duplicate entries are harmless. */
+		if(!slot->in_use)
+		{
+			(*slot) = entry;
+
+			allowlist->num_entries++;
+		}
+	}
+
+	if(ferror(file))
+	{
+		snprintf(error_buffer,error_buffer_size,"%s",strerror(errno));
+		goto out;
+	}
+
+	result = allowlist;
+	allowlist = NULL;
+
+ out:
+
+	if(file != NULL)
+		fclose(file);
+
+	delete_allowlist(allowlist);
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Release the memory allocated by load_allowlist(). This is safe to call
+ * with a NULL parameter.
+ */
+void
+delete_allowlist(struct allowlist * allowlist)
+{
+	if(allowlist != NULL)
+	{
+		if(allowlist->table != NULL)
+			free(allowlist->table);
+
+		free(allowlist);
+	}
+}
+
+/****************************************************************************/
+
+/* Check if a DHCP server is known. Entries which name a network interface
+ * take precedence; entries without an interface name match the server on
+ * any network interface.
+ */
+bool
+is_server_allowlisted(const struct allowlist * allowlist,const uint8_t * server_ipv4_address,
+	const uint8_t * server_mac_address,const char * interface_name)
+{
+	const struct allowlist_entry * slot;
+	bool result = false;
+
+	if(allowlist == NULL)
+		goto out;
+
+	if(interface_name != NULL && interface_name[0] != '\0')
+	{
+		slot = find_allowlist_slot(allowlist->table,allowlist->table_size,
+			server_ipv4_address,server_mac_address,interface_name);
+
+		if(slot->in_use)
+		{
+			result = true;
+			goto out;
+		}
+	}
+
+	slot = find_allowlist_slot(allowlist->table,allowlist->table_size,
+		server_ipv4_address,server_mac_address,"");
+
+	result = slot->in_use;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Return the number of entries in the allowlist. */
+size_t
+get_allowlist_size(const struct allowlist * allowlist)
+{
+	size_t result = 0;
+
+	if(allowlist != NULL)
+		result = allowlist->num_entries;
+
+	return(result);
+}
@@ -0,0 +1,33 @@
+/*
+ * Allowlist of known DHCP servers, each identified by its IPv4 address,
+ * its MAC address and, optionally, the network interface through which
+ * it is expected to respond.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#ifndef _ALLOWLIST_H
+#define _ALLOWLIST_H
+
+/****************************************************************************/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/****************************************************************************/
+
+struct allowlist;
+
+/****************************************************************************/
+
+struct allowlist *load_allowlist(const char *file_name, char *error_buffer, size_t error_buffer_size);
+void delete_allowlist(struct allowlist *allowlist);
+bool is_server_allowlisted(const struct allowlist *allowlist, const uint8_t *server_ipv4_address, const uint8_t *server_mac_address, const char *interface_name);
+size_t get_allowlist_size(const struct allowlist *allowlist);
+
+/****************************************************************************/
+
+#endif /* _ALLOWLIST_H */
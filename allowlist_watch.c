@@ -0,0 +1,381 @@
+/*
+ * Watch the allowlist file for changes and reload it in the background,
+ * so that the packet capture does not have to wait for it.
+ *
+ * The directory which contains the allowlist file is watched through
+ * inotify, because editors and configuration management tools tend to
+ * replace files by renaming a new copy over the old one, which a watch
+ * on the file itself would not survive. When the file changes, a thread
+ * is started which loads the new version. Once it is done, it wakes up
+ * the event loop through a pipe, and the event loop picks up the new
+ * allowlist from the thread and swaps it in place of the old one. The
+ * old allowlist may be freed right away because the event loop is the
+ * only one to use it.
+ *
+ * This is supported only on Linux.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <assert.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+#include <libgen.h>
+#include <pthread.h>
+#endif /* __linux__ */
+
+/****************************************************************************/
+
+#include "allowlist_watch.h"
+
+/****************************************************************************/
+
+#ifdef __linux__
+
+/****************************************************************************/
+
+struct allowlist_watch
+{
+	char *				file_name;
+	char *				base_name;
+
+	int					inotify_fd;
+	int					wakeup_pipe[2];
+
+	pthread_t			thread;
+	bool				reload_running;	/* Loader thread was started */
+	bool				reload_pending;	/* File changed again while loading */
+
+	/* Filled in by the loader thread. */
+	char				error_buffer[256];
+};
+
+/****************************************************************************/
+
+/* This runs in its own thread, loading the allowlist and then waking up
+ * the event loop. The new allowlist is handed over through pthread_join().
+ */
+static void *
+allowlist_loader_thread(void * arg)
+{
+	struct allowlist_watch * watch = arg;
+	struct allowlist * allowlist;
+	char c = 0;
+
+	allowlist = load_allowlist(watch->file_name,watch->error_buffer,sizeof(watch->error_buffer));
+
+	/* Wake up the event loop. */
+	while(write(watch->wakeup_pipe[1],&c,1) < 0 && errno == EINTR)
+		(void)NULL;
+
+	return(allowlist);
+}
+
+/****************************************************************************/
+
+/* Start loading the allowlist in the background, unless this is
+ * already in progress. Returns -1 if the thread could not be
+ * started.
+ */
+static int
+start_allowlist_reload(struct allowlist_watch * watch)
+{
+	int result = -1;
+	int error;
+
+	if(watch->reload_running)
+	{
+		watch->reload_pending = true;
+	}
+	else
+	{
+		watch->error_buffer[0] = '\0';
+
+		error = pthread_create(&watch->thread,NULL,allowlist_loader_thread,watch);
+		if(error != 0)
+		{
+			errno = error;
+			goto out;
+		}
+
+		watch->reload_running = true;
+		watch->reload_pending = false;
+	}
+
+	result = 0;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Release the resources allocated by create_allowlist_watch(), waiting
+ * for the loader thread to finish if necessary. This is safe to call
+ * with a NULL parameter.
+ */
+void
+delete_allowlist_watch(struct allowlist_watch * watch)
+{
+	void * allowlist;
+
+	if(watch != NULL)
+	{
+		if(watch->reload_running)
+		{
+			pthread_join(watch->thread,&allowlist);
+
+			delete_allowlist(allowlist);
+		}
+
+		if(watch->inotify_fd != -1)
+			close(watch->inotify_fd);
+
+		if(watch->wakeup_pipe[0] != -1)
+			close(watch->wakeup_pipe[0]);
+
+		if(watch->wakeup_pipe[1] != -1)
+			close(watch->wakeup_pipe[1]);
+
+		if(watch->file_name != NULL)
+			free(watch->file_name);
+
+		if(watch->base_name != NULL)
+			free(watch->base_name);
+
+		free(watch);
+	}
+}
+
+/****************************************************************************/
+
+/* Start watching the allowlist file for changes. Returns NULL in case of
+ * error, with a description of the problem in the error buffer provided.
+ */
+struct allowlist_watch *
+create_allowlist_watch(const char * file_name,char * error_buffer,size_t error_buffer_size)
+{
+	struct allowlist_watch * result = NULL;
+	struct allowlist_watch * watch;
+	char * directory_name = NULL;
+	char * copy;
+
+	assert( file_name != NULL && error_buffer != NULL && error_buffer_size > 0 );
+
+	watch = calloc(1,sizeof(*watch));
+	if(watch == NULL)
+		goto out;
+
+	watch->inotify_fd = watch->wakeup_pipe[0] = watch->wakeup_pipe[1] = -1;
+
+	watch->file_name = strdup(file_name);
+	if(watch->file_name == NULL)
+		goto out;
+
+	/* basename() and dirname() may modify the string they are given. */
+	copy = strdup(file_name);
+	if(copy == NULL)
+		goto out;
+
+	watch->base_name = strdup(basename(copy));
+	free(copy);
+
+	if(watch->base_name == NULL)
+		goto out;
+
+	copy = strdup(file_name);
+	if(copy == NULL)
+		goto out;
+
+	directory_name = strdup(dirname(copy));
+	free(copy);
+
+	if(directory_name == NULL)
+		goto out;
+
+	if(pipe(watch->wakeup_pipe) < 0)
+		goto out;
+
+	if(fcntl(watch->wakeup_pipe[0],F_SETFL,O_NONBLOCK) < 0 ||
+	   fcntl(watch->wakeup_pipe[0],F_SETFD,FD_CLOEXEC) < 0 ||
+	   fcntl(watch->wakeup_pipe[1],F_SETFD,FD_CLOEXEC) < 0)
+	{
+		goto out;
+	}
+
+	watch->inotify_fd = inotify_init1(IN_CLOEXEC|IN_NONBLOCK);
+	if(watch->inotify_fd < 0)
+		goto out;
+
+	/* Files written in place are picked up once they are closed, and
+	 * replacements once they are renamed into place. A file which was
+	 * just created may still be empty or only partly written, which
+	 * is why its creation is not watched for.
+	 */
+	if(inotify_add_watch(watch->inotify_fd,directory_name,IN_CLOSE_WRITE|IN_MOVED_TO) < 0)
+		goto out;
+
+	result = watch;
+	watch = NULL;
+
+ out:
+
+	if(result == NULL)
+		snprintf(error_buffer,error_buffer_size,"%s",strerror(errno));
+
+	if(directory_name != NULL)
+		free(directory_name);
+
+	delete_allowlist_watch(watch);
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Fill in the poll() table entries for the file descriptors to be
+ * watched. There must be room for ALLOWLIST_WATCH_NUM_FDS entries.
+ * Returns the number of entries filled in.
+ */
+int
+fill_allowlist_watch_pollfds(const struct allowlist_watch * watch,struct pollfd * pfd)
+{
+	pfd[0].fd = watch->inotify_fd;
+	pfd[0].events = POLLIN;
+	pfd[0].revents = 0;
+
+	pfd[1].fd = watch->wakeup_pipe[0];
+	pfd[1].events = POLLIN;
+	pfd[1].revents = 0;
+
+	return(ALLOWLIST_WATCH_NUM_FDS);
+}
+
+/****************************************************************************/
+
+/* Process the poll() results for the file descriptors filled in by
+ * fill_allowlist_watch_pollfds(). Returns a newly-loaded allowlist,
+ * which replaces the one currently in use, or NULL if there is none.
+ * If loading the allowlist failed, the error buffer will contain a
+ * description of the problem, otherwise it will contain an empty
+ * string.
+ */
+struct allowlist *
+check_allowlist_watch(struct allowlist_watch * watch,const struct pollfd * pfd,
+	char * error_buffer,size_t error_buffer_size)
+{
+	/* Room for at least one event and the file name following it. */
+	char event_buffer[sizeof(struct inotify_event) + NAME_MAX + 1]
+		__attribute__((aligned(__alignof__(struct inotify_event))));
+	const struct inotify_event * event;
+	struct allowlist * result = NULL;
+	bool file_changed = false;
+	void * allowlist;
+	ssize_t len;
+	ssize_t pos;
+	char c;
+
+	assert( error_buffer != NULL && error_buffer_size > 0 );
+
+	error_buffer[0] = '\0';
+
+	/* Did anything happen in the directory which contains the
+	 * allowlist file?
+	 */
+	if(pfd[0].revents & POLLIN)
+	{
+		while((len = read(watch->inotify_fd,event_buffer,sizeof(event_buffer))) > 0)
+		{
+			for(pos = 0 ; pos < len ; pos += sizeof(*event) + event->len)
+			{
+				event = (const struct inotify_event *)&event_buffer[pos];
+
+				if(event->len > 0 && strcmp(event->name,watch->base_name) == 0)
+					file_changed = true;
+			}
+		}
+
+		if(file_changed && start_allowlist_reload(watch) < 0)
+			snprintf(error_buffer,error_buffer_size,"%s",strerror(errno));
+	}
+
+	/* Is the loader thread done? */
+	if((pfd[1].revents & POLLIN) && watch->reload_running)
+	{
+		while(read(watch->wakeup_pipe[0],&c,1) > 0)
+			(void)NULL;
+
+		pthread_join(watch->thread,&allowlist);
+		watch->reload_running = false;
+
+		result = allowlist;
+		if(result == NULL)
+			snprintf(error_buffer,error_buffer_size,"%s",watch->error_buffer);
+
+		/* If the file changed again while the loader thread was
+		 * still busy, load it once more.
+		 */
+		if(watch->reload_pending && start_allowlist_reload(watch) < 0)
+			snprintf(error_buffer,error_buffer_size,"%s",strerror(errno));
+	}
+
+	return(result);
+}
+
+/****************************************************************************/
+
+#else
+
+/****************************************************************************/
+
+struct allowlist_watch *
+create_allowlist_watch(const char * file_name __attribute__((unused)),char * error_buffer,size_t error_buffer_size)
+{
+	snprintf(error_buffer,error_buffer_size,"%s",strerror(ENOSYS));
+
+	return(NULL);
+}
+
+/****************************************************************************/
+
+void
+delete_allowlist_watch(struct allowlist_watch * watch __attribute__((unused)))
+{
+}
+
+/****************************************************************************/
+
+int
+fill_allowlist_watch_pollfds(const struct allowlist_watch * watch __attribute__((unused)),
+	struct pollfd * pfd __attribute__((unused)))
+{
+	return(0);
+}
+
+/****************************************************************************/
+
+struct allowlist *
+check_allowlist_watch(struct allowlist_watch * watch __attribute__((unused)),
+	const struct pollfd * pfd __attribute__((unused)),
+	char * error_buffer,size_t error_buffer_size)
+{
+	if(error_buffer_size > 0)
+		error_buffer[0] = '\0';
+
+	return(NULL);
+}
+
+/****************************************************************************/
+
+#endif /* __linux__ */
@@ -0,0 +1,39 @@
+/*
+ * Watch the allowlist file for changes and reload it in the background,
+ * so that the packet capture does not have to wait for it.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#ifndef _ALLOWLIST_WATCH_H
+#define _ALLOWLIST_WATCH_H
+
+/****************************************************************************/
+
+#include <poll.h>
+
+/****************************************************************************/
+
+#include "allowlist.h"
+
+/****************************************************************************/
+
+/* Number of file descriptors which need to be watched by poll(). */
+#define ALLOWLIST_WATCH_NUM_FDS 2
+
+/****************************************************************************/
+
+struct allowlist_watch;
+
+/****************************************************************************/
+
+struct allowlist_watch *create_allowlist_watch(const char *file_name, char *error_buffer, size_t error_buffer_size);
+void delete_allowlist_watch(struct allowlist_watch *watch);
+int fill_allowlist_watch_pollfds(const struct allowlist_watch *watch, struct pollfd *pfd);
+struct allowlist *check_allowlist_watch(struct allowlist_watch *watch, const struct pollfd *pfd, char *error_buffer, size_t error_buffer_size);
+
+/****************************************************************************/
+
+#endif /* _ALLOWLIST_WATCH_H */
@@ -0,0 +1,1201 @@
+/*
+ * Persistent baseline of the DHCP servers seen in previous runs, stored
+ * in a memory-mapped file.
+ *
+ * The file consists of 64 byte records. The first record is the header,
+ * which is followed by an open addressing hash table (linear probing) of
+ * server records keyed by IPv4 address, MAC address and network interface
+ * name. The records of the servers which were seen in the most recent run
+ * on each interface are chained together, so that the servers which have
+ * vanished since then can be found without looking at the entire table.
+ * This means that the cost of each run depends only on the number of
+ * servers seen in it, and not on how many were recorded over time.
+ *
+ * Changes are never made to the file directly. Instead, modified records
+ * are collected in memory and then written to a journal file first. Once
+ * the journal has been flushed to disk, the changes are copied into the
+ * mapped file, which is then flushed as well, and the journal is removed.
+ * If the process stops before the changes have been flushed, the journal
+ * will be replayed when the file is opened the next time; a journal which
+ * was not completely written is ignored. When the hash table becomes too
+ * full, a new file with a larger table is built and renamed over the old
+ * one.
+ *
+ * The number of each run is written to the header as soon as the run
+ * begins, so that changes committed in the middle of a run which does
+ * not finish are never mistaken for changes made by the next run.
+ *
+ * Only one process may use the file at a time, which is made sure of
+ * with an exclusive lock on a separate lock file. The lock file is
+ * never replaced, unlike the file itself.
+ *
+ * The file uses the native byte order of the machine which created it.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/file.h>
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <assert.h>
+
+/****************************************************************************/
+
+#include "baseline.h"
+#include "fnv_hash.h"
+
+/****************************************************************************/
+
+#define BASELINE_MAGIC		"DHCPBASE"
+#define JOURNAL_MAGIC		"DHCPJRNL"
+#define BASELINE_VERSION	1
+
+/* Number of server records in a new file. */
+#define INITIAL_TABLE_SIZE	256
+
+/* Size of each record in the file. */
+#define RECORD_SIZE			64
+
+/****************************************************************************/
+
+/* Record 0 of the file. */
+struct baseline_header
+{
+	char		magic[8];
+	uint32_t	version;
+	uint32_t	table_size;		/* Number of server records; a power of 2 */
+	uint32_t	num_entries;	/* Number of server records in use */
+	uint32_t	run_head;		/* First record of the latest run chain, or 0 */
+	uint32_t	run_count;		/* Number of runs recorded so far */
+	uint32_t	reserved1;
+	int64_t		last_run;		/* When the most recent run started */
+	uint8_t		reserved2[24];
+};
+
+/* Records 1..table_size of the file. */
+struct baseline_entry
+{
+	uint8_t		server_ipv4_address[4];
+	uint8_t		server_mac_address[6];
+	uint8_t		in_use;
+	uint8_t		reserved1;
+	char		interface_name[16];
+	uint32_t	next_in_run;	/* Next record of the latest run chain, or 0 */
+	uint32_t	run_number;		/* Run in which this server was last seen */
+	uint32_t	reserved2;
+	int64_t		first_seen;
+	int64_t		last_seen;
+	uint64_t	offer_hash;
+};
+
+union baseline_record
+{
+	struct baseline_header	header;
+	struct baseline_entry	entry;
+	uint8_t					data[RECORD_SIZE];
+};
+
+/* Both record types must have the same size. */
+typedef char baseline_header_size_check[(sizeof(struct baseline_header) == RECORD_SIZE) ? 1 : -1];
+typedef char baseline_entry_size_check[(sizeof(struct baseline_entry) == RECORD_SIZE) ? 1 : -1];
+
+/****************************************************************************/
+
+/* The journal file consists of this header, followed by the records
+ * to be written.
+ */
+struct journal_header
+{
+	char		magic[8];
+	uint32_t	num_records;
+	uint32_t	reserved;
+	uint64_t	checksum;		/* FNV-1a hash over all the journal records */
+};
+
+struct journal_record
+{
+	uint32_t				record_number;
+	uint32_t				reserved;
+	union baseline_record	record;
+};
+
+/****************************************************************************/
+
+/* A modified record which has not been written to the file yet. */
+struct overlay_slot
+{
+	uint32_t				key;			/* Record number + 1, or 0 if unused */
+	union baseline_record	record;
+};
+
+/****************************************************************************/
+
+struct baseline
+{
+	char *					file_name;
+	char *					journal_name;
+	char *					temporary_name;
+	char *					lock_name;
+
+	int						lock_fd;
+	int						fd;
+	uint8_t *				map;
+	size_t					map_size;
+
+	/* Records modified since the last commit, kept in a hash
+	 * table keyed by record number.
+	 */
+	struct overlay_slot *	overlay;
+	uint32_t				overlay_size;	/* A power of 2 */
+	uint32_t				overlay_count;
+
+	/* Records of the servers seen in the current run. */
+	uint32_t *				run_records;
+	uint32_t				num_run_records;
+	uint32_t				run_records_size;
+
+	uint32_t				run_number;
+	time_t					now;
+};
+
+/****************************************************************************/
+
+/* Find the overlay slot for a record, or the free slot where it would
+ * have to go.
+ */
+static struct overlay_slot *
+find_overlay_slot(const struct overlay_slot * overlay,uint32_t overlay_size,uint32_t record_number)
+{
+	uint32_t mask = overlay_size - 1;
+	uint32_t i;
+
+	for(i = (record_number * 2654435761U) & mask ; ; i = (i + 1) & mask)
+	{
+		if(overlay[i].key == 0 || overlay[i].key == record_number + 1)
+			break;
+	}
+
+	return((struct overlay_slot *)&overlay[i]);
+}
+
+/****************************************************************************/
+
+/* Return the current contents of a record, which may have been
+ * modified but not committed yet.
+ */
+static const union baseline_record *
+read_record(const struct baseline * baseline,uint32_t record_number)
+{
+	const union baseline_record * result;
+	const struct overlay_slot * slot;
+
+	assert( (record_number + 1) * (size_t)RECORD_SIZE <= baseline->map_size );
+
+	slot = find_overlay_slot(baseline->overlay,baseline->overlay_size,record_number);
+	if(slot->key != 0)
+		result = &slot->record;
+	else
+		result = (const union baseline_record *)&baseline->map[record_number * RECORD_SIZE];
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Double the size of the overlay table. Returns -1 if not enough memory
+ * is available, 0 otherwise.
+ */
+static int
+grow_overlay(struct baseline * baseline)
+{
+	struct overlay_slot * overlay;
+	struct overlay_slot * slot;
+	uint32_t overlay_size;
+	int result = -1;
+	uint32_t i;
+
+	overlay_size = 2 * baseline->overlay_size;
+
+	overlay = calloc(overlay_size,sizeof(*overlay));
+	if(overlay == NULL)
+		goto out;
+
+	for(i = 0 ; i < baseline->overlay_size ; i++)
+	{
+		if(baseline->overlay[i].key != 0)
+		{
+			slot = find_overlay_slot(overlay,overlay_size,baseline->overlay[i].key - 1);
+
+			(*slot) = baseline->overlay[i];
+		}
+	}
+
+	free(baseline->overlay);
+
+	baseline->overlay = overlay;
+	baseline->overlay_size = overlay_size;
+
+	result = 0;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Return a modifiable copy of a record, which will be written to the file
+ * by the next commit. Returns NULL if not enough memory is available.
+ */
+static union baseline_record *
+write_record(struct baseline * baseline,uint32_t record_number)
+{
+	union baseline_record * result = NULL;
+	struct overlay_slot * slot;
+
+	slot = find_overlay_slot(baseline->overlay,baseline->overlay_size,record_number);
+	if(slot->key == 0)
+	{
+		/* Keep the overlay table at most half full. */
+		if(2 * (baseline->overlay_count + 1) > baseline->overlay_size)
+		{
+			if(grow_overlay(baseline) < 0)
+				goto out;
+
+			slot = find_overlay_slot(baseline->overlay,baseline->overlay_size,record_number);
+		}
+
+		slot->key = record_number + 1;
+		memmove(&slot->record,&baseline->map[record_number * RECORD_SIZE],RECORD_SIZE);
+
+		baseline->overlay_count++;
+	}
+
+	result = &slot->record;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Forget about all modified records. */
+static void
+clear_overlay(struct baseline * baseline)
+{
+	memset(baseline->overlay,0,baseline->overlay_size * sizeof(*baseline->overlay));
+	baseline->overlay_count = 0;
+}
+
+/****************************************************************************/
+
+/* Calculate the hash table position for a server. */
+static uint32_t
+hash_server_key(const uint8_t * server_ipv4_address,const uint8_t * server_mac_address,const char * interface_name)
+{
+	uint64_t hash;
+
+	hash = fnv1a_64(FNV1A_64_OFFSET_BASIS,server_ipv4_address,4);
+	hash = fnv1a_64(hash,server_mac_address,6);
+	hash = fnv1a_64(hash,interface_name,strlen(interface_name));
+
+	return((uint32_t)(hash ^ (hash >> 32)));
+}
+
+/****************************************************************************/
+
+/* Find the record number of the entry for a server, or of the free
+ * entry where it would have to go.
+ */
+static uint32_t
+find_entry(const struct baseline * baseline,const uint8_t * server_ipv4_address,const uint8_t * server_mac_address,
+	const char * interface_name,bool * found_ptr)
+{
+	const struct baseline_header * header = &read_record(baseline,0)->header;
+	const struct baseline_entry * entry;
+	uint32_t mask = header->table_size - 1;
+	bool found = false;
+	uint32_t i;
+
+	for(i = hash_server_key(server_ipv4_address,server_mac_address,interface_name) & mask ; ; i = (i + 1) & mask)
+	{
+		entry = &read_record(baseline,1 + i)->entry;
+
+		if(!entry->in_use)
+			break;
+
+		if(memcmp(entry->server_ipv4_address,server_ipv4_address,sizeof(entry->server_ipv4_address)) == 0 &&
+		   memcmp(entry->server_mac_address,server_mac_address,sizeof(entry->server_mac_address)) == 0 &&
+		   strncmp(entry->interface_name,interface_name,sizeof(entry->interface_name)) == 0)
+		{
+			found = true;
+			break;
+		}
+	}
+
+	(*found_ptr) = found;
+
+	return(1 + i);
+}
+
+/****************************************************************************/
+
+/* Make sure that a file's contents have been written to disk. */
+static int
+sync_file(int fd)
+{
+	int result;
+
+	#if defined(__APPLE__) && defined(F_FULLFSYNC)
+	{
+		result = fcntl(fd,F_FULLFSYNC);
+	}
+	#else
+	{
+		result = fsync(fd);
+	}
+	#endif
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Copy journal records into the mapped file and flush it to disk. */
+static int
+apply_journal_records(struct baseline * baseline,const struct journal_record * records,uint32_t num_records)
+{
+	int result = -1;
+	uint32_t i;
+
+	for(i = 0 ; i < num_records ; i++)
+	{
+		if((records[i].record_number + 1) * (size_t)RECORD_SIZE > baseline->map_size)
+		{
+			errno = EINVAL;
+			goto out;
+		}
+
+		memmove(&baseline->map[records[i].record_number * RECORD_SIZE],&records[i].record,RECORD_SIZE);
+	}
+
+	if(msync(baseline->map,baseline->map_size,MS_SYNC) < 0)
+		goto out;
+
+	result = 0;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* If a journal was left behind by a run which did not complete, apply
+ * its changes. A journal which was not completely written is discarded.
+ */
+static int
+replay_journal(struct baseline * baseline)
+{
+	struct journal_header header;
+	struct journal_record * records = NULL;
+	struct stat st;
+	int result = -1;
+	size_t size;
+	int fd;
+
+	fd = open(baseline->journal_name,O_RDONLY);
+	if(fd < 0)
+	{
+		if(errno == ENOENT)
+			result = 0;
+
+		goto out;
+	}
+
+	if(fstat(fd,&st) < 0)
+		goto out;
+
+	if(read(fd,&header,sizeof(header)) != sizeof(header) ||
+	   memcmp(header.magic,JOURNAL_MAGIC,sizeof(header.magic)) != 0)
+	{
+		goto discard;
+	}
+
+	size = header.num_records * sizeof(*records);
+	if((off_t)(sizeof(header) + size) != st.st_size || size == 0)
+		goto discard;
+
+	records = malloc(size);
+	if(records == NULL)
+		goto out;
+
+	if(read(fd,records,size) != (ssize_t)size ||
+	   fnv1a_64(FNV1A_64_OFFSET_BASIS,records,size) != header.checksum)
+	{
+		goto discard;
+	}
+
+	if(apply_journal_records(baseline,records,header.num_records) < 0)
+		goto out;
+
+ discard:
+
+	if(unlink(baseline->journal_name) < 0)
+		goto out;
+
+	result = 0;
+
+ out:
+
+	if(records != NULL)
+		free(records);
+
+	if(fd >= 0)
+		close(fd);
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Write all modified records to disk. Returns -1 in case of error,
+ * 0 otherwise.
+ */
+int
+commit_baseline(struct baseline * baseline)
+{
+	struct journal_header header;
+	struct journal_record * records = NULL;
+	uint32_t num_records = 0;
+	int result = -1;
+	size_t size;
+	int fd = -1;
+	uint32_t i;
+
+	if(baseline->overlay_count == 0)
+	{
+		result = 0;
+		goto out;
+	}
+
+	size = baseline->overlay_count * sizeof(*records);
+
+	records = calloc(1,size);
+	if(records == NULL)
+		goto out;
+
+	for(i = 0 ; i < baseline->overlay_size ; i++)
+	{
+		if(baseline->overlay[i].key != 0)
+		{
+			records[num_records].record_number = baseline->overlay[i].key - 1;
+			records[num_records].record = baseline->overlay[i].record;
+
+			num_records++;
+		}
+	}
+
+	assert( num_records == baseline->overlay_count );
+
+	memset(&header,0,sizeof(header));
+	memmove(header.magic,JOURNAL_MAGIC,sizeof(header.magic));
+	header.num_records = num_records;
+	header.checksum = fnv1a_64(FNV1A_64_OFFSET_BASIS,records,size);
+
+	/* First the journal must be safely on disk... */
+	fd = open(baseline->journal_name,O_WRONLY|O_CREAT|O_TRUNC,0644);
+	if(fd < 0)
+		goto out;
+
+	if(write(fd,&header,sizeof(header)) != sizeof(header) ||
+	   write(fd,records,size) != (ssize_t)size)
+	{
+		if(errno == 0)
+			errno = ENOSPC;
+
+		goto out;
+	}
+
+	if(sync_file(fd) < 0)
+		goto out;
+
+	close(fd);
+	fd = -1;
+
+	/* ...then the file can be updated, and the journal
+	 * is no longer needed.
+	 */
+	if(apply_journal_records(baseline,records,num_records) < 0)
+		goto out;
+
+	if(unlink(baseline->journal_name) < 0)
+		goto out;
+
+	clear_overlay(baseline);
+
+	result = 0;
+
+ out:
+
+	if(fd >= 0)
+		close(fd);
+
+	if(records != NULL)
+		free(records);
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Create a new, empty file with the given number of server records, and
+ * map it into memory. The file is created under a temporary name, which
+ * the caller has to rename once the file is ready. Returns -1 in case of
+ * error, 0 otherwise.
+ */
+static int
+create_baseline_file(const char * file_name,uint32_t table_size,int * fd_ptr,uint8_t ** map_ptr,size_t * map_size_ptr)
+{
+	struct baseline_header * header;
+	uint8_t * map = MAP_FAILED;
+	size_t map_size;
+	int result = -1;
+	int fd;
+
+	map_size = (1 + (size_t)table_size) * RECORD_SIZE;
+
+	fd = open(file_name,O_RDWR|O_CREAT|O_TRUNC,0644);
+	if(fd < 0)
+		goto out;
+
+	if(ftruncate(fd,map_size) < 0)
+		goto out;
+
+	map = mmap(NULL,map_size,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+	if(map == MAP_FAILED)
+		goto out;
+
+	header = (struct baseline_header *)map;
+
+	memmove(header->magic,BASELINE_MAGIC,sizeof(header->magic));
+	header->version = BASELINE_VERSION;
+	header->table_size = table_size;
+
+	(*fd_ptr) = fd;
+	(*map_ptr) = map;
+	(*map_size_ptr) = map_size;
+
+	result = 0;
+
+ out:
+
+	if(result != 0)
+	{
+		if(map != MAP_FAILED)
+			munmap(map,map_size);
+
+		if(fd >= 0)
+		{
+			close(fd);
+			unlink(file_name);
+		}
+	}
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Flush a newly-built file to disk and put it in place of the old one. */
+static int
+install_baseline_file(struct baseline * baseline,int fd,uint8_t * map,size_t map_size)
+{
+	int result = -1;
+
+	if(msync(map,map_size,MS_SYNC) < 0 || sync_file(fd) < 0)
+		goto out;
+
+	if(rename(baseline->temporary_name,baseline->file_name) < 0)
+		goto out;
+
+	if(baseline->map != NULL)
+		munmap(baseline->map,baseline->map_size);
+
+	if(baseline->fd >= 0)
+		close(baseline->fd);
+
+	baseline->fd = fd;
+	baseline->map = map;
+	baseline->map_size = map_size;
+
+	result = 0;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Double the size of the hash table. This builds a new file and copies all
+ * the server records over, which takes time proportional to the number of
+ * servers recorded, but it happens less and less often as the table grows.
+ */
+static int
+grow_baseline(struct baseline * baseline)
+{
+	const struct baseline_header * old_header;
+	struct baseline_header * new_header;
+	struct baseline_entry * old_entry;
+	struct baseline_entry * new_entry;
+	uint32_t * new_record_number = NULL;
+	uint32_t old_table_size,new_table_size;
+	uint8_t * map = MAP_FAILED;
+	size_t map_size = 0;
+	int result = -1;
+	int fd = -1;
+	uint32_t mask;
+	uint32_t i,j;
+
+	/* Changes must be in the file before it is copied. */
+	if(commit_baseline(baseline) < 0)
+		goto out;
+
+	old_header = (const struct baseline_header *)baseline->map;
+	old_table_size = old_header->table_size;
+	new_table_size = 2 * old_table_size;
+
+	/* Where each record moves to; record 0 (the header) stays
+	 * where it is.
+	 */
+	new_record_number = calloc(1 + old_table_size,sizeof(*new_record_number));
+	if(new_record_number == NULL)
+		goto out;
+
+	if(create_baseline_file(baseline->temporary_name,new_table_size,&fd,&map,&map_size) < 0)
+		goto out;
+
+	new_header = (struct baseline_header *)map;
+	mask = new_table_size - 1;
+
+	for(i = 1 ; i <= old_table_size ; i++)
+	{
+		old_entry = (struct baseline_entry *)&baseline->map[i * RECORD_SIZE];
+		if(!old_entry->in_use)
+			continue;
+
+		for(j = hash_server_key(old_entry->server_ipv4_address,old_entry->server_mac_address,old_entry->interface_name) & mask ;
+			((struct baseline_entry *)&map[(1 + j) * RECORD_SIZE])->in_use ;
+			j = (j + 1) & mask)
+		{
+			(void)NULL;
+		}
+
+		new_record_number[i] = 1 + j;
+
+		memmove(&map[(1 + j) * RECORD_SIZE],old_entry,RECORD_SIZE);
+	}
+
+	/* Fix up the run chain links. */
+	for(i = 1 ; i <= old_table_size ; i++)
+	{
+		if(new_record_number[i] != 0)
+		{
+			new_entry = (struct baseline_entry *)&map[new_record_number[i] * RECORD_SIZE];
+			if(new_entry->next_in_run <= old_table_size)
+				new_entry->next_in_run = new_record_number[new_entry->next_in_run];
+			else
+				new_entry->next_in_run = 0;
+		}
+	}
+
+	new_header->num_entries = old_header->num_entries;
+	if(old_header->run_head <= old_table_size)
+		new_header->run_head = new_record_number[old_header->run_head];
+	new_header->run_count = old_header->run_count;
+	new_header->last_run = old_header->last_run;
+
+	for(i = 0 ; i < baseline->num_run_records ; i++)
+		baseline->run_records[i] = new_record_number[baseline->run_records[i]];
+
+	if(install_baseline_file(baseline,fd,map,map_size) < 0)
+		goto out;
+
+	fd = -1;
+	map = MAP_FAILED;
+
+	result = 0;
+
+ out:
+
+	if(map != MAP_FAILED)
+		munmap(map,map_size);
+
+	if(fd >= 0)
+	{
+		close(fd);
+		unlink(baseline->temporary_name);
+	}
+
+	if(new_record_number != NULL)
+		free(new_record_number);
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Release all resources allocated by open_baseline(), without writing
+ * the changes which have not been committed yet. Returns -1 if the file
+ * could not be closed properly. This is safe to call with a NULL
+ * parameter.
+ */
+int
+close_baseline(struct baseline * baseline)
+{
+	int result = 0;
+
+	if(baseline != NULL)
+	{
+		if(baseline->map != NULL && munmap(baseline->map,baseline->map_size) < 0)
+			result = -1;
+
+		if(baseline->fd >= 0 && close(baseline->fd) < 0)
+			result = -1;
+
+		if(baseline->overlay != NULL)
+			free(baseline->overlay);
+
+		if(baseline->run_records != NULL)
+			free(baseline->run_records);
+
+		if(baseline->file_name != NULL)
+			free(baseline->file_name);
+
+		if(baseline->journal_name != NULL)
+			free(baseline->journal_name);
+
+		if(baseline->temporary_name != NULL)
+			free(baseline->temporary_name);
+
+		if(baseline->lock_name != NULL)
+			free(baseline->lock_name);
+
+		/* This releases the lock, too. */
+		if(baseline->lock_fd >= 0 && close(baseline->lock_fd) < 0)
+			result = -1;
+
+		free(baseline);
+	}
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Open the baseline file, creating it if it does not exist yet. Returns
+ * NULL in case of error, with errno set; errno is EBUSY if another
+ * process is using the file.
+ */
+struct baseline *
+open_baseline(const char * file_name)
+{
+	struct baseline * result = NULL;
+	const struct baseline_header * header;
+	struct baseline * baseline;
+	size_t name_size;
+	struct stat st;
+	int fd = -1;
+	uint8_t * map;
+	size_t map_size;
+
+	baseline = calloc(1,sizeof(*baseline));
+	if(baseline == NULL)
+		goto out;
+
+	baseline->fd = -1;
+	baseline->lock_fd = -1;
+
+	name_size = strlen(file_name) + sizeof(".journal");
+
+	baseline->file_name = strdup(file_name);
+	baseline->journal_name = malloc(name_size);
+	baseline->temporary_name = malloc(name_size);
+	baseline->lock_name = malloc(name_size);
+
+	if(baseline->file_name == NULL || baseline->journal_name == NULL || baseline->temporary_name == NULL || baseline->lock_name == NULL)
+		goto out;
+
+	snprintf(baseline->journal_name,name_size,"%s.journal",file_name);
+	snprintf(baseline->temporary_name,name_size,"%s.tmp",file_name);
+	snprintf(baseline->lock_name,name_size,"%s.lock",file_name);
+
+	/* Nothing else may touch the file, its journal or the new file
+	 * built when the table grows until the lock is released again.
+	 */
+	baseline->lock_fd = open(baseline->lock_name,O_RDWR|O_CREAT,0644);
+	if(baseline->lock_fd < 0)
+		goto out;
+
+	if(flock(baseline->lock_fd,LOCK_EX|LOCK_NB) < 0)
+	{
+		if(errno == EWOULDBLOCK)
+			errno = EBUSY;
+
+		goto out;
+	}
+
+	baseline->overlay_size = 64;
+
+	baseline->overlay = calloc(baseline->overlay_size,sizeof(*baseline->overlay));
+	if(baseline->overlay == NULL)
+		goto out;
+
+	fd = open(file_name,O_RDWR);
+	if(fd < 0)
+	{
+		if(errno != ENOENT)
+			goto out;
+
+		/* Start with an empty table. */
+		if(create_baseline_file(baseline->temporary_name,INITIAL_TABLE_SIZE,&fd,&map,&map_size) < 0)
+			goto out;
+
+		if(install_baseline_file(baseline,fd,map,map_size) < 0)
+		{
+			munmap(map,map_size);
+			goto out;
+		}
+	}
+	else
+	{
+		if(fstat(fd,&st) < 0)
+			goto out;
+
+		if(st.st_size < RECORD_SIZE)
+		{
+			errno = EINVAL;
+			goto out;
+		}
+
+		map_size = st.st_size;
+
+		map = mmap(NULL,map_size,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+		if(map == MAP_FAILED)
+			goto out;
+
+		baseline->fd = fd;
+		baseline->map = map;
+		baseline->map_size = map_size;
+
+		header = (const struct baseline_header *)map;
+
+		if(memcmp(header->magic,BASELINE_MAGIC,sizeof(header->magic)) != 0 ||
+		   header->version != BASELINE_VERSION ||
+		   header->table_size == 0 ||
+		   (header->table_size & (header->table_size - 1)) != 0 ||
+		   (1 + (size_t)header->table_size) * RECORD_SIZE != map_size)
+		{
+			errno = EINVAL;
+			goto out;
+		}
+
+		if(replay_journal(baseline) < 0)
+			goto out;
+	}
+
+	fd = -1;
+
+	result = baseline;
+	baseline = NULL;
+
+ out:
+
+	if(baseline != NULL)
+	{
+		int error = errno;
+
+		if(fd >= 0 && baseline->fd != fd)
+			close(fd);
+
+		close_baseline(baseline);
+
+		errno = error;
+	}
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Start a new run, in which the servers found will be recorded. The
+ * run number is counted in the header right away, so that it is never
+ * used again, even if the run does not finish. Returns -1 in case of
+ * error, with errno set, and 0 otherwise.
+ */
+int
+begin_baseline_run(struct baseline * baseline,time_t now)
+{
+	union baseline_record * record;
+	int result = -1;
+
+	record = write_record(baseline,0);
+	if(record == NULL)
+		goto out;
+
+	record->header.run_count++;
+
+	baseline->run_number = record->header.run_count;
+	baseline->now = now;
+	baseline->num_run_records = 0;
+
+	result = 0;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Copy a server record into its public form. */
+static void
+get_baseline_server(const struct baseline_entry * entry,struct baseline_server * server)
+{
+	memset(server,0,sizeof(*server));
+
+	memmove(server->server_ipv4_address,entry->server_ipv4_address,sizeof(server->server_ipv4_address));
+	memmove(server->server_mac_address,entry->server_mac_address,sizeof(server->server_mac_address));
+	memmove(server->interface_name,entry->interface_name,sizeof(entry->interface_name));
+
+	server->first_seen	= (time_t)entry->first_seen;
+	server->last_seen	= (time_t)entry->last_seen;
+	server->offer_hash	= entry->offer_hash;
+}
+
+/****************************************************************************/
+
+/* Record that a server was seen in the current run. Returns one of the
+ * BASELINE_STATUS_* values or -1 in case of error, with errno set. If
+ * the server was known already, what was previously known about it is
+ * filled in.
+ */
+int
+update_baseline_server(struct baseline * baseline,const uint8_t * server_ipv4_address,const uint8_t * server_mac_address,
+	const char * interface_name,uint64_t offer_hash,struct baseline_server * previous)
+{
+	const struct baseline_header * header;
+	union baseline_record * record;
+	struct baseline_entry * entry;
+	uint32_t record_number;
+	uint32_t * run_records;
+	uint32_t run_records_size;
+	int result = -1;
+	bool found;
+
+	assert( baseline->run_number > 0 );
+
+	if(strlen(interface_name) >= sizeof(entry->interface_name))
+	{
+		errno = ENAMETOOLONG;
+		goto out;
+	}
+
+	/* Make room for another record in the run chain. */
+	if(baseline->num_run_records == baseline->run_records_size)
+	{
+		run_records_size = (baseline->run_records_size > 0) ? 2 * baseline->run_records_size : 16;
+
+		run_records = realloc(baseline->run_records,run_records_size * sizeof(*run_records));
+		if(run_records == NULL)
+			goto out;
+
+		baseline->run_records = run_records;
+		baseline->run_records_size = run_records_size;
+	}
+
+	record_number = find_entry(baseline,server_ipv4_address,server_mac_address,interface_name,&found);
+	if(found)
+	{
+		record = write_record(baseline,record_number);
+		if(record == NULL)
+			goto out;
+
+		entry = &record->entry;
+
+		get_baseline_server(entry,previous);
+
+		result = (entry->offer_hash == offer_hash) ? BASELINE_STATUS_UNCHANGED : BASELINE_STATUS_CHANGED;
+	}
+	else
+	{
+		header = &read_record(baseline,0)->header;
+
+		/* Keep the table at most half full. */
+		if(2 * (header->num_entries + 1) > header->table_size)
+		{
+			if(grow_baseline(baseline) < 0)
+				goto out;
+
+			record_number = find_entry(baseline,server_ipv4_address,server_mac_address,interface_name,&found);
+		}
+
+		/* Note that write_record() may move the records it
+		 * returned before.
+		 */
+		record = write_record(baseline,0);
+		if(record == NULL)
+			goto out;
+
+		record->header.num_entries++;
+
+		record = write_record(baseline,record_number);
+		if(record == NULL)
+			goto out;
+
+		entry = &record->entry;
+
+		memset(entry,0,sizeof(*entry));
+
+		memmove(entry->server_ipv4_address,server_ipv4_address,sizeof(entry->server_ipv4_address));
+		memmove(entry->server_mac_address,server_mac_address,sizeof(entry->server_mac_address));
+		strcpy(entry->interface_name,interface_name);
+
+		entry->in_use = 1;
+		entry->first_seen = baseline->now;
+
+		memset(previous,0,sizeof(*previous));
+
+		result = BASELINE_STATUS_NEW;
+	}
+
+	/* The same server is added to the run chain only once. */
+	if(entry->run_number != baseline->run_number)
+		baseline->run_records[baseline->num_run_records++] = record_number;
+
+	entry->last_seen = baseline->now;
+	entry->offer_hash = offer_hash;
+	entry->run_number = baseline->run_number;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Finish the current run, reporting the servers which were seen in the
+ * previous run on one of the interfaces scanned but not in this one. The
+ * servers seen in this run replace those of the previous run in the run
+ * chain. Returns -1 in case of error, with errno set, and 0 otherwise.
+ */
+int
+finish_baseline_run(struct baseline * baseline,const char * const * interface_names,int num_interface_names,
+	baseline_vanished_callback callback,void * user_data)
+{
+	const struct baseline_header * header;
+	const struct baseline_entry * entry;
+	union baseline_record * record;
+	struct baseline_server server;
+	uint32_t * chain = NULL;
+	uint32_t chain_length = 0;
+	uint32_t chain_size;
+	uint32_t record_number;
+	bool scanned;
+	int result = -1;
+	uint32_t i;
+	int j;
+
+	header = &read_record(baseline,0)->header;
+
+	/* The chain cannot be longer than the table. */
+	chain_size = header->table_size + 1;
+
+	chain = malloc(chain_size * sizeof(*chain));
+	if(chain == NULL)
+		goto out;
+
+	/* Keep the servers of the previous run which were seen on other
+	 * interfaces. Those which were seen on the interfaces scanned but
+	 * not in this run have vanished.
+	 */
+	for(record_number = header->run_head ;
+		record_number != 0 && record_number <= header->table_size && chain_length < chain_size ;
+		record_number = entry->next_in_run)
+	{
+		entry = &read_record(baseline,record_number)->entry;
+
+		if(entry->run_number == baseline->run_number)
+			continue;
+
+		scanned = false;
+
+		for(j = 0 ; j < num_interface_names ; j++)
+		{
+			if(strncmp(entry->interface_name,interface_names[j],sizeof(entry->interface_name)) == 0)
+			{
+				scanned = true;
+				break;
+			}
+		}
+
+		if(scanned)
+		{
+			if(callback != NULL)
+			{
+				get_baseline_server(entry,&server);
+
+				(*callback)(&server,user_data);
+			}
+		}
+		else
+		{
+			chain[chain_length++] = record_number;
+		}
+	}
+
+	for(i = 0 ; i < baseline->num_run_records && chain_length < chain_size ; i++)
+		chain[chain_length++] = baseline->run_records[i];
+
+	/* Link the new chain together. */
+	for(i = 0 ; i < chain_length ; i++)
+	{
+		record = write_record(baseline,chain[i]);
+		if(record == NULL)
+			goto out;
+
+		record->entry.next_in_run = (i + 1 < chain_length) ? chain[i+1] : 0;
+	}
+
+	record = write_record(baseline,0);
+	if(record == NULL)
+		goto out;
+
+	record->header.run_head = (chain_length > 0) ? chain[0] : 0;
+	record->header.run_count = baseline->run_number;
+	record->header.last_run = baseline->now;
+
+	baseline->num_run_records = 0;
+
+	result = 0;
+
+ out:
+
+	if(chain != NULL)
+		free(chain);
+
+	return(result);
+}
@@ -0,0 +1,65 @@
+/*
+ * Persistent baseline of the DHCP servers seen in previous runs, stored
+ * in a memory-mapped file.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#ifndef _BASELINE_H
+#define _BASELINE_H
+
+/****************************************************************************/
+
+#include <net/if.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+/****************************************************************************/
+
+/* What the baseline knew about a server before it was updated. */
+enum
+{
+	BASELINE_STATUS_NONE=0,		/* No baseline in use */
+	BASELINE_STATUS_NEW,		/* Not seen before */
+	BASELINE_STATUS_CHANGED,	/* Seen before, offering something different */
+	BASELINE_STATUS_UNCHANGED	/* Seen before, offering the same */
+};
+
+/****************************************************************************/
+
+/* A server as recorded in the baseline. */
+struct baseline_server
+{
+	uint8_t		server_ipv4_address[4];
+	uint8_t		server_mac_address[6];
+	char		interface_name[IF_NAMESIZE];
+	time_t		first_seen;
+	time_t		last_seen;
+	uint64_t	offer_hash;
+};
+
+/****************************************************************************/
+
+struct baseline;
+
+/* Called for each server which was seen in the previous run on
+ * the same interface, but not in this run.
+ */
+typedef void (*baseline_vanished_callback)(const struct baseline_server *server, void *user_data);
+
+/****************************************************************************/
+
+struct baseline *open_baseline(const char *file_name);
+int close_baseline(struct baseline *baseline);
+int begin_baseline_run(struct baseline *baseline, time_t now);
+int update_baseline_server(struct baseline *baseline, const uint8_t *server_ipv4_address, const uint8_t *server_mac_address, const char *interface_name, uint64_t offer_hash, struct baseline_server *previous);
+int finish_baseline_run(struct baseline *baseline, const char * const *interface_names, int num_interface_names, baseline_vanished_callback callback, void *user_data);
+int commit_baseline(struct baseline *baseline);
+
+/****************************************************************************/
+
+#endif /* _BASELINE_H */
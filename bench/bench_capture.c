@@ -0,0 +1,664 @@
+/*
+ * Measure how fast each capture backend receives a stream of DHCP offers.
+ *
+ * The offers are sent through one network interface and received on
+ * another one, such as the two ends of a veth pair, using the same
+ * backend for both. By default the loopback interface is used for both,
+ * in which case every frame is captured twice, once on its way out and
+ * once on its way in. Each offer carries its own sequence number in the
+ * transaction ID, which is how frames captured more than once are told
+ * apart from frames which were lost.
+ *
+ * Then the wake-up latency of each backend is measured: one offer is sent
+ * at a time, and the time it takes until poll() wakes up and the offer
+ * is received is recorded. This is done in the default mode, in low
+ * latency mode and in low latency mode with busy polling, and the median,
+ * 99th percentile and maximum are reported for each.
+ *
+ * Opening a capture requires privileges; backends and modes which cannot
+ * be opened are skipped.
+ *
+ * Usage: bench_capture [transmit-interface [receive-interface]]
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <net/ethernet.h>
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <arpa/inet.h>
+
+#ifdef __linux__
+#define __FAVOR_BSD
+#endif /* __linux__ */
+#include <netinet/udp.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <time.h>
+
+#include <pthread.h>
+#include <unistd.h>
+#include <poll.h>
+
+/****************************************************************************/
+
+#include "capture_backend.h"
+#include "dhcp_protocol.h"
+
+/****************************************************************************/
+
+/* How many offers are sent through each backend. */
+#define NUM_FRAMES 200000
+
+/* How many offers are handed to the backend at a time. */
+#define BATCH_SIZE 64
+
+/* The size of the DHCP message, which is the smallest permitted. */
+#define DHCP_MESSAGE_SIZE 300
+
+#define FRAME_SIZE (sizeof(struct ether_header) + sizeof(struct ip) + sizeof(struct udphdr) + DHCP_MESSAGE_SIZE)
+
+/* The stream is over once nothing has arrived for this long (in milliseconds). */
+#define QUIET_TIME 200
+
+/* How many offers are sent one at a time to measure the wake-up latency. */
+#define NUM_LATENCY_SAMPLES 200
+
+/* How long (in milliseconds) to wait for each of these offers at most. */
+#define LATENCY_TIMEOUT 100
+
+/* How long (in microseconds) to busy-poll for, where this is tried. */
+#define BUSY_POLL_TIME 50
+
+/****************************************************************************/
+
+/* What the receiving end has seen. */
+struct receiver
+{
+	const struct capture_backend *	backend;
+	struct capture_handle *			handle;
+
+	uint8_t *		seen;				/* One bit for each sequence number */
+	long			num_received;		/* Distinct offers */
+	long			num_duplicates;		/* Offers captured more than once */
+	struct timespec	last_received;
+
+	double			cpu_time;			/* Seconds spent by the receiving thread */
+	bool			stop;
+	const char *	error;
+};
+
+/* The offer being waited for, one at a time. */
+struct latency_probe
+{
+	uint32_t		sequence;
+	bool			received;
+	struct timespec	when_received;
+};
+
+/* A way of opening the receiving end whose latency is measured. */
+struct latency_mode
+{
+	const char *			name;
+	struct capture_options	options;
+};
+
+/****************************************************************************/
+
+/* The one's complement checksum of the IP header. */
+static uint16_t
+get_ip_checksum(const void * data,int length)
+{
+	const uint16_t * word = data;
+	uint32_t sum = 0;
+
+	while(length > 1)
+	{
+		sum += (*word++);
+		length -= 2;
+	}
+
+	sum = (sum >> 16) + (sum & 0xffff);
+	sum += (sum >> 16);
+
+	return((uint16_t)~sum);
+}
+
+/****************************************************************************/
+
+/* Build a typical DHCP offer, broadcast by the server, with the given
+ * sequence number in its transaction ID.
+ */
+static void
+build_frame(uint8_t * frame,uint32_t sequence)
+{
+	static const uint8_t options[] =
+	{
+		OPTION_TYPE_DHCP_MESSAGE_TYPE,		1,	MESSAGE_TYPE_OFFER,
+		OPTION_TYPE_SERVER_IDENTIFIER,		4,	10,0,0,1,
+		OPTION_TYPE_IP_ADDRESS_LEASE_TIME,	4,	0,1,0x51,0x80,
+		OPTION_TYPE_SUBNET_MASK,			4,	255,255,255,0,
+		OPTION_TYPE_GATEWAY,				4,	10,0,0,1,
+		OPTION_TYPE_DNS,					8,	10,0,0,2,	10,0,0,3,
+		OPTION_TYPE_DOMAIN_NAME,			11,	'e','x','a','m','p','l','e','.','c','o','m',
+		OPTION_TYPE_END
+	};
+
+	static const uint8_t server_mac_address[ETHER_ADDR_LEN] = { 0x02, 0, 0, 0, 0, 1 };
+
+	struct ether_header * ethernet_header = (struct ether_header *)frame;
+	struct ip * ip_header = (struct ip *)&ethernet_header[1];
+	struct udphdr * udp_header = (struct udphdr *)&ip_header[1];
+	bootp_t * dhcp = (bootp_t *)&udp_header[1];
+
+	memset(frame,0,FRAME_SIZE);
+
+	memset(ethernet_header->ether_dhost,0xff,ETHER_ADDR_LEN);
+	memmove(ethernet_header->ether_shost,server_mac_address,ETHER_ADDR_LEN);
+	ethernet_header->ether_type = htons(ETHERTYPE_IP);
+
+	ip_header->ip_hl	= 5;
+	ip_header->ip_v		= IPVERSION;
+	ip_header->ip_len	= htons(sizeof(*ip_header) + sizeof(*udp_header) + DHCP_MESSAGE_SIZE);
+	ip_header->ip_ttl	= 64;
+	ip_header->ip_p		= IPPROTO_UDP;
+	ip_header->ip_src.s_addr = htonl(0x0a000001);
+	ip_header->ip_dst.s_addr = htonl(0xffffffff);
+	ip_header->ip_sum	= get_ip_checksum(ip_header,sizeof(*ip_header));
+
+	/* No UDP checksum is given. */
+	udp_header->uh_sport	= htons(DEFAULT_BOOTP_SERVER_PORT);
+	udp_header->uh_dport	= htons(DEFAULT_BOOTP_CLIENT_PORT);
+	udp_header->uh_ulen		= htons(sizeof(*udp_header) + DHCP_MESSAGE_SIZE);
+
+	dhcp->opcode		= BOOTREPLY;
+	dhcp->htype			= 1;
+	dhcp->hlen			= ETHER_ADDR_LEN;
+	dhcp->xid			= htonl(sequence);
+	dhcp->yiaddr		= htonl(0x0a000064);
+	dhcp->magic_cookie	= htonl(DHCP_MAGIC_COOKIE);
+
+	memmove(dhcp->vend,options,sizeof(options));
+}
+
+/****************************************************************************/
+
+/* Seconds elapsed between two points in time. */
+static double
+get_seconds_between(const struct timespec * from,const struct timespec * to)
+{
+	return((to->tv_sec - from->tv_sec) + (to->tv_nsec - from->tv_nsec) / 1e9);
+}
+
+/****************************************************************************/
+
+/* Count an offer captured, unless it is one of ours seen before. */
+static bool
+count_frame(const struct capture_frame * frame,void * user_data)
+{
+	struct receiver * receiver = user_data;
+	const bootp_t * dhcp;
+	uint32_t sequence;
+
+	if(frame->length >= FRAME_SIZE)
+	{
+		dhcp = (const bootp_t *)&frame->data[sizeof(struct ether_header) + sizeof(struct ip) + sizeof(struct udphdr)];
+
+		sequence = ntohl(dhcp->xid);
+
+		if(dhcp->magic_cookie == htonl(DHCP_MAGIC_COOKIE) && sequence < NUM_FRAMES)
+		{
+			if(receiver->seen[sequence / 8] & (1 << (sequence % 8)))
+			{
+				receiver->num_duplicates++;
+			}
+			else
+			{
+				receiver->seen[sequence / 8] |= (1 << (sequence % 8));
+				receiver->num_received++;
+			}
+		}
+	}
+
+	return(true);
+}
+
+/****************************************************************************/
+
+/* Keep receiving frames until told to stop. */
+static void *
+receive_frames(void * user_data)
+{
+	struct receiver * receiver = user_data;
+	struct timespec cpu_time;
+	struct pollfd pfd;
+	int n;
+
+	pfd.fd = (*receiver->backend->get_fd)(receiver->handle);
+	pfd.events = POLLIN;
+
+	while(!__atomic_load_n(&receiver->stop,__ATOMIC_ACQUIRE))
+	{
+		pfd.revents = 0;
+
+		/* Without a file descriptor, this checks every 10 milliseconds. */
+		if(poll(&pfd,1,10) < 0 && errno != EINTR)
+		{
+			receiver->error = strerror(errno);
+			break;
+		}
+
+		n = (*receiver->backend->receive)(receiver->handle,-1,count_frame,receiver);
+		if(n < 0)
+		{
+			receiver->error = (*receiver->backend->get_error)(receiver->handle);
+			break;
+		}
+
+		if(n > 0)
+			clock_gettime(CLOCK_MONOTONIC,&receiver->last_received);
+	}
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID,&cpu_time);
+
+	receiver->cpu_time = cpu_time.tv_sec + cpu_time.tv_nsec / 1e9;
+
+	return(NULL);
+}
+
+/****************************************************************************/
+
+/* Send the stream of offers through one backend and report how many of
+ * them were received, how fast, and at what cost. Returns -1 if the
+ * backend failed, and 0 otherwise, including if it was skipped.
+ */
+static int
+run_benchmark(const struct capture_backend * backend,const char * transmit_interface,const char * receive_interface)
+{
+	static uint8_t frames[BATCH_SIZE][FRAME_SIZE];
+	struct capture_frame batch[BATCH_SIZE];
+	struct capture_handle * transmit_handle = NULL;
+	struct capture_stats stats;
+	struct receiver receiver;
+	struct timespec started;
+	struct timespec now;
+	char error_buffer[CAPTURE_ERROR_SIZE];
+	pthread_t thread;
+	bool thread_running = false;
+	double seconds;
+	long num_sent = 0;
+	int result = -1;
+	int num_frames;
+	int n;
+	int i;
+
+	memset(&receiver,0,sizeof(receiver));
+
+	receiver.backend = backend;
+
+	receiver.seen = calloc((NUM_FRAMES + 7) / 8,1);
+	if(receiver.seen == NULL)
+	{
+		perror("calloc");
+		goto out;
+	}
+
+	receiver.handle = (*backend->open)(receive_interface,ETHER_MAX_LEN,NULL,error_buffer,sizeof(error_buffer));
+	if(receiver.handle == NULL)
+	{
+		printf("%s: skipped (%s)\n",backend->name,error_buffer);
+
+		result = 0;
+		goto out;
+	}
+
+	if((*backend->attach_filter)(receiver.handle,DEFAULT_BOOTP_CLIENT_PORT) < 0)
+	{
+		fprintf(stderr,"%s: %s\n",backend->name,(*backend->get_error)(receiver.handle));
+		goto out;
+	}
+
+	transmit_handle = (*backend->open)(transmit_interface,ETHER_MAX_LEN,NULL,error_buffer,sizeof(error_buffer));
+	if(transmit_handle == NULL)
+	{
+		printf("%s: skipped (%s)\n",backend->name,error_buffer);
+
+		result = 0;
+		goto out;
+	}
+
+	/* Nothing needs to be captured on the transmitting end, and no
+	 * UDP datagrams are sent from or to port 0.
+	 */
+	if((*backend->attach_filter)(transmit_handle,0) < 0)
+	{
+		fprintf(stderr,"%s: %s\n",backend->name,(*backend->get_error)(transmit_handle));
+		goto out;
+	}
+
+	errno = pthread_create(&thread,NULL,receive_frames,&receiver);
+	if(errno != 0)
+	{
+		perror("pthread_create");
+		goto out;
+	}
+
+	thread_running = true;
+
+	clock_gettime(CLOCK_MONOTONIC,&started);
+
+	receiver.last_received = started;
+
+	while(num_sent < NUM_FRAMES)
+	{
+		num_frames = (NUM_FRAMES - num_sent < BATCH_SIZE) ? (int)(NUM_FRAMES - num_sent) : BATCH_SIZE;
+
+		for(i = 0 ; i < num_frames ; i++)
+		{
+			build_frame(frames[i],(uint32_t)(num_sent + i));
+
+			batch[i].data	= frames[i];
+			batch[i].length	= FRAME_SIZE;
+		}
+
+		n = (*backend->transmit)(transmit_handle,batch,num_frames);
+		if(n < 0)
+		{
+			fprintf(stderr,"%s: %s\n",backend->name,(*backend->get_error)(transmit_handle));
+			goto out;
+		}
+
+		/* Frames which could not be sent are sent again. */
+		num_sent += n;
+	}
+
+	/* Wait for the stream to trickle in. */
+	do
+	{
+		usleep(QUIET_TIME * 1000 / 4);
+
+		clock_gettime(CLOCK_MONOTONIC,&now);
+
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	}
+	while(get_seconds_between(&receiver.last_received,&now) < QUIET_TIME / 1000.0 && receiver.num_received < NUM_FRAMES);
+
+	__atomic_store_n(&receiver.stop,true,__ATOMIC_RELEASE);
+
+	pthread_join(thread,NULL);
+	thread_running = false;
+
+	if(receiver.error != NULL)
+	{
+		fprintf(stderr,"%s: %s\n",backend->name,receiver.error);
+		goto out;
+	}
+
+	seconds = get_seconds_between(&started,&receiver.last_received);
+
+	printf("%s: %ld offers received of %ld sent, %.0f frames/s, %.0f ns CPU/frame, %.2f%% dropped",
+		backend->name,receiver.num_received,num_sent,
+		(seconds > 0) ? receiver.num_received / seconds : 0.0,
+		(receiver.num_received > 0) ? receiver.cpu_time * 1e9 / receiver.num_received : 0.0,
+		100.0 * (num_sent - receiver.num_received) / num_sent);
+
+	if((*backend->get_stats)(receiver.handle,&stats) == 0)
+		printf(" (%llu dropped by the kernel)",(unsigned long long)stats.dropped);
+
+	if(receiver.num_duplicates > 0)
+		printf(" (%ld captured twice)",receiver.num_duplicates);
+
+	printf("\n");
+
+	result = 0;
+
+ out:
+
+	if(thread_running)
+	{
+		__atomic_store_n(&receiver.stop,true,__ATOMIC_RELEASE);
+
+		pthread_join(thread,NULL);
+	}
+
+	if(transmit_handle != NULL)
+		(*backend->close)(transmit_handle);
+
+	if(receiver.handle != NULL)
+		(*backend->close)(receiver.handle);
+
+	free(receiver.seen);
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Note when the offer waited for has been received. */
+static bool
+note_probe(const struct capture_frame * frame,void * user_data)
+{
+	struct latency_probe * probe = user_data;
+	const bootp_t * dhcp;
+
+	if(!probe->received && frame->length >= FRAME_SIZE)
+	{
+		dhcp = (const bootp_t *)&frame->data[sizeof(struct ether_header) + sizeof(struct ip) + sizeof(struct udphdr)];
+
+		if(dhcp->magic_cookie == htonl(DHCP_MAGIC_COOKIE) && ntohl(dhcp->xid) == probe->sequence)
+		{
+			clock_gettime(CLOCK_MONOTONIC,&probe->when_received);
+			probe->received = true;
+		}
+	}
+
+	return(true);
+}
+
+/****************************************************************************/
+
+static int
+compare_doubles(const void * a,const void * b)
+{
+	double x = *(const double *)a;
+	double y = *(const double *)b;
+
+	return((x > y) - (x < y));
+}
+
+/****************************************************************************/
+
+/* Send one offer at a time through a backend, and measure how long it
+ * takes from sending it until poll() wakes up the receiving end and the
+ * offer is received, the way a scan waits for it. The offers are spaced
+ * out irregularly, so that they do not line up with any timer the
+ * capture may be waiting for. Returns -1 if the backend failed, and 0
+ * otherwise, including if the mode was skipped.
+ */
+static int
+measure_latency(const struct capture_backend * backend,const struct latency_mode * mode,
+	const char * transmit_interface,const char * receive_interface)
+{
+	static uint8_t frame[FRAME_SIZE];
+	static double latencies[NUM_LATENCY_SAMPLES];
+	struct capture_handle * receive_handle = NULL;
+	struct capture_handle * transmit_handle = NULL;
+	struct capture_frame batch;
+	struct latency_probe probe;
+	struct timespec sent;
+	struct timespec now;
+	struct pollfd pfd;
+	char error_buffer[CAPTURE_ERROR_SIZE];
+	int num_samples = 0;
+	int num_lost = 0;
+	int timeout;
+	int result = -1;
+	int i;
+
+	receive_handle = (*backend->open)(receive_interface,ETHER_MAX_LEN,&mode->options,error_buffer,sizeof(error_buffer));
+	if(receive_handle == NULL)
+	{
+		printf("%s (%s): skipped (%s)\n",backend->name,mode->name,error_buffer);
+
+		result = 0;
+		goto out;
+	}
+
+	if((*backend->attach_filter)(receive_handle,DEFAULT_BOOTP_CLIENT_PORT) < 0)
+	{
+		fprintf(stderr,"%s: %s\n",backend->name,(*backend->get_error)(receive_handle));
+		goto out;
+	}
+
+	transmit_handle = (*backend->open)(transmit_interface,ETHER_MAX_LEN,NULL,error_buffer,sizeof(error_buffer));
+	if(transmit_handle == NULL)
+	{
+		printf("%s (%s): skipped (%s)\n",backend->name,mode->name,error_buffer);
+
+		result = 0;
+		goto out;
+	}
+
+	if((*backend->attach_filter)(transmit_handle,0) < 0)
+	{
+		fprintf(stderr,"%s: %s\n",backend->name,(*backend->get_error)(transmit_handle));
+		goto out;
+	}
+
+	pfd.fd = (*backend->get_fd)(receive_handle);
+	pfd.events = POLLIN;
+
+	for(i = 0 ; i < NUM_LATENCY_SAMPLES ; i++)
+	{
+		/* Somewhere between 1 and 3 milliseconds apart. */
+		usleep(1000 + (i * 7919) % 2000);
+
+		memset(&probe,0,sizeof(probe));
+		probe.sequence = (uint32_t)i;
+
+		build_frame(frame,probe.sequence);
+
+		batch.data		= frame;
+		batch.length	= FRAME_SIZE;
+
+		clock_gettime(CLOCK_MONOTONIC,&sent);
+
+		if((*backend->transmit)(transmit_handle,&batch,1) < 0)
+		{
+			fprintf(stderr,"%s: %s\n",backend->name,(*backend->get_error)(transmit_handle));
+			goto out;
+		}
+
+		while(!probe.received)
+		{
+			clock_gettime(CLOCK_MONOTONIC,&now);
+
+			timeout = LATENCY_TIMEOUT - (int)(get_seconds_between(&sent,&now) * 1000);
+			if(timeout <= 0)
+				break;
+
+			/* Without a file descriptor, this checks every millisecond,
+			 * as a scan in low latency mode does.
+			 */
+			if(pfd.fd < 0)
+				timeout = 1;
+
+			pfd.revents = 0;
+
+			if(poll(&pfd,1,timeout) < 0 && errno != EINTR)
+			{
+				perror("poll");
+				goto out;
+			}
+
+			if((*backend->receive)(receive_handle,-1,note_probe,&probe) < 0)
+			{
+				fprintf(stderr,"%s: %s\n",backend->name,(*backend->get_error)(receive_handle));
+				goto out;
+			}
+		}
+
+		if(probe.received)
+			latencies[num_samples++] = get_seconds_between(&sent,&probe.when_received) * 1e6;
+		else
+			num_lost++;
+	}
+
+	printf("%s (%s): ",backend->name,mode->name);
+
+	if(num_samples > 0)
+	{
+		qsort(latencies,num_samples,sizeof(latencies[0]),compare_doubles);
+
+		printf("wake-up latency median %.0f us, 99th percentile %.0f us, maximum %.0f us",
+			latencies[num_samples / 2],latencies[(num_samples * 99) / 100],latencies[num_samples - 1]);
+	}
+	else
+	{
+		printf("no offers received");
+	}
+
+	printf(", %d of %d offers lost\n",num_lost,NUM_LATENCY_SAMPLES);
+
+	result = 0;
+
+ out:
+
+	if(transmit_handle != NULL)
+		(*backend->close)(transmit_handle);
+
+	if(receive_handle != NULL)
+		(*backend->close)(receive_handle);
+
+	return(result);
+}
+
+/****************************************************************************/
+
+int
+main(int argc,char ** argv)
+{
+	static const struct latency_mode latency_modes[] =
+	{
+		{ "default",						{ false, 0 } },
+		{ "low latency",					{ true, 0 } },
+		{ "low latency with busy polling",	{ true, BUSY_POLL_TIME } }
+	};
+
+	const struct capture_backend * backend;
+	const char * transmit_interface = "lo";
+	const char * receive_interface;
+	int result = EXIT_SUCCESS;
+	size_t j;
+	int i;
+
+	if(argc > 1)
+		transmit_interface = argv[1];
+
+	receive_interface = (argc > 2) ? argv[2] : transmit_interface;
+
+	for(i = 0 ; (backend = get_capture_backend(i)) != NULL ; i++)
+	{
+		if(run_benchmark(backend,transmit_interface,receive_interface) < 0)
+			result = EXIT_FAILURE;
+	}
+
+	for(i = 0 ; (backend = get_capture_backend(i)) != NULL ; i++)
+	{
+		for(j = 0 ; j < sizeof(latency_modes) / sizeof(latency_modes[0]) ; j++)
+		{
+			if(measure_latency(backend,&latency_modes[j],transmit_interface,receive_interface) < 0)
+				result = EXIT_FAILURE;
+		}
+	}
+
+	return(result);
+}
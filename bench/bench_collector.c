@@ -0,0 +1,240 @@
+/*
+ * Measure how many sensor reports the collector can merge per second,
+ * both directly and when the reports arrive over a Unix domain socket.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <stdio.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+
+/****************************************************************************/
+
+#include "collector.h"
+
+/****************************************************************************/
+
+/* Number of sensors simulated. */
+#define NUM_SENSORS 500
+
+/* Number of servers each sensor reports per scan. */
+#define NUM_RECORDS_PER_REPORT 4
+
+/* Number of reports merged directly. */
+#define NUM_DIRECT_REPORTS 1000000
+
+/* Number of reports sent over the socket. */
+#define NUM_SOCKET_REPORTS 50000
+
+/****************************************************************************/
+
+/* Fill in the report which a sensor sends for a scan. Most servers are
+ * seen by many sensors, as is the case for the legitimate ones, while a
+ * few are seen only by a single sensor.
+ */
+static void
+build_report(struct history_record * records,int sensor,int scan,char * sensor_name,size_t sensor_name_size)
+{
+	int i;
+
+	snprintf(sensor_name,sensor_name_size,"sensor-%03d",sensor);
+
+	memset(records,0,NUM_RECORDS_PER_REPORT * sizeof(*records));
+
+	for(i = 0 ; i < NUM_RECORDS_PER_REPORT ; i++)
+	{
+		records[i].time = 1000000000 + scan;
+
+		records[i].server_ipv4_address[0] = 10;
+		records[i].server_ipv4_address[1] = (i == 0) ? (uint8_t)(sensor >> 8) : 0;
+		records[i].server_ipv4_address[2] = (i == 0) ? (uint8_t)sensor : 0;
+		records[i].server_ipv4_address[3] = (uint8_t)(1 + (sensor + i) % 16);
+
+		records[i].server_mac_address[5] = records[i].server_ipv4_address[3];
+
+		strcpy(records[i].interface_name,"eth0");
+
+		records[i].offer_hash = i;
+	}
+}
+
+/****************************************************************************/
+
+/* Nanoseconds elapsed since the given time. */
+static double
+get_nanoseconds_since(const struct timespec * start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC,&now);
+
+	return((now.tv_sec - start->tv_sec) * 1e9 + (now.tv_nsec - start->tv_nsec));
+}
+
+/****************************************************************************/
+
+/* Ask the collector how many reports it merged so far. */
+static long
+get_number_of_reports(const char * socket_path)
+{
+	char * text = NULL;
+	size_t text_size = 0;
+	const char * s;
+	long result = -1;
+	FILE * out;
+
+	out = open_memstream(&text,&text_size);
+	if(out == NULL)
+		goto out;
+
+	if(query_collector(socket_path,out) < 0)
+	{
+		fclose(out);
+		goto out;
+	}
+
+	fclose(out);
+
+	s = strstr(text,"number-of-reports=");
+	if(s != NULL)
+		result = atol(s + strlen("number-of-reports="));
+
+ out:
+
+	if(text != NULL)
+		free(text);
+
+	return(result);
+}
+
+/****************************************************************************/
+
+int
+main(void)
+{
+	struct history_record records[NUM_RECORDS_PER_REPORT];
+	char sensor_name[COLLECTOR_SENSOR_NAME_SIZE];
+	struct collector * collector;
+	char socket_path[64];
+	struct timespec start;
+	double nanoseconds;
+	int result = EXIT_FAILURE;
+	pid_t pid = -1;
+	int n;
+
+	/* Merge reports without any communication overhead. */
+	collector = create_collector();
+	if(collector == NULL)
+	{
+		perror("create_collector");
+		goto out;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC,&start);
+
+	for(n = 0 ; n < NUM_DIRECT_REPORTS ; n++)
+	{
+		build_report(records,n % NUM_SENSORS,n / NUM_SENSORS,sensor_name,sizeof(sensor_name));
+
+		if(add_collector_report(collector,sensor_name,records,NUM_RECORDS_PER_REPORT) < 0)
+		{
+			perror("add_collector_report");
+			goto out;
+		}
+	}
+
+	nanoseconds = get_nanoseconds_since(&start);
+
+	printf("add_collector_report: %.0f reports/s (%.1f ns/report)\n",
+		NUM_DIRECT_REPORTS * 1e9 / nanoseconds,nanoseconds / NUM_DIRECT_REPORTS);
+
+	delete_collector(collector);
+	collector = NULL;
+
+	/* Now send the reports to a collector running in a separate
+	 * process, one connection per report, as the sensors do.
+	 */
+	snprintf(socket_path,sizeof(socket_path),"/tmp/bench_collector.%d",(int)getpid());
+
+	pid = fork();
+	if(pid < 0)
+	{
+		perror("fork");
+		goto out;
+	}
+
+	if(pid == 0)
+	{
+		collector = create_collector();
+		if(collector != NULL)
+			run_collector(collector,socket_path,false);
+
+		_exit(EXIT_FAILURE);
+	}
+
+	/* Wait for the collector to start listening. */
+	for(n = 0 ; get_number_of_reports(socket_path) < 0 ; n++)
+	{
+		if(n == 100)
+		{
+			fprintf(stderr,"Collector did not start.\n");
+			goto out;
+		}
+
+		usleep(10000);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC,&start);
+
+	for(n = 0 ; n < NUM_SOCKET_REPORTS ; n++)
+	{
+		build_report(records,n % NUM_SENSORS,n / NUM_SENSORS,sensor_name,sizeof(sensor_name));
+
+		if(send_collector_report(socket_path,sensor_name,records,NUM_RECORDS_PER_REPORT) < 0)
+		{
+			perror("send_collector_report");
+			goto out;
+		}
+	}
+
+	/* Wait until all reports have been merged. */
+	while((n = get_number_of_reports(socket_path)) < NUM_SOCKET_REPORTS)
+	{
+		if(n < 0)
+		{
+			perror("query_collector");
+			goto out;
+		}
+	}
+
+	nanoseconds = get_nanoseconds_since(&start);
+
+	printf("send_collector_report: %.0f reports/s (%.1f us/report)\n",
+		NUM_SOCKET_REPORTS * 1e9 / nanoseconds,nanoseconds / NUM_SOCKET_REPORTS / 1000.0);
+
+	result = EXIT_SUCCESS;
+
+ out:
+
+	if(pid > 0)
+	{
+		kill(pid,SIGTERM);
+		waitpid(pid,NULL,0);
+
+		unlink(socket_path);
+	}
+
+	delete_collector(collector);
+
+	return(result);
+}
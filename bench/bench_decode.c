@@ -0,0 +1,146 @@
+/*
+ * Measure how many DHCP offers per second a single core can decode,
+ * both into a struct dhcp_message and into readable form.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#include <arpa/inet.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+/****************************************************************************/
+
+#include "dhcp_message.h"
+#include "dhcp_offer.h"
+
+/****************************************************************************/
+
+/* How many offers are decoded into a struct dhcp_message. */
+#define NUM_MESSAGES 10000000
+
+/* How many offers are decoded into readable form. */
+#define NUM_OFFERS 200000
+
+/****************************************************************************/
+
+/* Build a typical DHCP offer. Returns the length of the message. */
+static int
+build_offer(bootp_t * dhcp)
+{
+	static const uint8_t options[] =
+	{
+		OPTION_TYPE_DHCP_MESSAGE_TYPE,		1,	MESSAGE_TYPE_OFFER,
+		OPTION_TYPE_SERVER_IDENTIFIER,		4,	10,0,0,1,
+		OPTION_TYPE_IP_ADDRESS_LEASE_TIME,	4,	0,1,0x51,0x80,
+		OPTION_TYPE_SUBNET_MASK,			4,	255,255,255,0,
+		OPTION_TYPE_GATEWAY,				4,	10,0,0,1,
+		OPTION_TYPE_DNS,					8,	10,0,0,2,	10,0,0,3,
+		OPTION_TYPE_DOMAIN_NAME,			11,	'e','x','a','m','p','l','e','.','c','o','m',
+		OPTION_TYPE_INTERFACE_MTU,			2,	0x05,0xdc,
+		OPTION_TYPE_NTP_SERVERS,			4,	10,0,0,4,
+		OPTION_TYPE_RENEWAL_TIME,			4,	0,0,0xa8,0xc0,
+		OPTION_TYPE_REBINDING_TIME,			4,	0,1,0x27,0x50,
+		OPTION_TYPE_END
+	};
+
+	memset(dhcp,0,sizeof(*dhcp));
+
+	dhcp->opcode = BOOTREPLY;
+	dhcp->xid = htonl(0x12345678);
+	dhcp->yiaddr = htonl(0x0a000064);
+	dhcp->magic_cookie = htonl(DHCP_MAGIC_COOKIE);
+
+	memmove(dhcp->vend,options,sizeof(options));
+
+	return(sizeof(*dhcp) + sizeof(options));
+}
+
+/****************************************************************************/
+
+/* Nanoseconds elapsed since the given time. */
+static double
+get_nanoseconds_since(const struct timespec * start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC,&now);
+
+	return((now.tv_sec - start->tv_sec) * 1e9 + (now.tv_nsec - start->tv_nsec));
+}
+
+/****************************************************************************/
+
+int
+main(void)
+{
+	static const uint8_t server_ipv4_address[4] = { 10, 0, 0, 1 };
+	static const uint8_t server_mac_address[6] = { 0x02, 0, 0, 0, 0, 1 };
+	static const uint8_t client_mac_address[6] = { 0x02, 0, 0, 0, 0, 2 };
+	struct dhcp_message message;
+	struct dhcp_offer * offer;
+	struct timespec start;
+	double nanoseconds;
+	bootp_t * dhcp;
+	int length;
+	long sum = 0;
+	int n;
+
+	dhcp = calloc(1,sizeof(*dhcp) + 312);
+	if(dhcp == NULL)
+	{
+		perror("calloc");
+		return(EXIT_FAILURE);
+	}
+
+	length = build_offer(dhcp);
+
+	clock_gettime(CLOCK_MONOTONIC,&start);
+
+	for(n = 0 ; n < NUM_MESSAGES ; n++)
+	{
+		if(decode_dhcp_message(&message,(const uint8_t *)dhcp,length) < 0)
+		{
+			fprintf(stderr,"decode_dhcp_message failed\n");
+			return(EXIT_FAILURE);
+		}
+
+		/* Make sure that the result is used. */
+		sum += message.dns_servers.count;
+	}
+
+	nanoseconds = get_nanoseconds_since(&start);
+
+	printf("decode_dhcp_message: %.1f ns/offer, %.0f offers/s (%ld)\n",
+		nanoseconds / NUM_MESSAGES,NUM_MESSAGES * 1e9 / nanoseconds,sum / NUM_MESSAGES);
+
+	clock_gettime(CLOCK_MONOTONIC,&start);
+
+	for(n = 0 ; n < NUM_OFFERS ; n++)
+	{
+		offer = create_dhcp_offer(server_ipv4_address,server_mac_address);
+		if(offer == NULL)
+		{
+			perror("create_dhcp_offer");
+			return(EXIT_FAILURE);
+		}
+
+		decode_dhcp_offer(offer,dhcp,length,client_mac_address,"eth0",client_mac_address);
+
+		delete_dhcp_offer(offer);
+	}
+
+	nanoseconds = get_nanoseconds_since(&start);
+
+	printf("decode_dhcp_offer: %.1f ns/offer, %.0f offers/s\n",
+		nanoseconds / NUM_OFFERS,NUM_OFFERS * 1e9 / nanoseconds);
+
+	free(dhcp);
+
+	return(EXIT_SUCCESS);
+}
@@ -0,0 +1,300 @@
+/*
+ * Measure how long a scan takes to process an offer, from the Ethernet
+ * frame to the recorded offer, for each category of offers written by
+ * make_offer_corpus. The frames are read from capture files and replayed
+ * to the scan, which means that neither a network interface nor any
+ * privileges are needed.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#include <sys/types.h>
+#include <net/ethernet.h>
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <arpa/inet.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <limits.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <time.h>
+
+/****************************************************************************/
+
+#include "dhcp_scan.h"
+#include "savefile.h"
+#include "replay_backend.h"
+
+/****************************************************************************/
+
+/* Where make_offer_corpus writes the files by default. */
+#define DEFAULT_CORPUS_DIRECTORY "bench/corpus"
+
+/* How many frames are processed by each scan. */
+#define FRAMES_PER_SCAN 64
+
+/* How long each category is measured (in seconds). */
+#define MEASUREMENT_TIME 0.5
+
+/****************************************************************************/
+
+/* Nanoseconds elapsed since the given time. */
+static double
+get_nanoseconds_since(const struct timespec * start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC,&now);
+
+	return((now.tv_sec - start->tv_sec) * 1e9 + (now.tv_nsec - start->tv_nsec));
+}
+
+/****************************************************************************/
+
+/* Find the DHCP message carried by the first frame which holds one. The
+ * scan has to use its transaction number and client hardware address.
+ */
+static const bootp_t *
+find_first_message(const struct savefile * file)
+{
+	const struct ether_header * ethernet_frame;
+	const struct ip * ip_packet;
+	const bootp_t * result = NULL;
+	size_t header_length;
+	int i;
+
+	for(i = 0 ; i < file->num_frames ; i++)
+	{
+		ethernet_frame = (const struct ether_header *)file->frames[i].data;
+		if(file->frames[i].length < sizeof(*ethernet_frame) + sizeof(*ip_packet) || ntohs(ethernet_frame->ether_type) != ETHERTYPE_IP)
+			continue;
+
+		ip_packet = (const struct ip *)&ethernet_frame[1];
+		header_length = sizeof(*ethernet_frame) + ip_packet->ip_hl * 4 + 8;
+
+		if(ip_packet->ip_p == IPPROTO_UDP && file->frames[i].length >= header_length + offsetof(bootp_t,vend))
+		{
+			result = (const bootp_t *)&file->frames[i].data[header_length];
+			break;
+		}
+	}
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Process the offers stored in a file over and over again for a while,
+ * and report how long each one took. Returns -1 in case of error, and
+ * 0 otherwise.
+ */
+static int
+measure_file(const char * file_name)
+{
+	char error_buffer[CAPTURE_ERROR_SIZE];
+	struct dhcp_scan_options options;
+	struct dhcp_scan * scan = NULL;
+	char category[NAME_MAX+1];
+	struct savefile file;
+	const bootp_t * dhcp;
+	struct timespec start;
+	double nanoseconds = 0;
+	long num_frames = 0;
+	long num_recorded = 0;
+	const char * s;
+	int result = -1;
+
+	memset(&file,0,sizeof(file));
+
+	/* The category is the name of the file, without the path and
+	 * the extension.
+	 */
+	s = strrchr(file_name,'/');
+	snprintf(category,sizeof(category),"%s",(s != NULL) ? s+1 : file_name);
+
+	if(strlen(category) > 5 && strcmp(&category[strlen(category)-5],".pcap") == 0)
+		category[strlen(category)-5] = '\0';
+
+	if(read_savefile(file_name,&file,error_buffer,sizeof(error_buffer)) < 0)
+	{
+		fprintf(stderr,"Could not read '%s' (%s).\n",file_name,error_buffer);
+		goto out;
+	}
+
+	dhcp = find_first_message(&file);
+	if(dhcp == NULL)
+	{
+		fprintf(stderr,"'%s' does not contain any DHCP messages.\n",file_name);
+		goto out;
+	}
+
+	memset(&options,0,sizeof(options));
+
+	options.capture_backend			= &replay_capture_backend;
+	options.interface_mac_address	= dhcp->chaddr;
+	options.interface_mtu			= ETHERMTU;
+	options.defer_capture			= true;
+
+	set_replay_frames(file.frames,file.num_frames,FRAMES_PER_SCAN);
+
+	scan = open_dhcp_scan("replay",&options,error_buffer,sizeof(error_buffer));
+	if(scan == NULL)
+	{
+		fprintf(stderr,"Could not set up the scan (%s).\n",error_buffer);
+		goto out;
+	}
+
+	/* Only the time it takes to process the frames counts, not the time
+	 * it takes to start the scan and to discard the offers recorded.
+	 */
+	while(nanoseconds < MEASUREMENT_TIME * 1e9)
+	{
+		if(start_dhcp_scan(scan,ntohl(dhcp->xid),0) < 0)
+		{
+			fprintf(stderr,"Could not start the scan (%s).\n",get_dhcp_scan_error(scan));
+			goto out;
+		}
+
+		clock_gettime(CLOCK_MONOTONIC,&start);
+
+		dispatch_dhcp_scan(scan);
+
+		nanoseconds += get_nanoseconds_since(&start);
+
+		num_frames += FRAMES_PER_SCAN;
+		num_recorded += get_dhcp_scan_num_offers(scan);
+	}
+
+	printf("dhcp_input %s: %.1f ns/offer, %.0f offers/s, %.0f%% recorded\n",
+		category,nanoseconds / num_frames,num_frames * 1e9 / nanoseconds,100.0 * num_recorded / num_frames);
+
+	result = 0;
+
+ out:
+
+	close_dhcp_scan(scan);
+
+	free_savefile(&file);
+
+	return(result);
+}
+
+/****************************************************************************/
+
+static int
+compare_names(const void * a,const void * b)
+{
+	return(strcmp(*(const char **)a,*(const char **)b));
+}
+
+/****************************************************************************/
+
+/* Measure every file found in the directory. Returns -1 in case of
+ * error, and 0 otherwise.
+ */
+static int
+measure_directory(const char * directory)
+{
+	char file_name[PATH_MAX];
+	char ** names = NULL;
+	char ** new_names;
+	int num_names = 0;
+	struct dirent * entry;
+	DIR * dir;
+	size_t length;
+	int result = -1;
+	int i;
+
+	dir = opendir(directory);
+	if(dir == NULL)
+	{
+		fprintf(stderr,"Could not open '%s'; enter 'bench/make_offer_corpus %s' first.\n",directory,directory);
+		goto out;
+	}
+
+	while((entry = readdir(dir)) != NULL)
+	{
+		length = strlen(entry->d_name);
+		if(length <= 5 || strcmp(&entry->d_name[length-5],".pcap") != 0)
+			continue;
+
+		new_names = realloc(names,(num_names + 1) * sizeof(*names));
+		if(new_names == NULL)
+		{
+			perror("realloc");
+			goto out;
+		}
+
+		names = new_names;
+
+		names[num_names] = strdup(entry->d_name);
+		if(names[num_names] == NULL)
+		{
+			perror("strdup");
+			goto out;
+		}
+
+		num_names++;
+	}
+
+	/* The categories should always show up in the same order. */
+	qsort(names,num_names,sizeof(*names),compare_names);
+
+	for(i = 0 ; i < num_names ; i++)
+	{
+		snprintf(file_name,sizeof(file_name),"%s/%s",directory,names[i]);
+
+		if(measure_file(file_name) < 0)
+			goto out;
+	}
+
+	result = 0;
+
+ out:
+
+	if(dir != NULL)
+		closedir(dir);
+
+	if(names != NULL)
+	{
+		for(i = 0 ; i < num_names ; i++)
+			free(names[i]);
+
+		free(names);
+	}
+
+	return(result);
+}
+
+/****************************************************************************/
+
+int
+main(int argc,char ** argv)
+{
+	int i;
+
+	/* Measure the files given, or all the files which make_offer_corpus
+	 * wrote by default.
+	 */
+	if(argc > 1)
+	{
+		for(i = 1 ; i < argc ; i++)
+		{
+			if(measure_file(argv[i]) < 0)
+				return(EXIT_FAILURE);
+		}
+	}
+	else
+	{
+		if(measure_directory(DEFAULT_CORPUS_DIRECTORY) < 0)
+			return(EXIT_FAILURE);
+	}
+
+	return(EXIT_SUCCESS);
+}
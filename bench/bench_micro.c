@@ -0,0 +1,793 @@
+/*
+ * Measure the decoding functions one at a time, as well as the receive
+ * path of a scan as a whole, on fixed inputs. For each function, the time
+ * and the number of memory allocations per call are reported and compared
+ * against a baseline recorded earlier. If any function became slower than
+ * the tolerance permits, or allocates more memory than it used to, the
+ * benchmark fails.
+ *
+ *     bench_micro [--baseline=<file>] [--tolerance=<percent>] [--update]
+ *
+ * With --update, the results are written to the baseline file instead.
+ * Memory allocations can only be counted if the C runtime library is
+ * glibc; elsewhere, they are neither reported nor compared.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <net/ethernet.h>
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <arpa/inet.h>
+
+#ifdef __linux__
+/* This makes the 'struct udphdr' use the same
+ * field names as used in the BSD header files.
+ */
+#define __FAVOR_BSD
+#endif /* __linux__ */
+#include <netinet/udp.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <time.h>
+
+#include <getopt.h>
+
+/****************************************************************************/
+
+#include "dhcp_protocol.h"
+#include "dhcp_decode.h"
+#include "dhcp_frame.h"
+#include "dhcp_scan.h"
+#include "replay_backend.h"
+
+/****************************************************************************/
+
+/* Where the baseline is kept, unless told otherwise. */
+#define DEFAULT_BASELINE_FILE "bench/micro_baseline.txt"
+
+/* How much slower (in percent) than the baseline a function may be
+ * before this counts as a regression. Timing varies from one run to
+ * the next, which is why some slack is needed.
+ */
+#define DEFAULT_TOLERANCE 50
+
+/* How long (in nanoseconds) each measurement should take at least. */
+#define MINIMUM_MEASUREMENT_TIME 20000000.0
+
+/* How many times each function is measured; the fastest run counts. */
+#define NUM_MEASUREMENTS 5
+
+/* How many different offers the scan receives. */
+#define NUM_FRAMES 64
+
+/* Most benchmarks in the baseline file. */
+#define MAX_BASELINE_ENTRIES 64
+
+/****************************************************************************/
+
+/* A function to measure. Each iteration stands for 'ops_per_iteration'
+ * calls of the function.
+ */
+struct benchmark
+{
+	const char *	name;
+	void			(*run)(long iterations);
+	int				ops_per_iteration;
+};
+
+/* What was measured for a function. */
+struct result
+{
+	char	name[64];
+	double	nanoseconds;	/* Per call */
+	double	allocations;	/* Per call; negative if not known */
+};
+
+/****************************************************************************/
+
+const char * command_name;
+
+/* Keeps the compiler from optimizing away what is being measured. */
+static volatile unsigned long sink;
+
+/* The inputs of the functions measured. */
+static uint8_t typical_options[256];
+static int typical_options_length;
+static uint8_t domain_search_options[256];
+static int domain_search_options_length;
+static uint8_t classless_routes[64];
+static int classless_routes_length;
+static uint8_t static_routes[64];
+static int static_routes_length;
+
+static uint8_t frames[NUM_FRAMES][ETHER_MAX_LEN];
+static struct capture_frame frame_list[NUM_FRAMES];
+
+static struct dhcp_scan * scan;
+
+/****************************************************************************/
+
+#if defined(__GLIBC__)
+
+/* Count every memory allocation by replacing the allocator functions
+ * with our own, which call those which the C runtime library provides.
+ */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t num_elements, size_t element_size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void __libc_free(void *ptr);
+
+static unsigned long num_allocations;
+
+void *
+malloc(size_t size)
+{
+	num_allocations++;
+
+	return(__libc_malloc(size));
+}
+
+void *
+calloc(size_t num_elements,size_t element_size)
+{
+	num_allocations++;
+
+	return(__libc_calloc(num_elements,element_size));
+}
+
+void *
+realloc(void * ptr,size_t size)
+{
+	num_allocations++;
+
+	return(__libc_realloc(ptr,size));
+}
+
+void
+free(void * ptr)
+{
+	__libc_free(ptr);
+}
+
+#define ALLOCATIONS_COUNTED true
+
+#else
+
+static unsigned long num_allocations;
+
+#define ALLOCATIONS_COUNTED false
+
+#endif /* __GLIBC__ */
+
+/****************************************************************************/
+
+/* Nanoseconds elapsed since the given time. */
+static double
+get_nanoseconds_since(const struct timespec * start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC,&now);
+
+	return((now.tv_sec - start->tv_sec) * 1e9 + (now.tv_nsec - start->tv_nsec));
+}
+
+/****************************************************************************/
+
+/* Set up the inputs for the functions to be measured. */
+static void
+set_up_inputs(void)
+{
+	/* A domain search list with compressed names, spread across three
+	 * options (RFC 3396).
+	 */
+	static const uint8_t domain_search[] =
+	{
+		7,'e','x','a','m','p','l','e',3,'c','o','m',0,
+		3,'e','n','g',0xc0,0,
+		3,'l','a','b',0xc0,13,
+		4,'c','o','r','p',7,'e','x','a','m','p','l','e',3,'n','e','t',0,
+		5,'s','t','o','r','e',0xc0,25
+	};
+
+	static const uint8_t classless_route_data[] =
+	{
+		0,					10,0,0,1,
+		8,	10,				10,0,0,1,
+		16,	10,1,			10,0,0,1,
+		20,	10,2,16,		10,0,0,1,
+		24,	10,3,4,			10,0,0,1,
+		32,	10,5,6,7,		10,0,0,1
+	};
+
+	static const uint8_t lease_time[4]		= { 0, 1, 0x51, 0x80 };
+	static const uint8_t subnet_mask[4]		= { 255, 255, 255, 0 };
+	static const uint8_t router[4]			= { 10, 0, 0, 1 };
+	static const uint8_t dns_servers[8]		= { 10, 0, 0, 2, 10, 0, 0, 3 };
+	static const char domain_name[]			= "example.com";
+	static const uint8_t broadcast_mac_address[ETHER_ADDR_LEN] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+	static const uint8_t client_mac_address[ETHER_ADDR_LEN] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+
+	uint8_t message_type = MESSAGE_TYPE_OFFER;
+	uint8_t server_mac_address[ETHER_ADDR_LEN];
+	struct ip * ip_header;
+	struct udphdr * udp_header;
+	ip4_t server_address;
+	bootp_t * dhcp;
+	int len;
+	int i;
+
+	/* The options of a typical offer, from a server which puts the
+	 * DHCP message type last.
+	 */
+	len = 0;
+	len += fill_dhcp_option(&typical_options[len], OPTION_TYPE_IP_ADDRESS_LEASE_TIME, lease_time, sizeof(lease_time));
+	len += fill_dhcp_option(&typical_options[len], OPTION_TYPE_SUBNET_MASK, subnet_mask, sizeof(subnet_mask));
+	len += fill_dhcp_option(&typical_options[len], OPTION_TYPE_GATEWAY, router, sizeof(router));
+	len += fill_dhcp_option(&typical_options[len], OPTION_TYPE_DNS, dns_servers, sizeof(dns_servers));
+	len += fill_dhcp_option(&typical_options[len], OPTION_TYPE_DOMAIN_NAME, domain_name, sizeof(domain_name)-1);
+	len += fill_dhcp_option(&typical_options[len], OPTION_TYPE_SERVER_IDENTIFIER, router, sizeof(router));
+	len += fill_dhcp_option(&typical_options[len], OPTION_TYPE_DHCP_MESSAGE_TYPE, &message_type, sizeof(message_type));
+	len += fill_dhcp_option(&typical_options[len], OPTION_TYPE_END, NULL, 0);
+	typical_options_length = len;
+
+	len = 0;
+	len += fill_dhcp_option(&domain_search_options[len], OPTION_TYPE_DHCP_MESSAGE_TYPE, &message_type, sizeof(message_type));
+	len += fill_dhcp_option(&domain_search_options[len], OPTION_TYPE_DOMAIN_SEARCH, &domain_search[0], 10);
+	len += fill_dhcp_option(&domain_search_options[len], OPTION_TYPE_SERVER_IDENTIFIER, router, sizeof(router));
+	len += fill_dhcp_option(&domain_search_options[len], OPTION_TYPE_DOMAIN_SEARCH, &domain_search[10], 20);
+	len += fill_dhcp_option(&domain_search_options[len], OPTION_TYPE_DOMAIN_SEARCH, &domain_search[30], sizeof(domain_search) - 30);
+	len += fill_dhcp_option(&domain_search_options[len], OPTION_TYPE_END, NULL, 0);
+	domain_search_options_length = len;
+
+	memmove(classless_routes,classless_route_data,sizeof(classless_route_data));
+	classless_routes_length = sizeof(classless_route_data);
+
+	/* Four routes, as decode_static_route() expects them. */
+	for(len = i = 0 ; i < 4 ; i++)
+	{
+		static_routes[len++] = 1;
+		static_routes[len++] = 10;
+		static_routes[len++] = 1 + i;
+		static_routes[len++] = 0;
+		static_routes[len++] = 0;
+		memmove(&static_routes[len],router,sizeof(router));
+		len += sizeof(router);
+	}
+
+	static_routes_length = len;
+
+	/* Offers from as many different servers as there are frames, so
+	 * that every one of them gets recorded.
+	 */
+	for(i = 0 ; i < NUM_FRAMES ; i++)
+	{
+		ip_header = (struct ip *)&frames[i][sizeof(struct ether_header)];
+		udp_header = (struct udphdr *)&ip_header[1];
+		dhcp = (bootp_t *)&udp_header[1];
+
+		server_address = htonl(0x0a000001 + i);
+
+		memset(server_mac_address,0,sizeof(server_mac_address));
+		server_mac_address[0] = 0x02;
+		server_mac_address[5] = 1 + i;
+
+		len = 0;
+		len += fill_dhcp_option(&dhcp->vend[len], OPTION_TYPE_DHCP_MESSAGE_TYPE, &message_type, sizeof(message_type));
+		len += fill_dhcp_option(&dhcp->vend[len], OPTION_TYPE_SERVER_IDENTIFIER, &server_address, sizeof(server_address));
+		len += fill_dhcp_option(&dhcp->vend[len], OPTION_TYPE_IP_ADDRESS_LEASE_TIME, lease_time, sizeof(lease_time));
+		len += fill_dhcp_option(&dhcp->vend[len], OPTION_TYPE_SUBNET_MASK, subnet_mask, sizeof(subnet_mask));
+		len += fill_dhcp_option(&dhcp->vend[len], OPTION_TYPE_GATEWAY, &server_address, sizeof(server_address));
+		len += fill_dhcp_option(&dhcp->vend[len], OPTION_TYPE_DNS, dns_servers, sizeof(dns_servers));
+		len += fill_dhcp_option(&dhcp->vend[len], OPTION_TYPE_DOMAIN_NAME, domain_name, sizeof(domain_name)-1);
+		len += fill_dhcp_option(&dhcp->vend[len], OPTION_TYPE_END, NULL, 0);
+
+		dhcp->opcode = BOOTREPLY;
+		dhcp->htype = BOOTP_HARDWARE_TYPE_10_ETHERNET;
+		dhcp->hlen = ETHER_ADDR_LEN;
+		dhcp->xid = htonl(0x12345678);
+		dhcp->flags = htons(0x8000);
+		dhcp->yiaddr = htonl(0x0a000064);
+		memmove(dhcp->chaddr, client_mac_address, ETHER_ADDR_LEN);
+		dhcp->magic_cookie = htonl(DHCP_MAGIC_COOKIE);
+
+		len += sizeof(*dhcp);
+		if(len < 300)
+			len = 300;
+
+		len = udp_output(ip_header, server_address, 0xFFFFFFFF, udp_header, DEFAULT_BOOTP_SERVER_PORT, DEFAULT_BOOTP_CLIENT_PORT, len);
+		len = ip_output(ip_header, server_address, 0xFFFFFFFF, len);
+		len = ether_output(frames[i], server_mac_address, broadcast_mac_address, len);
+
+		frame_list[i].data = frames[i];
+		frame_list[i].length = len;
+	}
+}
+
+/****************************************************************************/
+
+static void
+run_in_cksum(long iterations)
+{
+	const struct ip * ip_header = (const struct ip *)&frames[0][sizeof(struct ether_header)];
+	int length = ntohs(ip_header->ip_len);
+	unsigned long sum = 0;
+	long n;
+
+	for(n = 0 ; n < iterations ; n++)
+		sum += in_cksum(ip_header,length);
+
+	sink = sum;
+}
+
+/****************************************************************************/
+
+static void
+run_get_dhcp_message_type(long iterations)
+{
+	unsigned long sum = 0;
+	long n;
+
+	for(n = 0 ; n < iterations ; n++)
+		sum += get_dhcp_message_type(typical_options,typical_options_length);
+
+	sink = sum;
+}
+
+/****************************************************************************/
+
+static void
+run_fill_aggregate_buffer_from_option(long iterations)
+{
+	uint8_t * buffer;
+	size_t buffer_size;
+	unsigned long sum = 0;
+	long n;
+
+	for(n = 0 ; n < iterations ; n++)
+	{
+		if(fill_aggregate_buffer_from_option(domain_search_options,domain_search_options_length,
+			OPTION_TYPE_DOMAIN_SEARCH,&buffer,&buffer_size))
+		{
+			sum += buffer_size;
+
+			free(buffer);
+		}
+	}
+
+	sink = sum;
+}
+
+/****************************************************************************/
+
+static void
+run_decode_domain_search(long iterations)
+{
+	char text_buffer[1500];
+	unsigned long sum = 0;
+	long n;
+
+	for(n = 0 ; n < iterations ; n++)
+	{
+		if(decode_domain_search(domain_search_options,domain_search_options_length,
+			OPTION_TYPE_DOMAIN_SEARCH,text_buffer,sizeof(text_buffer)))
+		{
+			sum += text_buffer[0];
+		}
+	}
+
+	sink = sum;
+}
+
+/****************************************************************************/
+
+static void
+run_decode_classless_static_route(long iterations)
+{
+	char text_buffer[1500];
+	unsigned long sum = 0;
+	long n;
+
+	for(n = 0 ; n < iterations ; n++)
+		sum += decode_classless_static_route(classless_routes,classless_routes_length,text_buffer,sizeof(text_buffer));
+
+	sink = sum;
+}
+
+/****************************************************************************/
+
+static void
+run_decode_static_route(long iterations)
+{
+	char text_buffer[1500];
+	unsigned long sum = 0;
+	long n;
+
+	for(n = 0 ; n < iterations ; n++)
+		sum += decode_static_route(static_routes,static_routes_length,text_buffer,sizeof(text_buffer));
+
+	sink = sum;
+}
+
+/****************************************************************************/
+
+static void
+run_convert_seconds_to_readable_form(long iterations)
+{
+	static const uint32_t seconds[4] = { 45, 90, 3 * 3600 + 25 * 60, 8 * 86400 + 3600 };
+	char text_buffer[256];
+	unsigned long sum = 0;
+	long n;
+
+	for(n = 0 ; n < iterations ; n++)
+	{
+		convert_seconds_to_readable_form(seconds[n % 4],text_buffer,sizeof(text_buffer));
+
+		sum += text_buffer[0];
+	}
+
+	sink = sum;
+}
+
+/****************************************************************************/
+
+/* Each iteration is a scan which receives one offer from each server. */
+static void
+run_dhcp_input(long iterations)
+{
+	unsigned long sum = 0;
+	long n;
+
+	for(n = 0 ; n < iterations ; n++)
+	{
+		start_dhcp_scan(scan,0x12345678,0);
+		dispatch_dhcp_scan(scan);
+
+		sum += get_dhcp_scan_num_offers(scan);
+	}
+
+	sink = sum;
+}
+
+/****************************************************************************/
+
+static const struct benchmark benchmarks[] =
+{
+	{ "in_cksum",							run_in_cksum,							1 },
+	{ "get_dhcp_message_type",				run_get_dhcp_message_type,				1 },
+	{ "fill_aggregate_buffer_from_option",	run_fill_aggregate_buffer_from_option,	1 },
+	{ "decode_domain_search",				run_decode_domain_search,				1 },
+	{ "decode_classless_static_route",		run_decode_classless_static_route,		1 },
+	{ "decode_static_route",				run_decode_static_route,				1 },
+	{ "convert_seconds_to_readable_form",	run_convert_seconds_to_readable_form,	1 },
+	{ "dhcp_input",							run_dhcp_input,							NUM_FRAMES },
+	{ NULL,									NULL,									0 }
+};
+
+/****************************************************************************/
+
+/* Measure a function, first finding out how often it needs to be called
+ * for a measurement to take long enough.
+ */
+static void
+measure(const struct benchmark * benchmark,struct result * result)
+{
+	struct timespec start;
+	unsigned long allocations;
+	double nanoseconds;
+	long iterations;
+	int i;
+
+	snprintf(result->name,sizeof(result->name),"%s",benchmark->name);
+
+	for(iterations = 1 ; ; iterations *= 2)
+	{
+		clock_gettime(CLOCK_MONOTONIC,&start);
+
+		(*benchmark->run)(iterations);
+
+		if(get_nanoseconds_since(&start) >= MINIMUM_MEASUREMENT_TIME)
+			break;
+	}
+
+	result->nanoseconds = 0;
+
+	for(i = 0 ; i < NUM_MEASUREMENTS ; i++)
+	{
+		allocations = num_allocations;
+
+		clock_gettime(CLOCK_MONOTONIC,&start);
+
+		(*benchmark->run)(iterations);
+
+		nanoseconds = get_nanoseconds_since(&start) / ((double)iterations * benchmark->ops_per_iteration);
+
+		if(i == 0 || nanoseconds < result->nanoseconds)
+			result->nanoseconds = nanoseconds;
+
+		if(ALLOCATIONS_COUNTED)
+			result->allocations = (num_allocations - allocations) / ((double)iterations * benchmark->ops_per_iteration);
+		else
+			result->allocations = -1;
+	}
+}
+
+/****************************************************************************/
+
+/* Read the results recorded earlier. Returns the number of results read,
+ * or -1 if the file could not be read.
+ */
+static int
+read_baseline(const char * file_name,struct result * baseline,int max_results)
+{
+	char line[256];
+	int num_results = 0;
+	int result = -1;
+	FILE * in;
+
+	in = fopen(file_name,"r");
+	if(in == NULL)
+		goto out;
+
+	while(fgets(line,sizeof(line),in) != NULL && num_results < max_results)
+	{
+		if(line[0] == '#')
+			continue;
+
+		if(sscanf(line,"%63s %lf %lf",baseline[num_results].name,
+			&baseline[num_results].nanoseconds,&baseline[num_results].allocations) == 3)
+		{
+			num_results++;
+		}
+	}
+
+	fclose(in);
+
+	result = num_results;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Record the results, to be compared against later. Returns -1 in case of
+ * error, and 0 otherwise.
+ */
+static int
+write_baseline(const char * file_name,const struct result * results,int num_results)
+{
+	int result = -1;
+	FILE * out;
+	int i;
+
+	out = fopen(file_name,"w");
+	if(out == NULL)
+		goto out;
+
+	fprintf(out,"# Written by 'make bench-baseline'. Each line gives the name of a\n");
+	fprintf(out,"# function, how long it took (in nanoseconds) and how many memory\n");
+	fprintf(out,"# allocations it made per call, or -1 if these were not counted.\n");
+
+	for(i = 0 ; i < num_results ; i++)
+		fprintf(out,"%s %.1f %.2f\n",results[i].name,results[i].nanoseconds,results[i].allocations);
+
+	if(fclose(out) != 0)
+		goto out;
+
+	result = 0;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+static void
+print_usage(void)
+{
+	printf("Usage: %s "
+		"[--baseline=<file>] "
+		"[--tolerance=<percent>] "
+		"[--update] "
+		"[--help]\n",
+		command_name);
+}
+
+/****************************************************************************/
+
+int
+main(int argc,char ** argv)
+{
+	static const struct option longopts[] =
+	{
+		{ "baseline",	required_argument,	NULL,	'b'	},
+		{ "help",		no_argument,		NULL,	'h'	},
+		{ "tolerance",	required_argument,	NULL,	't'	},
+		{ "update",		no_argument,		NULL,	'u'	},
+		{ NULL,			0,					NULL,	0	}
+	};
+
+	struct result results[sizeof(benchmarks) / sizeof(benchmarks[0])];
+	struct result baseline[MAX_BASELINE_ENTRIES];
+	const char * baseline_file_name = DEFAULT_BASELINE_FILE;
+	char error_buffer[CAPTURE_ERROR_SIZE];
+	struct dhcp_scan_options options;
+	const struct result * expected;
+	double tolerance = DEFAULT_TOLERANCE;
+	bool update = false;
+	bool regressed;
+	int num_regressions = 0;
+	int num_baseline_entries;
+	int num_results;
+	int result = EXIT_FAILURE;
+	const char * s;
+	char * p;
+	int c;
+	int j;
+
+	/* Figure out the name of this command. Strip any
+	 * leading path from it.
+	 */
+	command_name = argv[0];
+
+	s = strrchr(command_name, '/');
+	if(s != NULL)
+		command_name = s+1;
+
+	while((c = getopt_long(argc,argv,"b:ht:u",longopts,NULL)) != -1)
+	{
+		switch(c)
+		{
+			/* Where the baseline is kept. */
+			case 'b':
+
+				baseline_file_name = optarg;
+				break;
+
+			/* Print the usage information. */
+			case 'h':
+
+				print_usage();
+
+				result = EXIT_SUCCESS;
+				goto out;
+
+			/* How much slower a function may become. */
+			case 't':
+
+				tolerance = strtod(optarg,&p);
+				if(p == optarg || (*p) != '\0' || tolerance < 0)
+				{
+					fprintf(stderr,"%s: Parameter '--tolerance=%s' is not valid.\n",command_name,optarg);
+					goto out;
+				}
+
+				break;
+
+			/* Record a new baseline. */
+			case 'u':
+
+				update = true;
+				break;
+
+			default:
+
+				fprintf(stderr,"%s: %s - %s\n",command_name,optarg,"option not known");
+				goto out;
+		}
+	}
+
+	if(optind != argc)
+	{
+		print_usage();
+		goto out;
+	}
+
+	set_up_inputs();
+
+	/* The scan receives the offers through a capture which replays
+	 * them, one offer from each server per scan.
+	 */
+	set_replay_frames(frame_list,NUM_FRAMES,NUM_FRAMES);
+
+	memset(&options,0,sizeof(options));
+
+	options.capture_backend			= &replay_capture_backend;
+	options.interface_mac_address	= ((const bootp_t *)&frames[0][sizeof(struct ether_header) + sizeof(struct ip) + sizeof(struct udphdr)])->chaddr;
+	options.interface_mtu			= ETHERMTU;
+	options.defer_capture			= true;
+
+	scan = open_dhcp_scan("replay",&options,error_buffer,sizeof(error_buffer));
+	if(scan == NULL)
+	{
+		fprintf(stderr,"%s: Could not set up the scan (%s).\n",command_name,error_buffer);
+		goto out;
+	}
+
+	num_baseline_entries = update ? -1 : read_baseline(baseline_file_name,baseline,MAX_BASELINE_ENTRIES);
+
+	if(!update && num_baseline_entries < 0)
+		printf("%s: No baseline found in '%s'; enter 'make bench-baseline' to record one.\n",command_name,baseline_file_name);
+
+	for(num_results = 0 ; benchmarks[num_results].name != NULL ; num_results++)
+	{
+		measure(&benchmarks[num_results],&results[num_results]);
+
+		printf("%-36s %10.1f ns/op",results[num_results].name,results[num_results].nanoseconds);
+
+		if(results[num_results].allocations >= 0)
+			printf(" %8.2f allocs/op",results[num_results].allocations);
+
+		expected = NULL;
+
+		for(j = 0 ; j < num_baseline_entries ; j++)
+		{
+			if(strcmp(baseline[j].name,results[num_results].name) == 0)
+			{
+				expected = &baseline[j];
+				break;
+			}
+		}
+
+		if(expected != NULL)
+		{
+			/* Allocations are counted exactly, which is why any
+			 * increase counts as a regression.
+			 */
+			regressed = (results[num_results].nanoseconds > expected->nanoseconds * (1 + tolerance / 100)) ||
+			            (results[num_results].allocations >= 0 && expected->allocations >= 0 &&
+			             results[num_results].allocations > expected->allocations + 0.005);
+
+			printf("  (baseline %.1f ns/op",expected->nanoseconds);
+
+			if(expected->allocations >= 0)
+				printf(", %.2f allocs/op",expected->allocations);
+
+			printf(")%s\n",regressed ? "  REGRESSION" : "");
+
+			if(regressed)
+				num_regressions++;
+		}
+		else
+		{
+			printf("\n");
+		}
+	}
+
+	if(update)
+	{
+		if(write_baseline(baseline_file_name,results,num_results) < 0)
+		{
+			fprintf(stderr,"%s: Could not write '%s' (%s).\n",command_name,baseline_file_name,strerror(errno));
+			goto out;
+		}
+
+		printf("%s: Baseline written to '%s'.\n",command_name,baseline_file_name);
+	}
+	else if (num_regressions > 0)
+	{
+		fprintf(stderr,"%s: %d of %d functions regressed beyond the baseline in '%s' (tolerance %.0f%%).\n",
+			command_name,num_regressions,num_results,baseline_file_name,tolerance);
+		goto out;
+	}
+
+	result = EXIT_SUCCESS;
+
+ out:
+
+	close_dhcp_scan(scan);
+
+	return(result);
+}
@@ -0,0 +1,140 @@
+/*
+ * Measure how long it takes to index a DHCP offer and to evaluate
+ * offer filter expressions against it.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#include <arpa/inet.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+/****************************************************************************/
+
+#include "offer_filter.h"
+
+/****************************************************************************/
+
+/* How often each measurement is repeated. */
+#define NUM_ITERATIONS 2000000
+
+/****************************************************************************/
+
+static const char * expressions[] =
+{
+	"router != 10.0.0.1",
+	"router != 10.0.0.1 or dns not in 10.0.0.0/8 or lease-time < 600",
+	"not (server-address in 10.0.0.0/8 and subnet-mask == 255.255.255.0) or domain-name != \"example.com\"",
+	"option-252 or (classless-static-route and not static-route) or interface-mtu < 1280 or ntp in 192.168.0.0/16"
+};
+
+/****************************************************************************/
+
+/* Build a typical DHCP offer. Returns the length of the options. */
+static int
+build_offer(bootp_t * dhcp)
+{
+	static const uint8_t options[] =
+	{
+		OPTION_TYPE_DHCP_MESSAGE_TYPE,		1,	MESSAGE_TYPE_OFFER,
+		OPTION_TYPE_SERVER_IDENTIFIER,		4,	10,0,0,1,
+		OPTION_TYPE_IP_ADDRESS_LEASE_TIME,	4,	0,1,0x51,0x80,
+		OPTION_TYPE_SUBNET_MASK,			4,	255,255,255,0,
+		OPTION_TYPE_GATEWAY,				4,	10,0,0,1,
+		OPTION_TYPE_DNS,					8,	10,0,0,2,	10,0,0,3,
+		OPTION_TYPE_DOMAIN_NAME,			11,	'e','x','a','m','p','l','e','.','c','o','m',
+		OPTION_TYPE_INTERFACE_MTU,			2,	0x05,0xdc,
+		OPTION_TYPE_NTP_SERVERS,			4,	10,0,0,4,
+		OPTION_TYPE_RENEWAL_TIME,			4,	0,0,0xa8,0xc0,
+		OPTION_TYPE_REBINDING_TIME,			4,	0,1,0x27,0x50,
+		OPTION_TYPE_END
+	};
+
+	memset(dhcp,0,sizeof(*dhcp));
+
+	dhcp->opcode = BOOTREPLY;
+	dhcp->yiaddr = htonl(0x0a000064);
+	dhcp->magic_cookie = htonl(DHCP_MAGIC_COOKIE);
+
+	memmove(dhcp->vend,options,sizeof(options));
+
+	return(sizeof(options));
+}
+
+/****************************************************************************/
+
+/* Nanoseconds elapsed since the given time. */
+static double
+get_nanoseconds_since(const struct timespec * start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC,&now);
+
+	return((now.tv_sec - start->tv_sec) * 1e9 + (now.tv_nsec - start->tv_nsec));
+}
+
+/****************************************************************************/
+
+int
+main(void)
+{
+	char error_buffer[256];
+	struct offer_filter * filter;
+	struct offer_index index;
+	struct timespec start;
+	bootp_t * dhcp;
+	int options_length;
+	size_t i;
+	int matches;
+	int n;
+
+	dhcp = calloc(1,sizeof(*dhcp) + 312);
+	if(dhcp == NULL)
+	{
+		perror("calloc");
+		return(EXIT_FAILURE);
+	}
+
+	options_length = build_offer(dhcp);
+
+	clock_gettime(CLOCK_MONOTONIC,&start);
+
+	for(n = 0 ; n < NUM_ITERATIONS ; n++)
+		build_offer_index(&index,0x0a000001,dhcp,dhcp->vend,options_length);
+
+	printf("build_offer_index: %.1f ns/offer\n",get_nanoseconds_since(&start) / NUM_ITERATIONS);
+
+	for(i = 0 ; i < sizeof(expressions) / sizeof(expressions[0]) ; i++)
+	{
+		filter = compile_offer_filter(expressions[i],error_buffer,sizeof(error_buffer));
+		if(filter == NULL)
+		{
+			fprintf(stderr,"'%s': %s\n",expressions[i],error_buffer);
+			return(EXIT_FAILURE);
+		}
+
+		matches = 0;
+
+		clock_gettime(CLOCK_MONOTONIC,&start);
+
+		for(n = 0 ; n < NUM_ITERATIONS ; n++)
+			matches += evaluate_offer_filter(filter,&index);
+
+		printf("evaluate_offer_filter: %.1f ns/offer (%s) for '%s'\n",
+			get_nanoseconds_since(&start) / NUM_ITERATIONS,
+			matches > 0 ? "match" : "no match",
+			expressions[i]);
+
+		delete_offer_filter(filter);
+	}
+
+	free(dhcp);
+
+	return(EXIT_SUCCESS);
+}
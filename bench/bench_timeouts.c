@@ -0,0 +1,766 @@
+/*
+ * Play through thousands of scans on a simulated clock, each with its own
+ * timeout and its own schedule of offers arriving: some spread out, some
+ * in bursts within the same millisecond, some retransmitted, and some
+ * arriving only after the timeout has elapsed. Each scan is run by
+ * run_dhcp_scan() as it would be on a network interface, except that
+ * waiting takes no time, and what it recorded is compared against what
+ * should have happened:
+ *
+ *     - only the offers which arrived before the timeout elapsed, or
+ *       before enough servers responded, are recorded or counted;
+ *     - each offer is stamped with the time at which it arrived;
+ *     - the scan ends exactly when the timeout elapses, or when the
+ *       last response it waits for arrives.
+ *
+ *     bench_timeouts [--scenarios=<number>] [--seed=<number>]
+ *
+ * Each scenario is made up from its own seed, which is reported if the
+ * scan did not do what it should have, so that the scenario may be
+ * played through again with '--seed=<number> --scenarios=1'.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <net/ethernet.h>
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <arpa/inet.h>
+
+#ifdef __linux__
+/* This makes the 'struct udphdr' use the same
+ * field names as used in the BSD header files.
+ */
+#define __FAVOR_BSD
+#endif /* __linux__ */
+#include <netinet/udp.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <getopt.h>
+
+/****************************************************************************/
+
+#include "dhcp_protocol.h"
+#include "dhcp_frame.h"
+#include "dhcp_scan.h"
+#include "scan_clock.h"
+
+/****************************************************************************/
+
+/* How many scenarios are played through, unless told otherwise. */
+#define DEFAULT_NUM_SCENARIOS 10000
+
+/* Most servers responding in a scenario. */
+#define MAX_SERVERS 64
+
+/* Most times a server sends the same offer again. */
+#define MAX_RETRANSMITS 3
+
+/* Most offers arriving in a scenario. */
+#define MAX_ARRIVALS (MAX_SERVERS * (1 + MAX_RETRANSMITS))
+
+/* The transaction ID of every scan, which the offers answer. */
+#define TRANSACTION_ID 0x12345678
+
+/****************************************************************************/
+
+/* An offer which arrives this many milliseconds after the DHCP DISCOVER
+ * message was sent.
+ */
+struct arrival
+{
+	int	millisecond;
+	int	server;
+};
+
+/* A scan and the offers it receives, in the order of their arrival. */
+struct scenario
+{
+	int				timeout;		/* In seconds */
+	int				max_responses;	/* 0 for no limit */
+	int				num_servers;
+
+	struct arrival	arrivals[MAX_ARRIVALS];
+	int				num_arrivals;
+};
+
+/****************************************************************************/
+
+const char * command_name;
+
+/* The offer sent by each server. */
+static uint8_t frames[MAX_SERVERS][ETHER_MAX_LEN];
+static size_t frame_lengths[MAX_SERVERS];
+
+static const uint8_t client_mac_address[ETHER_ADDR_LEN] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+
+/* The clock which all the scans run on. */
+static struct simulated_scan_clock simulated_clock;
+
+/* What the capture opened next will deliver. */
+static const struct scenario * current_scenario;
+
+/****************************************************************************/
+
+/* The next number produced by a xorshift64* pseudo-random number
+ * generator.
+ */
+static uint32_t
+get_random_number(uint64_t * state)
+{
+	uint64_t x = (*state);
+
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+
+	(*state) = x;
+
+	return((uint32_t)((x * 0x2545F4914F6CDD1DULL) >> 32));
+}
+
+/****************************************************************************/
+
+/* A pseudo-random number in the range minimum..maximum. */
+static int
+get_random_range(uint64_t * state,int minimum,int maximum)
+{
+	return(minimum + (int)(get_random_number(state) % (uint32_t)(maximum - minimum + 1)));
+}
+
+/****************************************************************************/
+
+/* The simulated monotonic time, in milliseconds. The clock only ever
+ * moves in whole milliseconds here.
+ */
+static long long
+get_simulated_milliseconds(void)
+{
+	struct timespec now;
+
+	(*simulated_clock.clock.get_monotonic_time)(&simulated_clock.clock,&now);
+
+	return(now.tv_sec * 1000LL + now.tv_nsec / 1000000);
+}
+
+/****************************************************************************/
+
+/* The simulated time of day at the given monotonic time. */
+static void
+get_simulated_time_of_day(long long millisecond,struct timeval * tv)
+{
+	tv->tv_sec = simulated_clock.time_of_day_start.tv_sec + millisecond / 1000;
+	tv->tv_usec = simulated_clock.time_of_day_start.tv_usec + (millisecond % 1000) * 1000;
+
+	if(tv->tv_usec >= 1000000)
+	{
+		tv->tv_sec++;
+		tv->tv_usec -= 1000000;
+	}
+}
+
+/****************************************************************************/
+
+/* The capture backend through which the scans receive the offers of the
+ * current scenario. Each offer becomes ready to be read at the time it
+ * arrives, which is when the simulated clock wakes up the scan.
+ */
+struct capture_handle
+{
+	const struct scenario *	scenario;
+	long long				discover_millisecond;	/* Negative until sent */
+	int						next_arrival;
+};
+
+/****************************************************************************/
+
+/* Have the simulated clock wake up the scan when the next offer arrives. */
+static void
+schedule_next_arrival(const struct capture_handle * handle)
+{
+	const struct arrival * arrival;
+	long long millisecond;
+	struct timespec when;
+
+	if(handle->discover_millisecond >= 0 && handle->next_arrival < handle->scenario->num_arrivals)
+	{
+		arrival = &handle->scenario->arrivals[handle->next_arrival];
+
+		millisecond = handle->discover_millisecond + arrival->millisecond;
+
+		when.tv_sec = millisecond / 1000;
+		when.tv_nsec = (millisecond % 1000) * 1000000L;
+
+		set_simulated_scan_clock_wakeup(&simulated_clock,&when);
+	}
+	else
+	{
+		clear_simulated_scan_clock_wakeup(&simulated_clock);
+	}
+}
+
+/****************************************************************************/
+
+static struct capture_handle *
+scripted_open(const char * interface_name __attribute__((unused)),int snapshot_length __attribute__((unused)),
+	const struct capture_options * options __attribute__((unused)),char * error_buffer,size_t error_buffer_size)
+{
+	struct capture_handle * handle;
+
+	handle = calloc(1,sizeof(*handle));
+	if(handle == NULL)
+	{
+		snprintf(error_buffer,error_buffer_size,"not enough memory");
+		goto out;
+	}
+
+	handle->scenario				= current_scenario;
+	handle->discover_millisecond	= -1;
+
+ out:
+
+	return(handle);
+}
+
+/****************************************************************************/
+
+static int
+scripted_attach_filter(struct capture_handle * handle __attribute__((unused)),uint16_t udp_port __attribute__((unused)))
+{
+	return(0);
+}
+
+/****************************************************************************/
+
+static int
+scripted_get_fd(const struct capture_handle * handle __attribute__((unused)))
+{
+	return(-1);
+}
+
+/****************************************************************************/
+
+/* Deliver the offers which have arrived by now. */
+static int
+scripted_receive(struct capture_handle * handle,int max_frames,capture_frame_function function,void * user_data)
+{
+	const struct arrival * arrival;
+	struct capture_frame frame;
+	long long now;
+	int result = 0;
+
+	if(handle->discover_millisecond < 0)
+		goto out;
+
+	now = get_simulated_milliseconds();
+
+	while(handle->next_arrival < handle->scenario->num_arrivals && (max_frames < 0 || result < max_frames))
+	{
+		arrival = &handle->scenario->arrivals[handle->next_arrival];
+		if(handle->discover_millisecond + arrival->millisecond > now)
+			break;
+
+		get_simulated_time_of_day(now,&frame.stamp);
+		frame.data = frames[arrival->server];
+		frame.length = frame_lengths[arrival->server];
+
+		handle->next_arrival++;
+		result++;
+
+		if(!(*function)(&frame,user_data))
+			break;
+	}
+
+	schedule_next_arrival(handle);
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* The DHCP DISCOVER message goes nowhere; the offers arrive relative to
+ * the time it was sent.
+ */
+static int
+scripted_transmit(struct capture_handle * handle,const struct capture_frame * frames_sent __attribute__((unused)),int num_frames)
+{
+	handle->discover_millisecond = get_simulated_milliseconds();
+	handle->next_arrival = 0;
+
+	schedule_next_arrival(handle);
+
+	return(num_frames);
+}
+
+/****************************************************************************/
+
+static int
+scripted_get_stats(struct capture_handle * handle __attribute__((unused)),struct capture_stats * stats)
+{
+	memset(stats,0,sizeof(*stats));
+
+	return(0);
+}
+
+/****************************************************************************/
+
+static const char *
+scripted_get_error(const struct capture_handle * handle __attribute__((unused)))
+{
+	return("");
+}
+
+/****************************************************************************/
+
+static void
+scripted_close(struct capture_handle * handle)
+{
+	clear_simulated_scan_clock_wakeup(&simulated_clock);
+
+	free(handle);
+}
+
+/****************************************************************************/
+
+static const struct capture_backend scripted_capture_backend =
+{
+	"scripted",
+	scripted_open,
+	scripted_attach_filter,
+	scripted_get_fd,
+	scripted_receive,
+	scripted_transmit,
+	scripted_get_stats,
+	scripted_get_error,
+	scripted_close
+};
+
+/****************************************************************************/
+
+/* Set up the offer which each server sends. */
+static void
+set_up_frames(void)
+{
+	static const uint8_t lease_time[4]		= { 0, 1, 0x51, 0x80 };
+	static const uint8_t subnet_mask[4]		= { 255, 255, 255, 0 };
+	static const uint8_t broadcast_mac_address[ETHER_ADDR_LEN] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+
+	uint8_t message_type = MESSAGE_TYPE_OFFER;
+	uint8_t server_mac_address[ETHER_ADDR_LEN];
+	struct ip * ip_header;
+	struct udphdr * udp_header;
+	ip4_t server_address;
+	bootp_t * dhcp;
+	int len;
+	int i;
+
+	for(i = 0 ; i < MAX_SERVERS ; i++)
+	{
+		ip_header = (struct ip *)&frames[i][sizeof(struct ether_header)];
+		udp_header = (struct udphdr *)&ip_header[1];
+		dhcp = (bootp_t *)&udp_header[1];
+
+		server_address = htonl(0x0a000001 + i);
+
+		memset(server_mac_address,0,sizeof(server_mac_address));
+		server_mac_address[0] = 0x02;
+		server_mac_address[5] = 1 + i;
+
+		len = 0;
+		len += fill_dhcp_option(&dhcp->vend[len], OPTION_TYPE_DHCP_MESSAGE_TYPE, &message_type, sizeof(message_type));
+		len += fill_dhcp_option(&dhcp->vend[len], OPTION_TYPE_SERVER_IDENTIFIER, &server_address, sizeof(server_address));
+		len += fill_dhcp_option(&dhcp->vend[len], OPTION_TYPE_IP_ADDRESS_LEASE_TIME, lease_time, sizeof(lease_time));
+		len += fill_dhcp_option(&dhcp->vend[len], OPTION_TYPE_SUBNET_MASK, subnet_mask, sizeof(subnet_mask));
+		len += fill_dhcp_option(&dhcp->vend[len], OPTION_TYPE_GATEWAY, &server_address, sizeof(server_address));
+		len += fill_dhcp_option(&dhcp->vend[len], OPTION_TYPE_END, NULL, 0);
+
+		dhcp->opcode = BOOTREPLY;
+		dhcp->htype = BOOTP_HARDWARE_TYPE_10_ETHERNET;
+		dhcp->hlen = ETHER_ADDR_LEN;
+		dhcp->xid = htonl(TRANSACTION_ID);
+		dhcp->flags = htons(0x8000);
+		dhcp->yiaddr = htonl(0x0a000064);
+		memmove(dhcp->chaddr, client_mac_address, ETHER_ADDR_LEN);
+		dhcp->magic_cookie = htonl(DHCP_MAGIC_COOKIE);
+
+		len += sizeof(*dhcp);
+		if(len < 300)
+			len = 300;
+
+		len = udp_output(ip_header, server_address, 0xFFFFFFFF, udp_header, DEFAULT_BOOTP_SERVER_PORT, DEFAULT_BOOTP_CLIENT_PORT, len);
+		len = ip_output(ip_header, server_address, 0xFFFFFFFF, len);
+		len = ether_output(frames[i], server_mac_address, broadcast_mac_address, len);
+
+		frame_lengths[i] = len;
+	}
+}
+
+/****************************************************************************/
+
+/* Add an offer to the scenario, keeping the offers in the order of their
+ * arrival. Offers which arrive in the same millisecond keep the order in
+ * which they were added.
+ */
+static void
+add_arrival(struct scenario * scenario,int millisecond,int server)
+{
+	int i;
+
+	for(i = scenario->num_arrivals ; i > 0 && scenario->arrivals[i-1].millisecond > millisecond ; i--)
+		scenario->arrivals[i] = scenario->arrivals[i-1];
+
+	scenario->arrivals[i].millisecond = millisecond;
+	scenario->arrivals[i].server = server;
+
+	scenario->num_arrivals++;
+}
+
+/****************************************************************************/
+
+/* Make up a scenario from the given seed. The offers arrive at any time
+ * up to twice the timeout, which means that about half of them arrive
+ * too late. In bursty scenarios, half the servers respond within the
+ * same millisecond; with retransmits, servers may send their offers
+ * up to three more times.
+ */
+static void
+make_scenario(struct scenario * scenario,uint64_t seed)
+{
+	uint64_t state = seed * 0x9E3779B97F4A7C15ULL + 1;
+	int last_millisecond;
+	int burst_millisecond;
+	bool bursty;
+	bool retransmitting;
+	int millisecond;
+	int num_retransmits;
+	int i,j;
+
+	memset(scenario,0,sizeof(*scenario));
+
+	scenario->timeout = get_random_range(&state,1,10);
+	scenario->num_servers = get_random_range(&state,1,MAX_SERVERS);
+
+	if(get_random_range(&state,0,1) == 1)
+		scenario->max_responses = get_random_range(&state,1,scenario->num_servers);
+
+	last_millisecond = 2 * 1000 * scenario->timeout;
+
+	bursty = (get_random_range(&state,0,1) == 1);
+	retransmitting = (get_random_range(&state,0,1) == 1);
+	burst_millisecond = get_random_range(&state,0,last_millisecond);
+
+	for(i = 0 ; i < scenario->num_servers ; i++)
+	{
+		if(bursty && get_random_range(&state,0,1) == 1)
+			millisecond = burst_millisecond;
+		else
+			millisecond = get_random_range(&state,0,last_millisecond);
+
+		add_arrival(scenario,millisecond,i);
+
+		num_retransmits = retransmitting ? get_random_range(&state,0,MAX_RETRANSMITS) : 0;
+
+		for(j = 0 ; j < num_retransmits ; j++)
+		{
+			millisecond += get_random_range(&state,1,1000);
+
+			add_arrival(scenario,millisecond,i);
+		}
+	}
+}
+
+/****************************************************************************/
+
+/* Check if the scan recorded what it should have, given that it was
+ * started at the given time and ended at another. If not, a
+ * description of what went wrong is placed in the buffer.
+ */
+static bool
+check_scenario(const struct scenario * scenario,const struct dhcp_scan * scan,
+	long long start_millisecond,long long end_millisecond,char * buffer,size_t buffer_size)
+{
+	int expected_order[MAX_SERVERS];
+	unsigned long expected_duplicates[MAX_SERVERS];
+	int expected_arrival[MAX_SERVERS];
+	bool recorded[MAX_SERVERS];
+	int num_expected = 0;
+	long long expected_end;
+	const struct arrival * arrival;
+	const struct dhcp_offer * offer;
+	const struct Node * node;
+	struct timeval stamp;
+	int server;
+	int i;
+	bool result = false;
+
+	memset(expected_duplicates,0,sizeof(expected_duplicates));
+	memset(recorded,0,sizeof(recorded));
+
+	/* The offers which arrive as the timeout elapses still count. */
+	expected_end = 1000LL * scenario->timeout;
+
+	for(i = 0 ; i < scenario->num_arrivals ; i++)
+	{
+		arrival = &scenario->arrivals[i];
+		if(arrival->millisecond > 1000LL * scenario->timeout)
+			break;
+
+		if(recorded[arrival->server])
+		{
+			expected_duplicates[arrival->server]++;
+			continue;
+		}
+
+		recorded[arrival->server] = true;
+		expected_arrival[arrival->server] = arrival->millisecond;
+		expected_order[num_expected++] = arrival->server;
+
+		if(num_expected == scenario->max_responses)
+		{
+			expected_end = arrival->millisecond;
+			break;
+		}
+	}
+
+	if(end_millisecond - start_millisecond != expected_end)
+	{
+		snprintf(buffer,buffer_size,"the scan ended after %lld ms rather than %lld ms",
+			end_millisecond - start_millisecond,expected_end);
+		goto out;
+	}
+
+	if(get_dhcp_scan_num_offers(scan) != num_expected)
+	{
+		snprintf(buffer,buffer_size,"%d offers were recorded rather than %d",
+			get_dhcp_scan_num_offers(scan),num_expected);
+		goto out;
+	}
+
+	for(node = get_list_head(get_dhcp_scan_offers(scan)), i = 0 ;
+	    node != NULL && i < num_expected ;
+	    node = get_next_node(node), i++)
+	{
+		offer = (const struct dhcp_offer *)node;
+
+		server = offer->server_ipv4_address[3] - 1;
+		if(server != expected_order[i])
+		{
+			snprintf(buffer,buffer_size,"offer #%d is from server #%d rather than server #%d",
+				i+1,server+1,expected_order[i]+1);
+			goto out;
+		}
+
+		if(offer->duplicates.count != expected_duplicates[server])
+		{
+			snprintf(buffer,buffer_size,"server #%d sent %lu duplicates rather than %lu",
+				server+1,offer->duplicates.count,expected_duplicates[server]);
+			goto out;
+		}
+
+		get_simulated_time_of_day(start_millisecond + expected_arrival[server],&stamp);
+
+		if(offer->stamp.tv_sec != stamp.tv_sec || offer->stamp.tv_usec != stamp.tv_usec)
+		{
+			snprintf(buffer,buffer_size,"the offer of server #%d is stamped %ld.%06ld rather than %ld.%06ld",
+				server+1,(long)offer->stamp.tv_sec,(long)offer->stamp.tv_usec,(long)stamp.tv_sec,(long)stamp.tv_usec);
+			goto out;
+		}
+	}
+
+	result = true;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+static void
+print_usage(void)
+{
+	printf("Usage: %s "
+		"[--scenarios=<number>] "
+		"[--seed=<number>] "
+		"[--help]\n",
+		command_name);
+}
+
+/****************************************************************************/
+
+int
+main(int argc,char ** argv)
+{
+	static const struct option longopts[] =
+	{
+		{ "help",		no_argument,		NULL,	'h'	},
+		{ "scenarios",	required_argument,	NULL,	'n'	},
+		{ "seed",		required_argument,	NULL,	's'	},
+		{ NULL,			0,					NULL,	0	}
+	};
+
+	/* Some time of day for the simulated clock to start at; it does
+	 * not begin on a whole second, so that stamps carry over into the
+	 * next second now and then.
+	 */
+	static const struct timeval time_of_day_start = { 1700000000, 999500 };
+
+	char error_buffer[CAPTURE_ERROR_SIZE];
+	char problem[256];
+	struct dhcp_scan_options options;
+	struct scenario scenario;
+	struct dhcp_scan * scan = NULL;
+	struct timespec start,stop;
+	long long start_millisecond;
+	long long end_millisecond;
+	long long simulated_milliseconds = 0;
+	unsigned long long seed = 1;
+	long num_scenarios = DEFAULT_NUM_SCENARIOS;
+	long num_ended_early = 0;
+	double elapsed;
+	int result = EXIT_FAILURE;
+	const char * s;
+	char * p;
+	long i;
+	int c;
+
+	/* Figure out the name of this command. Strip any
+	 * leading path from it.
+	 */
+	command_name = argv[0];
+
+	s = strrchr(command_name, '/');
+	if(s != NULL)
+		command_name = s+1;
+
+	while((c = getopt_long(argc,argv,"hn:s:",longopts,NULL)) != -1)
+	{
+		switch(c)
+		{
+			/* Print the usage information. */
+			case 'h':
+
+				print_usage();
+
+				result = EXIT_SUCCESS;
+				goto out;
+
+			/* How many scenarios to play through. */
+			case 'n':
+
+				num_scenarios = strtol(optarg,&p,10);
+				if(p == optarg || (*p) != '\0' || num_scenarios < 1)
+				{
+					fprintf(stderr,"%s: Parameter '--scenarios=%s' is not valid.\n",command_name,optarg);
+					goto out;
+				}
+
+				break;
+
+			/* The seed of the first scenario. */
+			case 's':
+
+				seed = strtoull(optarg,&p,10);
+				if(p == optarg || (*p) != '\0')
+				{
+					fprintf(stderr,"%s: Parameter '--seed=%s' is not valid.\n",command_name,optarg);
+					goto out;
+				}
+
+				break;
+
+			default:
+
+				fprintf(stderr,"%s: %s - %s\n",command_name,optarg,"option not known");
+				goto out;
+		}
+	}
+
+	if(optind != argc)
+	{
+		print_usage();
+		goto out;
+	}
+
+	set_up_frames();
+
+	init_simulated_scan_clock(&simulated_clock,&time_of_day_start);
+
+	memset(&options,0,sizeof(options));
+
+	options.capture_backend			= &scripted_capture_backend;
+	options.clock					= &simulated_clock.clock;
+	options.interface_mac_address	= client_mac_address;
+	options.interface_mtu			= ETHERMTU;
+	options.defer_capture			= true;
+
+	clock_gettime(CLOCK_MONOTONIC,&start);
+
+	for(i = 0 ; i < num_scenarios ; i++)
+	{
+		make_scenario(&scenario,seed + i);
+
+		current_scenario = &scenario;
+		options.max_responses = scenario.max_responses;
+
+		scan = open_dhcp_scan("simulated",&options,error_buffer,sizeof(error_buffer));
+		if(scan == NULL)
+		{
+			fprintf(stderr,"%s: Could not set up the scan (%s).\n",command_name,error_buffer);
+			goto out;
+		}
+
+		start_millisecond = get_simulated_milliseconds();
+
+		if(run_dhcp_scan(scan,TRANSACTION_ID,scenario.timeout) < 0)
+		{
+			fprintf(stderr,"%s: The scan of scenario %llu failed (%s).\n",command_name,seed + i,get_dhcp_scan_error(scan));
+			goto out;
+		}
+
+		end_millisecond = get_simulated_milliseconds();
+
+		if(!check_scenario(&scenario,scan,start_millisecond,end_millisecond,problem,sizeof(problem)))
+		{
+			fprintf(stderr,"%s: In scenario %llu (%d second timeout, %d servers, %d offers, --max-responses=%d), %s.\n",
+				command_name,seed + i,scenario.timeout,scenario.num_servers,scenario.num_arrivals,scenario.max_responses,problem);
+			goto out;
+		}
+
+		if(end_millisecond - start_millisecond < 1000LL * scenario.timeout)
+			num_ended_early++;
+
+		simulated_milliseconds += end_millisecond - start_millisecond;
+
+		close_dhcp_scan(scan);
+		scan = NULL;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC,&stop);
+
+	elapsed = (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) / 1e9;
+
+	printf("%s: %ld scenarios (%ld ended by --max-responses), %.1f simulated seconds in %.1f ms (%.0f scenarios/s)\n",
+		command_name,num_scenarios,num_ended_early,simulated_milliseconds / 1000.0,elapsed * 1000.0,
+		(elapsed > 0) ? num_scenarios / elapsed : 0.0);
+
+	result = EXIT_SUCCESS;
+
+ out:
+
+	if(scan != NULL)
+		close_dhcp_scan(scan);
+
+	return(result);
+}
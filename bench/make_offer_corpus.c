@@ -0,0 +1,812 @@
+/*
+ * Write DHCP offers for the decoder benchmarks to capture files, one file
+ * per category of offers. Besides typical offers, the categories cover
+ * what is costly or difficult to decode: long domain search lists and
+ * route tables spread across several options (RFC 3396), unknown options,
+ * lots of padding, malformed options and chains of domain name
+ * compression pointers.
+ *
+ * Each offer comes from a different server, so that a scan records every
+ * single one of them. The offers are made up by a pseudo-random number
+ * generator started with a fixed seed, so that the same files are
+ * written every time.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <net/ethernet.h>
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <arpa/inet.h>
+
+#ifdef __linux__
+/* This makes the 'struct udphdr' use the same
+ * field names as used in the BSD header files.
+ */
+#define __FAVOR_BSD
+#endif /* __linux__ */
+#include <netinet/udp.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <stdio.h>
+#include <errno.h>
+
+#include <getopt.h>
+
+/****************************************************************************/
+
+#include "dhcp_protocol.h"
+#include "dhcp_frame.h"
+#include "savefile.h"
+
+/****************************************************************************/
+
+/* How many offers are written for each category, unless told otherwise. */
+#define DEFAULT_COUNT 10000
+
+/* Room for the options of an offer, such that it still fits into a
+ * 1500 octet MTU.
+ */
+#define MAX_OPTIONS_SIZE 1200
+
+/* Room for option data which is spread across several options. */
+#define MAX_LONG_OPTION_SIZE 900
+
+/* All offers respond to this DHCP DISCOVER message. */
+#define TRANSACTION_ID 0x12345678
+
+/****************************************************************************/
+
+/* Fills in the options of an offer which follow the DHCP message type and
+ * the server identifier, up to 'size' octets. Returns how many octets
+ * were used.
+ */
+typedef int (*option_function)(uint8_t * options,int size,uint64_t * random_state);
+
+/* A category of offers, and how their options are made up. */
+struct category
+{
+	const char *	name;
+	option_function	fill_options;
+};
+
+/****************************************************************************/
+
+const char * command_name;
+
+/****************************************************************************/
+
+/* The next number produced by a xorshift64* pseudo-random number
+ * generator.
+ */
+static uint32_t
+get_random_number(uint64_t * state)
+{
+	uint64_t x = (*state);
+
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+
+	(*state) = x;
+
+	return((uint32_t)((x * 0x2545F4914F6CDD1DULL) >> 32));
+}
+
+/****************************************************************************/
+
+/* A pseudo-random number in the range minimum..maximum. */
+static int
+get_random_range(uint64_t * state,int minimum,int maximum)
+{
+	return(minimum + (int)(get_random_number(state) % (uint32_t)(maximum - minimum + 1)));
+}
+
+/****************************************************************************/
+
+/* Encode a domain name as a list of labels (RFC 1035, section 3.1). The
+ * name ends with a compression pointer to the given offset if that is
+ * not negative, and with the root label otherwise. Returns the number
+ * of octets used.
+ */
+static int
+encode_domain_name(uint8_t * buffer,const char * name,int suffix_offset)
+{
+	const char * label;
+	const char * dot;
+	int label_length;
+	int len = 0;
+
+	for(label = name ; (*label) != '\0' ; label += label_length)
+	{
+		dot = strchr(label,'.');
+		label_length = (dot != NULL) ? (int)(dot - label) : (int)strlen(label);
+
+		buffer[len++] = label_length;
+		memmove(&buffer[len],label,label_length);
+		len += label_length;
+
+		if(dot != NULL)
+			label_length++;
+	}
+
+	if(suffix_offset >= 0)
+	{
+		buffer[len++] = 0xc0 | ((suffix_offset >> 8) & 0x3f);
+		buffer[len++] = suffix_offset & 0xff;
+	}
+	else
+	{
+		buffer[len++] = 0;
+	}
+
+	return(len);
+}
+
+/****************************************************************************/
+
+/* Store option data which may not fit into a single option, spreading it
+ * across as many options as needed, each of a random size (RFC 3396).
+ * Returns the number of octets used.
+ */
+static int
+fill_long_option(uint8_t * options,uint8_t option_code,const uint8_t * data,int data_length,uint64_t * random_state)
+{
+	int fragment_length;
+	int len = 0;
+	int pos;
+
+	for(pos = 0 ; pos < data_length ; pos += fragment_length)
+	{
+		fragment_length = get_random_range(random_state,16,255);
+		if(fragment_length > data_length - pos)
+			fragment_length = data_length - pos;
+
+		len += fill_dhcp_option(&options[len],option_code,&data[pos],fragment_length);
+	}
+
+	return(len);
+}
+
+/****************************************************************************/
+
+/* The options which most offers carry, without the end marker. Returns
+ * the number of octets used.
+ */
+static int
+fill_common_options(uint8_t * options)
+{
+	static const uint8_t lease_time[4]		= { 0, 1, 0x51, 0x80 };
+	static const uint8_t renewal_time[4]	= { 0, 0, 0xa8, 0xc0 };
+	static const uint8_t rebinding_time[4]	= { 0, 1, 0x27, 0x50 };
+	static const uint8_t subnet_mask[4]		= { 255, 255, 255, 0 };
+	static const uint8_t router[4]			= { 10, 0, 0, 1 };
+	static const uint8_t dns_servers[8]		= { 10, 0, 0, 2, 10, 0, 0, 3 };
+	static const uint8_t ntp_server[4]		= { 10, 0, 0, 4 };
+	static const uint8_t mtu[2]				= { 0x05, 0xdc };
+	static const char domain_name[]			= "example.com";
+	int len = 0;
+
+	len += fill_dhcp_option(&options[len], OPTION_TYPE_IP_ADDRESS_LEASE_TIME, lease_time, sizeof(lease_time));
+	len += fill_dhcp_option(&options[len], OPTION_TYPE_SUBNET_MASK, subnet_mask, sizeof(subnet_mask));
+	len += fill_dhcp_option(&options[len], OPTION_TYPE_GATEWAY, router, sizeof(router));
+	len += fill_dhcp_option(&options[len], OPTION_TYPE_DNS, dns_servers, sizeof(dns_servers));
+	len += fill_dhcp_option(&options[len], OPTION_TYPE_DOMAIN_NAME, domain_name, sizeof(domain_name)-1);
+	len += fill_dhcp_option(&options[len], OPTION_TYPE_INTERFACE_MTU, mtu, sizeof(mtu));
+	len += fill_dhcp_option(&options[len], OPTION_TYPE_NTP_SERVERS, ntp_server, sizeof(ntp_server));
+	len += fill_dhcp_option(&options[len], OPTION_TYPE_RENEWAL_TIME, renewal_time, sizeof(renewal_time));
+	len += fill_dhcp_option(&options[len], OPTION_TYPE_REBINDING_TIME, rebinding_time, sizeof(rebinding_time));
+
+	return(len);
+}
+
+/****************************************************************************/
+
+/* A typical offer, for comparison. */
+static int
+fill_typical_options(uint8_t * options,int size __attribute__((unused)),uint64_t * random_state __attribute__((unused)))
+{
+	int len;
+
+	len = fill_common_options(options);
+	len += fill_dhcp_option(&options[len], OPTION_TYPE_END, NULL, 0);
+
+	return(len);
+}
+
+/****************************************************************************/
+
+/* A long domain search list, partly compressed, which is spread across
+ * several options.
+ */
+static int
+fill_domain_search_options(uint8_t * options,int size __attribute__((unused)),uint64_t * random_state)
+{
+	uint8_t data[MAX_LONG_OPTION_SIZE];
+	char name[64];
+	int data_length;
+	int limit;
+	int len;
+
+	/* The names either end with a pointer to the first one, or they
+	 * are written out in full.
+	 */
+	data_length = encode_domain_name(data,"example.com",-1);
+
+	limit = get_random_range(random_state,300,MAX_LONG_OPTION_SIZE);
+
+	while(data_length + (int)sizeof(name) < limit)
+	{
+		if(get_random_number(random_state) % 2)
+		{
+			snprintf(name,sizeof(name),"host%u.dept%u",get_random_number(random_state) % 1000,get_random_number(random_state) % 100);
+			data_length += encode_domain_name(&data[data_length],name,0);
+		}
+		else
+		{
+			snprintf(name,sizeof(name),"host%u.dept%u.example.com",get_random_number(random_state) % 1000,get_random_number(random_state) % 100);
+			data_length += encode_domain_name(&data[data_length],name,-1);
+		}
+	}
+
+	len = fill_common_options(options);
+	len += fill_long_option(&options[len], OPTION_TYPE_DOMAIN_SEARCH, data, data_length, random_state);
+	len += fill_dhcp_option(&options[len], OPTION_TYPE_END, NULL, 0);
+
+	return(len);
+}
+
+/****************************************************************************/
+
+/* A large table of classless static routes (RFC 3442), which is spread
+ * across several options.
+ */
+static int
+fill_classless_route_options(uint8_t * options,int size __attribute__((unused)),uint64_t * random_state)
+{
+	static const int widths[] = { 0, 8, 16, 24, 32 };
+	uint8_t data[MAX_LONG_OPTION_SIZE];
+	int num_routes;
+	int data_length = 0;
+	int width;
+	int len;
+	int i;
+
+	num_routes = get_random_range(random_state,20,100);
+
+	while(num_routes-- > 0 && data_length + 9 <= (int)sizeof(data))
+	{
+		/* Mostly octet-aligned subnet masks, as is common. */
+		if(get_random_number(random_state) % 4)
+			width = widths[get_random_number(random_state) % 5];
+		else
+			width = get_random_range(random_state,1,32);
+
+		/* Only the significant octets of the destination follow. */
+		data[data_length++] = width;
+
+		for(i = 0 ; i < (width + 7) / 8 ; i++)
+			data[data_length++] = (i == 0) ? 10 : get_random_number(random_state) % 256;
+
+		data[data_length++] = 10;
+		data[data_length++] = 0;
+		data[data_length++] = 0;
+		data[data_length++] = 1 + get_random_number(random_state) % 254;
+	}
+
+	len = fill_common_options(options);
+	len += fill_long_option(&options[len], OPTION_TYPE_CLASSLESS_STATIC_ROUTE, data, data_length, random_state);
+	len += fill_dhcp_option(&options[len], OPTION_TYPE_END, NULL, 0);
+
+	return(len);
+}
+
+/****************************************************************************/
+
+/* Many options which the decoder does not know. */
+static int
+fill_unknown_options(uint8_t * options,int size,uint64_t * random_state)
+{
+	uint8_t data[32];
+	int num_options;
+	int option_code;
+	int option_length;
+	int len;
+	int i;
+
+	len = fill_common_options(options);
+
+	for(num_options = get_random_range(random_state,20,60) ; num_options > 0 ; num_options--)
+	{
+		/* Site-specific options (RFC 2132, section 2), other than the
+		 * web proxy auto-discovery option.
+		 */
+		option_code = get_random_range(random_state,224,251);
+		option_length = get_random_range(random_state,0,sizeof(data));
+
+		if(len + 2 + option_length + 1 > size)
+			break;
+
+		for(i = 0 ; i < option_length ; i++)
+			data[i] = get_random_number(random_state) % 256;
+
+		len += fill_dhcp_option(&options[len], option_code, data, option_length);
+	}
+
+	len += fill_dhcp_option(&options[len], OPTION_TYPE_END, NULL, 0);
+
+	return(len);
+}
+
+/****************************************************************************/
+
+/* The typical options, with long runs of padding between them. */
+static int
+fill_padded_options(uint8_t * options,int size,uint64_t * random_state)
+{
+	uint8_t common_options[256];
+	int common_length;
+	int option_length;
+	int padding;
+	int len = 0;
+	int pos;
+
+	common_length = fill_common_options(common_options);
+
+	for(pos = 0 ; pos < common_length ; pos += 2 + option_length)
+	{
+		option_length = common_options[pos+1];
+
+		padding = get_random_range(random_state,0,80);
+		if(len + padding + 2 + option_length + (common_length - pos) + 1 > size)
+			padding = 0;
+
+		memset(&options[len],OPTION_TYPE_PAD,padding);
+		len += padding;
+
+		memmove(&options[len],&common_options[pos],2 + option_length);
+		len += 2 + option_length;
+	}
+
+	len += fill_dhcp_option(&options[len], OPTION_TYPE_END, NULL, 0);
+
+	/* Padding may follow the end marker, too. */
+	padding = get_random_range(random_state,0,size - len);
+
+	memset(&options[len],OPTION_TYPE_PAD,padding);
+	len += padding;
+
+	return(len);
+}
+
+/****************************************************************************/
+
+/* Options whose lengths do not add up, or whose contents are not valid. */
+static int
+fill_malformed_options(uint8_t * options,int size __attribute__((unused)),uint64_t * random_state)
+{
+	static const uint8_t truncated_label[]	= { 7, 'e', 'x', 'a', 'm' };
+	static const uint8_t pointer_loop[]		= { 3, 'f', 'o', 'o', 0xc0, 0x00 };
+	static const uint8_t pointer_ahead[]	= { 3, 'f', 'o', 'o', 0xc0, 0x20, 0 };
+	static const uint8_t wide_route[]		= { 33, 10, 0, 0, 0, 0, 10, 0, 0, 1 };
+	static const uint8_t truncated_route[]	= { 24, 10, 1, 2, 10, 0, 0 };
+	static const uint8_t static_route[]		= { 10, 1, 0, 0, 10, 0, 0 };
+	static const uint8_t short_number[]		= { 0, 1 };
+	uint8_t data[16];
+	int len;
+
+	len = fill_common_options(options);
+
+	switch(get_random_number(random_state) % 8)
+	{
+		/* The last option claims more data than the message holds. */
+		case 0:
+
+			memset(data,0,sizeof(data));
+
+			len += fill_dhcp_option(&options[len], OPTION_TYPE_MESSAGE, data, sizeof(data));
+			options[len - sizeof(data) - 1] = 255;
+
+			return(len);
+
+		/* The message ends after an option code, without an end marker. */
+		case 1:
+
+			options[len++] = OPTION_TYPE_MESSAGE;
+			return(len);
+
+		/* A domain name label which runs past the end of the data. */
+		case 2:
+
+			len += fill_dhcp_option(&options[len], OPTION_TYPE_DOMAIN_SEARCH, truncated_label, sizeof(truncated_label));
+			break;
+
+		/* A compression pointer which leads back to itself. */
+		case 3:
+
+			len += fill_dhcp_option(&options[len], OPTION_TYPE_DOMAIN_SEARCH, pointer_loop, sizeof(pointer_loop));
+			break;
+
+		/* A compression pointer which leads beyond the data. */
+		case 4:
+
+			len += fill_dhcp_option(&options[len], OPTION_TYPE_DOMAIN_SEARCH, pointer_ahead, sizeof(pointer_ahead));
+			break;
+
+		/* A classless static route with a subnet mask which is too wide,
+		 * or with the router address cut short.
+		 */
+		case 5:
+
+			if(get_random_number(random_state) % 2)
+				len += fill_dhcp_option(&options[len], OPTION_TYPE_CLASSLESS_STATIC_ROUTE, wide_route, sizeof(wide_route));
+			else
+				len += fill_dhcp_option(&options[len], OPTION_TYPE_CLASSLESS_STATIC_ROUTE, truncated_route, sizeof(truncated_route));
+
+			break;
+
+		/* A static route which is not a multiple of 8 octets long. */
+		case 6:
+
+			len += fill_dhcp_option(&options[len], OPTION_TYPE_STATIC_ROUTE, static_route, sizeof(static_route));
+			break;
+
+		/* Numbers and addresses which are too short. */
+		default:
+
+			len += fill_dhcp_option(&options[len], OPTION_TYPE_BROADCAST_ADDRESS, short_number, sizeof(short_number));
+			len += fill_dhcp_option(&options[len], OPTION_TYPE_MAXIMUM_DHCP_MESSAGE_SIZE, NULL, 0);
+			break;
+	}
+
+	len += fill_dhcp_option(&options[len], OPTION_TYPE_END, NULL, 0);
+
+	return(len);
+}
+
+/****************************************************************************/
+
+/* A domain search list in which each name adds one label to the name
+ * before it, through a compression pointer. Decoding the last name means
+ * following a pointer for each name which came before it.
+ */
+static int
+fill_pointer_chain_options(uint8_t * options,int size __attribute__((unused)),uint64_t * random_state)
+{
+	uint8_t data[MAX_LONG_OPTION_SIZE];
+	int data_length;
+	int previous_name = 0;
+	char label[16];
+	int limit;
+	int len;
+	int i;
+
+	data_length = encode_domain_name(data,"example.com",-1);
+
+	limit = get_random_range(random_state,200,MAX_LONG_OPTION_SIZE);
+
+	for(i = 0 ; data_length + (int)sizeof(label) + 2 < limit ; i++)
+	{
+		snprintf(label,sizeof(label),"a%d",i);
+
+		/* This name ends with the name before it. */
+		len = data_length;
+		data_length += encode_domain_name(&data[data_length],label,previous_name);
+		previous_name = len;
+	}
+
+	len = fill_common_options(options);
+	len += fill_long_option(&options[len], OPTION_TYPE_DOMAIN_SEARCH, data, data_length, random_state);
+	len += fill_dhcp_option(&options[len], OPTION_TYPE_END, NULL, 0);
+
+	return(len);
+}
+
+/****************************************************************************/
+
+static const struct category categories[] =
+{
+	{ "typical",				fill_typical_options },
+	{ "domain-search",			fill_domain_search_options },
+	{ "classless-routes",		fill_classless_route_options },
+	{ "unknown-options",		fill_unknown_options },
+	{ "padding",				fill_padded_options },
+	{ "malformed",				fill_malformed_options },
+	{ "pointer-chains",			fill_pointer_chain_options },
+	{ NULL,						NULL }
+};
+
+/****************************************************************************/
+
+/* Build the offer number 'n' of a category, sent to the broadcast address.
+ * Returns the length of the frame.
+ */
+static int
+build_offer(const struct category * category,int n,uint64_t * random_state,uint8_t * frame)
+{
+	static const uint8_t broadcast_mac_address[ETHER_ADDR_LEN] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+	static const uint8_t client_mac_address[ETHER_ADDR_LEN] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+
+	struct ip * ip_header = (struct ip *)&frame[sizeof(struct ether_header)];
+	struct udphdr * udp_header = (struct udphdr *)&ip_header[1];
+	bootp_t * dhcp = (bootp_t *)&udp_header[1];
+	uint8_t message_type = MESSAGE_TYPE_OFFER;
+	uint8_t server_mac_address[ETHER_ADDR_LEN];
+	ip4_t server_address;
+	int len = 0;
+
+	memset(frame,0,ETHER_MAX_LEN);
+
+	/* Every offer comes from a different server. */
+	server_address = htonl(0x0a000000 + 1 + n);
+
+	server_mac_address[0] = 0x02;
+	server_mac_address[1] = 0x00;
+	server_mac_address[2] = (n >> 24) & 0xff;
+	server_mac_address[3] = (n >> 16) & 0xff;
+	server_mac_address[4] = (n >> 8) & 0xff;
+	server_mac_address[5] = n & 0xff;
+
+	len += fill_dhcp_option(&dhcp->vend[len], OPTION_TYPE_DHCP_MESSAGE_TYPE, &message_type, sizeof(message_type));
+	len += fill_dhcp_option(&dhcp->vend[len], OPTION_TYPE_SERVER_IDENTIFIER, &server_address, sizeof(server_address));
+	len += (*category->fill_options)(&dhcp->vend[len], MAX_OPTIONS_SIZE - len, random_state);
+
+	dhcp->opcode = BOOTREPLY;
+	dhcp->htype = BOOTP_HARDWARE_TYPE_10_ETHERNET;
+	dhcp->hlen = ETHER_ADDR_LEN;
+	dhcp->xid = htonl(TRANSACTION_ID);
+	dhcp->flags = htons(0x8000);
+	dhcp->yiaddr = htonl(0x0a000000 + 1 + n + 1);
+	memmove(dhcp->chaddr, client_mac_address, ETHER_ADDR_LEN);
+	dhcp->magic_cookie = htonl(DHCP_MAGIC_COOKIE);
+
+	len += sizeof(*dhcp);
+
+	/* DHCP messages shorter than 300 octets may be dropped by relay
+	 * servers (RFC 1532, section 2.1).
+	 */
+	if(len < 300)
+		len = 300;
+
+	len = udp_output(ip_header, server_address, 0xFFFFFFFF, udp_header, DEFAULT_BOOTP_SERVER_PORT, DEFAULT_BOOTP_CLIENT_PORT, len);
+	len = ip_output(ip_header, server_address, 0xFFFFFFFF, len);
+	len = ether_output(frame, server_mac_address, broadcast_mac_address, len);
+
+	return(len);
+}
+
+/****************************************************************************/
+
+/* Write the offers of a category to a file in the given directory.
+ * Returns -1 in case of error, and 0 otherwise.
+ */
+static int
+write_category(const char * directory,const struct category * category,int count,uint64_t random_state)
+{
+	static uint8_t frame[ETHER_MAX_LEN];
+	struct capture_frame output;
+	char file_name[PATH_MAX];
+	long total_length = 0;
+	FILE * out = NULL;
+	int result = -1;
+	int n;
+
+	snprintf(file_name,sizeof(file_name),"%s/%s.pcap",directory,category->name);
+
+	out = fopen(file_name,"wb");
+	if(out == NULL)
+	{
+		fprintf(stderr,"%s: Could not create '%s' (%s).\n",command_name,file_name,strerror(errno));
+		goto out;
+	}
+
+	if(write_savefile_header(out,ETHER_MAX_LEN) < 0)
+	{
+		fprintf(stderr,"%s: Could not write '%s' (%s).\n",command_name,file_name,strerror(errno));
+		goto out;
+	}
+
+	for(n = 0 ; n < count ; n++)
+	{
+		output.stamp.tv_sec		= 1700000000 + n / 10000;
+		output.stamp.tv_usec	= (n % 10000) * 100;
+		output.data				= frame;
+		output.length			= build_offer(category,n,&random_state,frame);
+
+		if(write_savefile_frame(out,&output) < 0)
+		{
+			fprintf(stderr,"%s: Could not write '%s' (%s).\n",command_name,file_name,strerror(errno));
+			goto out;
+		}
+
+		total_length += output.length;
+	}
+
+	n = fclose(out);
+	out = NULL;
+
+	if(n != 0)
+	{
+		fprintf(stderr,"%s: Could not write '%s' (%s).\n",command_name,file_name,strerror(errno));
+		goto out;
+	}
+
+	printf("%s: %d offers, %ld octets per frame on average.\n",file_name,count,(count > 0) ? total_length / count : 0);
+
+	result = 0;
+
+ out:
+
+	if(out != NULL)
+		fclose(out);
+
+	return(result);
+}
+
+/****************************************************************************/
+
+static void
+print_usage(void)
+{
+	int i;
+
+	printf("Usage: %s "
+		"[--category=<name>]... "
+		"[--count=<number>] "
+		"[--seed=<number>] "
+		"[--help] "
+		"directory\n"
+		"\n"
+		"Categories:",
+		command_name);
+
+	for(i = 0 ; categories[i].name != NULL ; i++)
+		printf(" %s",categories[i].name);
+
+	printf("\n");
+}
+
+/****************************************************************************/
+
+int
+main(int argc, char *argv[])
+{
+	static const struct option longopts[] =
+	{
+		{ "category",	required_argument,	NULL,	'c'	},
+		{ "count",		required_argument,	NULL,	'n'	},
+		{ "help",		no_argument,		NULL,	'h'	},
+		{ "seed",		required_argument,	NULL,	'r'	},
+		{ NULL,			0,					NULL,	0	}
+	};
+
+	bool selected[sizeof(categories) / sizeof(categories[0])];
+	bool any_selected = false;
+	const char * directory;
+	uint64_t seed = 1;
+	int count = DEFAULT_COUNT;
+	int result = EXIT_FAILURE;
+	const char * s;
+	char * p;
+	long n;
+	int c;
+	int i;
+
+	/* Figure out the name of this command. Strip any
+	 * leading path from it.
+	 */
+	command_name = argv[0];
+
+	s = strrchr(command_name, '/');
+	if(s != NULL)
+		command_name = s+1;
+
+	memset(selected,0,sizeof(selected));
+
+	while((c = getopt_long(argc,argv,"c:hn:r:",longopts,NULL)) != -1)
+	{
+		switch(c)
+		{
+			/* Write only the offers of this category. */
+			case 'c':
+
+				for(i = 0 ; categories[i].name != NULL ; i++)
+				{
+					if(strcmp(categories[i].name,optarg) == 0)
+						break;
+				}
+
+				if(categories[i].name == NULL)
+				{
+					fprintf(stderr,"%s: Parameter '--category=%s' is not valid.\n",command_name,optarg);
+					goto out;
+				}
+
+				selected[i] = any_selected = true;
+				break;
+
+			/* How many offers to write for each category. */
+			case 'n':
+
+				n = strtol(optarg,&p,0);
+				if(p == optarg || (*p) != '\0' || n < 1 || n > 0x00ffffff)
+				{
+					fprintf(stderr,"%s: Parameter '--count=%s' is not valid.\n",command_name,optarg);
+					goto out;
+				}
+
+				count = (int)n;
+				break;
+
+			/* Print the usage information. */
+			case 'h':
+
+				print_usage();
+
+				result = EXIT_SUCCESS;
+				goto out;
+
+			/* Make up different offers. */
+			case 'r':
+
+				n = strtol(optarg,&p,0);
+				if(p == optarg || (*p) != '\0' || n < 1)
+				{
+					fprintf(stderr,"%s: Parameter '--seed=%s' is not valid.\n",command_name,optarg);
+					goto out;
+				}
+
+				seed = (uint64_t)n;
+				break;
+
+			default:
+
+				fprintf(stderr,"%s: %s - %s\n",command_name,optarg,"option not known");
+				goto out;
+		}
+	}
+
+	argc -= optind;
+	argv += optind;
+
+	if(argc != 1)
+	{
+		print_usage();
+		goto out;
+	}
+
+	directory = argv[0];
+
+	if(mkdir(directory,0777) < 0 && errno != EEXIST)
+	{
+		fprintf(stderr,"%s: Could not create '%s' (%s).\n",command_name,directory,strerror(errno));
+		goto out;
+	}
+
+	/* Each category starts with the same seed, so that the offers of
+	 * one category do not change when another one is left out.
+	 */
+	for(i = 0 ; categories[i].name != NULL ; i++)
+	{
+		if(any_selected && !selected[i])
+			continue;
+
+		if(write_category(directory,&categories[i],count,seed) < 0)
+			goto out;
+	}
+
+	result = EXIT_SUCCESS;
+
+ out:
+
+	return(result);
+}
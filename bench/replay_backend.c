@@ -0,0 +1,176 @@
+/*
+ * A capture backend for the benchmarks which replays frames held in
+ * memory, so that a scan may be measured without a network interface.
+ *
+ * Each time the scan sends its DHCP DISCOVER message, the next few
+ * frames are made ready to be received, starting over with the first
+ * frame after the last one. This keeps each scan small, since every
+ * offer received is compared against those already recorded.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+/****************************************************************************/
+
+#include "replay_backend.h"
+
+/****************************************************************************/
+
+struct capture_handle
+{
+	const struct capture_frame *	frames;
+	int								num_frames;
+	int								frames_per_scan;
+
+	int								next_frame;
+	int								num_frames_left;
+};
+
+/****************************************************************************/
+
+/* What the next capture opened will replay. */
+static const struct capture_frame * replay_frames;
+static int replay_num_frames;
+static int replay_frames_per_scan;
+
+/****************************************************************************/
+
+/* Choose the frames which the next capture opened will replay, and how
+ * many of them each scan will receive.
+ */
+void
+set_replay_frames(const struct capture_frame * frames,int num_frames,int frames_per_scan)
+{
+	replay_frames			= frames;
+	replay_num_frames		= num_frames;
+	replay_frames_per_scan	= frames_per_scan;
+}
+
+/****************************************************************************/
+
+static struct capture_handle *
+replay_open(const char * interface_name __attribute__((unused)),int snapshot_length __attribute__((unused)),
+	const struct capture_options * options __attribute__((unused)),char * error_buffer,size_t error_buffer_size)
+{
+	struct capture_handle * handle = NULL;
+
+	if(replay_num_frames == 0)
+	{
+		snprintf(error_buffer,error_buffer_size,"no frames to replay");
+		goto out;
+	}
+
+	handle = calloc(1,sizeof(*handle));
+	if(handle == NULL)
+	{
+		snprintf(error_buffer,error_buffer_size,"not enough memory");
+		goto out;
+	}
+
+	handle->frames			= replay_frames;
+	handle->num_frames		= replay_num_frames;
+	handle->frames_per_scan	= replay_frames_per_scan;
+
+ out:
+
+	return(handle);
+}
+
+/****************************************************************************/
+
+static int
+replay_attach_filter(struct capture_handle * handle __attribute__((unused)),uint16_t udp_port __attribute__((unused)))
+{
+	return(0);
+}
+
+/****************************************************************************/
+
+static int
+replay_get_fd(const struct capture_handle * handle __attribute__((unused)))
+{
+	return(-1);
+}
+
+/****************************************************************************/
+
+static int
+replay_receive(struct capture_handle * handle,int max_frames,capture_frame_function function,void * user_data)
+{
+	const struct capture_frame * frame;
+	int result = 0;
+
+	while(handle->num_frames_left > 0 && (max_frames < 0 || result < max_frames))
+	{
+		frame = &handle->frames[handle->next_frame];
+
+		handle->next_frame = (handle->next_frame + 1) % handle->num_frames;
+		handle->num_frames_left--;
+		result++;
+
+		if(!(*function)(frame,user_data))
+			break;
+	}
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* The DHCP DISCOVER message goes nowhere; sending it marks the start of
+ * another scan.
+ */
+static int
+replay_transmit(struct capture_handle * handle,const struct capture_frame * frames __attribute__((unused)),int num_frames)
+{
+	handle->num_frames_left = handle->frames_per_scan;
+
+	return(num_frames);
+}
+
+/****************************************************************************/
+
+static int
+replay_get_stats(struct capture_handle * handle __attribute__((unused)),struct capture_stats * stats)
+{
+	memset(stats,0,sizeof(*stats));
+
+	return(0);
+}
+
+/****************************************************************************/
+
+static const char *
+replay_get_error(const struct capture_handle * handle __attribute__((unused)))
+{
+	return("");
+}
+
+/****************************************************************************/
+
+static void
+replay_close(struct capture_handle * handle)
+{
+	free(handle);
+}
+
+/****************************************************************************/
+
+const struct capture_backend replay_capture_backend =
+{
+	"replay",
+	replay_open,
+	replay_attach_filter,
+	replay_get_fd,
+	replay_receive,
+	replay_transmit,
+	replay_get_stats,
+	replay_get_error,
+	replay_close
+};
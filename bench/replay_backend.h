@@ -0,0 +1,27 @@
+/*
+ * A capture backend for the benchmarks which replays frames held in
+ * memory, so that a scan may be measured without a network interface.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#ifndef _REPLAY_BACKEND_H
+#define _REPLAY_BACKEND_H
+
+/****************************************************************************/
+
+#include "capture_backend.h"
+
+/****************************************************************************/
+
+extern const struct capture_backend replay_capture_backend;
+
+/****************************************************************************/
+
+void set_replay_frames(const struct capture_frame *frames, int num_frames, int frames_per_scan);
+
+/****************************************************************************/
+
+#endif /* _REPLAY_BACKEND_H */
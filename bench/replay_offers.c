@@ -0,0 +1,1044 @@
+/*
+ * Replay the frames stored in a capture file through a network interface,
+ * such as one end of a veth pair or a tap device, so that the receive
+ * path of find-dhcp-servers can be driven with real traffic.
+ *
+ * The frames are sent either with the same spacing as when they were
+ * recorded, sped up or slowed down by some factor, or as fast as the
+ * network interface takes them. The DHCP responses among them are made
+ * to answer the DHCP DISCOVER message which the scan sent last: their
+ * transaction number and client hardware address are rewritten as they
+ * are sent, and so is the destination of unicast frames, with the UDP
+ * checksum adjusted to match. Replay begins with the first DHCP DISCOVER
+ * message seen, and a scan which starts over, e.g. in monitoring mode,
+ * is followed along.
+ *
+ * The DHCP requests in the file, such as the DHCP DISCOVER message which
+ * the recorded offers answered, are not sent, since the scan would take
+ * no notice of them, and they would be mistaken for those of the scan.
+ *
+ * If a command is given after the network interface, it is started once
+ * the capture is ready, and its output is passed on. If that command is
+ * find-dhcp-servers with the --verbose option, the number of frames it
+ * processed is compared against the number of frames sent.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <net/ethernet.h>
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <arpa/inet.h>
+
+#ifdef __linux__
+/* This makes the 'struct udphdr' use the same
+ * field names as used in the BSD header files.
+ */
+#define __FAVOR_BSD
+#endif /* __linux__ */
+#include <netinet/udp.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <limits.h>
+#include <stdio.h>
+#include <errno.h>
+#include <time.h>
+
+#include <unistd.h>
+#include <getopt.h>
+#include <poll.h>
+
+/****************************************************************************/
+
+#include "capture_backend.h"
+#include "dhcp_protocol.h"
+#include "dhcp_message.h"
+#include "savefile.h"
+
+/****************************************************************************/
+
+/* Most frames sent at a time. */
+#define MAX_BATCH_SIZE 64
+
+/* How long to wait (in milliseconds) before trying again to send frames
+ * which did not fit into the send buffer.
+ */
+#define RETRY_INTERVAL 1
+
+/* Longest line of output of the command which is looked at. */
+#define MAX_LINE_LENGTH 1024
+
+/****************************************************************************/
+
+/* What is done with a frame from the file. */
+enum
+{
+	FRAME_SEND=0,		/* Sent as it is */
+	FRAME_REWRITE,		/* Carries a DHCP response, which is rewritten */
+	FRAME_SKIP			/* Carries a DHCP request, or is too long */
+};
+
+/* A frame from the file, and where its DHCP message is found. */
+struct replay_frame
+{
+	const struct capture_frame *	frame;
+	double							offset;		/* Seconds after the first frame */
+	int								what;
+	size_t							udp_offset;
+	size_t							message_offset;
+};
+
+/* Everything the replay is up to. */
+struct replayer
+{
+	const struct capture_backend *	backend;
+	struct capture_handle *			capture;
+
+	struct replay_frame *	frames;
+	int						num_frames;
+	int						num_frames_skipped;
+	int						num_loops;
+	double					speed;			/* 0 for as fast as possible */
+
+	/* Where the replay stands: the next frame to be sent, and in which
+	 * pass through the file.
+	 */
+	bool					started;
+	int						next_frame;
+	int						loop;
+	struct timespec			loop_started;	/* When the first frame of this pass was due */
+
+	/* The DHCP DISCOVER message which the frames are to answer. */
+	uint8_t					transaction_id[4];		/* Network byte order */
+	uint8_t					client_mac_address[ETHER_ADDR_LEN];
+	uint8_t					source_mac_address[ETHER_ADDR_LEN];
+	unsigned long			num_discovers;
+
+	unsigned long			num_frames_sent;
+	struct timespec			first_sent;
+	struct timespec			last_sent;
+
+	/* The command which is run, and what it reported. */
+	pid_t					command_pid;
+	int						command_fd;
+	char					line[MAX_LINE_LENGTH];
+	size_t					line_length;
+	bool					have_stats;
+	unsigned long long		frames_received;
+	unsigned long long		frames_processed;
+	unsigned long long		frames_dropped;
+};
+
+/****************************************************************************/
+
+const char * command_name;
+
+/****************************************************************************/
+
+/* The number of seconds from one time to another. */
+static double
+get_seconds_between(const struct timespec * from,const struct timespec * to)
+{
+	return((to->tv_sec - from->tv_sec) + (to->tv_nsec - from->tv_nsec) / 1e9);
+}
+
+/****************************************************************************/
+
+/* Add a number of seconds to a time. */
+static void
+add_seconds(struct timespec * t,double seconds)
+{
+	long long nanoseconds;
+
+	nanoseconds = t->tv_nsec + (long long)(seconds * 1e9);
+
+	t->tv_sec += nanoseconds / 1000000000LL;
+	t->tv_nsec = nanoseconds % 1000000000LL;
+}
+
+/****************************************************************************/
+
+/* Find out what a frame carries, and what is to be done with it. */
+static void
+classify_frame(struct replay_frame * rf)
+{
+	const struct capture_frame * frame = rf->frame;
+	const struct ether_header * ethernet_frame = (const struct ether_header *)frame->data;
+	const struct ip * ip_packet = (const struct ip *)&ethernet_frame[1];
+	const struct udphdr * udp_packet;
+	struct dhcp_message message;
+	size_t offset;
+	int length;
+
+	rf->what = FRAME_SEND;
+
+	/* Frames which do not fit into an Ethernet frame cannot be sent. */
+	if(frame->length > ETHER_MAX_LEN)
+	{
+		rf->what = FRAME_SKIP;
+		goto out;
+	}
+
+	if(frame->length < sizeof(*ethernet_frame) + sizeof(*ip_packet) + sizeof(*udp_packet))
+		goto out;
+
+	if(ntohs(ethernet_frame->ether_type) != ETHERTYPE_IP || ip_packet->ip_p != IPPROTO_UDP)
+		goto out;
+
+	offset = sizeof(*ethernet_frame) + ip_packet->ip_hl * 4;
+	if(offset + sizeof(*udp_packet) > frame->length)
+		goto out;
+
+	udp_packet = (const struct udphdr *)&frame->data[offset];
+
+	rf->udp_offset = offset;
+
+	offset += sizeof(*udp_packet);
+
+	length = ntohs(udp_packet->uh_ulen) - (int)sizeof(*udp_packet);
+	if(length < (int)offsetof(bootp_t,vend) || offset + length > frame->length)
+		goto out;
+
+	if(decode_dhcp_message(&message, &frame->data[offset], length) < 0)
+		goto out;
+
+	rf->message_offset = offset;
+
+	if(message.opcode == BOOTREPLY)
+		rf->what = FRAME_REWRITE;
+	else if (message.opcode == BOOTREQUEST)
+		rf->what = FRAME_SKIP;
+
+ out:
+
+	return;
+}
+
+/****************************************************************************/
+
+/* Adjust a UDP checksum (in network byte order) for data which changed,
+ * without adding up the whole datagram again (RFC 1624). The data must
+ * start at an even offset into the datagram and have an even length.
+ */
+static uint16_t
+adjust_checksum(uint16_t checksum,const uint8_t * old_data,const uint8_t * new_data,int length)
+{
+	uint32_t sum;
+	int i;
+
+	/* No checksum was given. */
+	if(checksum == 0)
+		return(0);
+
+	sum = (uint16_t)~ntohs(checksum);
+
+	for(i = 0 ; i < length ; i += 2)
+	{
+		sum += (uint16_t)~((old_data[i] << 8) | old_data[i+1]);
+		sum += (new_data[i] << 8) | new_data[i+1];
+	}
+
+	while(sum > 0xffff)
+		sum = (sum & 0xffff) + (sum >> 16);
+
+	sum = (uint16_t)~sum;
+
+	/* A checksum of 0 would mean that there is none. */
+	if(sum == 0)
+		sum = 0xffff;
+
+	return(htons((uint16_t)sum));
+}
+
+/****************************************************************************/
+
+/* Copy a frame, making the DHCP response it carries answer the DHCP
+ * DISCOVER message of the scan. Returns the length of the frame.
+ */
+static size_t
+rewrite_frame(const struct replayer * replayer,const struct replay_frame * rf,uint8_t * output)
+{
+	struct ether_header * ethernet_frame = (struct ether_header *)output;
+	struct udphdr * udp_packet;
+	uint8_t * message;
+	uint16_t checksum;
+
+	memmove(output,rf->frame->data,rf->frame->length);
+
+	if(rf->what == FRAME_REWRITE)
+	{
+		/* Broadcast and multicast frames stay as they are. */
+		if((ethernet_frame->ether_dhost[0] & 1) == 0)
+			memmove(ethernet_frame->ether_dhost,replayer->source_mac_address,ETHER_ADDR_LEN);
+
+		udp_packet = (struct udphdr *)&output[rf->udp_offset];
+		message = &output[rf->message_offset];
+
+		checksum = udp_packet->uh_sum;
+
+		checksum = adjust_checksum(checksum,&message[offsetof(bootp_t,xid)],replayer->transaction_id,sizeof(replayer->transaction_id));
+		memmove(&message[offsetof(bootp_t,xid)],replayer->transaction_id,sizeof(replayer->transaction_id));
+
+		checksum = adjust_checksum(checksum,&message[offsetof(bootp_t,chaddr)],replayer->client_mac_address,ETHER_ADDR_LEN);
+		memmove(&message[offsetof(bootp_t,chaddr)],replayer->client_mac_address,ETHER_ADDR_LEN);
+
+		udp_packet->uh_sum = checksum;
+	}
+
+	return(rf->frame->length);
+}
+
+/****************************************************************************/
+
+/* When a frame of the current pass through the file is due to be sent. */
+static void
+get_frame_due(const struct replayer * replayer,int which,struct timespec * due)
+{
+	(*due) = replayer->loop_started;
+
+	if(replayer->speed > 0)
+		add_seconds(due,replayer->frames[which].offset / replayer->speed);
+}
+
+/****************************************************************************/
+
+/* Check if every pass through the file is complete. */
+static bool
+is_replay_done(const struct replayer * replayer)
+{
+	return(replayer->loop == replayer->num_loops);
+}
+
+/****************************************************************************/
+
+/* Move on to the given frame, starting over with the first frame once
+ * the end of the file has been reached. The next pass begins when the
+ * last frame of this one was due.
+ */
+static void
+advance_replay(struct replayer * replayer,int next_frame)
+{
+	struct timespec due;
+
+	if(next_frame == replayer->num_frames)
+	{
+		get_frame_due(replayer,replayer->num_frames-1,&due);
+
+		replayer->loop_started = due;
+		replayer->loop++;
+
+		next_frame = 0;
+	}
+
+	replayer->next_frame = next_frame;
+}
+
+/****************************************************************************/
+
+/* Send the frames which are due, a batch at a time. Returns -1 in case
+ * of error, 1 if the send buffer is full and 0 otherwise.
+ */
+static int
+send_due_frames(struct replayer * replayer)
+{
+	static uint8_t frames[MAX_BATCH_SIZE][ETHER_MAX_LEN];
+	struct capture_frame output[MAX_BATCH_SIZE];
+	int batch[MAX_BATCH_SIZE];
+	struct timespec now,due;
+	int num_frames;
+	int result = -1;
+	int n;
+	int i;
+
+	clock_gettime(CLOCK_MONOTONIC,&now);
+
+	while(!is_replay_done(replayer))
+	{
+		/* Put together as many of the frames which are due as fit into
+		 * a batch, passing over those which are not to be sent.
+		 */
+		for(num_frames = 0, i = replayer->next_frame ; num_frames < MAX_BATCH_SIZE && i < replayer->num_frames ; i++)
+		{
+			get_frame_due(replayer,i,&due);
+			if(get_seconds_between(&now,&due) > 0)
+				break;
+
+			if(replayer->frames[i].what == FRAME_SKIP)
+				continue;
+
+			batch[num_frames] = i;
+
+			output[num_frames].data = frames[num_frames];
+			output[num_frames].length = rewrite_frame(replayer,&replayer->frames[i],frames[num_frames]);
+
+			num_frames++;
+		}
+
+		/* Nothing is due yet? */
+		if(i == replayer->next_frame)
+			break;
+
+		n = 0;
+
+		if(num_frames > 0)
+		{
+			n = (*replayer->backend->transmit)(replayer->capture,output,num_frames);
+			if(n < 0)
+			{
+				fprintf(stderr,"%s: Could not send frames (%s).\n",command_name,(*replayer->backend->get_error)(replayer->capture));
+				goto out;
+			}
+
+			if(n > 0)
+			{
+				clock_gettime(CLOCK_MONOTONIC,&replayer->last_sent);
+
+				if(replayer->num_frames_sent == 0)
+					replayer->first_sent = replayer->last_sent;
+
+				replayer->num_frames_sent += n;
+			}
+		}
+
+		/* The frames which did not fit into the send buffer are tried
+		 * again shortly.
+		 */
+		if(n < num_frames)
+		{
+			advance_replay(replayer,batch[n]);
+
+			result = 1;
+			goto out;
+		}
+
+		advance_replay(replayer,i);
+	}
+
+	result = 0;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* How long to wait (in milliseconds) until the next frame is due, or -1
+ * if no frame is waiting to be sent.
+ */
+static int
+get_poll_timeout(const struct replayer * replayer)
+{
+	struct timespec now,due;
+	long long milliseconds;
+	int result = -1;
+
+	if(replayer->started && !is_replay_done(replayer))
+	{
+		clock_gettime(CLOCK_MONOTONIC,&now);
+
+		get_frame_due(replayer,replayer->next_frame,&due);
+
+		milliseconds = (long long)(get_seconds_between(&now,&due) * 1000);
+		if(milliseconds < 0)
+			milliseconds = 0;
+
+		result = (milliseconds > INT_MAX) ? INT_MAX : (int)milliseconds;
+	}
+
+	/* Without a file descriptor to wait on, the capture is checked
+	 * periodically.
+	 */
+	if((*replayer->backend->get_fd)(replayer->capture) == -1 && (result < 0 || result > 10))
+		result = 10;
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Wait until the next frame is due, if that is less than a millisecond
+ * away, which is shorter than poll() can wait.
+ */
+static void
+wait_for_next_frame(const struct replayer * replayer)
+{
+	struct timespec now,due;
+	double seconds;
+
+	if(replayer->started && !is_replay_done(replayer) && replayer->speed > 0)
+	{
+		clock_gettime(CLOCK_MONOTONIC,&now);
+
+		get_frame_due(replayer,replayer->next_frame,&due);
+
+		seconds = get_seconds_between(&now,&due);
+		if(seconds > 0 && seconds < 0.001)
+			nanosleep(&(struct timespec){ 0, (long)(seconds * 1e9) },NULL);
+	}
+}
+
+/****************************************************************************/
+
+/* Frame handler, invoked through the receive function of the capture
+ * backend. Each DHCP DISCOVER message provides what the frames which
+ * are sent from then on have to answer. The first one starts the replay.
+ */
+static bool
+frame_received(const struct capture_frame * frame,void * user_data)
+{
+	struct replayer * replayer = user_data;
+	const struct ether_header * ethernet_frame = (const struct ether_header *)frame->data;
+	const struct ip * ip_packet = (const struct ip *)&ethernet_frame[1];
+	const struct udphdr * udp_packet;
+	const bootp_t * dhcp;
+	struct dhcp_message message;
+	size_t offset;
+	int length;
+
+	if(frame->length < sizeof(*ethernet_frame) + sizeof(*ip_packet) + sizeof(*udp_packet))
+		goto out;
+
+	if(ntohs(ethernet_frame->ether_type) != ETHERTYPE_IP || ip_packet->ip_p != IPPROTO_UDP)
+		goto out;
+
+	offset = sizeof(*ethernet_frame) + ip_packet->ip_hl * 4;
+	if(offset + sizeof(*udp_packet) > frame->length)
+		goto out;
+
+	udp_packet = (const struct udphdr *)&frame->data[offset];
+
+	/* The frames sent are captured, too. */
+	if(ntohs(udp_packet->uh_dport) != DEFAULT_BOOTP_SERVER_PORT)
+		goto out;
+
+	offset += sizeof(*udp_packet);
+
+	length = ntohs(udp_packet->uh_ulen) - (int)sizeof(*udp_packet);
+	if(length < (int)sizeof(bootp_t) || offset + length > frame->length)
+		goto out;
+
+	if(decode_dhcp_message(&message, &frame->data[offset], length) < 0)
+		goto out;
+
+	if(message.opcode != BOOTREQUEST || !message.has_magic_cookie || message.message_type != MESSAGE_TYPE_DISCOVER)
+		goto out;
+
+	dhcp = (const bootp_t *)&frame->data[offset];
+
+	memmove(replayer->transaction_id,&dhcp->xid,sizeof(replayer->transaction_id));
+	memmove(replayer->client_mac_address,dhcp->chaddr,ETHER_ADDR_LEN);
+	memmove(replayer->source_mac_address,ethernet_frame->ether_shost,ETHER_ADDR_LEN);
+
+	replayer->num_discovers++;
+
+	if(!replayer->started)
+	{
+		clock_gettime(CLOCK_MONOTONIC,&replayer->loop_started);
+
+		replayer->started = true;
+	}
+
+ out:
+
+	return(true);
+}
+
+/****************************************************************************/
+
+/* Look for the statistics which find-dhcp-servers prints for each network
+ * interface it scanned, and add them up.
+ */
+static void
+parse_command_output(struct replayer * replayer,const char * line)
+{
+	unsigned long long received,processed,dropped;
+	const char * s;
+
+	s = strstr(line," received ");
+	if(s != NULL && sscanf(s," received %llu frames, of which %llu were processed and %llu were dropped",&received,&processed,&dropped) == 3)
+	{
+		replayer->frames_received	+= received;
+		replayer->frames_processed	+= processed;
+		replayer->frames_dropped	+= dropped;
+
+		replayer->have_stats = true;
+	}
+}
+
+/****************************************************************************/
+
+/* Pass on the output of the command, a line at a time. Returns -1 once
+ * the command has closed its output, and 0 otherwise.
+ */
+static int
+read_command_output(struct replayer * replayer)
+{
+	char buffer[4096];
+	ssize_t n;
+	ssize_t i;
+	int result = -1;
+
+	n = read(replayer->command_fd,buffer,sizeof(buffer));
+	if(n < 0)
+	{
+		if(errno == EINTR || errno == EAGAIN)
+			result = 0;
+
+		goto out;
+	}
+
+	if(n == 0)
+		goto out;
+
+	fwrite(buffer,1,(size_t)n,stdout);
+	fflush(stdout);
+
+	for(i = 0 ; i < n ; i++)
+	{
+		if(buffer[i] == '\n')
+		{
+			replayer->line[replayer->line_length] = '\0';
+			parse_command_output(replayer,replayer->line);
+
+			replayer->line_length = 0;
+		}
+		else if (replayer->line_length < sizeof(replayer->line) - 1)
+		{
+			replayer->line[replayer->line_length++] = buffer[i];
+		}
+	}
+
+	result = 0;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Start the command, with its output going through a pipe. Returns -1
+ * in case of error, and 0 otherwise.
+ */
+static int
+start_command(struct replayer * replayer,char ** argv)
+{
+	int fd[2] = { -1, -1 };
+	int result = -1;
+	pid_t pid;
+
+	if(pipe(fd) < 0)
+	{
+		fprintf(stderr,"%s: Could not run '%s' (%s).\n",command_name,argv[0],strerror(errno));
+		goto out;
+	}
+
+	fflush(stdout);
+
+	pid = fork();
+	if(pid < 0)
+	{
+		fprintf(stderr,"%s: Could not run '%s' (%s).\n",command_name,argv[0],strerror(errno));
+		goto out;
+	}
+
+	if(pid == 0)
+	{
+		close(fd[0]);
+
+		if(dup2(fd[1],STDOUT_FILENO) < 0)
+			_exit(127);
+
+		close(fd[1]);
+
+		execvp(argv[0],argv);
+
+		fprintf(stderr,"%s: Could not run '%s' (%s).\n",command_name,argv[0],strerror(errno));
+		_exit(127);
+	}
+
+	close(fd[1]);
+	fd[1] = -1;
+
+	replayer->command_pid = pid;
+	replayer->command_fd = fd[0];
+	fd[0] = -1;
+
+	result = 0;
+
+ out:
+
+	if(fd[0] != -1)
+		close(fd[0]);
+
+	if(fd[1] != -1)
+		close(fd[1]);
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Replay the frames, and keep passing on the output of the command until
+ * it exits. Returns -1 in case of error, and 0 otherwise.
+ */
+static int
+run_replay(struct replayer * replayer)
+{
+	struct pollfd pfd[2];
+	int command_index;
+	int num_fds;
+	int status;
+	int result = -1;
+
+	while(true)
+	{
+		/* Once all the frames have been sent, only the command is
+		 * still of interest.
+		 */
+		if(replayer->started && is_replay_done(replayer) && replayer->command_fd == -1)
+			break;
+
+		num_fds = 0;
+
+		if(!is_replay_done(replayer))
+		{
+			pfd[num_fds].fd = (*replayer->backend->get_fd)(replayer->capture);
+			pfd[num_fds].events = POLLIN;
+			pfd[num_fds].revents = 0;
+			num_fds++;
+		}
+
+		command_index = -1;
+
+		if(replayer->command_fd != -1)
+		{
+			command_index = num_fds;
+
+			pfd[num_fds].fd = replayer->command_fd;
+			pfd[num_fds].events = POLLIN;
+			pfd[num_fds].revents = 0;
+			num_fds++;
+		}
+
+		if(poll(pfd,num_fds,is_replay_done(replayer) ? -1 : get_poll_timeout(replayer)) < 0)
+		{
+			if(errno == EINTR)
+				continue;
+
+			fprintf(stderr,"%s: %s.\n",command_name,strerror(errno));
+			goto out;
+		}
+
+		/* The command may have finished before all the frames were
+		 * sent, in which case the replay ends, too.
+		 */
+		if(command_index != -1 && pfd[command_index].revents != 0 && read_command_output(replayer) < 0)
+		{
+			close(replayer->command_fd);
+			replayer->command_fd = -1;
+
+			waitpid(replayer->command_pid,&status,0);
+			replayer->command_pid = -1;
+
+			break;
+		}
+
+		if(is_replay_done(replayer))
+			continue;
+
+		if((*replayer->backend->receive)(replayer->capture, -1, frame_received, replayer) < 0)
+		{
+			fprintf(stderr,"%s: %s.\n",command_name,(*replayer->backend->get_error)(replayer->capture));
+			goto out;
+		}
+
+		if(!replayer->started)
+			continue;
+
+		wait_for_next_frame(replayer);
+
+		switch(send_due_frames(replayer))
+		{
+			case -1:
+
+				goto out;
+
+			case 1:
+
+				poll(NULL,0,RETRY_INTERVAL);
+				break;
+		}
+	}
+
+	result = 0;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+static void
+print_usage(void)
+{
+	printf("Usage: %s "
+		"[--capture=<backend>] "
+		"[--loop=<number>] "
+		"[--max-rate] "
+		"[--speed=<factor>] "
+		"[--help] "
+		"file interface [command [argument ...]]\n",
+		command_name);
+}
+
+/****************************************************************************/
+
+int
+main(int argc, char *argv[])
+{
+	static const struct option longopts[] =
+	{
+		{ "capture",	required_argument,	NULL,	'k'	},
+		{ "help",		no_argument,		NULL,	'h'	},
+		{ "loop",		required_argument,	NULL,	'l'	},
+		{ "max-rate",	no_argument,		NULL,	'm'	},
+		{ "speed",		required_argument,	NULL,	's'	},
+		{ NULL,			0,					NULL,	0	}
+	};
+
+	char error_buffer[CAPTURE_ERROR_SIZE];
+	struct replayer replayer;
+	struct savefile file;
+	const char * interface_name;
+	const char * file_name;
+	double seconds;
+	int result = EXIT_FAILURE;
+	const char * s;
+	char * p;
+	double d;
+	long n;
+	int c;
+	int i;
+
+	/* Figure out the name of this command. Strip any
+	 * leading path from it.
+	 */
+	command_name = argv[0];
+
+	s = strrchr(command_name, '/');
+	if(s != NULL)
+		command_name = s+1;
+
+	memset(&file,0,sizeof(file));
+	memset(&replayer,0,sizeof(replayer));
+
+	replayer.backend = get_default_capture_backend();
+	replayer.num_loops = 1;
+	replayer.speed = 1;
+	replayer.command_pid = -1;
+	replayer.command_fd = -1;
+
+	/* The options of the command which follows must not be taken
+	 * for options of our own.
+	 */
+	while((c = getopt_long(argc,argv,"+hk:l:ms:",longopts,NULL)) != -1)
+	{
+		switch(c)
+		{
+			/* Print the usage information. */
+			case 'h':
+
+				print_usage();
+
+				result = EXIT_SUCCESS;
+				goto out;
+
+			/* How to capture and send frames. */
+			case 'k':
+
+				replayer.backend = find_capture_backend(optarg);
+				if(replayer.backend == NULL)
+				{
+					fprintf(stderr,"%s: Parameter '--capture=%s' is not valid.\n",command_name,optarg);
+					goto out;
+				}
+
+				break;
+
+			/* How often to send the frames in the file. */
+			case 'l':
+
+				n = strtol(optarg,&p,0);
+				if(p == optarg || (*p) != '\0' || n < 1 || n > INT_MAX)
+				{
+					fprintf(stderr,"%s: Parameter '--loop=%s' is not valid.\n",command_name,optarg);
+					goto out;
+				}
+
+				replayer.num_loops = (int)n;
+				break;
+
+			/* Send the frames as fast as possible. */
+			case 'm':
+
+				replayer.speed = 0;
+				break;
+
+			/* How much faster than recorded to send the frames. */
+			case 's':
+
+				d = strtod(optarg,&p);
+				if(p == optarg || (*p) != '\0' || !(d > 0))
+				{
+					fprintf(stderr,"%s: Parameter '--speed=%s' is not valid.\n",command_name,optarg);
+					goto out;
+				}
+
+				replayer.speed = d;
+				break;
+
+			default:
+
+				fprintf(stderr,"%s: %s - %s\n",command_name,optarg,"option not known");
+				goto out;
+		}
+	}
+
+	argc -= optind;
+	argv += optind;
+
+	if(argc < 2)
+	{
+		print_usage();
+		goto out;
+	}
+
+	file_name = argv[0];
+	interface_name = argv[1];
+
+	if(read_savefile(file_name,&file,error_buffer,sizeof(error_buffer)) < 0)
+	{
+		fprintf(stderr,"%s: Could not read '%s' (%s).\n",command_name,file_name,error_buffer);
+		goto out;
+	}
+
+	if(file.num_frames == 0)
+	{
+		fprintf(stderr,"%s: '%s' does not contain any frames.\n",command_name,file_name);
+		goto out;
+	}
+
+	replayer.frames = calloc(file.num_frames,sizeof(*replayer.frames));
+	if(replayer.frames == NULL)
+	{
+		fprintf(stderr,"%s: Not enough memory.\n",command_name);
+		goto out;
+	}
+
+	replayer.num_frames = file.num_frames;
+
+	for(i = 0 ; i < file.num_frames ; i++)
+	{
+		replayer.frames[i].frame = &file.frames[i];
+
+		/* Frames which were recorded out of order are sent right
+		 * after the frame before them.
+		 */
+		seconds = (file.frames[i].stamp.tv_sec - file.frames[0].stamp.tv_sec) + (file.frames[i].stamp.tv_usec - file.frames[0].stamp.tv_usec) / 1e6;
+		if(i > 0 && seconds < replayer.frames[i-1].offset)
+			seconds = replayer.frames[i-1].offset;
+
+		replayer.frames[i].offset = seconds;
+
+		classify_frame(&replayer.frames[i]);
+
+		if(replayer.frames[i].what == FRAME_SKIP)
+			replayer.num_frames_skipped++;
+	}
+
+	replayer.capture = (*replayer.backend->open)(interface_name, ETHER_MAX_LEN, NULL, error_buffer, sizeof(error_buffer));
+	if(replayer.capture == NULL)
+	{
+		fprintf(stderr,"%s: Could not capture on '%s' (%s).\n",command_name,interface_name,error_buffer);
+		goto out;
+	}
+
+	if((*replayer.backend->attach_filter)(replayer.capture, DEFAULT_BOOTP_SERVER_PORT) < 0)
+	{
+		fprintf(stderr,"%s: %s.\n",command_name,(*replayer.backend->get_error)(replayer.capture));
+		goto out;
+	}
+
+	/* The command starts only now, so that its DHCP DISCOVER message
+	 * cannot be missed.
+	 */
+	if(argc > 2 && start_command(&replayer,&argv[2]) < 0)
+		goto out;
+
+	if(run_replay(&replayer) < 0)
+		goto out;
+
+	/* Report how fast the frames were offered, and how many of them the
+	 * scan got to see.
+	 */
+	seconds = get_seconds_between(&replayer.first_sent,&replayer.last_sent);
+
+	printf("%s: Sent %lu frames in %.3f seconds",command_name,replayer.num_frames_sent,seconds);
+
+	if(seconds > 0)
+		printf(" (%.0f frames/s)",replayer.num_frames_sent / seconds);
+
+	printf(", answering %lu DHCP DISCOVER messages",replayer.num_discovers);
+
+	if(replayer.num_frames_skipped > 0)
+		printf("; %d frames in the file were not sent",replayer.num_frames_skipped);
+
+	printf(".\n");
+
+	if(replayer.have_stats)
+	{
+		printf("%s: The scan received %llu frames and processed %llu",command_name,replayer.frames_received,replayer.frames_processed);
+
+		if(seconds > 0)
+			printf(" (%.0f frames/s)",replayer.frames_processed / seconds);
+
+		if(replayer.num_frames_sent > 0)
+			printf(", %.1f%% of those sent",100.0 * replayer.frames_processed / replayer.num_frames_sent);
+
+		printf("; %llu were dropped by the kernel.\n",replayer.frames_dropped);
+	}
+	else if (argc > 2)
+	{
+		printf("%s: The command did not report how many frames it processed; use find-dhcp-servers with the --verbose option.\n",command_name);
+	}
+
+	result = EXIT_SUCCESS;
+
+ out:
+
+	if(replayer.command_fd != -1)
+		close(replayer.command_fd);
+
+	if(replayer.command_pid != -1)
+		waitpid(replayer.command_pid,NULL,0);
+
+	if(replayer.capture != NULL)
+		(*replayer.backend->close)(replayer.capture);
+
+	free(replayer.frames);
+
+	free_savefile(&file);
+
+	return(result);
+}
@@ -0,0 +1,104 @@
+/*
+ * Run a command and report how long it took, how much CPU time it used
+ * and how much memory it needed at most, for the benchmarks which run
+ * whole commands rather than functions. This does what 'time -v' does,
+ * for systems which lack GNU time.
+ *
+ * The measurements are printed to the standard error output once the
+ * command has exited, as a single line:
+ *
+ *     wall-time=0.052114 user-time=0.004000 system-time=0.012000 peak-rss=3912
+ *
+ * The times are in seconds and the peak resident set size in kilobytes.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <stdio.h>
+#include <time.h>
+
+/****************************************************************************/
+
+static double
+get_seconds(const struct timeval * tv)
+{
+	return(tv->tv_sec + tv->tv_usec / 1e6);
+}
+
+/****************************************************************************/
+
+int
+main(int argc,char ** argv)
+{
+	struct timespec start,stop;
+	struct rusage usage;
+	int status;
+	pid_t pid;
+	int result = EXIT_FAILURE;
+
+	if(argc < 2)
+	{
+		fprintf(stderr,"Usage: %s command [argument ...]\n",argv[0]);
+		goto out;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC,&start);
+
+	pid = fork();
+	if(pid < 0)
+	{
+		perror("fork");
+		goto out;
+	}
+
+	if(pid == 0)
+	{
+		execvp(argv[1],&argv[1]);
+
+		fprintf(stderr,"%s: Could not run '%s' (%s).\n",argv[0],argv[1],strerror(errno));
+		_exit(127);
+	}
+
+	while(wait4(pid,&status,0,&usage) < 0)
+	{
+		if(errno != EINTR)
+		{
+			perror("wait4");
+			goto out;
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC,&stop);
+
+	/* ru_maxrss is in kilobytes on Linux and FreeBSD, but in bytes on
+	 * Mac OS X.
+	 */
+#ifdef __APPLE__
+	usage.ru_maxrss /= 1024;
+#endif /* __APPLE__ */
+
+	fprintf(stderr,"wall-time=%.6f user-time=%.6f system-time=%.6f peak-rss=%ld\n",
+		(stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) / 1e9,
+		get_seconds(&usage.ru_utime),get_seconds(&usage.ru_stime),(long)usage.ru_maxrss);
+
+	/* Pass on how the command fared. */
+	if(WIFEXITED(status))
+		result = WEXITSTATUS(status);
+	else
+		result = 128 + WTERMSIG(status);
+
+ out:
+
+	return(result);
+}
@@ -0,0 +1,165 @@
+#!/bin/sh
+#
+# Measure how find-dhcp-servers copes as the number of DHCP servers which
+# respond to it grows. A network namespace is set up with a veth pair,
+# fake-dhcp-servers answers as 1, 10, 100, 1000 and 10000 servers at one
+# end, and find-dhcp-servers scans the other end, once with each capture
+# backend and output format. Each run is reported on a single line:
+#
+#     servers=100 capture=packet format=stream time-to-first-offer=0.001 time-to-complete=0.034 cpu-time=0.012 peak-rss=3912 missed-servers=0
+#
+# time-to-first-offer is how long it took from the DHCP discover message
+# until the first offer arrived, as reported by the scan. time-to-complete
+# is how long the command ran, from start to exit, including printing the
+# responses. cpu-time is the user and system time it used, in seconds,
+# and peak-rss the most memory it held, in kilobytes. missed-servers is
+# the number of servers whose offers never made it into the results.
+#
+# The scan waits for as many responses as there are servers, and gives up
+# after 10 seconds. This requires root privileges and is supported only
+# on Linux. Enter 'make bench-scale' to build the commands and run it.
+#
+# License : BSD
+#
+# :ts=4
+
+usage()
+{
+	echo "Usage: $0 [-s \"<servers> ...\"] [-c \"<backend> ...\"] [-f \"<format> ...\"] [-r <backend>] [-t <seconds>]" >&2
+	exit 1
+}
+
+servers="1 10 100 1000 10000"
+backends="pcap packet"
+formats="report stream"
+responder_backend="packet"
+timeout=10
+
+while getopts "s:c:f:r:t:" option
+do
+	case "$option" in
+		s)	servers="$OPTARG" ;;
+		c)	backends="$OPTARG" ;;
+		f)	formats="$OPTARG" ;;
+		r)	responder_backend="$OPTARG" ;;
+		t)	timeout="$OPTARG" ;;
+		*)	usage ;;
+	esac
+done
+
+for command in ./find-dhcp-servers ./fake-dhcp-servers ./bench/run_measured
+do
+	if [ ! -x "$command" ]
+	then
+		echo "$0: $command is missing; enter 'make bench-scale' first." >&2
+		exit 1
+	fi
+done
+
+if [ "$(id -u)" != "0" ]
+then
+	echo "$0: Setting up a network namespace requires root privileges." >&2
+	exit 1
+fi
+
+netns="find-dhcp-servers-bench"
+scan_interface="fds-scan"
+serve_interface="fds-serve"
+
+work_directory=$(mktemp -d) || exit 1
+responder_pid=""
+
+cleanup()
+{
+	if [ -n "$responder_pid" ]
+	then
+		kill "$responder_pid" 2>/dev/null
+		wait "$responder_pid" 2>/dev/null
+	fi
+
+	ip netns delete "$netns" 2>/dev/null
+	rm -rf "$work_directory"
+}
+
+trap cleanup EXIT
+trap 'exit 1' INT TERM
+
+# Everything happens inside the namespace, so that none of the host's own
+# network interfaces are touched, and deleting the namespace removes the
+# veth pair again.
+ip netns delete "$netns" 2>/dev/null
+
+if ! ip netns add "$netns" ||
+   ! ip -n "$netns" link add "$scan_interface" type veth peer name "$serve_interface" ||
+   ! ip -n "$netns" link set "$scan_interface" up ||
+   ! ip -n "$netns" link set "$serve_interface" up
+then
+	echo "$0: Could not set up the network namespace." >&2
+	exit 1
+fi
+
+for num_servers in $servers
+do
+	ip netns exec "$netns" ./fake-dhcp-servers --quiet --capture="$responder_backend" \
+		--servers="$num_servers" "$serve_interface" 2>"$work_directory/responder.err" &
+	responder_pid=$!
+
+	# Give the fake servers a moment to start capturing.
+	sleep 1
+
+	if ! kill -0 "$responder_pid" 2>/dev/null
+	then
+		echo "$0: fake-dhcp-servers did not start: $(cat "$work_directory/responder.err")" >&2
+		responder_pid=""
+		exit 1
+	fi
+
+	for backend in $backends
+	do
+		for format in $formats
+		do
+			case "$format" in
+				report)	format_option="" ;;
+				stream)	format_option="--stream" ;;
+				*)		echo "$0: Output format '$format' is not known." >&2 ; exit 1 ;;
+			esac
+
+			ip netns exec "$netns" ./bench/run_measured ./find-dhcp-servers --verbose \
+				--capture="$backend" --max-responses="$num_servers" --timeout="$timeout" \
+				$format_option "$scan_interface" >"$work_directory/scan.out" 2>"$work_directory/scan.err"
+
+			summary=$(grep "Scanned network interface" "$work_directory/scan.out")
+			measurements=$(grep "^wall-time=" "$work_directory/scan.err")
+
+			if [ -z "$summary" ] || [ -z "$measurements" ]
+			then
+				echo "servers=$num_servers capture=$backend format=$format skipped: $(grep -v "^wall-time=" "$work_directory/scan.err" | head -n 1)"
+				continue
+			fi
+
+			echo "$summary" "$measurements" | awk -v servers="$num_servers" -v backend="$backend" -v format="$format" '
+			{
+				responded = 0
+				first = "-"
+
+				for(i = 1 ; i <= NF ; i++)
+				{
+					if($i == "DHCP" && $(i+1) == "servers" && $(i+2) == "responded,")
+						responded = $(i-1)
+					else if($i == "first" && $(i+1) == "after")
+						first = $(i+2)
+					else if(split($i, pair, "=") == 2)
+						value[pair[1]] = pair[2]
+				}
+
+				printf("servers=%d capture=%s format=%s time-to-first-offer=%s time-to-complete=%.3f cpu-time=%.3f peak-rss=%d missed-servers=%d\n",
+					servers, backend, format, first, value["wall-time"],
+					value["user-time"] + value["system-time"], value["peak-rss"], servers - responded)
+			}'
+		done
+	done
+
+	kill "$responder_pid" 2>/dev/null
+	wait "$responder_pid" 2>/dev/null
+	responder_pid=""
+done
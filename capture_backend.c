@@ -0,0 +1,133 @@
+/*
+ * Ways of capturing and sending Ethernet frames on a network interface.
+ *
+ * libpcap works on every platform and is used unless another backend is
+ * asked for. On Linux, frames may also be captured and sent through a
+ * packet socket directly, which handles a whole batch of frames with
+ * each system call.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+
+/****************************************************************************/
+
+#include "capture_backend.h"
+
+/****************************************************************************/
+
+/* All the backends available, the default one first. */
+static const struct capture_backend * const capture_backends[] =
+{
+	&pcap_capture_backend,
+	#if defined(__linux__)
+	&packet_capture_backend,
+	#endif /* __linux__ */
+	NULL
+};
+
+/****************************************************************************/
+
+/* The backend to use unless another one is asked for. */
+const struct capture_backend *
+get_default_capture_backend(void)
+{
+	return(capture_backends[0]);
+}
+
+/****************************************************************************/
+
+/* Look up a backend by its position in the list of those available,
+ * counting from 0. Returns NULL past the end of the list.
+ */
+const struct capture_backend *
+get_capture_backend(int index)
+{
+	const struct capture_backend * result = NULL;
+	int i;
+
+	for(i = 0 ; i <= index && capture_backends[i] != NULL ; i++)
+	{
+		if(i == index)
+			result = capture_backends[i];
+	}
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Look up a backend by name. Returns NULL if there is no such backend. */
+const struct capture_backend *
+find_capture_backend(const char * name)
+{
+	const struct capture_backend * result = NULL;
+	int i;
+
+	for(i = 0 ; capture_backends[i] != NULL ; i++)
+	{
+		if(strcmp(capture_backends[i]->name,name) == 0)
+		{
+			result = capture_backends[i];
+			break;
+		}
+	}
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Have the kernel busy-poll the network device for up to the given
+ * number of microseconds when reading from the socket finds no frames
+ * ready, rather than waiting for the device to raise an interrupt.
+ * This trades CPU time for latency, and only helps with devices whose
+ * drivers support it. Returns -1 in case of error, with a description
+ * of the problem placed in the error buffer.
+ */
+int
+set_capture_busy_poll(int fd,int microseconds,char * error_buffer,size_t error_buffer_size)
+{
+	int result = -1;
+
+	if(fd < 0)
+	{
+		snprintf(error_buffer,error_buffer_size,"cannot enable busy polling (%s)","no socket to enable it for");
+		goto out;
+	}
+
+	#if defined(SO_BUSY_POLL)
+	{
+		/* Permitting more than the system default requires the
+		 * CAP_NET_ADMIN capability.
+		 */
+		if(setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &microseconds, sizeof(microseconds)) == -1)
+		{
+			snprintf(error_buffer,error_buffer_size,"cannot enable busy polling (%s)",strerror(errno));
+			goto out;
+		}
+	}
+	#else
+	{
+		(void)microseconds;
+
+		snprintf(error_buffer,error_buffer_size,"cannot enable busy polling (%s)","not supported on this platform");
+		goto out;
+	}
+	#endif /* SO_BUSY_POLL */
+
+	result = 0;
+
+ out:
+
+	return(result);
+}
@@ -0,0 +1,125 @@
+/*
+ * Ways of capturing and sending Ethernet frames on a network interface.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#ifndef _CAPTURE_BACKEND_H
+#define _CAPTURE_BACKEND_H
+
+/****************************************************************************/
+
+#include <sys/time.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/****************************************************************************/
+
+/* How large the error buffer of a capture handle should be. */
+#define CAPTURE_ERROR_SIZE 256
+
+/****************************************************************************/
+
+/* An Ethernet frame, either captured or to be sent. */
+struct capture_frame
+{
+	struct timeval		stamp;		/* When it was captured */
+	const uint8_t *		data;
+	size_t				length;
+};
+
+/* How many frames the capture processed and lost. */
+struct capture_stats
+{
+	uint64_t	received;
+	uint64_t	dropped;
+};
+
+/* How a capture should be opened. */
+struct capture_options
+{
+	/* Hand over each frame as soon as it arrives, rather than waiting
+	 * briefly for more to arrive so that they may be read together.
+	 */
+	bool	low_latency;
+
+	/* How long (in microseconds) the kernel may busy-poll the network
+	 * device for frames when a read finds none ready; 0 for not at all.
+	 */
+	int		busy_poll;
+};
+
+/* Invoked for each frame captured. Returns false to stop receiving more
+ * of the frames which are ready to be read.
+ */
+typedef bool (*capture_frame_function)(const struct capture_frame *frame, void *user_data);
+
+/****************************************************************************/
+
+struct capture_handle;
+
+/* The operations every backend supports. Each function which returns an
+ * int returns -1 in case of error, with a description of the problem
+ * available through get_error().
+ */
+struct capture_backend
+{
+	const char * name;
+
+	/* Open the named network interface, capturing up to snapshot_length
+	 * octets of each frame, with the options given (the defaults if
+	 * NULL). Reading frames must not block. Returns NULL in case of
+	 * error, with a description of the problem placed in the error
+	 * buffer.
+	 */
+	struct capture_handle *(*open)(const char *interface_name, int snapshot_length, const struct capture_options *options, char *error_buffer, size_t error_buffer_size);
+
+	/* Capture only UDP datagrams sent from or to the given port. */
+	int (*attach_filter)(struct capture_handle *handle, uint16_t udp_port);
+
+	/* The file descriptor to poll() for frames to arrive, or -1 if
+	 * there is none and the capture has to be checked periodically.
+	 */
+	int (*get_fd)(const struct capture_handle *handle);
+
+	/* Invoke the function for each of the frames which are ready to be
+	 * read, up to max_frames of them (or all if -1), without waiting.
+	 * Returns the number of frames processed.
+	 */
+	int (*receive)(struct capture_handle *handle, int max_frames, capture_frame_function function, void *user_data);
+
+	/* Send the frames given, in this order. Returns the number of frames
+	 * sent, which may be fewer than requested if the send buffer is full.
+	 */
+	int (*transmit)(struct capture_handle *handle, const struct capture_frame *frames, int num_frames);
+
+	/* Fill in the statistics of the capture, as far as they are known. */
+	int (*get_stats)(struct capture_handle *handle, struct capture_stats *stats);
+
+	const char *(*get_error)(const struct capture_handle *handle);
+
+	void (*close)(struct capture_handle *handle);
+};
+
+/****************************************************************************/
+
+extern const struct capture_backend pcap_capture_backend;
+
+#if defined(__linux__)
+extern const struct capture_backend packet_capture_backend;
+#endif /* __linux__ */
+
+/****************************************************************************/
+
+const struct capture_backend *get_default_capture_backend(void);
+const struct capture_backend *get_capture_backend(int index);
+const struct capture_backend *find_capture_backend(const char *name);
+int set_capture_busy_poll(int fd, int microseconds, char *error_buffer, size_t error_buffer_size);
+
+/****************************************************************************/
+
+#endif /* _CAPTURE_BACKEND_H */
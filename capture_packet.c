@@ -0,0 +1,451 @@
+/*
+ * Capture and send Ethernet frames through a Linux packet socket.
+ *
+ * Unlike libpcap, which reads and sends one frame per system call, this
+ * reads a whole batch of frames with recvmmsg() and sends a whole batch
+ * with sendmmsg(). The UDP port filter is a classic BPF program, built
+ * here rather than compiled from a filter expression.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#if defined(__linux__)
+
+/****************************************************************************/
+
+/* This is needed for recvmmsg() and sendmmsg(). */
+#define _GNU_SOURCE
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <net/ethernet.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <linux/filter.h>
+#include <linux/if_packet.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+
+#include <unistd.h>
+
+/****************************************************************************/
+
+#include "capture_backend.h"
+
+/****************************************************************************/
+
+/* Most frames read or sent with one system call. */
+#define MAX_BATCH_SIZE 64
+
+/* How much memory the frames read in one batch may take up. On interfaces
+ * with a very large MTU, such as the loopback interface, the batches are
+ * smaller.
+ */
+#define MAX_BATCH_MEMORY (256 * 1024)
+
+/* How much the kernel may buffer for the socket, which is the same as
+ * libpcap uses by default.
+ */
+#define RECEIVE_BUFFER_SIZE (2 * 1024 * 1024)
+
+/****************************************************************************/
+
+struct capture_handle
+{
+	int					fd;
+	int					snapshot_length;
+	int					batch_size;
+
+	/* Room for reading a whole batch of frames at once. */
+	uint8_t *			buffer;
+	struct mmsghdr		messages[MAX_BATCH_SIZE];
+	struct iovec		vectors[MAX_BATCH_SIZE];
+	union
+	{
+		struct cmsghdr	header;
+		uint8_t			data[CMSG_SPACE(sizeof(struct timeval))];
+	}					control[MAX_BATCH_SIZE];
+
+	/* Reading the kernel statistics resets them. */
+	struct capture_stats	stats;
+
+	char				error_buffer[CAPTURE_ERROR_SIZE];
+};
+
+/****************************************************************************/
+
+static void
+packet_backend_close(struct capture_handle * handle)
+{
+	if(handle != NULL)
+	{
+		if(handle->fd != -1)
+			close(handle->fd);
+
+		free(handle->buffer);
+		free(handle);
+	}
+}
+
+/****************************************************************************/
+
+static struct capture_handle *
+packet_backend_open(const char * interface_name,int snapshot_length,const struct capture_options * options,
+	char * error_buffer,size_t error_buffer_size)
+{
+	struct capture_handle * result = NULL;
+	struct capture_handle * handle;
+	struct sockaddr_ll address;
+	unsigned int index;
+	int size = RECEIVE_BUFFER_SIZE;
+	int on = 1;
+
+	handle = calloc(1,sizeof(*handle));
+	if(handle == NULL)
+	{
+		snprintf(error_buffer,error_buffer_size,"%s",strerror(errno));
+		goto out;
+	}
+
+	handle->fd = -1;
+
+	index = if_nametoindex(interface_name);
+	if(index == 0)
+	{
+		snprintf(error_buffer,error_buffer_size,"%s: %s",interface_name,strerror(errno));
+		goto out;
+	}
+
+	handle->snapshot_length = snapshot_length;
+
+	handle->batch_size = MAX_BATCH_MEMORY / snapshot_length;
+	if(handle->batch_size > MAX_BATCH_SIZE)
+		handle->batch_size = MAX_BATCH_SIZE;
+	else if (handle->batch_size < 1)
+		handle->batch_size = 1;
+
+	handle->buffer = malloc((size_t)handle->batch_size * snapshot_length);
+	if(handle->buffer == NULL)
+	{
+		snprintf(error_buffer,error_buffer_size,"%s",strerror(errno));
+		goto out;
+	}
+
+	handle->fd = socket(PF_PACKET, SOCK_RAW|SOCK_NONBLOCK|SOCK_CLOEXEC, htons(ETH_P_ALL));
+	if(handle->fd == -1)
+	{
+		snprintf(error_buffer,error_buffer_size,"cannot open packet socket (%s)",strerror(errno));
+		goto out;
+	}
+
+	/* Each frame read comes with the time when it was captured. */
+	if(setsockopt(handle->fd, SOL_SOCKET, SO_TIMESTAMP, &on, sizeof(on)) == -1)
+	{
+		snprintf(error_buffer,error_buffer_size,"cannot enable time stamps (%s)",strerror(errno));
+		goto out;
+	}
+
+	/* Without privileges, the buffer may end up smaller than requested,
+	 * which is not worth failing over.
+	 */
+	if(setsockopt(handle->fd, SOL_SOCKET, SO_RCVBUFFORCE, &size, sizeof(size)) == -1)
+		(void)setsockopt(handle->fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+
+	/* Frames are handed over as soon as they arrive anyway, which is
+	 * why there is nothing else to do for low latency.
+	 */
+	if(options != NULL && options->busy_poll > 0 && set_capture_busy_poll(handle->fd, options->busy_poll, error_buffer, error_buffer_size) < 0)
+		goto out;
+
+	memset(&address,0,sizeof(address));
+
+	address.sll_family		= AF_PACKET;
+	address.sll_protocol	= htons(ETH_P_ALL);
+	address.sll_ifindex		= (int)index;
+
+	if(bind(handle->fd, (struct sockaddr *)&address, sizeof(address)) == -1)
+	{
+		snprintf(error_buffer,error_buffer_size,"%s: %s",interface_name,strerror(errno));
+		goto out;
+	}
+
+	result = handle;
+	handle = NULL;
+
+ out:
+
+	packet_backend_close(handle);
+
+	return(result);
+}
+
+/****************************************************************************/
+
+static int
+packet_backend_attach_filter(struct capture_handle * handle,uint16_t udp_port)
+{
+	/* The same as "udp port <udp_port>" for IPv4 frames, which means that
+	 * only the first fragment of a UDP datagram is accepted.
+	 */
+	struct sock_filter instructions[] =
+	{
+		BPF_STMT(BPF_LD|BPF_H|BPF_ABS, 12),						/* Ethernet type */
+		BPF_JUMP(BPF_JMP|BPF_JEQ|BPF_K, ETHERTYPE_IP, 0, 10),
+		BPF_STMT(BPF_LD|BPF_B|BPF_ABS, 23),						/* IP protocol */
+		BPF_JUMP(BPF_JMP|BPF_JEQ|BPF_K, IPPROTO_UDP, 0, 8),
+		BPF_STMT(BPF_LD|BPF_H|BPF_ABS, 20),						/* Fragment offset */
+		BPF_JUMP(BPF_JMP|BPF_JSET|BPF_K, 0x1fff, 6, 0),
+		BPF_STMT(BPF_LDX|BPF_B|BPF_MSH, 14),					/* IP header length */
+		BPF_STMT(BPF_LD|BPF_H|BPF_IND, 14),						/* UDP source port */
+		BPF_JUMP(BPF_JMP|BPF_JEQ|BPF_K, udp_port, 2, 0),
+		BPF_STMT(BPF_LD|BPF_H|BPF_IND, 16),						/* UDP destination port */
+		BPF_JUMP(BPF_JMP|BPF_JEQ|BPF_K, udp_port, 0, 1),
+		BPF_STMT(BPF_RET|BPF_K, 0x40000),						/* Accept */
+		BPF_STMT(BPF_RET|BPF_K, 0)								/* Reject */
+	};
+
+	struct sock_fprog program;
+	uint8_t frame[1];
+	int result = -1;
+
+	program.len		= sizeof(instructions) / sizeof(instructions[0]);
+	program.filter	= instructions;
+
+	if(setsockopt(handle->fd, SOL_SOCKET, SO_ATTACH_FILTER, &program, sizeof(program)) == -1)
+	{
+		snprintf(handle->error_buffer,sizeof(handle->error_buffer),"cannot set up packet filter (%s)",strerror(errno));
+		goto out;
+	}
+
+	/* Frames which arrived before the filter was attached were not
+	 * filtered, and need to go.
+	 */
+	while(recv(handle->fd, frame, sizeof(frame), MSG_DONTWAIT|MSG_TRUNC) != -1)
+		continue;
+
+	result = 0;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+static int
+packet_backend_get_fd(const struct capture_handle * handle)
+{
+	return(handle->fd);
+}
+
+/****************************************************************************/
+
+/* The time when a frame was captured, as provided along with it. */
+static void
+get_frame_stamp(const struct msghdr * message,struct timeval * stamp)
+{
+	const struct cmsghdr * control;
+	bool found = false;
+
+	for(control = CMSG_FIRSTHDR(message) ; control != NULL && !found ; control = CMSG_NXTHDR((struct msghdr *)message,(struct cmsghdr *)control))
+	{
+		if(control->cmsg_level == SOL_SOCKET && control->cmsg_type == SCM_TIMESTAMP)
+		{
+			memcpy(stamp,CMSG_DATA(control),sizeof(*stamp));
+			found = true;
+		}
+	}
+
+	if(!found)
+		gettimeofday(stamp,NULL);
+}
+
+/****************************************************************************/
+
+/* Frames are read a batch at a time. If the function asks to stop, the
+ * rest of the batch is discarded.
+ */
+static int
+packet_backend_receive(struct capture_handle * handle,int max_frames,capture_frame_function function,void * user_data)
+{
+	struct capture_frame frame;
+	int result = -1;
+	int num_frames = 0;
+	int batch_size;
+	int n;
+	int i;
+
+	do
+	{
+		batch_size = handle->batch_size;
+		if(max_frames > 0 && max_frames - num_frames < batch_size)
+			batch_size = max_frames - num_frames;
+
+		for(i = 0 ; i < batch_size ; i++)
+		{
+			handle->vectors[i].iov_base	= &handle->buffer[(size_t)i * handle->snapshot_length];
+			handle->vectors[i].iov_len	= handle->snapshot_length;
+
+			memset(&handle->messages[i],0,sizeof(handle->messages[i]));
+
+			handle->messages[i].msg_hdr.msg_iov			= &handle->vectors[i];
+			handle->messages[i].msg_hdr.msg_iovlen		= 1;
+			handle->messages[i].msg_hdr.msg_control		= &handle->control[i];
+			handle->messages[i].msg_hdr.msg_controllen	= sizeof(handle->control[i]);
+		}
+
+		n = recvmmsg(handle->fd, handle->messages, batch_size, MSG_DONTWAIT, NULL);
+		if(n == -1)
+		{
+			if(errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+				break;
+
+			snprintf(handle->error_buffer,sizeof(handle->error_buffer),"%s",strerror(errno));
+			goto out;
+		}
+
+		for(i = 0 ; i < n ; i++)
+		{
+			get_frame_stamp(&handle->messages[i].msg_hdr,&frame.stamp);
+
+			frame.data		= handle->vectors[i].iov_base;
+			frame.length	= handle->messages[i].msg_len;
+
+			num_frames++;
+
+			if(!(*function)(&frame,user_data))
+				goto stop;
+		}
+	}
+	while(n == batch_size && (max_frames <= 0 || num_frames < max_frames));
+
+ stop:
+
+	result = num_frames;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+static int
+packet_backend_transmit(struct capture_handle * handle,const struct capture_frame * frames,int num_frames)
+{
+	struct mmsghdr messages[MAX_BATCH_SIZE];
+	struct iovec vectors[MAX_BATCH_SIZE];
+	int result = -1;
+	int num_sent = 0;
+	int batch_size;
+	int n;
+	int i;
+
+	while(num_sent < num_frames)
+	{
+		batch_size = num_frames - num_sent;
+		if(batch_size > MAX_BATCH_SIZE)
+			batch_size = MAX_BATCH_SIZE;
+
+		for(i = 0 ; i < batch_size ; i++)
+		{
+			vectors[i].iov_base	= (void *)frames[num_sent + i].data;
+			vectors[i].iov_len	= frames[num_sent + i].length;
+
+			memset(&messages[i],0,sizeof(messages[i]));
+
+			messages[i].msg_hdr.msg_iov		= &vectors[i];
+			messages[i].msg_hdr.msg_iovlen	= 1;
+		}
+
+		/* The frames go out through the interface the socket is bound to. */
+		n = sendmmsg(handle->fd, messages, batch_size, MSG_DONTWAIT);
+		if(n == -1)
+		{
+			/* The send buffer is full? */
+			if(errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS || errno == EINTR)
+				break;
+
+			if(num_sent == 0)
+			{
+				snprintf(handle->error_buffer,sizeof(handle->error_buffer),"%s",strerror(errno));
+				goto out;
+			}
+
+			break;
+		}
+
+		num_sent += n;
+
+		if(n < batch_size)
+			break;
+	}
+
+	result = num_sent;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+static int
+packet_backend_get_stats(struct capture_handle * handle,struct capture_stats * stats)
+{
+	struct tpacket_stats kernel_stats;
+	socklen_t length = sizeof(kernel_stats);
+	int result = -1;
+
+	if(getsockopt(handle->fd, SOL_PACKET, PACKET_STATISTICS, &kernel_stats, &length) == -1)
+	{
+		snprintf(handle->error_buffer,sizeof(handle->error_buffer),"%s",strerror(errno));
+		goto out;
+	}
+
+	/* The number of frames received includes those which were dropped. */
+	handle->stats.received	+= kernel_stats.tp_packets;
+	handle->stats.dropped	+= kernel_stats.tp_drops;
+
+	(*stats) = handle->stats;
+
+	result = 0;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+static const char *
+packet_backend_get_error(const struct capture_handle * handle)
+{
+	return(handle->error_buffer);
+}
+
+/****************************************************************************/
+
+const struct capture_backend packet_capture_backend =
+{
+	"packet",
+	packet_backend_open,
+	packet_backend_attach_filter,
+	packet_backend_get_fd,
+	packet_backend_receive,
+	packet_backend_transmit,
+	packet_backend_get_stats,
+	packet_backend_get_error,
+	packet_backend_close
+};
+
+/****************************************************************************/
+
+#endif /* __linux__ */
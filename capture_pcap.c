@@ -0,0 +1,322 @@
+/*
+ * Capture and send Ethernet frames through libpcap.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+
+#include <pthread.h>
+#include <pcap.h>
+
+/****************************************************************************/
+
+#include "capture_backend.h"
+
+/****************************************************************************/
+
+struct capture_handle
+{
+	pcap_t *				pcap_handle;
+	struct bpf_program		filter_program;
+	bool					filter_program_valid;
+	int						pcap_fd;
+
+	/* Where pcap_dispatch() delivers the frames to. */
+	capture_frame_function	function;
+	void *					user_data;
+
+	char					error_buffer[PCAP_ERRBUF_SIZE];
+};
+
+/****************************************************************************/
+
+/* Older libpcap versions do not permit pcap_compile() to be called
+ * by more than one thread at a time.
+ */
+static pthread_mutex_t compile_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/****************************************************************************/
+
+static void
+pcap_backend_close(struct capture_handle * handle)
+{
+	if(handle != NULL)
+	{
+		if(handle->filter_program_valid)
+			pcap_freecode(&handle->filter_program);
+
+		if(handle->pcap_handle != NULL)
+			pcap_close(handle->pcap_handle);
+
+		free(handle);
+	}
+}
+
+/****************************************************************************/
+
+/* Describe why a capture could not be set up, which libpcap may or may
+ * not have explained itself.
+ */
+static void
+report_pcap_error(pcap_t * pcap_handle,int status,const char * interface_name,char * error_buffer,size_t error_buffer_size)
+{
+	const char * message = pcap_geterr(pcap_handle);
+
+	if(message == NULL || message[0] == '\0')
+		snprintf(error_buffer,error_buffer_size,"%s: %s",interface_name,pcap_statustostr(status));
+	else
+		snprintf(error_buffer,error_buffer_size,"%s",message);
+}
+
+/****************************************************************************/
+
+static struct capture_handle *
+pcap_backend_open(const char * interface_name,int snapshot_length,const struct capture_options * options,
+	char * error_buffer,size_t error_buffer_size)
+{
+	static const struct capture_options default_options;
+
+	struct capture_handle * result = NULL;
+	struct capture_handle * handle;
+	int status;
+
+	if(options == NULL)
+		options = &default_options;
+
+	handle = calloc(1,sizeof(*handle));
+	if(handle == NULL)
+	{
+		snprintf(error_buffer,error_buffer_size,"%s",strerror(errno));
+		goto out;
+	}
+
+	handle->pcap_handle = pcap_create(interface_name, handle->error_buffer);
+	if (handle->pcap_handle == NULL)
+	{
+		snprintf(error_buffer,error_buffer_size,"%s",handle->error_buffer);
+		goto out;
+	}
+
+	/* Promiscuous mode is disabled (not needed), and we wait up to 10
+	 * milliseconds for multiple frames to arrive (we don't want to read
+	 * just one single frame at a time). On Linux, this means that a
+	 * frame may sit in the kernel buffer for up to 10 milliseconds
+	 * before poll() reports it, unless immediate mode is enabled, in
+	 * which case each frame is handed over as soon as it arrives.
+	 */
+	pcap_set_snaplen(handle->pcap_handle, snapshot_length);
+	pcap_set_promisc(handle->pcap_handle, false);
+	pcap_set_timeout(handle->pcap_handle, 10);
+
+	if(options->low_latency && pcap_set_immediate_mode(handle->pcap_handle, true) != 0)
+	{
+		snprintf(error_buffer,error_buffer_size,"%s: cannot enable immediate mode",interface_name);
+		goto out;
+	}
+
+	/* Warnings, e.g. about the time stamp type, are of no concern. */
+	status = pcap_activate(handle->pcap_handle);
+	if(status < 0)
+	{
+		report_pcap_error(handle->pcap_handle,status,interface_name,error_buffer,error_buffer_size);
+		goto out;
+	}
+
+	/* The capture is driven by poll(), which means that reading frames
+	 * must not block.
+	 */
+	if(pcap_setnonblock(handle->pcap_handle, true, handle->error_buffer) < 0)
+	{
+		snprintf(error_buffer,error_buffer_size,"%s",handle->error_buffer);
+		goto out;
+	}
+
+	/* This may be -1 if the platform does not support it, in which
+	 * case poll() will ignore it and we fall back to checking for
+	 * new frames periodically.
+	 */
+	handle->pcap_fd = pcap_get_selectable_fd(handle->pcap_handle);
+
+	if(options->busy_poll > 0 && set_capture_busy_poll(handle->pcap_fd, options->busy_poll, error_buffer, error_buffer_size) < 0)
+		goto out;
+
+	result = handle;
+	handle = NULL;
+
+ out:
+
+	pcap_backend_close(handle);
+
+	return(result);
+}
+
+/****************************************************************************/
+
+static int
+pcap_backend_attach_filter(struct capture_handle * handle,uint16_t udp_port)
+{
+	char filter_command[256];
+	int result = -1;
+	int status;
+
+	snprintf(filter_command, sizeof(filter_command), "udp port %d", udp_port);
+
+	pthread_mutex_lock(&compile_lock);
+	status = pcap_compile(handle->pcap_handle,&handle->filter_program,filter_command,1,0);
+	pthread_mutex_unlock(&compile_lock);
+
+	if(status < 0)
+	{
+		snprintf(handle->error_buffer,sizeof(handle->error_buffer),"cannot set up packet filter (%s)",pcap_geterr(handle->pcap_handle));
+		goto out;
+	}
+
+	handle->filter_program_valid = true;
+
+	if(pcap_setfilter(handle->pcap_handle,&handle->filter_program) < 0)
+	{
+		snprintf(handle->error_buffer,sizeof(handle->error_buffer),"cannot set up packet filter (%s)",pcap_geterr(handle->pcap_handle));
+		goto out;
+	}
+
+	result = 0;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+static int
+pcap_backend_get_fd(const struct capture_handle * handle)
+{
+	return(handle->pcap_fd);
+}
+
+/****************************************************************************/
+
+/* Frame handler, invoked through pcap_dispatch(). */
+static void
+pcap_backend_frame_input(uint8_t *args, const struct pcap_pkthdr *header, const uint8_t *data)
+{
+	struct capture_handle * handle = (struct capture_handle *)args;
+	struct capture_frame frame;
+
+	frame.stamp		= header->ts;
+	frame.data		= data;
+	frame.length	= header->caplen;
+
+	if(!(*handle->function)(&frame,handle->user_data))
+		pcap_breakloop(handle->pcap_handle);
+}
+
+/****************************************************************************/
+
+static int
+pcap_backend_receive(struct capture_handle * handle,int max_frames,capture_frame_function function,void * user_data)
+{
+	int result;
+
+	handle->function	= function;
+	handle->user_data	= user_data;
+
+	result = pcap_dispatch(handle->pcap_handle, max_frames, pcap_backend_frame_input, (uint8_t *)handle);
+
+	/* Being told to stop early is not an error. */
+	if(result == PCAP_ERROR_BREAK)
+	{
+		result = 0;
+	}
+	else if (result < 0)
+	{
+		snprintf(handle->error_buffer,sizeof(handle->error_buffer),"%s",pcap_geterr(handle->pcap_handle));
+		result = -1;
+	}
+
+	return(result);
+}
+
+/****************************************************************************/
+
+static int
+pcap_backend_transmit(struct capture_handle * handle,const struct capture_frame * frames,int num_frames)
+{
+	int result = -1;
+	int i;
+
+	/* libpcap sends one frame at a time. */
+	for(i = 0 ; i < num_frames ; i++)
+	{
+		if(pcap_inject(handle->pcap_handle, frames[i].data, frames[i].length) < 0)
+		{
+			if(i == 0)
+			{
+				snprintf(handle->error_buffer,sizeof(handle->error_buffer),"%s",pcap_geterr(handle->pcap_handle));
+				goto out;
+			}
+
+			break;
+		}
+	}
+
+	result = i;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+static int
+pcap_backend_get_stats(struct capture_handle * handle,struct capture_stats * stats)
+{
+	struct pcap_stat ps;
+	int result = -1;
+
+	if(pcap_stats(handle->pcap_handle,&ps) < 0)
+	{
+		snprintf(handle->error_buffer,sizeof(handle->error_buffer),"%s",pcap_geterr(handle->pcap_handle));
+		goto out;
+	}
+
+	stats->received	= ps.ps_recv;
+	stats->dropped	= (uint64_t)ps.ps_drop + ps.ps_ifdrop;
+
+	result = 0;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+static const char *
+pcap_backend_get_error(const struct capture_handle * handle)
+{
+	return(handle->error_buffer);
+}
+
+/****************************************************************************/
+
+const struct capture_backend pcap_capture_backend =
+{
+	"pcap",
+	pcap_backend_open,
+	pcap_backend_attach_filter,
+	pcap_backend_get_fd,
+	pcap_backend_receive,
+	pcap_backend_transmit,
+	pcap_backend_get_stats,
+	pcap_backend_get_error,
+	pcap_backend_close
+};
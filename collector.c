@@ -0,0 +1,1360 @@
+/*
+ * Collector which merges the scan results reported by many sensors into
+ * a single index of DHCP servers, and the protocol used to talk to it.
+ *
+ * Sensors send one report message per scan over a Unix domain stream
+ * socket, listing the servers which responded. The collector keeps one
+ * entry per DHCP server, identified by its IPv4 and MAC address, and for
+ * each server one "sighting" per sensor and network interface through
+ * which it was seen. Servers, sensors and sightings are stored in arrays
+ * and found through open addressing hash tables, so that merging a report
+ * takes constant time per record, no matter how many servers and sensors
+ * are known.
+ *
+ * The collector runs a single-threaded event loop, using poll() and
+ * non-blocking sockets. A client may send a query message instead of a
+ * report, in which case the collector replies with a text listing of all
+ * the servers and closes the connection.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/time.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <assert.h>
+
+/****************************************************************************/
+
+#include "collector.h"
+#include "fnv_hash.h"
+
+/****************************************************************************/
+
+/* Largest number of records accepted in a single report. */
+#define MAXIMUM_REPORT_RECORDS 65536
+
+/* Largest message accepted. */
+#define MAXIMUM_MESSAGE_SIZE \
+	(sizeof(struct collector_message_header) + \
+	 sizeof(struct collector_report_header) + \
+	 MAXIMUM_REPORT_RECORDS * sizeof(struct history_record))
+
+/* Largest number of clients connected at the same time. */
+#define MAXIMUM_CONNECTIONS 1024
+
+/* How much to read from a client at a time. */
+#define READ_BUFFER_SIZE 65536
+
+/****************************************************************************/
+
+/* An entry in one of the hash tables, which refers to an array element. */
+struct hash_slot
+{
+	uint32_t	item;		/* Array index + 1, or 0 if unused */
+	uint32_t	hash;
+};
+
+/* Open addressing hash table with linear probing, kept at most half full. */
+struct hash_index
+{
+	struct hash_slot *	slots;
+	uint32_t			size;		/* A power of 2 */
+	uint32_t			count;
+};
+
+/****************************************************************************/
+
+struct collector_sensor
+{
+	char		name[COLLECTOR_SENSOR_NAME_SIZE];
+};
+
+struct collector_server
+{
+	uint8_t		server_ipv4_address[4];
+	uint8_t		server_mac_address[6];
+	int64_t		first_seen;
+	int64_t		last_seen;
+	uint64_t	num_reports;
+	uint32_t	first_sighting;		/* Array index + 1, or 0 if none */
+	uint32_t	last_sighting;
+};
+
+/* Which sensor saw a server, and through which interface. */
+struct collector_sighting
+{
+	uint32_t	server;
+	uint32_t	sensor;
+	char		interface_name[16];
+	int64_t		first_seen;
+	int64_t		last_seen;
+	uint64_t	num_reports;
+	uint64_t	offer_hash;
+	uint32_t	next;				/* Next sighting of the same server + 1, or 0 */
+};
+
+/****************************************************************************/
+
+struct collector
+{
+	struct collector_sensor *	sensors;
+	uint32_t					num_sensors;
+	uint32_t					sensors_size;
+
+	struct collector_server *	servers;
+	uint32_t					num_servers;
+	uint32_t					servers_size;
+
+	struct collector_sighting *	sightings;
+	uint32_t					num_sightings;
+	uint32_t					sightings_size;
+
+	struct hash_index			sensor_index;
+	struct hash_index			server_index;
+	struct hash_index			sighting_index;
+
+	uint64_t					num_reports;
+};
+
+/****************************************************************************/
+
+/* A client connected to the collector. */
+struct collector_connection
+{
+	int			fd;
+
+	uint8_t *	buffer;				/* Data received, not yet processed */
+	size_t		buffer_size;
+	size_t		buffer_length;
+
+	char *		reply;				/* Reply to a query, if any */
+	size_t		reply_length;
+	size_t		reply_sent;
+};
+
+/****************************************************************************/
+
+/* Make room for one more element in an array, which grows by doubling.
+ * Returns -1 if not enough memory is available, 0 otherwise.
+ */
+static int
+grow_array(void ** array_ptr,uint32_t count,uint32_t * size_ptr,size_t element_size)
+{
+	uint32_t size = (*size_ptr);
+	int result = -1;
+	void * array;
+
+	if(count == size)
+	{
+		size = (size > 0) ? 2 * size : 64;
+
+		array = realloc((*array_ptr),size * element_size);
+		if(array == NULL)
+			goto out;
+
+		(*array_ptr) = array;
+		(*size_ptr) = size;
+	}
+
+	result = 0;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Add an item to a hash table, growing it if necessary. The item must
+ * not be in the table yet. Returns -1 if not enough memory is
+ * available, 0 otherwise.
+ */
+static int
+add_to_hash_index(struct hash_index * index,uint32_t hash,uint32_t item)
+{
+	struct hash_slot * slots;
+	uint32_t size,mask;
+	int result = -1;
+	uint32_t i,j;
+
+	if(2 * (index->count + 1) > index->size)
+	{
+		size = (index->size > 0) ? 2 * index->size : 256;
+		mask = size - 1;
+
+		slots = calloc(size,sizeof(*slots));
+		if(slots == NULL)
+			goto out;
+
+		for(i = 0 ; i < index->size ; i++)
+		{
+			if(index->slots[i].item == 0)
+				continue;
+
+			for(j = index->slots[i].hash & mask ; slots[j].item != 0 ; j = (j + 1) & mask)
+				(void)NULL;
+
+			slots[j] = index->slots[i];
+		}
+
+		if(index->slots != NULL)
+			free(index->slots);
+
+		index->slots = slots;
+		index->size = size;
+	}
+
+	mask = index->size - 1;
+
+	for(j = hash & mask ; index->slots[j].item != 0 ; j = (j + 1) & mask)
+		(void)NULL;
+
+	index->slots[j].item = item + 1;
+	index->slots[j].hash = hash;
+
+	index->count++;
+
+	result = 0;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Calculate the hash value of a key. */
+static uint32_t
+hash_key(const void * key,size_t key_size)
+{
+	uint64_t hash;
+
+	hash = fnv1a_64(FNV1A_64_OFFSET_BASIS,key,key_size);
+
+	return((uint32_t)(hash ^ (hash >> 32)));
+}
+
+/****************************************************************************/
+
+/* Find a sensor by name, adding it if necessary. Returns -1 if not
+ * enough memory is available, otherwise the sensor's array index.
+ */
+static int64_t
+get_sensor(struct collector * collector,const char * name)
+{
+	const struct hash_index * index = &collector->sensor_index;
+	struct collector_sensor * sensor;
+	int64_t result = -1;
+	uint32_t hash,mask;
+	uint32_t item;
+	uint32_t i;
+
+	hash = hash_key(name,strlen(name));
+
+	if(index->size > 0)
+	{
+		mask = index->size - 1;
+
+		for(i = hash & mask ; (item = index->slots[i].item) != 0 ; i = (i + 1) & mask)
+		{
+			if(index->slots[i].hash == hash && strcmp(collector->sensors[item-1].name,name) == 0)
+			{
+				result = item - 1;
+				goto out;
+			}
+		}
+	}
+
+	if(grow_array((void **)&collector->sensors,collector->num_sensors,&collector->sensors_size,sizeof(*collector->sensors)) < 0)
+		goto out;
+
+	if(add_to_hash_index(&collector->sensor_index,hash,collector->num_sensors) < 0)
+		goto out;
+
+	sensor = &collector->sensors[collector->num_sensors];
+
+	memset(sensor,0,sizeof(*sensor));
+	strncpy(sensor->name,name,sizeof(sensor->name)-1);
+
+	result = collector->num_sensors++;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Find a server by its IPv4 and MAC address, adding it if necessary.
+ * Returns -1 if not enough memory is available, otherwise the server's
+ * array index.
+ */
+static int64_t
+get_server(struct collector * collector,const uint8_t * server_ipv4_address,const uint8_t * server_mac_address)
+{
+	const struct hash_index * index = &collector->server_index;
+	const struct collector_server * server;
+	struct collector_server * new_server;
+	int64_t result = -1;
+	uint32_t hash,mask;
+	uint8_t key[10];
+	uint32_t item;
+	uint32_t i;
+
+	memmove(&key[0],server_ipv4_address,4);
+	memmove(&key[4],server_mac_address,6);
+
+	hash = hash_key(key,sizeof(key));
+
+	if(index->size > 0)
+	{
+		mask = index->size - 1;
+
+		for(i = hash & mask ; (item = index->slots[i].item) != 0 ; i = (i + 1) & mask)
+		{
+			if(index->slots[i].hash != hash)
+				continue;
+
+			server = &collector->servers[item-1];
+
+			if(memcmp(server->server_ipv4_address,server_ipv4_address,sizeof(server->server_ipv4_address)) == 0 &&
+			   memcmp(server->server_mac_address,server_mac_address,sizeof(server->server_mac_address)) == 0)
+			{
+				result = item - 1;
+				goto out;
+			}
+		}
+	}
+
+	if(grow_array((void **)&collector->servers,collector->num_servers,&collector->servers_size,sizeof(*collector->servers)) < 0)
+		goto out;
+
+	if(add_to_hash_index(&collector->server_index,hash,collector->num_servers) < 0)
+		goto out;
+
+	new_server = &collector->servers[collector->num_servers];
+
+	memset(new_server,0,sizeof(*new_server));
+
+	memmove(new_server->server_ipv4_address,server_ipv4_address,sizeof(new_server->server_ipv4_address));
+	memmove(new_server->server_mac_address,server_mac_address,sizeof(new_server->server_mac_address));
+
+	new_server->first_seen = INT64_MAX;
+	new_server->last_seen = INT64_MIN;
+
+	result = collector->num_servers++;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Find the sighting of a server by a sensor through an interface, adding
+ * it if necessary. Returns -1 if not enough memory is available, otherwise
+ * the sighting's array index.
+ */
+static int64_t
+get_sighting(struct collector * collector,uint32_t server,uint32_t sensor,const char * interface_name)
+{
+	const struct hash_index * index = &collector->sighting_index;
+	const struct collector_sighting * sighting;
+	struct collector_sighting * new_sighting;
+	struct collector_server * owner;
+	int64_t result = -1;
+	uint32_t hash,mask;
+	uint32_t key[2+4];
+	uint32_t item;
+	uint32_t i;
+
+	memset(key,0,sizeof(key));
+
+	key[0] = server;
+	key[1] = sensor;
+	strncpy((char *)&key[2],interface_name,16);
+
+	hash = hash_key(key,sizeof(key));
+
+	if(index->size > 0)
+	{
+		mask = index->size - 1;
+
+		for(i = hash & mask ; (item = index->slots[i].item) != 0 ; i = (i + 1) & mask)
+		{
+			if(index->slots[i].hash != hash)
+				continue;
+
+			sighting = &collector->sightings[item-1];
+
+			if(sighting->server == server && sighting->sensor == sensor &&
+			   strncmp(sighting->interface_name,interface_name,sizeof(sighting->interface_name)) == 0)
+			{
+				result = item - 1;
+				goto out;
+			}
+		}
+	}
+
+	if(grow_array((void **)&collector->sightings,collector->num_sightings,&collector->sightings_size,sizeof(*collector->sightings)) < 0)
+		goto out;
+
+	if(add_to_hash_index(&collector->sighting_index,hash,collector->num_sightings) < 0)
+		goto out;
+
+	new_sighting = &collector->sightings[collector->num_sightings];
+
+	memset(new_sighting,0,sizeof(*new_sighting));
+
+	new_sighting->server = server;
+	new_sighting->sensor = sensor;
+	strncpy(new_sighting->interface_name,interface_name,sizeof(new_sighting->interface_name));
+
+	new_sighting->first_seen = INT64_MAX;
+	new_sighting->last_seen = INT64_MIN;
+
+	/* Add it to the end of the server's list of sightings. */
+	owner = &collector->servers[server];
+
+	if(owner->last_sighting != 0)
+		collector->sightings[owner->last_sighting-1].next = collector->num_sightings + 1;
+	else
+		owner->first_sighting = collector->num_sightings + 1;
+
+	owner->last_sighting = collector->num_sightings + 1;
+
+	result = collector->num_sightings++;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Release the memory allocated by create_collector(). This is safe to
+ * call with a NULL parameter.
+ */
+void
+delete_collector(struct collector * collector)
+{
+	if(collector != NULL)
+	{
+		if(collector->sensors != NULL)
+			free(collector->sensors);
+
+		if(collector->servers != NULL)
+			free(collector->servers);
+
+		if(collector->sightings != NULL)
+			free(collector->sightings);
+
+		if(collector->sensor_index.slots != NULL)
+			free(collector->sensor_index.slots);
+
+		if(collector->server_index.slots != NULL)
+			free(collector->server_index.slots);
+
+		if(collector->sighting_index.slots != NULL)
+			free(collector->sighting_index.slots);
+
+		free(collector);
+	}
+}
+
+/****************************************************************************/
+
+/* Create an empty server index. Returns NULL if not enough memory
+ * is available.
+ */
+struct collector *
+create_collector(void)
+{
+	return(calloc(1,sizeof(struct collector)));
+}
+
+/****************************************************************************/
+
+/* Merge the records of one report into the server index. The records
+ * need not be suitably aligned, as they may come straight out of the
+ * receive buffer, so each one is copied before it is used. Returns -1 if
+ * not enough memory is available, 0 otherwise.
+ */
+int
+add_collector_report(struct collector * collector,const char * sensor_name,const void * records,size_t num_records)
+{
+	struct history_record record;
+	struct collector_sighting * sighting;
+	struct collector_server * server;
+	char interface_name[17];
+	int64_t sensor_index;
+	int64_t server_index;
+	int64_t sighting_index;
+	int result = -1;
+	size_t i;
+
+	sensor_index = get_sensor(collector,sensor_name);
+	if(sensor_index < 0)
+		goto out;
+
+	for(i = 0 ; i < num_records ; i++)
+	{
+		memcpy(&record,(const char *)records + i * sizeof(record),sizeof(record));
+
+		server_index = get_server(collector,record.server_ipv4_address,record.server_mac_address);
+		if(server_index < 0)
+			goto out;
+
+		/* The interface name need not be NUL-terminated. */
+		memmove(interface_name,record.interface_name,sizeof(record.interface_name));
+		interface_name[sizeof(interface_name)-1] = '\0';
+
+		sighting_index = get_sighting(collector,(uint32_t)server_index,(uint32_t)sensor_index,interface_name);
+		if(sighting_index < 0)
+			goto out;
+
+		server = &collector->servers[server_index];
+		sighting = &collector->sightings[sighting_index];
+
+		if(server->first_seen > record.time)
+			server->first_seen = record.time;
+
+		if(server->last_seen < record.time)
+			server->last_seen = record.time;
+
+		server->num_reports++;
+
+		if(sighting->first_seen > record.time)
+			sighting->first_seen = record.time;
+
+		if(sighting->last_seen <= record.time)
+		{
+			sighting->last_seen = record.time;
+			sighting->offer_hash = record.offer_hash;
+		}
+
+		sighting->num_reports++;
+	}
+
+	collector->num_reports++;
+
+	result = 0;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Convert a time stamp into ISO 8601 format, with second accuracy. */
+static void
+format_time_stamp(time_t stamp,char * buffer,size_t buffer_size)
+{
+	strftime(buffer,buffer_size,"%Y-%m-%dT%H:%M:%S%z",localtime(&stamp));
+}
+
+/****************************************************************************/
+
+/* Sort servers by IPv4 address and MAC address. */
+static int
+compare_servers(const void * a,const void * b)
+{
+	const struct collector_server * x = a;
+	const struct collector_server * y = b;
+	int result;
+
+	result = memcmp(x->server_ipv4_address,y->server_ipv4_address,sizeof(x->server_ipv4_address));
+	if(result == 0)
+		result = memcmp(x->server_mac_address,y->server_mac_address,sizeof(x->server_mac_address));
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Print all the servers known, sorted by IPv4 and MAC address, along with
+ * the sensors which saw them.
+ */
+void
+print_collector_servers(const struct collector * collector,FILE * out)
+{
+	struct collector_server * servers = NULL;
+	const struct collector_sighting * sighting;
+	const struct collector_sighting * other;
+	const struct collector_server * server;
+	char first_seen_string[32];
+	char last_seen_string[32];
+	uint32_t num_sensors;
+	uint32_t i,j;
+
+	fprintf(out,"number-of-sensors=%u\n",collector->num_sensors);
+	fprintf(out,"number-of-reports=%llu\n",(unsigned long long)collector->num_reports);
+	fprintf(out,"number-of-servers=%u\n",collector->num_servers);
+
+	/* Print the servers in order, if possible. */
+	if(collector->num_servers > 0)
+	{
+		servers = malloc(collector->num_servers * sizeof(*servers));
+		if(servers != NULL)
+		{
+			memmove(servers,collector->servers,collector->num_servers * sizeof(*servers));
+			qsort(servers,collector->num_servers,sizeof(*servers),compare_servers);
+		}
+	}
+
+	for(i = 0 ; i < collector->num_servers ; i++)
+	{
+		server = (servers != NULL) ? &servers[i] : &collector->servers[i];
+
+		/* Count the different sensors which saw this server. */
+		num_sensors = 0;
+
+		for(j = server->first_sighting ; j != 0 ; j = sighting->next)
+		{
+			sighting = &collector->sightings[j-1];
+
+			for(other = &collector->sightings[server->first_sighting-1] ; other != sighting ; other = &collector->sightings[other->next-1])
+			{
+				if(other->sensor == sighting->sensor)
+					break;
+			}
+
+			if(other == sighting)
+				num_sensors++;
+		}
+
+		format_time_stamp((time_t)server->first_seen,first_seen_string,sizeof(first_seen_string));
+		format_time_stamp((time_t)server->last_seen,last_seen_string,sizeof(last_seen_string));
+
+		fprintf(out,"\n");
+
+		fprintf(out,"server-ipv4-address=%u.%u.%u.%u\n",
+			server->server_ipv4_address[0],
+			server->server_ipv4_address[1],
+			server->server_ipv4_address[2],
+			server->server_ipv4_address[3]);
+
+		fprintf(out,"server-mac-address=%02x:%02x:%02x:%02x:%02x:%02x\n",
+			server->server_mac_address[0],
+			server->server_mac_address[1],
+			server->server_mac_address[2],
+			server->server_mac_address[3],
+			server->server_mac_address[4],
+			server->server_mac_address[5]);
+
+		fprintf(out,"first-seen=%s\n",first_seen_string);
+		fprintf(out,"last-seen=%s\n",last_seen_string);
+		fprintf(out,"times-seen=%llu\n",(unsigned long long)server->num_reports);
+		fprintf(out,"number-of-sensors=%u\n",num_sensors);
+
+		for(j = server->first_sighting ; j != 0 ; j = sighting->next)
+		{
+			sighting = &collector->sightings[j-1];
+
+			format_time_stamp((time_t)sighting->first_seen,first_seen_string,sizeof(first_seen_string));
+			format_time_stamp((time_t)sighting->last_seen,last_seen_string,sizeof(last_seen_string));
+
+			fprintf(out,"sensor=%s %s (first-seen %s, last-seen %s, times-seen %llu)\n",
+				collector->sensors[sighting->sensor].name,
+				sighting->interface_name,
+				first_seen_string,last_seen_string,
+				(unsigned long long)sighting->num_reports);
+		}
+	}
+
+	if(servers != NULL)
+		free(servers);
+}
+
+/****************************************************************************/
+
+/* Release the resources used by a client connection. */
+static void
+close_connection(struct collector_connection * connection)
+{
+	if(connection->fd >= 0)
+		close(connection->fd);
+
+	if(connection->buffer != NULL)
+		free(connection->buffer);
+
+	if(connection->reply != NULL)
+		free(connection->reply);
+
+	memset(connection,0,sizeof(*connection));
+
+	connection->fd = -1;
+}
+
+/****************************************************************************/
+
+/* Prepare the reply to a query. Returns -1 if not enough memory is
+ * available, 0 otherwise.
+ */
+static int
+prepare_query_reply(const struct collector * collector,struct collector_connection * connection)
+{
+	int result = -1;
+	FILE * out;
+
+	out = open_memstream(&connection->reply,&connection->reply_length);
+	if(out == NULL)
+		goto out;
+
+	print_collector_servers(collector,out);
+
+	if(fclose(out) != 0)
+		goto out;
+
+	connection->reply_sent = 0;
+
+	result = 0;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Process the complete messages received from a client. Returns -1 if
+ * the connection should be closed, 0 otherwise.
+ */
+static int
+process_messages(struct collector * collector,struct collector_connection * connection,bool verbose)
+{
+	const struct collector_message_header * header;
+	const struct collector_report_header * report;
+	char sensor_name[COLLECTOR_SENSOR_NAME_SIZE];
+	size_t message_size;
+	size_t position = 0;
+	int result = -1;
+
+	while(connection->buffer_length - position >= sizeof(*header))
+	{
+		header = (const struct collector_message_header *)&connection->buffer[position];
+
+		if(header->magic != COLLECTOR_MAGIC || header->version != COLLECTOR_VERSION ||
+		   header->length > MAXIMUM_MESSAGE_SIZE - sizeof(*header))
+		{
+			if(verbose)
+				fprintf(stderr,"collector: Dropping connection after receiving an invalid message.\n");
+
+			goto out;
+		}
+
+		message_size = sizeof(*header) + header->length;
+
+		/* Wait for the rest of the message to arrive. */
+		if(connection->buffer_length - position < message_size)
+			break;
+
+		if(header->type == COLLECTOR_MESSAGE_REPORT)
+		{
+			report = (const struct collector_report_header *)&header[1];
+
+			if(header->length < sizeof(*report) ||
+			   header->length != sizeof(*report) + report->num_records * sizeof(struct history_record))
+			{
+				if(verbose)
+					fprintf(stderr,"collector: Dropping connection after receiving an invalid report.\n");
+
+				goto out;
+			}
+
+			memmove(sensor_name,report->sensor_name,sizeof(sensor_name));
+			sensor_name[sizeof(sensor_name)-1] = '\0';
+
+			if(add_collector_report(collector,sensor_name,&report[1],report->num_records) < 0)
+			{
+				if(verbose)
+					fprintf(stderr,"collector: Not enough memory to add report from sensor '%s'.\n",sensor_name);
+
+				goto out;
+			}
+		}
+		else if (header->type == COLLECTOR_MESSAGE_QUERY)
+		{
+			/* Nothing else will be accepted on this connection. */
+			if(prepare_query_reply(collector,connection) < 0)
+				goto out;
+
+			connection->buffer_length = 0;
+
+			result = 0;
+			goto out;
+		}
+		else
+		{
+			if(verbose)
+				fprintf(stderr,"collector: Dropping connection after receiving message of unknown type %u.\n",header->type);
+
+			goto out;
+		}
+
+		position += message_size;
+	}
+
+	/* Keep what is left for later. */
+	memmove(connection->buffer,&connection->buffer[position],connection->buffer_length - position);
+	connection->buffer_length -= position;
+
+	result = 0;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Read what the client sent. Returns -1 if the connection should be
+ * closed, 0 otherwise.
+ */
+static int
+receive_messages(struct collector * collector,struct collector_connection * connection,bool verbose)
+{
+	size_t buffer_size;
+	uint8_t * buffer;
+	int result = -1;
+	ssize_t n;
+
+	/* Read until there is nothing left, or until a query
+	 * has been received.
+	 */
+	while(connection->reply == NULL)
+	{
+		/* Make room for more data. A message never needs more than
+		 * MAXIMUM_MESSAGE_SIZE bytes.
+		 */
+		if(connection->buffer_size - connection->buffer_length < READ_BUFFER_SIZE)
+		{
+			buffer_size = 2 * connection->buffer_size;
+			if(buffer_size < connection->buffer_length + READ_BUFFER_SIZE)
+				buffer_size = connection->buffer_length + READ_BUFFER_SIZE;
+
+			if(buffer_size > MAXIMUM_MESSAGE_SIZE + READ_BUFFER_SIZE)
+				buffer_size = MAXIMUM_MESSAGE_SIZE + READ_BUFFER_SIZE;
+
+			buffer = realloc(connection->buffer,buffer_size);
+			if(buffer == NULL)
+				goto out;
+
+			connection->buffer = buffer;
+			connection->buffer_size = buffer_size;
+		}
+
+		n = read(connection->fd,&connection->buffer[connection->buffer_length],connection->buffer_size - connection->buffer_length);
+		if(n < 0)
+		{
+			if(errno == EINTR)
+				continue;
+
+			if(errno == EAGAIN || errno == EWOULDBLOCK)
+				break;
+
+			goto out;
+		}
+
+		/* The client closed the connection. */
+		if(n == 0)
+			goto out;
+
+		connection->buffer_length += n;
+
+		if(process_messages(collector,connection,verbose) < 0)
+			goto out;
+	}
+
+	result = 0;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Send as much of the reply to a query as possible. Returns -1 if the
+ * connection should be closed, which is the case once the complete
+ * reply has been sent, and 0 otherwise.
+ */
+static int
+send_reply(struct collector_connection * connection)
+{
+	int flags = 0;
+	int result = -1;
+	ssize_t n;
+
+	#if defined(MSG_NOSIGNAL)
+	{
+		flags = MSG_NOSIGNAL;
+	}
+	#endif /* MSG_NOSIGNAL */
+
+	while(connection->reply_sent < connection->reply_length)
+	{
+		n = send(connection->fd,&connection->reply[connection->reply_sent],connection->reply_length - connection->reply_sent,flags);
+		if(n < 0)
+		{
+			if(errno == EINTR)
+				continue;
+
+			if(errno == EAGAIN || errno == EWOULDBLOCK)
+				result = 0;
+
+			goto out;
+		}
+
+		connection->reply_sent += n;
+	}
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Set the non-blocking and close-on-exec flags of a socket, and make
+ * sure that writing to it cannot raise a SIGPIPE signal.
+ */
+static int
+prepare_socket(int fd)
+{
+	int result = -1;
+	int flags;
+
+	flags = fcntl(fd,F_GETFL);
+	if(flags < 0 || fcntl(fd,F_SETFL,flags|O_NONBLOCK) < 0)
+		goto out;
+
+	flags = fcntl(fd,F_GETFD);
+	if(flags < 0 || fcntl(fd,F_SETFD,flags|FD_CLOEXEC) < 0)
+		goto out;
+
+	#if defined(SO_NOSIGPIPE)
+	{
+		int on = 1;
+
+		if(setsockopt(fd,SOL_SOCKET,SO_NOSIGPIPE,&on,sizeof(on)) < 0)
+			goto out;
+	}
+	#endif /* SO_NOSIGPIPE */
+
+	result = 0;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Accept reports and queries on a Unix domain socket until an error
+ * occurs. A socket file left over by a previous run is replaced. This
+ * function returns only in case of error, with errno set.
+ */
+int
+run_collector(struct collector * collector,const char * socket_path,bool verbose)
+{
+	struct collector_connection * connections = NULL;
+	struct collector_connection * connection;
+	struct pollfd * pfds = NULL;
+	struct sockaddr_un address;
+	int num_connections = 0;
+	int listen_fd = -1;
+	bool keep_open;
+	int result = -1;
+	int fd;
+	int i;
+
+	memset(&address,0,sizeof(address));
+
+	if(strlen(socket_path) >= sizeof(address.sun_path))
+	{
+		errno = ENAMETOOLONG;
+		goto out;
+	}
+
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path,socket_path);
+
+	/* Each connection uses the poll() entry following that of
+	 * the listening socket at the same position.
+	 */
+	connections = calloc(MAXIMUM_CONNECTIONS,sizeof(*connections));
+	pfds = calloc(1 + MAXIMUM_CONNECTIONS,sizeof(*pfds));
+
+	if(connections == NULL || pfds == NULL)
+		goto out;
+
+	for(i = 0 ; i < MAXIMUM_CONNECTIONS ; i++)
+	{
+		connections[i].fd = -1;
+		pfds[1+i].fd = -1;
+	}
+
+	listen_fd = socket(AF_UNIX,SOCK_STREAM,0);
+	if(listen_fd < 0)
+		goto out;
+
+	if(prepare_socket(listen_fd) < 0)
+		goto out;
+
+	unlink(socket_path);
+
+	if(bind(listen_fd,(struct sockaddr *)&address,sizeof(address)) < 0)
+		goto out;
+
+	if(listen(listen_fd,SOMAXCONN) < 0)
+		goto out;
+
+	pfds[0].fd = listen_fd;
+	pfds[0].events = POLLIN;
+
+	if(verbose)
+		fprintf(stderr,"collector: Waiting for reports on '%s'.\n",socket_path);
+
+	for(;;)
+	{
+		if(poll(pfds,1 + MAXIMUM_CONNECTIONS,-1) < 0)
+		{
+			if(errno == EINTR)
+				continue;
+
+			goto out;
+		}
+
+		for(i = 0 ; i < MAXIMUM_CONNECTIONS ; i++)
+		{
+			if(pfds[1+i].fd < 0 || pfds[1+i].revents == 0)
+				continue;
+
+			connection = &connections[i];
+
+			if(connection->reply != NULL)
+				keep_open = (send_reply(connection) == 0);
+			else
+				keep_open = (receive_messages(collector,connection,verbose) == 0);
+
+			if(!keep_open)
+			{
+				close_connection(connection);
+
+				pfds[1+i].fd = -1;
+				pfds[1+i].events = 0;
+
+				num_connections--;
+			}
+			/* Switch to sending the reply to a query. */
+			else if (connection->reply != NULL)
+			{
+				pfds[1+i].events = POLLOUT;
+			}
+		}
+
+		/* Take on new clients. If there are too many already, the
+		 * others have to wait in the listen queue.
+		 */
+		if(pfds[0].revents != 0)
+		{
+			while(num_connections < MAXIMUM_CONNECTIONS && (fd = accept(listen_fd,NULL,NULL)) >= 0)
+			{
+				if(prepare_socket(fd) < 0)
+				{
+					close(fd);
+					continue;
+				}
+
+				for(i = 0 ; connections[i].fd >= 0 ; i++)
+					(void)NULL;
+
+				connections[i].fd = fd;
+
+				pfds[1+i].fd = fd;
+				pfds[1+i].events = POLLIN;
+				pfds[1+i].revents = 0;
+
+				num_connections++;
+			}
+
+			if(num_connections < MAXIMUM_CONNECTIONS &&
+			   errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR && errno != ECONNABORTED)
+			{
+				goto out;
+			}
+		}
+
+		pfds[0].events = (num_connections < MAXIMUM_CONNECTIONS) ? POLLIN : 0;
+	}
+
+ out:
+
+	if(connections != NULL)
+	{
+		int error = errno;
+
+		for(i = 0 ; i < MAXIMUM_CONNECTIONS ; i++)
+		{
+			if(connections[i].fd >= 0)
+				close_connection(&connections[i]);
+		}
+
+		free(connections);
+
+		errno = error;
+	}
+
+	if(pfds != NULL)
+		free(pfds);
+
+	if(listen_fd >= 0)
+	{
+		close(listen_fd);
+		unlink(socket_path);
+	}
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Connect to the collector. Returns -1 in case of error, with errno set,
+ * otherwise the socket.
+ */
+static int
+connect_to_collector(const char * socket_path)
+{
+	struct sockaddr_un address;
+	struct timeval timeout;
+	int result = -1;
+	int fd = -1;
+
+	memset(&address,0,sizeof(address));
+
+	if(strlen(socket_path) >= sizeof(address.sun_path))
+	{
+		errno = ENAMETOOLONG;
+		goto out;
+	}
+
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path,socket_path);
+
+	fd = socket(AF_UNIX,SOCK_STREAM,0);
+	if(fd < 0)
+		goto out;
+
+	/* Do not wait forever if the collector is stuck. */
+	timeout.tv_sec = 5;
+	timeout.tv_usec = 0;
+
+	setsockopt(fd,SOL_SOCKET,SO_SNDTIMEO,&timeout,sizeof(timeout));
+	setsockopt(fd,SOL_SOCKET,SO_RCVTIMEO,&timeout,sizeof(timeout));
+
+	#if defined(SO_NOSIGPIPE)
+	{
+		int on = 1;
+
+		setsockopt(fd,SOL_SOCKET,SO_NOSIGPIPE,&on,sizeof(on));
+	}
+	#endif /* SO_NOSIGPIPE */
+
+	if(connect(fd,(struct sockaddr *)&address,sizeof(address)) < 0)
+		goto out;
+
+	result = fd;
+	fd = -1;
+
+ out:
+
+	if(fd >= 0)
+	{
+		int error = errno;
+
+		close(fd);
+
+		errno = error;
+	}
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Send all the data given, unless an error occurs. Returns -1 in case of
+ * error, with errno set, and 0 otherwise.
+ */
+static int
+send_all(int fd,const void * data,size_t size)
+{
+	const uint8_t * bytes = data;
+	int flags = 0;
+	int result = -1;
+	ssize_t n;
+
+	#if defined(MSG_NOSIGNAL)
+	{
+		flags = MSG_NOSIGNAL;
+	}
+	#endif /* MSG_NOSIGNAL */
+
+	while(size > 0)
+	{
+		n = send(fd,bytes,size,flags);
+		if(n < 0)
+		{
+			if(errno == EINTR)
+				continue;
+
+			goto out;
+		}
+
+		bytes += n;
+		size -= n;
+	}
+
+	result = 0;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Send the results of a scan to the collector. Large numbers of records
+ * are split into several reports. Returns -1 in case of error, with errno
+ * set, and 0 otherwise.
+ */
+int
+send_collector_report(const char * socket_path,const char * sensor_name,const struct history_record * records,size_t num_records)
+{
+	struct collector_message_header header;
+	struct collector_report_header report;
+	size_t num_sent = 0;
+	int result = -1;
+	size_t n;
+	int fd;
+
+	fd = connect_to_collector(socket_path);
+	if(fd < 0)
+		goto out;
+
+	do
+	{
+		n = num_records - num_sent;
+		if(n > MAXIMUM_REPORT_RECORDS)
+			n = MAXIMUM_REPORT_RECORDS;
+
+		memset(&header,0,sizeof(header));
+
+		header.magic = COLLECTOR_MAGIC;
+		header.version = COLLECTOR_VERSION;
+		header.type = COLLECTOR_MESSAGE_REPORT;
+		header.length = sizeof(report) + n * sizeof(*records);
+
+		memset(&report,0,sizeof(report));
+
+		strncpy(report.sensor_name,sensor_name,sizeof(report.sensor_name)-1);
+		report.num_records = (uint32_t)n;
+
+		if(send_all(fd,&header,sizeof(header)) < 0 ||
+		   send_all(fd,&report,sizeof(report)) < 0 ||
+		   send_all(fd,&records[num_sent],n * sizeof(*records)) < 0)
+		{
+			goto out;
+		}
+
+		num_sent += n;
+	}
+	while(num_sent < num_records);
+
+	result = 0;
+
+ out:
+
+	if(fd >= 0)
+	{
+		int error = errno;
+
+		close(fd);
+
+		errno = error;
+	}
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Ask the collector for its list of servers and copy the reply to the
+ * given stream. Returns -1 in case of error, with errno set, and 0
+ * otherwise.
+ */
+int
+query_collector(const char * socket_path,FILE * out)
+{
+	struct collector_message_header header;
+	char buffer[4096];
+	int result = -1;
+	ssize_t n;
+	int fd;
+
+	fd = connect_to_collector(socket_path);
+	if(fd < 0)
+		goto out;
+
+	memset(&header,0,sizeof(header));
+
+	header.magic = COLLECTOR_MAGIC;
+	header.version = COLLECTOR_VERSION;
+	header.type = COLLECTOR_MESSAGE_QUERY;
+
+	if(send_all(fd,&header,sizeof(header)) < 0)
+		goto out;
+
+	/* The reply ends when the collector closes the connection. */
+	while((n = read(fd,buffer,sizeof(buffer))) != 0)
+	{
+		if(n < 0)
+		{
+			if(errno == EINTR)
+				continue;
+
+			goto out;
+		}
+
+		fwrite(buffer,1,n,out);
+	}
+
+	result = 0;
+
+ out:
+
+	if(fd >= 0)
+	{
+		int error = errno;
+
+		close(fd);
+
+		errno = error;
+	}
+
+	return(result);
+}
@@ -0,0 +1,80 @@
+/*
+ * Collector which merges the scan results reported by many sensors into
+ * a single index of DHCP servers, and the protocol used to talk to it.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#ifndef _COLLECTOR_H
+#define _COLLECTOR_H
+
+/****************************************************************************/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+/****************************************************************************/
+
+#include "history.h"
+
+/****************************************************************************/
+
+#define COLLECTOR_MAGIC		0x44484352	/* "DHCR" */
+#define COLLECTOR_VERSION	1
+
+/* Longest sensor name, including the terminating NUL. */
+#define COLLECTOR_SENSOR_NAME_SIZE 64
+
+/****************************************************************************/
+
+/* Message types. */
+enum
+{
+	COLLECTOR_MESSAGE_REPORT=1,		/* Sensor reports scan results */
+	COLLECTOR_MESSAGE_QUERY=2		/* Client asks for the server index */
+};
+
+/****************************************************************************/
+
+/* Every message begins with this header. The numbers are in native
+ * byte order, since only local sockets are used.
+ */
+struct collector_message_header
+{
+	uint32_t	magic;
+	uint16_t	version;
+	uint16_t	type;
+	uint32_t	length;		/* Number of bytes following the header */
+};
+
+/* A report message is made up of this header, followed by the records
+ * for the servers which responded to a scan.
+ */
+struct collector_report_header
+{
+	char		sensor_name[COLLECTOR_SENSOR_NAME_SIZE];
+	uint32_t	num_records;
+	uint32_t	reserved;
+};
+
+/****************************************************************************/
+
+struct collector;
+
+/****************************************************************************/
+
+struct collector *create_collector(void);
+void delete_collector(struct collector *collector);
+int add_collector_report(struct collector *collector, const char *sensor_name, const void *records, size_t num_records);
+void print_collector_servers(const struct collector *collector, FILE *out);
+int run_collector(struct collector *collector, const char *socket_path, bool verbose);
+int send_collector_report(const char *socket_path, const char *sensor_name, const struct history_record *records, size_t num_records);
+int query_collector(const char *socket_path, FILE *out);
+
+/****************************************************************************/
+
+#endif /* _COLLECTOR_H */
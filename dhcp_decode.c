@@ -0,0 +1,748 @@
+/*
+ * Decoding of BOOTP/DHCP message contents.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdio.h>
+
+/****************************************************************************/
+
+#include "dhcp_decode.h"
+#include "fnv_hash.h"
+
+/****************************************************************************/
+
+
+/*
+ * Return checksum for the given data.
+ * Copied from FreeBSD
+ */
+unsigned short
+in_cksum(const void *_addr, int nleft)
+{
+	const uint16_t *w = _addr;
+	int sum = 0;
+	uint16_t answer = 0;
+
+	/*
+	 * Our algorithm is simple, using a 32 bit accumulator (sum), we add
+	 * sequential 16 bit words to it, and at the end, fold back all the
+	 * carry bits from the top 16 bits into the lower 16 bits.
+	 */
+	while (nleft > 1)
+	{
+		sum += *w++;
+		nleft -= 2;
+	}
+
+	/* mop up an odd byte, if necessary */
+	if (nleft == 1)
+	{
+		*(uint8_t *)&answer = *(const uint8_t *)w;
+		sum += answer;
+	}
+
+	/* add back carry outs from top 16 bits to low 16 bits */
+	sum = (sum >> 16) + (sum & 0xffff);	/* add hi 16 to low 16 */
+	sum += (sum >> 16);	/* add carry */
+	answer = ~sum;	/* truncate to 16 bits */
+
+	return (answer);
+}
+
+/****************************************************************************/
+
+/* Search the DHCP options for the DHCP message type and then return it.
+ * Returns -1 if no DHCP message type could be found.
+ */
+int
+get_dhcp_message_type(const uint8_t * vendor_options,int vendor_options_length)
+{
+	int option_type,option_length;
+	int result = -1;
+	int pos;
+
+	for(pos = 0 ; pos < vendor_options_length ; (void)NULL)
+	{
+		option_type = vendor_options[pos++];
+
+		/* Padding is simply skipped. */
+		if(option_type == OPTION_TYPE_PAD)
+			continue;
+
+		/* We stop at the end marker, or if we reach the end of the option buffer. */
+		if(option_type == OPTION_TYPE_END || pos == vendor_options_length)
+			break;
+
+		/* We stop when we reach the end of the option buffer. */
+		option_length = vendor_options[pos++];
+		if(pos == vendor_options_length)
+			break;
+
+		if(option_type == OPTION_TYPE_DHCP_MESSAGE_TYPE)
+		{
+			result = vendor_options[pos];
+			break;
+		}
+
+		pos += option_length;
+	}
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Decode classless static route information (RFC 3442) into a text buffer. */
+int decode_classless_static_route(const uint8_t * option_data, int option_length,
+	char * text_buffer, size_t text_buffer_size)
+{
+	int subnet_mask_width;
+	int num_destination_octets;
+	uint8_t destination_octets[4];
+	uint8_t route_octets[4];
+	int num_routes_decoded = 0;
+	char decoded_route_buffer[256];
+	int decoded_route_buffer_len;
+	size_t len = 0;
+	int result = -1;
+	int pos;
+	int i;
+
+	/* One off for NUL-termination. */
+	if(text_buffer_size > 0)
+		text_buffer_size--;
+
+	for(pos = 0 ; pos < option_length ; )
+	{
+		/* First octet states the width of the subnet mask,
+		 * in bits. This must be a value in the range 0-32.
+		 */
+		subnet_mask_width = option_data[pos++];
+		if(subnet_mask_width > 32)
+			goto out;
+
+		/* Only the significant octets of the destination
+		 * address are given.
+		 */
+		num_destination_octets = (subnet_mask_width + 7) / 8;
+
+		/* Number of octets to follow must be in the
+		 * buffer provided, not beyond it.
+		 */
+		if(pos + num_destination_octets > option_length)
+			goto out;
+
+		/* Copy the significant octets, then fill up
+		 * the remainder with zeroes.
+		 */
+		for(i = 0 ; i < num_destination_octets ; i++)
+			destination_octets[i] = option_data[pos++];
+
+		for( ; i < 4 ; i++)
+			destination_octets[i] = 0;
+
+		/* The router address must be in the buffer. */
+		if(pos + 4 > option_length)
+			goto out;
+
+		for(i = 0 ; i < 4 ; i++)
+			route_octets[i] = option_data[pos++];
+
+		/* No destination given? Then decode only the router address. */
+		if (subnet_mask_width == 0)
+		{
+			decoded_route_buffer_len = snprintf(decoded_route_buffer,sizeof(decoded_route_buffer),
+				"%u.%u.%u.%u",
+				route_octets[0],route_octets[1],
+				route_octets[2],route_octets[3]);
+		}
+		/* 32 bit subnet mask given? Then omit the subnet mask from the decoded output. */
+		else if (subnet_mask_width == 32)
+		{
+			decoded_route_buffer_len = snprintf(decoded_route_buffer,sizeof(decoded_route_buffer),
+				"%u.%u.%u.%u -> %u.%u.%u.%u",
+				destination_octets[0],destination_octets[1],
+				destination_octets[2],destination_octets[3],
+				route_octets[0],route_octets[1],
+				route_octets[2],route_octets[3]);
+		}
+		/* Default case: decode destination address and subnet size, as well
+		 * as the router address.
+		 */
+		else
+		{
+			decoded_route_buffer_len = snprintf(decoded_route_buffer,sizeof(decoded_route_buffer),
+				"%u.%u.%u.%u/%d -> %u.%u.%u.%u",
+				destination_octets[0],destination_octets[1],
+				destination_octets[2],destination_octets[3],
+				subnet_mask_width,
+				route_octets[0],route_octets[1],
+				route_octets[2],route_octets[3]);
+		}
+
+		assert( decoded_route_buffer_len > 0 );
+
+		/* If more than one single destination/subnet/router
+		 * was provided, separate the output by adding a
+		 * command and a blank space.
+		 */
+		if(len > 0)
+		{
+			/* Buffer overflow? */
+			if(len + 2 > text_buffer_size)
+				goto out;
+
+			text_buffer[len++] = ',';
+			text_buffer[len++] = ' ';
+		}
+
+		/* Buffer overflow? */
+		if(len + decoded_route_buffer_len > text_buffer_size)
+			goto out;
+
+		memmove(&text_buffer[len], decoded_route_buffer, decoded_route_buffer_len);
+
+		len += decoded_route_buffer_len;
+
+		text_buffer[len] = '\0';
+
+		num_routes_decoded++;
+	}
+
+	text_buffer[len] = '\0';
+
+	result = num_routes_decoded;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Decode static route information (RFC 1533) into a text buffer. */
+int decode_static_route(const uint8_t * option_data, int option_length,
+	char * text_buffer, size_t text_buffer_size)
+{
+	int num_routes;
+	uint8_t destination_octets[4];
+	uint8_t route_octets[4];
+	int num_routes_decoded = 0;
+	char decoded_route_buffer[256];
+	int decoded_route_buffer_len;
+	size_t len = 0;
+	int result = -1;
+	int pos;
+	int i;
+
+	/* One off for NUL-termination. */
+	if(text_buffer_size > 0)
+		text_buffer_size--;
+
+	for(pos = 0 ; pos < option_length ; )
+	{
+		num_routes = option_data[pos++];
+		if(num_routes == 0)
+			break;
+
+		/* Number of octets to follow must be in the
+		 * buffer provided, not beyond it.
+		 */
+		if(pos + 4 + 4 > option_length)
+			goto out;
+
+		for(i = 0 ; i < 4 ; i++)
+			destination_octets[i] = option_data[pos++];
+
+		for(i = 0 ; i < 4 ; i++)
+			route_octets[i] = option_data[pos++];
+
+		decoded_route_buffer_len = snprintf(decoded_route_buffer,sizeof(decoded_route_buffer),
+			"%u.%u.%u.%u -> %u.%u.%u.%u",
+			destination_octets[0],destination_octets[1],
+			destination_octets[2],destination_octets[3],
+			route_octets[0],route_octets[1],
+			route_octets[2],route_octets[3]);
+
+		assert( decoded_route_buffer_len > 0 );
+
+		/* If more than one single destination/subnet/router
+		 * was provided, separate the output by adding a
+		 * command and a blank space.
+		 */
+		if(len > 0)
+		{
+			/* Buffer overflow? */
+			if(len + 2 > text_buffer_size)
+				goto out;
+
+			text_buffer[len++] = ',';
+			text_buffer[len++] = ' ';
+		}
+
+		/* Buffer overflow? */
+		if(len + decoded_route_buffer_len > text_buffer_size)
+			goto out;
+
+		memmove(&text_buffer[len], decoded_route_buffer, decoded_route_buffer_len);
+
+		len += decoded_route_buffer_len;
+
+		text_buffer[len] = '\0';
+
+		num_routes_decoded++;
+	}
+
+	text_buffer[len] = '\0';
+
+	result = num_routes_decoded;
+
+out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Convert the number of seconds given for lease time and renewal/rebinding
+ * interval into more than just a single number, detailing minutes/hours/days.
+ */
+void
+convert_seconds_to_readable_form(uint32_t seconds,char * buffer,size_t buffer_size)
+{
+	if(seconds < 60)
+	{
+		assert( buffer_size > 0 );
+		
+		strcpy(buffer,"");
+	}
+	else if (seconds < 60 * 60)
+	{
+		int minutes = seconds / 60;
+
+		snprintf(buffer,buffer_size,minutes > 1 ? " (%u:%02u minutes)" : " (%u:%02u minute)",
+			minutes,
+			seconds % 60);
+	}
+	else if (seconds < 24 * 60 * 60)
+	{
+		int hours = seconds / (60 * 60);
+
+		snprintf(buffer,buffer_size,hours > 1 ? " (%u:%02u:%02u hours)" : " (%u:%02u:%02u hour)",
+			hours,
+			(seconds / 60) % 60,
+			seconds % 60);
+	}
+	else
+	{
+		int days = seconds / (24 * 60 * 60);
+
+		snprintf(buffer,buffer_size,days > 1 ? " (%u:%02u:%02u:%02u days)" : " (%u:%02u:%02u:%02u day)",
+			days,
+			(seconds / (60 * 60)) % 24,
+			(seconds / 60) % 60,
+			seconds % 60);
+	}
+}
+
+/****************************************************************************/
+
+/* Search for DHCP options of a specific type, aggregating their data into
+ * a single consecutive memory buffer. Returns true if any DHCP options
+ * could be found and a buffer was allocated for them, false otherwise.
+ * The buffer allocated must be freed eventually.
+ *
+ * Aggregated option data is described in RFC 3396 ("Encoding long options
+ * in the Dynamic Host Configuration Protocol (DHCPv4)").
+ */
+bool
+fill_aggregate_buffer_from_option(const uint8_t * vendor_options,int vendor_options_length,
+	int aggregate_option_type, uint8_t ** aggregate_buffer_ptr,size_t * aggregate_buffer_size_ptr)
+{
+	bool option_data_found = false;
+	uint8_t * aggregate_buffer = NULL;
+	size_t required_size = 0;
+	int option_type;
+	int option_length;
+	int output_pos;
+	int read_pos;
+	
+	assert( 0 < aggregate_option_type && aggregate_option_type < 255 );
+	assert( aggregate_buffer_ptr != NULL );
+	assert( aggregate_buffer_size_ptr != NULL );
+
+	/* Find out how much memory is required to store all
+	 * the data for a specific option type.
+	 */
+	for(read_pos = 0 ; read_pos < vendor_options_length ; (void)NULL)
+	{
+		option_type = vendor_options[read_pos++];
+
+		/* Skip the padding octet. */
+		if(option_type == OPTION_TYPE_PAD)
+			continue;
+
+		/* Stop at the end marker, or the end of the options buffer. */
+		if(option_type == OPTION_TYPE_END || read_pos == vendor_options_length)
+			break;
+
+		option_length = vendor_options[read_pos++];
+
+		/* Stop at the end of the options buffer. */
+		if(read_pos + option_length > vendor_options_length)
+			break;
+		
+		if(option_type == aggregate_option_type)
+			required_size += option_length;
+
+		read_pos += option_length;
+	}
+
+	/* No option data found? Then we have failed... */
+	if(required_size == 0)
+		goto out;
+
+	/* Allocate memory for storing the aggregated data in.
+	 * The buffer address and how much memory was allocated
+	 * will be provided to the caller.
+	 */
+	aggregate_buffer = malloc(required_size);
+	if(aggregate_buffer == NULL)
+		goto out;
+	
+	(*aggregate_buffer_ptr) = aggregate_buffer;
+	(*aggregate_buffer_size_ptr) = required_size;
+	
+	for(read_pos = output_pos = 0 ; read_pos < vendor_options_length ; (void)NULL)
+	{
+		option_type = vendor_options[read_pos++];
+
+		/* Skip the padding octet. */
+		if(option_type == OPTION_TYPE_PAD)
+			continue;
+
+		/* Stop at the end marker, or the end of the options buffer. */
+		if(option_type == OPTION_TYPE_END || read_pos == vendor_options_length)
+			break;
+
+		option_length = vendor_options[read_pos++];
+
+		/* Stop at the end of the options buffer. */
+		if(read_pos + option_length > vendor_options_length)
+			break;
+		
+		if(option_type == aggregate_option_type)
+		{
+			assert( output_pos + option_length <= (int)required_size );
+			
+			memmove(&aggregate_buffer[output_pos],&vendor_options[read_pos],option_length);
+
+			output_pos += option_length;
+		}
+
+		read_pos += option_length;
+	}
+	
+	option_data_found = true;
+	
+ out:
+	
+	return(option_data_found);
+}
+
+/****************************************************************************/
+
+/* Find out how much space is required for storing a complete,
+ * encoded domain name. The name either ends with a root marker
+ * or a compression pointer (RFC 1035, section 4.1.4). Returns
+ * number of octets used or 0 for buffer overflow/encoding
+ * error.
+ */
+static size_t
+get_domain_name_size(const uint8_t * buffer,size_t buffer_size)
+{
+	int length,compression;
+	size_t result = 0;
+	size_t pos;
+	
+	for(pos = 0 ; pos < buffer_size ; (void)NULL)
+	{
+		length = buffer[pos++];
+		if(length == 0)
+			break;
+
+		/* A label begins with a length field which
+		 * could also be a compression pointer.
+		 */
+		compression = length & 0xc0;
+
+		/* Is this a length field? */
+		if (compression == 0)
+		{
+			/* Check for buffer overflow. */
+			if(pos + length > buffer_size)
+				goto out;
+
+			pos += length;
+		}
+		/* Is this a compression pointer? */
+		else if (compression == 0xc0)
+		{
+			/* Check for buffer overflow. */
+			if(pos == buffer_size)
+				goto out;
+
+			/* Domain name continues where the
+			 * compression pointer leads to.
+			 */
+			pos++;
+			break;
+		}
+		/* Undefined encoding scheme. */
+		else
+		{
+			goto out;
+		}
+	}
+
+	result = pos;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Decode a domain name stored in a DNS record, decompressing it as
+ * necessary (RFC 1035, section 4.1.4). Returns the length of the
+ * decoded domain name or 0 for decoding error.
+ */
+static size_t
+decode_domain_name(const uint8_t * input_buffer,size_t input_buffer_size,size_t input_pos,
+	char * output_buffer,size_t output_buffer_size)
+{
+	int length,compression;
+	size_t output_pos = 0;
+	size_t result = 0;
+	size_t label_start = input_pos;
+
+	assert( output_buffer_size > 0 );
+	
+	while(input_pos < input_buffer_size)
+	{
+		length = input_buffer[input_pos++];
+		if(length == 0)
+			break;
+		
+		/* A label begins with a length field which
+		 * could also be a compression pointer.
+		 */
+		compression = length & 0xc0;
+
+		/* Is this a length field? */
+		if (compression == 0)
+		{
+			/* Check for buffer overflow. */
+			if(input_pos + length > input_buffer_size)
+				goto out;
+
+			/* Append the label to the output buffer if there is room. */
+			if(output_pos + length + 1 < output_buffer_size)
+			{
+				/* Add the label separator if there already is a
+				 * label in the output buffer.
+				 */
+				if(output_pos > 0)
+					output_buffer[output_pos++] = '.';
+
+				memmove(&output_buffer[output_pos],&input_buffer[input_pos],length);
+				output_pos += length;
+			}
+			
+			input_pos += length;
+		}
+		/* Is this a compression pointer? */
+		else if (compression == 0xc0)
+		{
+			size_t pointer;
+			
+			/* Check for buffer overflow. */
+			if(input_pos == input_buffer_size)
+				goto out;
+			
+			pointer = ((length & ~0xc0) << 8) | input_buffer[input_pos++];
+			
+			/* A compression pointer must lead to labels which came
+			 * before those decoded so far, or else the pointers
+			 * could form a loop which never ends.
+			 */
+			if(pointer >= label_start)
+				goto out;
+
+			/* Domain name continues where the compression
+			 * pointer leads.
+			 */
+			input_pos = label_start = pointer;
+		}
+		/* Undefined encoding scheme. */
+		else
+		{
+			goto out;
+		}
+	}
+
+	assert( output_pos < output_buffer_size );
+	output_buffer[output_pos] = '\0';
+
+	result = output_pos;
+
+ out:
+	
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Decode DHCP option 119 (Domain search, RFC 3397). The domain data may
+ * be broken up into several DHCP data options (RFC 3396) which first
+ * need to be aggregated. Returns true if the data could be decoded,
+ * false otherwise.
+ */
+bool
+decode_domain_search(const uint8_t * vendor_options,int vendor_options_length,
+	int aggregate_option_type,char * buffer,size_t buffer_size)
+{
+	/* The maximum length of a domain name, including "." separators,
+	 * would be 255 characters (RFC 2181, section 11 "Name syntax").
+	 * Space is reserved for the terminating NUL byte, too.
+	 */
+	char domain_name_buffer[256];
+	size_t domain_name_length;
+	uint8_t * aggregate_buffer = NULL;
+	size_t aggregate_buffer_size = 0;
+	bool found = false;
+	size_t buffer_pos = 0;
+	size_t pos;
+	size_t encoded_domain_size;
+
+	assert( buffer != NULL );
+	assert( buffer_size > 0 );
+
+	/* Aggregate all option 119 data. */
+	if(!fill_aggregate_buffer_from_option(vendor_options,vendor_options_length,
+			aggregate_option_type,&aggregate_buffer,&aggregate_buffer_size))
+		goto out;
+
+	/* Process the aggregated data, decoding each domain name stored. */
+	for(pos = 0 ; pos < aggregate_buffer_size ; pos += encoded_domain_size)
+	{
+		/* How much room will this encoded domain name take up? */
+		encoded_domain_size = get_domain_name_size(&aggregate_buffer[pos],aggregate_buffer_size - pos);
+		if(encoded_domain_size == 0)
+			break;
+
+		/* Attempt to decode this domain name. */
+		domain_name_length = decode_domain_name(aggregate_buffer,aggregate_buffer_size,pos,
+			domain_name_buffer,sizeof(domain_name_buffer));
+
+		if(domain_name_length > 0)
+		{
+			/* If there is more than one domain name in the output buffer
+			 * already, add a separator.
+			 */
+			if(buffer_pos > 0 && buffer_pos + 2 < buffer_size)
+			{
+				buffer[buffer_pos++] = ',';
+				buffer[buffer_pos++] = ' ';
+			}
+
+			/* Add the decoded domain name, if there is stil room. */
+			if(buffer_pos + domain_name_length < buffer_size)
+			{
+				memmove(&buffer[buffer_pos],domain_name_buffer,domain_name_length);
+				buffer_pos += domain_name_length;
+			}
+		}
+	}
+	
+	found = true;
+	
+ out:
+
+	/* Provide NUL termination for the output buffer. */
+	if(buffer_pos < buffer_size)
+		buffer[buffer_pos] = '\0';
+
+	/* Free the memory which we allocated for the
+	 * aggregated option 119 data.
+	 */
+	if(aggregate_buffer != NULL)
+		free(aggregate_buffer);
+
+	return(found);
+}
+
+/****************************************************************************/
+
+/* Calculate a hash value over the normalised contents of a DHCP offer, so
+ * that offers can be compared without formatting and comparing their text
+ * form. The offered IPv4 address and the lease, renewal and rebinding times
+ * are left out since these may change from one offer to the next without
+ * the server configuration having changed. The individual options are
+ * combined in such a way that the order in which they appear does not
+ * matter.
+ */
+uint64_t
+hash_offer(const bootp_t * dhcp,const uint8_t * vendor_options,int vendor_options_length)
+{
+	uint64_t result;
+	uint64_t option_hash;
+	int option_type,option_length;
+	int pos;
+
+	result = FNV1A_64_OFFSET_BASIS;
+	result = fnv1a_64(result,&dhcp->siaddr,sizeof(dhcp->siaddr));
+	result = fnv1a_64(result,&dhcp->giaddr,sizeof(dhcp->giaddr));
+	result = fnv1a_64(result,dhcp->sname,sizeof(dhcp->sname));
+	result = fnv1a_64(result,dhcp->file,sizeof(dhcp->file));
+
+	for(pos = 0 ; pos < vendor_options_length ; (void)NULL)
+	{
+		option_type = vendor_options[pos++];
+
+		/* Skip the padding octet. */
+		if(option_type == OPTION_TYPE_PAD)
+			continue;
+
+		/* Stop at the end marker, or the end of the options buffer. */
+		if(option_type == OPTION_TYPE_END || pos == vendor_options_length)
+			break;
+
+		/* Stop at the end of the options buffer. */
+		option_length = vendor_options[pos++];
+		if(pos + option_length > vendor_options_length)
+			break;
+
+		if(option_type != OPTION_TYPE_IP_ADDRESS_LEASE_TIME &&
+		   option_type != OPTION_TYPE_RENEWAL_TIME &&
+		   option_type != OPTION_TYPE_REBINDING_TIME)
+		{
+			option_hash = fnv1a_64(FNV1A_64_OFFSET_BASIS,&vendor_options[pos-2],2 + option_length);
+
+			result += option_hash;
+		}
+
+		pos += option_length;
+	}
+
+	return(result);
+}
+
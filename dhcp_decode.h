@@ -0,0 +1,37 @@
+/*
+ * Decoding of BOOTP/DHCP message contents. None of these functions
+ * keep any state of their own, which means that they may be called
+ * from several threads at the same time.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#ifndef _DHCP_DECODE_H
+#define _DHCP_DECODE_H
+
+/****************************************************************************/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/****************************************************************************/
+
+#include "dhcp_protocol.h"
+
+/****************************************************************************/
+
+unsigned short in_cksum(const void *_addr, int nleft);
+int get_dhcp_message_type(const uint8_t *vendor_options, int vendor_options_length);
+int decode_classless_static_route(const uint8_t *option_data, int option_length, char *text_buffer, size_t text_buffer_size);
+int decode_static_route(const uint8_t *option_data, int option_length, char *text_buffer, size_t text_buffer_size);
+void convert_seconds_to_readable_form(uint32_t seconds, char *buffer, size_t buffer_size);
+bool fill_aggregate_buffer_from_option(const uint8_t *vendor_options, int vendor_options_length, int aggregate_option_type, uint8_t **aggregate_buffer_ptr, size_t *aggregate_buffer_size_ptr);
+bool decode_domain_search(const uint8_t *vendor_options, int vendor_options_length, int aggregate_option_type, char *buffer, size_t buffer_size);
+uint64_t hash_offer(const bootp_t *dhcp, const uint8_t *vendor_options, int vendor_options_length);
+
+/****************************************************************************/
+
+#endif /* _DHCP_DECODE_H */
@@ -0,0 +1,142 @@
+/*
+ * Building the Ethernet frames which carry DHCP messages, as used for
+ * sending DHCP DISCOVER messages and, by the fake DHCP servers, for
+ * sending offers in response.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <net/ethernet.h>
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <arpa/inet.h>
+
+#ifdef __linux__
+/* This makes the 'struct udphdr' use the same
+ * field names as used in the BSD header files.
+ */
+#define __FAVOR_BSD
+#endif /* __linux__ */
+#include <netinet/udp.h>
+
+#include <string.h>
+#include <assert.h>
+
+/****************************************************************************/
+
+#include "dhcp_frame.h"
+#include "dhcp_decode.h"
+
+/****************************************************************************/
+
+/*
+ * Ethernet output handler - Fills appropriate bytes in ethernet header
+ */
+int
+ether_output(uint8_t *frame, const uint8_t *src_mac_address, const uint8_t *dst_mac_address, int len)
+{
+	struct ether_header *eframe = (struct ether_header *)frame;
+
+	len += sizeof(*eframe);
+
+	memmove(eframe->ether_shost, src_mac_address, ETHER_ADDR_LEN);
+	memmove(eframe->ether_dhost, dst_mac_address, ETHER_ADDR_LEN);
+
+	eframe->ether_type = htons(ETHERTYPE_IP);
+
+	return(len);
+}
+
+/****************************************************************************/
+
+/*
+ * IP Output handler - Fills appropriate bytes in IP header
+ */
+int
+ip_output(struct ip *ip_header, ip4_t src_address, ip4_t dst_address, int len)
+{
+	len += sizeof(struct ip);
+
+	ip_header->ip_hl = 5;
+	ip_header->ip_v = IPVERSION;
+	ip_header->ip_tos = 0x10; /* minimize delay (RFC 1349) */
+	ip_header->ip_len = htons(len);
+	ip_header->ip_id = htons(0xffff);
+	ip_header->ip_off = 0;
+	ip_header->ip_ttl = 16;
+	ip_header->ip_p = IPPROTO_UDP;
+	ip_header->ip_sum = 0;
+	ip_header->ip_src.s_addr = src_address;
+	ip_header->ip_dst.s_addr = dst_address;
+
+	ip_header->ip_sum = in_cksum(ip_header, sizeof(struct ip));
+
+	return(len);
+}
+
+/****************************************************************************/
+
+/*
+ * UDP output - Fills appropriate bytes in UDP header
+ */
+int
+udp_output(struct ip *ip_header, ip4_t src_address, ip4_t dst_address, struct udphdr *udp_header,
+	uint16_t src_port, uint16_t dst_port, int len)
+{
+	struct udp_pseudo_header * udp_pseudo_header;
+	
+	/* Length must be even. */
+	if ((len % 2) != 0)
+		len++;
+
+	len += sizeof(struct udphdr);
+
+	udp_header->uh_sport = htons(src_port);
+	udp_header->uh_dport = htons(dst_port);
+	udp_header->uh_ulen = htons(len);
+	udp_header->uh_sum = 0;
+
+	/* We fill the IP/UDP pseudo-header with defaults with regard
+	 * to protocol, source IPv4 address and destination IPv4 address.
+	 */
+	udp_pseudo_header = (struct udp_pseudo_header *)ip_header;
+	udp_pseudo_header->ih_zero1[0] = udp_pseudo_header->ih_zero1[1] = 0;
+	udp_pseudo_header->ih_zero2 = 0;
+	udp_pseudo_header->ih_pr = IPPROTO_UDP;
+	udp_pseudo_header->ih_src = src_address;
+	udp_pseudo_header->ih_dst = dst_address;
+	udp_pseudo_header->ih_len = udp_pseudo_header->uh_ulen;
+	
+	udp_header->uh_sum = in_cksum(ip_header,sizeof(*ip_header) + ntohs(udp_pseudo_header->uh_ulen));
+	
+	return(len);
+}
+
+/****************************************************************************/
+
+/*
+ * Adds DHCP option to the bytestream
+ */
+int
+fill_dhcp_option(uint8_t *option_buffer, uint8_t option_code, const void *option_data, int len)
+{
+	assert( 0 <= len && len < 256 );
+
+	option_buffer[0] = option_code;
+	option_buffer[1] = len;
+
+	if(len > 0)
+	{
+		assert( option_data != NULL );
+
+		memmove(&option_buffer[2], option_data, len);
+	}
+
+	len += sizeof(uint8_t) * 2;
+
+	return(len);
+}
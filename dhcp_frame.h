@@ -0,0 +1,40 @@
+/*
+ * Building the Ethernet frames which carry DHCP messages.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#ifndef _DHCP_FRAME_H
+#define _DHCP_FRAME_H
+
+/****************************************************************************/
+
+#include <stdint.h>
+
+/****************************************************************************/
+
+#include "dhcp_protocol.h"
+
+/****************************************************************************/
+
+struct ip;
+struct udphdr;
+
+/****************************************************************************/
+
+/* The UDP header must be filled in before the IP header, since the UDP
+ * checksum is calculated in the space which the IP header takes up.
+ * Each function is given the length of what follows its header and
+ * returns the length including its header. The IPv4 addresses are in
+ * network byte order.
+ */
+int ether_output(uint8_t *frame, const uint8_t *src_mac_address, const uint8_t *dst_mac_address, int len);
+int ip_output(struct ip *ip_header, ip4_t src_address, ip4_t dst_address, int len);
+int udp_output(struct ip *ip_header, ip4_t src_address, ip4_t dst_address, struct udphdr *udp_header, uint16_t src_port, uint16_t dst_port, int len);
+int fill_dhcp_option(uint8_t *option_buffer, uint8_t option_code, const void *option_data, int len);
+
+/****************************************************************************/
+
+#endif /* _DHCP_FRAME_H */
@@ -0,0 +1,238 @@
+/*
+ * Decoding of a BOOTP/DHCP message into a fixed-size structure, without
+ * allocating any memory.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#include <string.h>
+#include <errno.h>
+
+/****************************************************************************/
+
+#include "dhcp_message.h"
+
+/****************************************************************************/
+
+/* The largest options area which the index can describe. */
+#define MAXIMUM_OPTIONS_LENGTH 65535
+
+/****************************************************************************/
+
+/* Read a 16 or 32 bit number stored in network byte order, which need
+ * not be aligned.
+ */
+static inline uint16_t
+get_uint16(const uint8_t * data)
+{
+	return((uint16_t)((data[0] << 8) | data[1]));
+}
+
+static inline uint32_t
+get_uint32(const uint8_t * data)
+{
+	return(((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | data[3]);
+}
+
+/****************************************************************************/
+
+/* Length of the text stored in a fixed size field, which is NUL-terminated
+ * only if it is shorter than the field.
+ */
+static int
+get_text_length(const uint8_t * field,int field_size)
+{
+	const uint8_t * nul;
+	int result;
+
+	nul = memchr(field,'\0',field_size);
+	if(nul != NULL)
+		result = nul - field;
+	else
+		result = field_size;
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Find the data of an option, if it is present and its size is at least
+ * minimum_length octets, and a multiple of 'granularity' octets. Returns
+ * NULL otherwise.
+ */
+static const uint8_t *
+get_option(const struct dhcp_message * message,int option_type,int minimum_length,int granularity,int * length_ptr)
+{
+	const uint8_t * result = NULL;
+	int length;
+
+	if(is_option_present(&message->index,option_type))
+	{
+		length = message->index.option_length[option_type];
+
+		if(length >= minimum_length && (length % granularity) == 0)
+		{
+			(*length_ptr) = length;
+
+			result = &message->index.options[message->index.option_offset[option_type]];
+		}
+	}
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Fill in the view of an option which holds a number of 16 or 32 bits. */
+static void
+view_number(struct dhcp_message * message,int option_type,uint32_t view,int size,void * number)
+{
+	const uint8_t * data;
+	int length;
+
+	data = get_option(message,option_type,size,1,&length);
+	if(data != NULL)
+	{
+		if(size == sizeof(uint16_t))
+			(*(uint16_t *)number) = get_uint16(data);
+		else
+			(*(uint32_t *)number) = get_uint32(data);
+
+		message->views |= view;
+	}
+}
+
+/****************************************************************************/
+
+/* Fill in the view of an option which holds a list of IPv4 addresses. */
+static void
+view_address_list(struct dhcp_message * message,int option_type,uint32_t view,struct dhcp_address_list * list)
+{
+	const uint8_t * data;
+	int length;
+
+	data = get_option(message,option_type,4,4,&length);
+	if(data != NULL)
+	{
+		list->addresses = data;
+		list->count = length / 4;
+
+		message->views |= view;
+	}
+}
+
+/****************************************************************************/
+
+/* Fill in the view of an option which holds text. */
+static void
+view_text(struct dhcp_message * message,int option_type,uint32_t view,struct dhcp_text * text)
+{
+	const uint8_t * data;
+	int length;
+
+	data = get_option(message,option_type,1,1,&length);
+	if(data != NULL)
+	{
+		text->text = (const char *)data;
+		text->length = length;
+
+		message->views |= view;
+	}
+}
+
+/****************************************************************************/
+
+/* Decode the BOOTP/DHCP message found in the payload of a UDP datagram,
+ * filling in the structure provided. The message is not modified and
+ * no memory is allocated, which means that this function may be called
+ * from several threads at the same time. Returns -1 if the message is
+ * too short to hold a BOOTP header, with errno set to EINVAL, and 0
+ * otherwise.
+ */
+int
+decode_dhcp_message(struct dhcp_message * message,const uint8_t * payload,size_t length)
+{
+	const uint8_t * vendor_options = NULL;
+	size_t vendor_options_length = 0;
+	int result = -1;
+
+	memset(message,0,offsetof(struct dhcp_message,index));
+
+	if(length < offsetof(bootp_t,magic_cookie))
+	{
+		errno = EINVAL;
+		goto out;
+	}
+
+	message->opcode						= payload[offsetof(bootp_t,opcode)];
+	message->hardware_type				= payload[offsetof(bootp_t,htype)];
+	message->hardware_address_length	= payload[offsetof(bootp_t,hlen)];
+	message->hops						= payload[offsetof(bootp_t,hops)];
+	message->transaction_id				= get_uint32(&payload[offsetof(bootp_t,xid)]);
+	message->seconds					= get_uint16(&payload[offsetof(bootp_t,secs)]);
+	message->flags						= get_uint16(&payload[offsetof(bootp_t,flags)]);
+	message->client_address				= get_uint32(&payload[offsetof(bootp_t,ciaddr)]);
+	message->offered_address			= get_uint32(&payload[offsetof(bootp_t,yiaddr)]);
+	message->next_server_address		= get_uint32(&payload[offsetof(bootp_t,siaddr)]);
+	message->relay_agent_address		= get_uint32(&payload[offsetof(bootp_t,giaddr)]);
+	message->client_hardware_address	= &payload[offsetof(bootp_t,chaddr)];
+
+	message->server_name.text = (const char *)&payload[offsetof(bootp_t,sname)];
+	message->server_name.length = get_text_length(&payload[offsetof(bootp_t,sname)],sizeof(((bootp_t *)NULL)->sname));
+
+	message->boot_file_name.text = (const char *)&payload[offsetof(bootp_t,file)];
+	message->boot_file_name.length = get_text_length(&payload[offsetof(bootp_t,file)],sizeof(((bootp_t *)NULL)->file));
+
+	/* The options follow the magic cookie, if there is one. */
+	if(length >= offsetof(bootp_t,vend) && get_uint32(&payload[offsetof(bootp_t,magic_cookie)]) == DHCP_MAGIC_COOKIE)
+	{
+		message->has_magic_cookie = true;
+
+		vendor_options = &payload[offsetof(bootp_t,vend)];
+		vendor_options_length = length - offsetof(bootp_t,vend);
+
+		if(vendor_options_length > MAXIMUM_OPTIONS_LENGTH)
+			vendor_options_length = MAXIMUM_OPTIONS_LENGTH;
+	}
+
+	message->index.server_address		= 0;
+	message->index.offered_address		= message->offered_address;
+	message->index.next_server_address	= message->next_server_address;
+	message->index.relay_agent_address	= message->relay_agent_address;
+
+	build_option_index(&message->index,vendor_options,(int)vendor_options_length);
+
+	/* The typed views are cleared only now, since they follow the index. */
+	memset(&message->views,0,sizeof(*message) - offsetof(struct dhcp_message,views));
+
+	message->message_type = -1;
+
+	if(is_option_present(&message->index,OPTION_TYPE_DHCP_MESSAGE_TYPE) && message->index.option_length[OPTION_TYPE_DHCP_MESSAGE_TYPE] > 0)
+		message->message_type = message->index.options[message->index.option_offset[OPTION_TYPE_DHCP_MESSAGE_TYPE]];
+
+	view_number(message,OPTION_TYPE_SUBNET_MASK,DHCP_VIEW_SUBNET_MASK,sizeof(uint32_t),&message->subnet_mask);
+	view_number(message,OPTION_TYPE_BROADCAST_ADDRESS,DHCP_VIEW_BROADCAST_ADDRESS,sizeof(uint32_t),&message->broadcast_address);
+	view_number(message,OPTION_TYPE_SERVER_IDENTIFIER,DHCP_VIEW_SERVER_IDENTIFIER,sizeof(uint32_t),&message->server_identifier);
+	view_number(message,OPTION_TYPE_IP_ADDRESS_LEASE_TIME,DHCP_VIEW_LEASE_TIME,sizeof(uint32_t),&message->lease_time);
+	view_number(message,OPTION_TYPE_RENEWAL_TIME,DHCP_VIEW_RENEWAL_TIME,sizeof(uint32_t),&message->renewal_time);
+	view_number(message,OPTION_TYPE_REBINDING_TIME,DHCP_VIEW_REBINDING_TIME,sizeof(uint32_t),&message->rebinding_time);
+	view_number(message,OPTION_TYPE_INTERFACE_MTU,DHCP_VIEW_INTERFACE_MTU,sizeof(uint16_t),&message->interface_mtu);
+	view_number(message,OPTION_TYPE_MAXIMUM_DHCP_MESSAGE_SIZE,DHCP_VIEW_MAXIMUM_MESSAGE_SIZE,sizeof(uint16_t),&message->maximum_message_size);
+
+	view_address_list(message,OPTION_TYPE_GATEWAY,DHCP_VIEW_ROUTERS,&message->routers);
+	view_address_list(message,OPTION_TYPE_DNS,DHCP_VIEW_DNS_SERVERS,&message->dns_servers);
+	view_address_list(message,OPTION_TYPE_NTP_SERVERS,DHCP_VIEW_NTP_SERVERS,&message->ntp_servers);
+	view_address_list(message,OPTION_TYPE_NETBIOS_OVER_TCP_IP_NAME_SERVER,DHCP_VIEW_NETBIOS_NAME_SERVERS,&message->netbios_name_servers);
+
+	view_text(message,OPTION_TYPE_DOMAIN_NAME,DHCP_VIEW_DOMAIN_NAME,&message->domain_name);
+	view_text(message,OPTION_TYPE_MESSAGE,DHCP_VIEW_MESSAGE,&message->message);
+	view_text(message,OPTION_TYPE_PROXY_AUTODISCOVERY,DHCP_VIEW_PROXY_AUTODISCOVERY,&message->proxy_autodiscovery);
+
+	result = 0;
+
+ out:
+
+	return(result);
+}
@@ -0,0 +1,122 @@
+/*
+ * Decoding of a BOOTP/DHCP message into a fixed-size structure, without
+ * allocating any memory. The structure refers to the message contents
+ * rather than copying them, which means that the message buffer must
+ * remain valid for as long as the structure is used.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#ifndef _DHCP_MESSAGE_H
+#define _DHCP_MESSAGE_H
+
+/****************************************************************************/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/****************************************************************************/
+
+#include "dhcp_protocol.h"
+#include "offer_index.h"
+
+/****************************************************************************/
+
+/* A list of IPv4 addresses, 4 octets each, in network byte order. */
+struct dhcp_address_list
+{
+	const uint8_t *	addresses;
+	int				count;
+};
+
+/* Text which is not necessarily NUL-terminated. */
+struct dhcp_text
+{
+	const char *	text;
+	int				length;
+};
+
+/****************************************************************************/
+
+/* Which of the typed option views in a struct dhcp_message are valid. An
+ * option must be present and have the expected size for its view to be
+ * valid.
+ */
+enum
+{
+	DHCP_VIEW_SUBNET_MASK					= (1 << 0),
+	DHCP_VIEW_BROADCAST_ADDRESS				= (1 << 1),
+	DHCP_VIEW_SERVER_IDENTIFIER				= (1 << 2),
+	DHCP_VIEW_LEASE_TIME					= (1 << 3),
+	DHCP_VIEW_RENEWAL_TIME					= (1 << 4),
+	DHCP_VIEW_REBINDING_TIME				= (1 << 5),
+	DHCP_VIEW_INTERFACE_MTU					= (1 << 6),
+	DHCP_VIEW_MAXIMUM_MESSAGE_SIZE			= (1 << 7),
+	DHCP_VIEW_ROUTERS						= (1 << 8),
+	DHCP_VIEW_DNS_SERVERS					= (1 << 9),
+	DHCP_VIEW_NTP_SERVERS					= (1 << 10),
+	DHCP_VIEW_NETBIOS_NAME_SERVERS			= (1 << 11),
+	DHCP_VIEW_DOMAIN_NAME					= (1 << 12),
+	DHCP_VIEW_MESSAGE						= (1 << 13),
+	DHCP_VIEW_PROXY_AUTODISCOVERY			= (1 << 14)
+};
+
+/****************************************************************************/
+
+/* The BOOTP header fields, the index of the options and typed views of
+ * the most common options. All numbers and addresses other than those
+ * in address lists are stored in host byte order. Only the first
+ * instance of each option is considered.
+ */
+struct dhcp_message
+{
+	uint8_t						opcode;
+	uint8_t						hardware_type;
+	uint8_t						hardware_address_length;
+	uint8_t						hops;
+	uint32_t					transaction_id;
+	uint16_t					seconds;
+	uint16_t					flags;
+	uint32_t					client_address;			/* ciaddr */
+	uint32_t					offered_address;		/* yiaddr */
+	uint32_t					next_server_address;	/* siaddr */
+	uint32_t					relay_agent_address;	/* giaddr */
+	const uint8_t *				client_hardware_address;/* chaddr, 16 octets */
+	struct dhcp_text			server_name;			/* sname */
+	struct dhcp_text			boot_file_name;			/* file */
+
+	bool						has_magic_cookie;		/* Options follow? */
+	int							message_type;			/* MESSAGE_TYPE_*, or -1 */
+
+	/* Where to find the raw option data; its server_address is 0. */
+	struct offer_index			index;
+
+	uint32_t					views;					/* DHCP_VIEW_* */
+
+	uint32_t					subnet_mask;
+	uint32_t					broadcast_address;
+	uint32_t					server_identifier;
+	uint32_t					lease_time;
+	uint32_t					renewal_time;
+	uint32_t					rebinding_time;
+	uint16_t					interface_mtu;
+	uint16_t					maximum_message_size;
+	struct dhcp_address_list	routers;
+	struct dhcp_address_list	dns_servers;
+	struct dhcp_address_list	ntp_servers;
+	struct dhcp_address_list	netbios_name_servers;
+	struct dhcp_text			domain_name;
+	struct dhcp_text			message;
+	struct dhcp_text			proxy_autodiscovery;
+};
+
+/****************************************************************************/
+
+int decode_dhcp_message(struct dhcp_message *message, const uint8_t *payload, size_t length);
+
+/****************************************************************************/
+
+#endif /* _DHCP_MESSAGE_H */
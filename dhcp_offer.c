@@ -0,0 +1,744 @@
+/*
+ * DHCP offers received from a server, decoded into readable form.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+/****************************************************************************/
+
+/* This is needed for vasprintf(). */
+#define _GNU_SOURCE
+
+#include <sys/types.h>
+#include <net/ethernet.h>
+#include <arpa/inet.h>
+
+#include <stdbool.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+
+/****************************************************************************/
+
+#include "dhcp_offer.h"
+#include "dhcp_decode.h"
+
+/****************************************************************************/
+
+/* Generic Ethernet broadcast group address. */
+static const uint8_t broadcast_mac_address[ETHER_ADDR_LEN] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+
+/****************************************************************************/
+
+/* Allocate a record for a DHCP server with given IPv4 address and MAC
+ * address, time-stamped with the current time. Returns NULL if not
+ * enough memory is available.
+ */
+struct dhcp_offer *
+create_dhcp_offer(const uint8_t * server_ipv4_address, const uint8_t * server_mac_address)
+{
+	struct dhcp_offer * result = NULL;
+	struct dhcp_offer * offer;
+
+	offer = calloc(1,sizeof(*offer));
+	if(offer == NULL)
+		goto out;
+
+	gettimeofday(&offer->stamp, NULL);
+
+	memmove(offer->server_ipv4_address,server_ipv4_address,sizeof(offer->server_ipv4_address));
+	memmove(offer->server_mac_address,server_mac_address,sizeof(offer->server_mac_address));
+
+	new_list(&offer->dhcp_response);
+	new_list(&offer->dhcp_option);
+
+	result = offer;
+	offer = NULL;
+
+out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Release memory allocated by create_kv_node(). This is safe to call
+ * even if create_kv_node() failed.
+ */
+static void
+delete_kv_node(struct kv_node * kvn)
+{
+	if(kvn != NULL)
+	{
+		if(kvn->key != NULL)
+			free(kvn->key);
+
+		if(kvn->value != NULL)
+			free(kvn->value);
+
+		free(kvn);
+	}
+}
+
+/****************************************************************************/
+
+/* Allocate memory for a key-value record, with the key value
+ * generated from a printf() style format spec. Returns NULL
+ * in case of error.
+ */
+static struct kv_node *
+create_kv_node(const char * key,const char * string_format,va_list args)
+{
+	struct kv_node * result = NULL;
+	struct kv_node * kvn;
+
+	kvn = calloc(1,sizeof(*kvn));
+	if(kvn == NULL)
+		goto out;
+
+	kvn->key = strdup(key);
+	if(kvn->key == NULL)
+		goto out;
+
+	if(vasprintf(&kvn->value,string_format,args) < 0)
+		goto out;
+
+	result = kvn;
+	kvn = NULL;
+
+out:
+
+	if(kvn != NULL)
+		delete_kv_node(kvn);
+
+	return(result);
+}
+
+/****************************************************************************/
+/* Release memory allocated by create_dhcp_offer(), including all the
+ * response and option records attached to it. The record must have been
+ * removed from any list before this function is called.
+ */
+void
+delete_dhcp_offer(struct dhcp_offer * offer)
+{
+	struct kv_node * kvn;
+
+	if(offer != NULL)
+	{
+		while((kvn = (struct kv_node *)remove_list_head(&offer->dhcp_response)) != NULL)
+			delete_kv_node(kvn);
+
+		while((kvn = (struct kv_node *)remove_list_head(&offer->dhcp_option)) != NULL)
+			delete_kv_node(kvn);
+
+		free(offer);
+	}
+}
+
+/****************************************************************************/
+
+/* Check if a list already contains the record of a specific DHCP server,
+ * which uses a known combination of IPv4 address and MAC address. Returns
+ * NULL if no such DHCP server has been recorded yet.
+ */
+struct dhcp_offer *
+find_dhcp_offer(const struct List * offer_list, const uint8_t * server_ipv4_address, const uint8_t * server_mac_address)
+{
+	struct dhcp_offer * result = NULL;
+	struct dhcp_offer * offer;
+
+	for(offer = (struct dhcp_offer *)get_list_head(offer_list) ;
+		offer != NULL ;
+		offer = (struct dhcp_offer *)get_next_node(&offer->node))
+	{
+		if(memcmp(offer->server_ipv4_address,server_ipv4_address,sizeof(offer->server_ipv4_address)) == 0 &&
+		   memcmp(offer->server_mac_address,server_mac_address,sizeof(offer->server_mac_address)) == 0)
+		{
+			result = offer;
+			break;
+		}
+	}
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Take note of a further response by the server which sent the offer,
+ * which arrived at the given time.
+ */
+static void
+add_duplicate(struct dhcp_offer * offer, const struct timeval * stamp)
+{
+	struct dhcp_duplicates * duplicates = &offer->duplicates;
+	const struct timeval * previous_stamp;
+	int64_t interval;
+
+	if(duplicates->count == 0)
+		previous_stamp = &offer->stamp;
+	else
+		previous_stamp = &duplicates->last_stamp;
+
+	interval = (int64_t)(stamp->tv_sec - previous_stamp->tv_sec) * 1000000 + (stamp->tv_usec - previous_stamp->tv_usec);
+
+	/* The system time may have been changed in the meantime. */
+	if(interval < 0)
+		interval = 0;
+
+	if(duplicates->count == 0 || interval < duplicates->minimum_interval)
+		duplicates->minimum_interval = interval;
+
+	if(duplicates->count == 0 || interval > duplicates->maximum_interval)
+		duplicates->maximum_interval = interval;
+
+	duplicates->total_interval += interval;
+	duplicates->last_stamp = (*stamp);
+	duplicates->count++;
+}
+
+/****************************************************************************/
+
+/* Take note of a further response by the server which sent the offer,
+ * which arrived at the given time. This neither allocates memory nor
+ * performs any I/O, so that a server which keeps responding costs as
+ * little as possible.
+ */
+void
+count_duplicate_dhcp_offer(struct dhcp_offer * offer, const struct timeval * stamp)
+{
+	add_duplicate(offer, stamp);
+}
+
+/****************************************************************************/
+
+/* Count a later record of the same server, along with its own duplicates,
+ * as duplicates of the offer.
+ */
+void
+merge_dhcp_offer_duplicates(struct dhcp_offer * offer, const struct dhcp_offer * later_offer)
+{
+	struct dhcp_duplicates * duplicates = &offer->duplicates;
+	const struct dhcp_duplicates * later_duplicates = &later_offer->duplicates;
+
+	add_duplicate(offer, &later_offer->stamp);
+
+	if(later_duplicates->count > 0)
+	{
+		if(later_duplicates->minimum_interval < duplicates->minimum_interval)
+			duplicates->minimum_interval = later_duplicates->minimum_interval;
+
+		if(later_duplicates->maximum_interval > duplicates->maximum_interval)
+			duplicates->maximum_interval = later_duplicates->maximum_interval;
+
+		duplicates->total_interval += later_duplicates->total_interval;
+		duplicates->last_stamp = later_duplicates->last_stamp;
+		duplicates->count += later_duplicates->count;
+	}
+}
+
+/****************************************************************************/
+
+/* Remove and release all the records in a list. */
+void
+clear_dhcp_offers(struct List * offer_list)
+{
+	struct dhcp_offer * offer;
+
+	while((offer = (struct dhcp_offer *)remove_list_head(offer_list)) != NULL)
+		delete_dhcp_offer(offer);
+}
+
+/****************************************************************************/
+
+/* Remember a DHCP server response, with given name. The response value is
+ * stored as a string, using the printf() style formatting provided.
+ */
+struct kv_node *
+add_dhcp_response(struct dhcp_offer * offer,const char * key,const char * string_format,...)
+{
+	struct kv_node * result = NULL;
+	struct kv_node * kvn;
+	va_list args;
+
+	va_start(args, string_format);
+	kvn = create_kv_node(key,string_format,args);
+	va_end(args);
+
+	if(kvn == NULL)
+		goto out;
+
+	add_node_to_list_tail(&offer->dhcp_response, &kvn->node);
+
+	result = kvn;
+
+out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Remember a DHCP option, with given option name. The option value is
+ * stored as a string, using the printf() style formatting provided.
+ */
+struct kv_node *
+add_dhcp_option(struct dhcp_offer * offer,const char * key,const char * string_format,...)
+{
+	struct kv_node * result = NULL;
+	struct kv_node * kvn;
+	va_list args;
+
+	va_start(args, string_format);
+	kvn = create_kv_node(key,string_format,args);
+	va_end(args);
+
+	if(kvn == NULL)
+		goto out;
+
+	add_node_to_list_tail(&offer->dhcp_option, &kvn->node);
+
+	result = kvn;
+
+out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Decode a DHCP offer, adding the general response information and the
+ * BOOTP/DHCP options it contains to the record, in readable form. The
+ * offer was sent to the destination MAC address given and received
+ * through the named interface, whose own MAC address is given, too.
+ * Records which cannot be added for lack of memory are skipped.
+ */
+void
+decode_dhcp_offer(struct dhcp_offer * offer,
+	const bootp_t * dhcp,
+	int length,
+	const uint8_t * destination_mac_address,
+	const char * interface_name,
+	const uint8_t * client_mac_address)
+{
+	uint8_t ignore_option[256 / 8];
+	ip4_t ipv4_address;
+	const uint8_t * vendor_options;
+	int vendor_options_length;
+	int pos;
+	char text_buffer[1500];
+	int option_type,option_length;
+	uint8_t * aggregate_buffer;
+	size_t aggregate_buffer_size;
+
+	/* We copy the option data to a 32 bit word-aligned
+	 * buffer because we may need to access 32 bit words
+	 * inside it and we cannot expect the option data to
+	 * be aligned appropriately.
+	 */
+	uint32_t aligned_buffer[256 / sizeof(uint32_t)+1];
+	uint8_t * option_data = (uint8_t *)aligned_buffer;
+
+	/* We ignore no vendor option yet. */
+	memset(ignore_option,0,sizeof(ignore_option));
+
+	vendor_options = dhcp->vend;
+	vendor_options_length = length - offsetof(bootp_t,vend);
+
+	offer->offer_hash = hash_offer(dhcp,vendor_options,vendor_options_length);
+
+	add_dhcp_response(offer,"network-interface","%s (%02x:%02x:%02x:%02x:%02x:%02x)",
+		interface_name,
+		client_mac_address[0], client_mac_address[1], client_mac_address[2],
+		client_mac_address[3], client_mac_address[4], client_mac_address[5]);
+
+	/* The server name, if not empty, should be NUL-terminated. We cannot
+	 * assume that it will be, which is why we add another NUL termination.
+	 */
+	memmove(text_buffer, dhcp->sname, sizeof(dhcp->sname));
+	text_buffer[sizeof(dhcp->sname)] = '\0';
+
+	if(text_buffer[0] != '\0')
+		add_dhcp_response(offer,"server-name","\"%s\"",text_buffer);
+
+	add_dhcp_response(offer,"server-ipv4-address","%u.%u.%u.%u",
+		offer->server_ipv4_address[0],offer->server_ipv4_address[1],
+		offer->server_ipv4_address[2],offer->server_ipv4_address[3]);
+
+	add_dhcp_response(offer,"server-mac-address","%02x:%02x:%02x:%02x:%02x:%02x",
+		offer->server_mac_address[0], offer->server_mac_address[1], offer->server_mac_address[2],
+		offer->server_mac_address[3], offer->server_mac_address[4], offer->server_mac_address[5]);
+
+	add_dhcp_response(offer,"destination-mac-address","%02x:%02x:%02x:%02x:%02x:%02x (%s)",
+		destination_mac_address[0], destination_mac_address[1], destination_mac_address[2],
+		destination_mac_address[3], destination_mac_address[4], destination_mac_address[5],
+		memcmp(destination_mac_address,broadcast_mac_address,ETHER_ADDR_LEN) == 0 ? "broadcast" : "unicast");
+
+	memmove(offer->offered_ipv4_address,&dhcp->yiaddr,sizeof(offer->offered_ipv4_address));
+
+	ipv4_address = ntohl(dhcp->yiaddr);
+
+	add_dhcp_response(offer,"offered-ipv4-address","%u.%u.%u.%u",
+		(ipv4_address >> 24) & 0xff, (ipv4_address >> 16) & 0xff,
+		(ipv4_address >> 8) & 0xff, (ipv4_address) & 0xff);
+
+	ipv4_address = ntohl(dhcp->siaddr);
+	if(ipv4_address)
+	{
+		add_dhcp_response(offer,"next-server-ipv4-address","%u.%u.%u.%u",
+			(ipv4_address >> 24) & 0xff, (ipv4_address >> 16) & 0xff,
+			(ipv4_address >> 8) & 0xff, (ipv4_address) & 0xff);
+	}
+
+	ipv4_address = ntohl(dhcp->giaddr);
+	if(ipv4_address)
+	{
+		add_dhcp_response(offer,"relay-agent-ipv4-address","%u.%u.%u.%u",
+			(ipv4_address >> 24) & 0xff, (ipv4_address >> 16) & 0xff,
+			(ipv4_address >> 8) & 0xff, (ipv4_address) & 0xff);
+	}
+
+	/* The file name, if not empty, should be NUL-terminated. We cannot
+	 * assume that it will be, which is why we add another NUL termination.
+	 */
+	memmove(text_buffer, dhcp->file, sizeof(dhcp->file));
+	text_buffer[sizeof(dhcp->file)] = '\0';
+
+	if(text_buffer[0] != '\0')
+		add_dhcp_response(offer,"boot-file-name","\"%s\"",text_buffer);
+
+	/* Process the BOOTP/DHCP options and print information for a
+	 * selection of options.
+	 */
+	for(pos = 0 ; pos < vendor_options_length ; (void)NULL)
+	{
+		option_type = vendor_options[pos++];
+
+		/* Skip the padding octet. */
+		if(option_type == OPTION_TYPE_PAD)
+			continue;
+
+		/* Stop at the end marker, or the end of the options buffer. */
+		if(option_type == OPTION_TYPE_END || pos == vendor_options_length)
+			break;
+
+		/* Stop at the end of the options buffer. */
+		option_length = vendor_options[pos++];
+		if(pos + option_length > vendor_options_length)
+			break;
+
+		/* Move the option data to a 32-bit word aligned buffer for
+		 * safe access.
+		 */
+		memmove(aligned_buffer,&vendor_options[pos],option_length);
+		option_data[option_length] = '\0';
+
+		pos += option_length;
+
+		/* Ignore this option? */
+		if(ignore_option[option_type / 8] & (1 << (option_type % 8)))
+			continue;
+
+		switch(option_type)
+		{
+			/* DHCP message type */
+			case OPTION_TYPE_DHCP_MESSAGE_TYPE:
+
+				if(MESSAGE_TYPE_DISCOVER <= option_data[0] && option_data[0] <= MESSAGE_TYPE_INFORM)
+				{
+					static const char * message_types[8] =
+					{
+						"discover",
+						"offer",
+						"request",
+						"decline",
+						"acknowledge",
+						"negative acknowledgement",
+						"release",
+						"inform",
+					};
+
+					add_dhcp_option(offer,"dhcp-message-type","%u (%s)", option_data[0],
+						message_types[option_data[0] - MESSAGE_TYPE_DISCOVER]);
+				}
+				else
+				{
+					add_dhcp_option(offer,"dhcp-message-type","%u", option_data[0]);
+				}
+
+				break;
+
+			/* Server identifier */
+			case OPTION_TYPE_SERVER_IDENTIFIER:
+
+				/* Minimum length is 4 octets. */
+				if(option_length >= 4)
+				{
+					add_dhcp_option(offer,"server-identifier","%u.%u.%u.%u",
+						option_data[0],option_data[1],option_data[2],option_data[3]);
+				}
+
+				break;
+
+			/* IP address lease time */
+			case OPTION_TYPE_IP_ADDRESS_LEASE_TIME:
+
+				/* Minimum length is 4 octets. */
+				if(option_length >= 4)
+				{
+					uint32_t seconds = ntohl(*(uint32_t *)option_data);
+
+					convert_seconds_to_readable_form(seconds,text_buffer,sizeof(text_buffer));
+
+					add_dhcp_option(offer,"ip-address-lease-time","%u seconds%s",seconds,text_buffer);
+				}
+
+				break;
+
+			/* Subnet mask */
+			case OPTION_TYPE_SUBNET_MASK:
+
+				/* Minimum length is 4 octets. */
+				if(option_length >= 4)
+				{
+					add_dhcp_option(offer,"subnet-mask","%u.%u.%u.%u",
+						option_data[0],option_data[1],option_data[2],option_data[3]);
+				}
+
+				break;
+
+			/* Gateway */
+			case OPTION_TYPE_GATEWAY:
+
+				/* Minimum length is 4 octets, and the payload must
+				 * be a multiple of 4, too.
+				 */
+				if(option_length >= 4 && (option_length % 4) == 0)
+				{
+					int i;
+
+					for(i = 0 ; i < option_length ; i += 4)
+					{
+						add_dhcp_option(offer,"gateway","%u.%u.%u.%u",
+							option_data[i],option_data[i+1],option_data[i+2],option_data[i+3]);
+					}
+				}
+
+				break;
+
+			/* Domain name server */
+			case OPTION_TYPE_DNS:
+
+				/* Minimum length is 4 octets, and the payload must
+				 * be a multiple of 4, too.
+				 */
+				if(option_length >= 4 && (option_length % 4) == 0)
+				{
+					int i;
+
+					for(i = 0 ; i < option_length ; i += 4)
+					{
+						add_dhcp_option(offer,"domain-name-server","%u.%u.%u.%u",
+							option_data[i],option_data[i+1],option_data[i+2],option_data[i+3]);
+					}
+				}
+
+				break;
+
+			/* Domain name */
+			case OPTION_TYPE_DOMAIN_NAME:
+
+				add_dhcp_option(offer,"domain-name","%s",option_data);
+				break;
+
+			/* Maximum DHCP message size */
+			case OPTION_TYPE_MAXIMUM_DHCP_MESSAGE_SIZE:
+
+				if(option_length >= 4)
+					add_dhcp_option(offer,"maximum-dhcp-message-size","%u",ntohs(*(uint16_t *)option_data));
+
+				break;
+
+			/* Renewal time value */
+			case OPTION_TYPE_RENEWAL_TIME:
+
+				if(option_length >= 4)
+				{
+					uint32_t seconds = ntohl(*(uint32_t *)option_data);
+
+					convert_seconds_to_readable_form(seconds,text_buffer,sizeof(text_buffer));
+
+					add_dhcp_option(offer,"renewal-time","%u seconds%s",seconds,text_buffer);
+				}
+
+				break;
+
+			/* Rebinding time value */
+			case OPTION_TYPE_REBINDING_TIME:
+
+				if(option_length >= 4)
+				{
+					uint32_t seconds = ntohl(*(uint32_t *)option_data);
+
+					convert_seconds_to_readable_form(seconds,text_buffer,sizeof(text_buffer));
+
+					add_dhcp_option(offer,"rebinding-time","%u seconds%s",seconds,text_buffer);
+				}
+
+				break;
+
+			/* Static route */
+			case OPTION_TYPE_STATIC_ROUTE:
+
+				if(decode_static_route(option_data, option_length, text_buffer, sizeof(text_buffer)) > 0)
+					add_dhcp_option(offer,"static-route","%s",text_buffer);
+
+				break;
+
+			/* Message from server */
+			case OPTION_TYPE_MESSAGE:
+
+				add_dhcp_option(offer,"message","%s",option_data);
+				break;
+
+			/* Domain search (RFC 3397) */
+			case OPTION_TYPE_DOMAIN_SEARCH:
+
+				/* The data used by this option can be spread across
+				 * several options. We aggregate them and then decode
+				 * them all in one step. This is why we process this
+				 * option only once.
+				 */
+				ignore_option[option_type / 8] |= (1 << (option_type % 8));
+
+				if(decode_domain_search(vendor_options,vendor_options_length,option_type,text_buffer, sizeof(text_buffer)))
+					add_dhcp_option(offer,"domain-search","%s",text_buffer);
+
+				break;
+
+			/* Classless static routes (RFC 3442) */
+			case OPTION_TYPE_CLASSLESS_STATIC_ROUTE:
+
+				/* A long list of routes may be spread across several
+				 * options, just like the domain search list (RFC 3396).
+				 * This is why we process this option only once, too.
+				 */
+				ignore_option[option_type / 8] |= (1 << (option_type % 8));
+
+				if(fill_aggregate_buffer_from_option(vendor_options,vendor_options_length,option_type,&aggregate_buffer,&aggregate_buffer_size))
+				{
+					if(decode_classless_static_route(aggregate_buffer, (int)aggregate_buffer_size, text_buffer, sizeof(text_buffer)) > 0)
+						add_dhcp_option(offer,"classless-static-route","%s",text_buffer);
+
+					free(aggregate_buffer);
+				}
+
+				break;
+
+			/* Web proxy auto-discovery protocol (RFC draft). */
+			case OPTION_TYPE_PROXY_AUTODISCOVERY:
+
+				add_dhcp_option(offer,"web-proxy-auto-discovery","%s",option_data);
+				break;
+
+			/* LDAP URL (RFC draft). */
+			case OPTION_TYPE_LDAP_URL:
+
+				add_dhcp_option(offer,"ldap-url","%s",option_data);
+				break;
+
+			/* NetBIOS over TCP/IP name servers */
+			case OPTION_TYPE_NETBIOS_OVER_TCP_IP_NAME_SERVER:
+
+				/* Minimum length is 4 octets, and the payload must
+				 * be a multiple of 4, too.
+				 */
+				if(option_length >= 4 && (option_length % 4) == 0)
+				{
+					int i;
+
+					for(i = 0 ; i < option_length ; i += 4)
+					{
+						add_dhcp_option(offer,"netbios-over-tcp-ip-name-server","%u.%u.%u.%u",
+							option_data[i],option_data[i+1],option_data[i+2],option_data[i+3]);
+					}
+				}
+
+				break;
+
+			/* NetBIOS over TCP/IP node type */
+			case OPTION_TYPE_NETBIOS_OVER_TCP_IP_NODE_TYPE:
+
+				add_dhcp_option(offer,"netbios-over-tcp-ip-node-type","%u",option_data[0]);
+				break;
+
+			/* NetBIOS over TCP/IP scope */
+			case OPTION_TYPE_NETBIOS_OVER_TCP_IP_SCOPE:
+
+				add_dhcp_option(offer,"netbios-over-tcp-ip-scope","%s",option_data);
+				break;
+
+			/* Perform router discovery */
+			case OPTION_TYPE_PERFORM_ROUTER_DISCOVERY:
+
+				add_dhcp_option(offer,"perform-router-discovery","%s",option_data[0] ? "yes" : "no");
+				break;
+
+			/* Interface MTU */
+			case OPTION_TYPE_INTERFACE_MTU:
+
+				add_dhcp_option(offer,"interface-mtu","%u",ntohs(*(uint16_t *)option_data));
+				break;
+
+			/* Network time protocol server */
+			case OPTION_TYPE_NTP_SERVERS:
+
+				/* Minimum length is 4 octets, and the payload must
+				 * be a multiple of 4, too.
+				 */
+				if(option_length >= 4 && (option_length % 4) == 0)
+				{
+					int i;
+
+					for(i = 0 ; i < option_length ; i += 4)
+					{
+						add_dhcp_option(offer,"network-time-protocol-server","%u.%u.%u.%u",
+							option_data[i],option_data[i+1],option_data[i+2],option_data[i+3]);
+					}
+				}
+
+				break;
+
+			/* Broadcast address */
+			case OPTION_TYPE_BROADCAST_ADDRESS:
+
+				/* Minimum length is 4 octets. */
+				if(option_length >= 4)
+				{
+					add_dhcp_option(offer,"broadcast-address","%u.%u.%u.%u",
+						option_data[0],option_data[1],option_data[2],option_data[3]);
+				}
+
+				break;
+
+			/* Auto-configure (RFC 2563) */
+			case OPTION_TYPE_AUTO_CONFIGURE:
+
+				add_dhcp_option(offer,"auto-configure","%s",
+					option_data[0] ? "AutoConfigure" : "DoNotAutoConfigure");
+
+				break;
+
+			default:
+
+				snprintf(text_buffer,sizeof(text_buffer),"option-%u",option_type);
+
+				add_dhcp_option(offer,text_buffer,"%u data bytes",option_length);
+				break;
+		}
+	}
+}
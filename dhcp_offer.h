@@ -0,0 +1,89 @@
+/*
+ * DHCP offers received from a server, decoded into readable form.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#ifndef _DHCP_OFFER_H
+#define _DHCP_OFFER_H
+
+/****************************************************************************/
+
+#include <sys/time.h>
+#include <net/if.h>
+
+#include <stdint.h>
+#include <time.h>
+
+/****************************************************************************/
+
+#include "list_node.h"
+#include "dhcp_protocol.h"
+
+/****************************************************************************/
+
+/* Stores a key and its associated value string. */
+struct kv_node
+{
+	struct Node	node;
+	char *		key;
+	char *		value;
+};
+
+/****************************************************************************/
+
+/* Further responses by a server which has already been recorded. The
+ * intervals (in microseconds) are measured between successive responses,
+ * starting with the first one.
+ */
+struct dhcp_duplicates
+{
+	unsigned long	count;
+	struct timeval	last_stamp;
+	int64_t			minimum_interval;
+	int64_t			maximum_interval;
+	int64_t			total_interval;
+};
+
+/****************************************************************************/
+
+/* Store DHCP server response data; the server is uniquely identified
+ * by the pair of its IPv4 and MAC address.
+ */
+struct dhcp_offer
+{
+	struct Node		node;
+
+	struct timeval	stamp;
+	char			interface_name[IF_NAMESIZE];	/* Where the offer was received */
+	uint8_t			server_ipv4_address[4];
+	uint8_t			server_mac_address[6];
+	uint8_t			offered_ipv4_address[4];
+	uint64_t		offer_hash;
+
+	struct dhcp_duplicates	duplicates;
+
+	int				baseline_status;	/* One of BASELINE_STATUS_*, filled in by the caller */
+	time_t			first_seen;			/* According to the baseline, filled in by the caller */
+
+	struct List		dhcp_response;
+	struct List		dhcp_option;
+};
+
+/****************************************************************************/
+
+struct dhcp_offer *create_dhcp_offer(const uint8_t *server_ipv4_address, const uint8_t *server_mac_address);
+void delete_dhcp_offer(struct dhcp_offer *offer);
+struct dhcp_offer *find_dhcp_offer(const struct List *offer_list, const uint8_t *server_ipv4_address, const uint8_t *server_mac_address);
+void clear_dhcp_offers(struct List *offer_list);
+void count_duplicate_dhcp_offer(struct dhcp_offer *offer, const struct timeval *stamp);
+void merge_dhcp_offer_duplicates(struct dhcp_offer *offer, const struct dhcp_offer *later_offer);
+struct kv_node *add_dhcp_response(struct dhcp_offer *offer, const char *key, const char *string_format, ...) __attribute__ ((format (printf, 3, 4)));
+struct kv_node *add_dhcp_option(struct dhcp_offer *offer, const char *key, const char *string_format, ...) __attribute__ ((format (printf, 3, 4)));
+void decode_dhcp_offer(struct dhcp_offer *offer, const bootp_t *dhcp, int length, const uint8_t *destination_mac_address, const char *interface_name, const uint8_t *client_mac_address);
+
+/****************************************************************************/
+
+#endif /* _DHCP_OFFER_H */
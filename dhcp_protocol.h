@@ -0,0 +1,155 @@
+/*
+ * BOOTP/DHCP protocol definitions (RFC 951, RFC 1048, RFC 2131,
+ * RFC 2132, etc.)
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#ifndef _DHCP_PROTOCOL_H
+#define _DHCP_PROTOCOL_H
+
+/****************************************************************************/
+
+#include <stdint.h>
+
+/****************************************************************************/
+
+/* 32 bit IPv4 address. */
+typedef uint32_t ip4_t;
+
+/****************************************************************************/
+
+/* Combined IP and UDP headers, suitable for calculating
+ * and verifying the UDP datagram checksum.
+ */
+struct udp_pseudo_header
+{
+	uint32_t	ih_zero1[2];	/* set to zero */
+	uint8_t		ih_zero2;		/* set to zero */
+	uint8_t		ih_pr;			/* protocol */
+	uint16_t	ih_len;			/* protocol length */
+	ip4_t		ih_src;			/* source internet address */
+	ip4_t		ih_dst;			/* destination internet address */
+	
+	uint16_t	uh_sport;		/* source port */
+	uint16_t	uh_dport;		/* destination port */
+	int16_t		uh_ulen;		/* udp length */
+	uint16_t	uh_sum;			/* udp checksum */
+};
+
+/****************************************************************************/
+
+/* Source: http://www.tcpipguide.com/free/t_DHCPMessageFormat.htm
+ *
+ * This is actually the BOOTP packet (RFC 951) with the
+ * vendor information format stored in the first four
+ * octets of the vendor specific area (RFC 1048).
+ */
+typedef struct
+{
+	uint8_t		opcode;			/* Packet op code / message type */
+	uint8_t		htype;			/* Hardware address type */
+	uint8_t		hlen;			/* Hardware address length */
+	uint8_t		hops;
+	uint32_t	xid;			/* Transaction ID */
+	uint16_t	secs;
+	uint16_t	flags;
+	ip4_t		ciaddr;			/* Client IP address; client sets this to 0 */
+	ip4_t		yiaddr;			/* Filled in by server if client doesn't know its own address */
+	ip4_t		siaddr;			/* Server IP address */
+	ip4_t		giaddr;			/* Gateway IP address */
+	uint8_t		chaddr[16];		/* Client hardware address */
+	char		sname[64];		/* Optional server host name */
+	char		file[128];		/* Boot file name */
+	uint32_t	magic_cookie;	/* Vendor information format (RFC 1048). */
+	uint8_t		vend[0];		/* Vendor-specific area; these should be 60 octets minimum. */
+} bootp_t;
+
+/****************************************************************************/
+
+/* This should be in bootp_t.opcode (RFC 951). */
+enum
+{
+	BOOTREQUEST=1,
+	BOOTREPLY=2
+};
+
+/****************************************************************************/
+
+/* This goes into bootp_t.htype (RFC 951). */
+#define BOOTP_HARDWARE_TYPE_10_ETHERNET	1
+
+/****************************************************************************/
+
+/* Selected BOOTP/DHCP option types (RFC 2132, etc.). */
+enum
+{
+	OPTION_TYPE_PAD=0,
+	OPTION_TYPE_SUBNET_MASK=1,
+	OPTION_TYPE_GATEWAY=3,
+	OPTION_TYPE_DNS=6,
+	OPTION_TYPE_DOMAIN_NAME=15,
+	OPTION_TYPE_INTERFACE_MTU=26,
+	OPTION_TYPE_BROADCAST_ADDRESS=28,
+	OPTION_TYPE_PERFORM_ROUTER_DISCOVERY=31,
+	OPTION_TYPE_STATIC_ROUTE=33,
+	OPTION_TYPE_NTP_SERVERS=42,
+	OPTION_TYPE_NETBIOS_OVER_TCP_IP_NAME_SERVER=44,
+	OPTION_TYPE_NETBIOS_OVER_TCP_IP_NODE_TYPE=46,
+	OPTION_TYPE_NETBIOS_OVER_TCP_IP_SCOPE=47,
+	OPTION_TYPE_IP_ADDRESS_LEASE_TIME=51,
+	OPTION_TYPE_DHCP_MESSAGE_TYPE=53,
+	OPTION_TYPE_SERVER_IDENTIFIER=54,
+	OPTION_TYPE_PARAMETER_REQUEST_LIST=55,
+	OPTION_TYPE_MESSAGE=56,
+	OPTION_TYPE_MAXIMUM_DHCP_MESSAGE_SIZE=57,
+	OPTION_TYPE_RENEWAL_TIME=58,
+	OPTION_TYPE_REBINDING_TIME=59,
+	OPTION_TYPE_LDAP_URL=95,
+	OPTION_TYPE_AUTO_CONFIGURE=116,
+	OPTION_TYPE_DOMAIN_SEARCH=119,
+	OPTION_TYPE_CLASSLESS_STATIC_ROUTE=121,
+	OPTION_TYPE_PROXY_AUTODISCOVERY=252,
+	OPTION_TYPE_END=255
+};
+
+/****************************************************************************/
+
+/* DHCP message types (RFC 1531, etc.). */
+enum
+{
+	MESSAGE_TYPE_DISCOVER=1,
+	MESSAGE_TYPE_OFFER=2,
+	MESSAGE_TYPE_REQUEST=3,
+	MESSAGE_TYPE_DECLINE=4,
+	MESSAGE_TYPE_ACK=5,
+	MESSAGE_TYPE_NAK=6,
+	MESSAGE_TYPE_RELEASE=7,
+	MESSAGE_TYPE_INFORM=8
+};
+
+/****************************************************************************/
+
+/* DHCP server and client port numbers. Actually, these
+ * are really the BOOTP port numbers (RFC 951). We use
+ * these values only as fallbacks if the "bootp" entries
+ * are missing from the network database.
+ */
+enum
+{
+	DEFAULT_BOOTP_SERVER_PORT=67,
+	DEFAULT_BOOTP_CLIENT_PORT=68
+};
+
+/****************************************************************************/
+
+/* Magic cookie stored in the vendor-specific area (RFC 1048, etc.),
+ * identifying the contents and structure of the data following
+ * it. */
+#define DHCP_MAGIC_COOKIE 0x63825363
+
+/****************************************************************************/
+
+#endif /* _DHCP_PROTOCOL_H */
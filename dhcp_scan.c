@@ -0,0 +1,1336 @@
+/*
+ * Scan for DHCP servers on a network interface.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/ioctl.h>
+#include <net/ethernet.h>
+#include <net/if.h>
+#ifndef __linux__
+#include <net/if_dl.h>
+#endif /* !__linux__ */
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <arpa/inet.h>
+
+#ifdef __linux__
+/* This makes the 'struct udphdr' use the same
+ * field names as used in the BSD header files.
+ */
+#define __FAVOR_BSD
+#endif /* __linux__ */
+#include <netinet/udp.h>
+
+#include <ifaddrs.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <assert.h>
+#include <stdio.h>
+#include <errno.h>
+#include <time.h>
+
+#include <unistd.h>
+#include <poll.h>
+
+/****************************************************************************/
+
+#include "dhcp_scan.h"
+#include "dhcp_decode.h"
+#include "dhcp_message.h"
+#include "capture_backend.h"
+#include "dhcp_frame.h"
+#include "fnv_hash.h"
+
+/****************************************************************************/
+
+/* An entry of the table which finds the record of a DHCP server by its
+ * IPv4 and MAC address. The record is only valid if the entry belongs
+ * to the current generation: taking the records out of the scan starts
+ * a new one, which leaves the old entries behind without having to
+ * visit them. This is why the key is kept in the entry, too. Entries
+ * of the generations which were forgotten are dead; they keep their
+ * place until the table is rebuilt.
+ */
+struct offer_slot
+{
+	struct dhcp_offer *	offer;
+	uint32_t			hash;
+	uint32_t			generation;		/* 0 if unused */
+	uint8_t				key[10];
+};
+
+/* Everything needed to send a DHCP DISCOVER message through a network
+ * interface and to collect the responses.
+ */
+struct dhcp_scan
+{
+	char						interface_name[IF_NAMESIZE];
+	uint8_t						client_mac_address[ETHER_ADDR_LEN];
+	int							interface_mtu;
+
+	const struct capture_backend *	backend;
+	struct capture_options		capture_options;
+	struct capture_handle *		capture;
+	int							capture_fd;
+
+	struct scan_clock *			clock;
+
+	uint16_t					server_port;
+	uint16_t					client_port;
+	bool						use_broadcast;
+	bool						ignore_checksums;
+	int							max_responses;
+	const struct allowlist *	allowlist;
+	const struct offer_filter *	offer_filter;
+	dhcp_offer_callback			callback;
+	void *						user_data;
+
+	uint32_t					transaction_id;
+	struct timespec				deadline;
+	bool						have_deadline;
+	int							max_responses_remaining;
+	bool						done;
+
+	struct List					offer_list;
+	int							num_offers;
+
+	/* Open addressing hash table with linear probing, kept at most
+	 * half full, which indexes the offers recorded.
+	 */
+	struct offer_slot *			offer_slots;
+	uint32_t					offer_slots_size;	/* A power of 2 */
+	uint32_t					num_offer_slots;	/* Including the dead ones */
+	uint32_t					offer_generation;
+	uint32_t					forgotten_generation;
+
+	/* The capture backend counts from the time the capture was opened,
+	 * which is why its counts at the start of the scan are kept.
+	 */
+	struct dhcp_scan_stats		stats;
+	struct capture_stats		capture_stats_start;
+
+	char						error_buffer[CAPTURE_ERROR_SIZE];
+};
+
+/****************************************************************************/
+
+/* Generic Ethernet broadcast group address. */
+static const uint8_t broadcast_mac_address[ETHER_ADDR_LEN] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+
+/****************************************************************************/
+
+/*
+ * Get MAC address of given link(dev_name)
+ */
+static int
+get_mac_address_and_mtu(const char *dev_name, uint8_t *mac_address, int * mtu)
+{
+	int result = -1;
+	struct ifreq ifr;
+	int fd;
+
+	fd = socket(PF_INET, SOCK_DGRAM, IPPROTO_IP);
+	if(fd == -1)
+		goto out;
+
+	memset(&ifr,0,sizeof(ifr));
+	strncpy(ifr.ifr_name, dev_name, sizeof(ifr.ifr_name));
+
+	if(ioctl(fd, SIOCGIFMTU, &ifr) == -1)
+		goto out;
+
+	(*mtu) = ifr.ifr_mtu;
+
+	#if defined(__linux__)
+	{
+		memset(&ifr,0,sizeof(ifr));
+		strncpy(ifr.ifr_name, dev_name, sizeof(ifr.ifr_name));
+
+		if(ioctl(fd, SIOCGIFHWADDR, &ifr) == -1)
+			goto out;
+
+		memmove(mac_address, ifr.ifr_addr.sa_data, ETHER_ADDR_LEN);
+	}
+	#else
+	{
+		struct ifaddrs *ifap, *p;
+
+		if (getifaddrs(&ifap) != 0)
+			goto out;
+
+		for (p = ifap ; p != NULL ; p = p->ifa_next)
+		{
+			/* Check the device name */
+			if (strcmp(p->ifa_name, dev_name) == 0 && p->ifa_addr->sa_family == AF_LINK)
+			{
+				const struct sockaddr_dl * sdp;
+
+				sdp = (struct sockaddr_dl *)p->ifa_addr;
+				memmove(mac_address, sdp->sdl_data + sdp->sdl_nlen, ETHER_ADDR_LEN);
+
+				break;
+			}
+		}
+
+		freeifaddrs(ifap);
+	}
+	#endif
+
+	result = 0;
+
+out:
+
+	if(fd != -1)
+		close(fd);
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Build the key under which the record of a DHCP server is indexed and
+ * calculate its hash value.
+ */
+static uint32_t
+make_offer_key(uint8_t * key,const uint8_t * server_ipv4_address,const uint8_t * server_mac_address)
+{
+	uint64_t hash;
+
+	memmove(&key[0],server_ipv4_address,4);
+	memmove(&key[4],server_mac_address,6);
+
+	hash = fnv1a_64(FNV1A_64_OFFSET_BASIS,key,10);
+
+	return((uint32_t)(hash ^ (hash >> 32)));
+}
+
+/****************************************************************************/
+
+/* Find the table entry for a DHCP server, of whatever generation.
+ * Returns NULL if there is none.
+ */
+static struct offer_slot *
+find_offer_slot(const struct dhcp_scan * scan,const uint8_t * server_ipv4_address,const uint8_t * server_mac_address)
+{
+	struct offer_slot * result = NULL;
+	struct offer_slot * slot;
+	uint32_t hash,mask;
+	uint8_t key[10];
+	uint32_t i;
+
+	if(scan->offer_slots_size == 0)
+		goto out;
+
+	hash = make_offer_key(key,server_ipv4_address,server_mac_address);
+	mask = scan->offer_slots_size - 1;
+
+	for(i = hash & mask ; (slot = &scan->offer_slots[i])->generation != 0 ; i = (i + 1) & mask)
+	{
+		if(slot->generation > scan->forgotten_generation && slot->hash == hash && memcmp(slot->key,key,sizeof(key)) == 0)
+		{
+			result = slot;
+			break;
+		}
+	}
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Add a table entry for a DHCP server which does not have one yet,
+ * rebuilding the table without its dead entries, and growing it, if
+ * necessary. The entry belongs to the current generation and refers
+ * to the record given. Returns -1 if not enough memory is available,
+ * 0 otherwise.
+ */
+static int
+add_offer_slot(struct dhcp_scan * scan,struct dhcp_offer * offer)
+{
+	struct offer_slot * slots;
+	struct offer_slot * slot;
+	uint32_t size,mask;
+	uint32_t num_slots;
+	uint8_t key[10];
+	uint32_t hash;
+	int result = -1;
+	uint32_t i,j;
+
+	if(2 * (scan->num_offer_slots + 1) > scan->offer_slots_size)
+	{
+		num_slots = 0;
+
+		for(i = 0 ; i < scan->offer_slots_size ; i++)
+		{
+			if(scan->offer_slots[i].generation > scan->forgotten_generation)
+				num_slots++;
+		}
+
+		size = (scan->offer_slots_size > 0) ? scan->offer_slots_size : 64;
+		while(2 * (num_slots + 1) > size)
+			size *= 2;
+
+		mask = size - 1;
+
+		slots = calloc(size,sizeof(*slots));
+		if(slots == NULL)
+			goto out;
+
+		for(i = 0 ; i < scan->offer_slots_size ; i++)
+		{
+			if(scan->offer_slots[i].generation <= scan->forgotten_generation)
+				continue;
+
+			for(j = scan->offer_slots[i].hash & mask ; slots[j].generation != 0 ; j = (j + 1) & mask)
+				(void)NULL;
+
+			slots[j] = scan->offer_slots[i];
+		}
+
+		if(scan->offer_slots != NULL)
+			free(scan->offer_slots);
+
+		scan->offer_slots = slots;
+		scan->offer_slots_size = size;
+		scan->num_offer_slots = num_slots;
+	}
+
+	hash = make_offer_key(key,offer->server_ipv4_address,offer->server_mac_address);
+	mask = scan->offer_slots_size - 1;
+
+	for(j = hash & mask ; scan->offer_slots[j].generation != 0 ; j = (j + 1) & mask)
+		(void)NULL;
+
+	slot = &scan->offer_slots[j];
+
+	slot->offer = offer;
+	slot->hash = hash;
+	slot->generation = scan->offer_generation;
+	memmove(slot->key,key,sizeof(key));
+
+	scan->num_offer_slots++;
+
+	result = 0;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Empty the table, forgetting about all the DHCP servers in it. */
+static void
+clear_offer_slots(struct dhcp_scan * scan)
+{
+	if(scan->offer_slots != NULL)
+	{
+		free(scan->offer_slots);
+		scan->offer_slots = NULL;
+	}
+
+	scan->offer_slots_size = 0;
+	scan->num_offer_slots = 0;
+	scan->offer_generation = 1;
+	scan->forgotten_generation = 0;
+}
+
+/****************************************************************************/
+
+/*
+ * This function will be called for any incoming DHCP responses
+ */
+static void
+dhcp_input(struct dhcp_scan * scan,
+	const struct ether_header * eframe,
+	const struct ip * ip_packet,
+	const bootp_t * dhcp,
+	int length)
+{
+	struct dhcp_message message;
+	ip4_t server_address;
+	uint8_t server_ipv4_address[4];
+	struct offer_slot * slot;
+	struct dhcp_offer * offer;
+	struct timeval now;
+	bool repeated;
+
+	if (length < 0 || decode_dhcp_message(&message, (const uint8_t *)dhcp, length) < 0)
+		return;
+
+	/* This should be a DHCP server response, the transaction number must match
+	 * the request we made and DHCP server should have responded with an
+	 * offer.
+	 */
+	if (message.opcode != BOOTREPLY || !message.has_magic_cookie ||
+		message.transaction_id != scan->transaction_id ||
+		message.message_type != MESSAGE_TYPE_OFFER)
+	{
+		return;
+	}
+
+	server_address = ntohl(ip_packet->ip_src.s_addr);
+
+	server_ipv4_address[0] = (server_address >> 24) & 0xff;
+	server_ipv4_address[1] = (server_address >> 16) & 0xff;
+	server_ipv4_address[2] = (server_address >> 8) & 0xff;
+	server_ipv4_address[3] = server_address & 0xff;
+
+	/* Known DHCP servers are neither recorded nor reported. */
+	if(is_server_allowlisted(scan->allowlist, server_ipv4_address, eframe->ether_shost, scan->interface_name))
+		return;
+
+	/* Only record offers which match the filter expression? */
+	if(scan->offer_filter != NULL)
+	{
+		message.index.server_address = server_address;
+
+		if(!evaluate_offer_filter(scan->offer_filter, &message.index))
+			return;
+	}
+
+	(*scan->clock->get_time_of_day)(scan->clock, &now);
+
+	/* We only store one response per server. Do we already have
+	 * a record of this one? If so, just count its response.
+	 */
+	slot = find_offer_slot(scan, server_ipv4_address, eframe->ether_shost);
+	if(slot != NULL && slot->generation == scan->offer_generation)
+	{
+		offer = slot->offer;
+
+		count_duplicate_dhcp_offer(offer, &now);
+
+		if(scan->callback != NULL)
+			(*scan->callback)(offer, DHCP_SCAN_OFFER_DUPLICATE, scan->user_data);
+
+		return;
+	}
+
+	/* Register a new server response. A server whose record was
+	 * taken out of the scan still has an entry in the table, which
+	 * is reused. Its response is recorded separately, since the
+	 * caller may be looking at the record taken, but it is counted
+	 * as a duplicate, which is what it will become when the record
+	 * is handed back.
+	 */
+	repeated = (slot != NULL);
+
+	offer = create_dhcp_offer(server_ipv4_address, eframe->ether_shost);
+	if(offer != NULL)
+	{
+		if(slot != NULL)
+		{
+			slot->offer = offer;
+			slot->generation = scan->offer_generation;
+		}
+		else if (add_offer_slot(scan, offer) < 0)
+		{
+			delete_dhcp_offer(offer);
+			offer = NULL;
+		}
+	}
+
+	if(offer == NULL)
+	{
+		if(scan->callback != NULL)
+		{
+			struct dhcp_offer server;
+
+			memset(&server,0,sizeof(server));
+
+			strcpy(server.interface_name,scan->interface_name);
+			memmove(server.server_ipv4_address,server_ipv4_address,sizeof(server.server_ipv4_address));
+			memmove(server.server_mac_address,eframe->ether_shost,sizeof(server.server_mac_address));
+
+			(*scan->callback)(&server, DHCP_SCAN_OFFER_NO_MEMORY, scan->user_data);
+		}
+
+		return;
+	}
+
+	offer->stamp = now;
+
+	strcpy(offer->interface_name, scan->interface_name);
+
+	decode_dhcp_offer(offer, dhcp, length, eframe->ether_dhost, scan->interface_name, scan->client_mac_address);
+
+	add_node_to_list_tail(&scan->offer_list, &offer->node);
+	scan->num_offers++;
+
+	if(scan->callback != NULL)
+		(*scan->callback)(offer, repeated ? DHCP_SCAN_OFFER_DUPLICATE : DHCP_SCAN_OFFER_RECORDED, scan->user_data);
+
+	/* Only read a limited number of DHCP server responses? */
+	if(scan->max_responses_remaining > 0 && !repeated)
+	{
+		/* Stop looking for more DHCP server responses? */
+		scan->max_responses_remaining--;
+		if(scan->max_responses_remaining == 0)
+			scan->done = true;
+	}
+}
+
+/****************************************************************************/
+
+/*
+ * UDP packet handler. The length is the number of octets captured from the
+ * start of the UDP header on, which is at least the size of the header.
+ */
+static void
+udp_input(struct dhcp_scan * scan,const struct ether_header *eframe,struct ip * ip_packet,const struct udphdr * udp_packet,int length)
+{
+	int udp_length;
+	int checksum;
+
+	/* The length given in the header cannot be trusted; only what was
+	 * actually captured may be looked at.
+	 */
+	udp_length = ntohs(udp_packet->uh_ulen);
+	if (udp_length < (int)sizeof(struct udphdr))
+		return;
+
+	if (udp_length > length)
+		udp_length = length;
+
+	/* Verify the UDP datagram checksum? */
+	if(udp_packet->uh_sum != 0)
+	{
+		struct ip ip_copy;
+		struct udp_pseudo_header * udp_pseudo_header;
+		ip4_t src_address = ip_packet->ip_src.s_addr;
+		ip4_t dst_address = ip_packet->ip_dst.s_addr;
+		uint8_t protocol = ip_packet->ip_p;
+
+		/* The pseudo header takes the place of the IP header in front
+		 * of the UDP header, or of the end of the IP header if it has
+		 * options. We will clobber it for the calculation, so let's
+		 * save it first.
+		 */
+		udp_pseudo_header = (struct udp_pseudo_header *)((uint8_t *)udp_packet - sizeof(ip_copy));
+
+		memmove(&ip_copy,udp_pseudo_header,sizeof(ip_copy));
+
+		udp_pseudo_header->ih_zero1[0] = udp_pseudo_header->ih_zero1[1] = 0;
+		udp_pseudo_header->ih_zero2 = 0;
+		udp_pseudo_header->ih_pr = protocol;
+		udp_pseudo_header->ih_len = udp_pseudo_header->uh_ulen;
+		udp_pseudo_header->ih_src = src_address;
+		udp_pseudo_header->ih_dst = dst_address;
+	
+		checksum = in_cksum(udp_pseudo_header,sizeof(ip_copy) + udp_length);
+	
+		/* Restore the damage. */
+		memmove(udp_pseudo_header,&ip_copy,sizeof(ip_copy));
+	}
+	/* No checksum was given. */
+	else
+	{
+		checksum = 0;
+	}
+	
+	/* Check if there is a response from DHCP server. */
+	if ((scan->ignore_checksums || checksum == 0) && ntohs(udp_packet->uh_sport) == scan->server_port)
+		dhcp_input(scan,eframe,ip_packet,(bootp_t *)&udp_packet[1],udp_length - sizeof(struct udphdr));
+}
+
+/****************************************************************************/
+
+/*
+ * IP Packet handler. The length is the number of octets captured from the
+ * start of the IP header on.
+ */
+static void
+ip_input(struct dhcp_scan * scan,const struct ether_header *eframe,struct ip * ip_packet,int length)
+{
+	int header_length;
+	int checksum;
+
+	/* The IP header, including its options, and the UDP header
+	 * must have been captured in full.
+	 */
+	if (length < (int)sizeof(struct ip))
+		return;
+
+	header_length = ip_packet->ip_hl * 4;
+	if (header_length < (int)sizeof(struct ip) || length < header_length + (int)sizeof(struct udphdr))
+		return;
+
+	/* Verify the IP header checksum. */
+	checksum = in_cksum(ip_packet,header_length);
+	
+	/* Care only about UDP - since DHCP sits over UDP */
+	if ((scan->ignore_checksums || checksum == 0) && ip_packet->ip_p == IPPROTO_UDP)
+		udp_input(scan,eframe,ip_packet,(struct udphdr *)((uint8_t *)ip_packet + header_length),length - header_length);
+}
+
+/****************************************************************************/
+
+/* Check if this Ethernet frame was sent for us to process. This means it either
+ * was sent to the broadcast address group or it was sent to the address of the
+ * interface which we are listening to.
+ */
+static bool
+is_ethernet_frame_for_us(const struct dhcp_scan * scan,const struct ether_header *ethernet_frame)
+{
+	bool result;
+
+	result = (memcmp(ethernet_frame->ether_dhost,scan->client_mac_address,ETHER_ADDR_LEN) == 0 ||
+			  memcmp(ethernet_frame->ether_dhost,broadcast_mac_address,ETHER_ADDR_LEN) == 0);
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/*
+ * Ethernet packet handler, invoked through the receive function of the
+ * capture backend. Returns false once the scan is complete, so that the
+ * frames still buffered are not read.
+ */
+static bool
+ether_input(const struct capture_frame *frame, void *user_data)
+{
+	struct dhcp_scan * scan = (struct dhcp_scan *)user_data;
+	const struct ether_header *ethernet_frame = (struct ether_header *)frame->data;
+
+	/* Ignore what is still buffered once the scan is complete. */
+	if(scan->done)
+		return(false);
+
+	scan->stats.frames_processed++;
+
+	/* This must be an Ethernet frame (not ARP), and the destination address must
+	 * either refer to the network interface we listen to or it must be
+	 * the broadcast group address. Frames too short to hold even the
+	 * Ethernet header are dropped.
+	 */
+	if (frame->length >= sizeof(*ethernet_frame) &&
+	    htons(ethernet_frame->ether_type) == ETHERTYPE_IP && is_ethernet_frame_for_us(scan,ethernet_frame))
+	{
+		ip_input(scan,ethernet_frame,(struct ip *)&ethernet_frame[1],(int)(frame->length - sizeof(*ethernet_frame)));
+	}
+
+	return(!scan->done);
+}
+
+/****************************************************************************/
+
+/*
+ * DHCP output - Just fills DHCP "discover" message
+ */
+static int
+dhcp_output(bootp_t *dhcp, const uint8_t *client_mac_address, uint32_t transaction_id, bool use_broadcast, int len)
+{
+	memset(dhcp, 0, sizeof(*dhcp));
+
+	dhcp->opcode = BOOTREQUEST;
+	dhcp->htype = BOOTP_HARDWARE_TYPE_10_ETHERNET;
+
+	/* Request that the server responds by broadcast rather
+	 * than unicast (RFC1531, section 2).
+	 */
+	if(use_broadcast)
+		dhcp->flags = htons(0x8000);
+
+	dhcp->hlen = ETHER_ADDR_LEN;
+	memmove(dhcp->chaddr, client_mac_address, ETHER_ADDR_LEN);
+
+	dhcp->xid = htonl(transaction_id);
+
+	dhcp->magic_cookie = htonl(DHCP_MAGIC_COOKIE);
+
+	len += sizeof(*dhcp);
+
+	return(len);
+}
+
+/****************************************************************************/
+
+/*
+ * Fill DHCP options
+ */
+static int
+fill_dhcp_discover_options(bootp_t *dhcp, int interface_mtu)
+{
+	static const uint8_t parameter_req_list[] =
+	{
+		OPTION_TYPE_SUBNET_MASK,
+		OPTION_TYPE_GATEWAY,
+		OPTION_TYPE_DNS,
+		OPTION_TYPE_DOMAIN_NAME,
+		OPTION_TYPE_INTERFACE_MTU,
+		OPTION_TYPE_BROADCAST_ADDRESS,
+		OPTION_TYPE_PERFORM_ROUTER_DISCOVERY,
+		OPTION_TYPE_STATIC_ROUTE,
+		OPTION_TYPE_NTP_SERVERS,
+		OPTION_TYPE_NETBIOS_OVER_TCP_IP_NAME_SERVER,
+		OPTION_TYPE_NETBIOS_OVER_TCP_IP_NODE_TYPE,
+		OPTION_TYPE_NETBIOS_OVER_TCP_IP_SCOPE,
+		OPTION_TYPE_IP_ADDRESS_LEASE_TIME,
+		OPTION_TYPE_DHCP_MESSAGE_TYPE,
+		OPTION_TYPE_SERVER_IDENTIFIER,
+		OPTION_TYPE_PARAMETER_REQUEST_LIST,
+		OPTION_TYPE_MESSAGE,
+		OPTION_TYPE_MAXIMUM_DHCP_MESSAGE_SIZE,
+		OPTION_TYPE_RENEWAL_TIME,
+		OPTION_TYPE_REBINDING_TIME,
+		OPTION_TYPE_LDAP_URL,
+		OPTION_TYPE_AUTO_CONFIGURE,
+		OPTION_TYPE_DOMAIN_SEARCH,
+		OPTION_TYPE_CLASSLESS_STATIC_ROUTE,
+		OPTION_TYPE_PROXY_AUTODISCOVERY
+	};
+
+	uint8_t message_type;
+	uint16_t message_size;
+	int len = 0;
+
+	message_type = MESSAGE_TYPE_DISCOVER;
+	len += fill_dhcp_option(&dhcp->vend[len], OPTION_TYPE_DHCP_MESSAGE_TYPE, &message_type, sizeof(message_type));
+
+	assert( 0 < interface_mtu && interface_mtu < 65536 );
+
+	message_size = htons(interface_mtu);
+	len += fill_dhcp_option(&dhcp->vend[len], OPTION_TYPE_MAXIMUM_DHCP_MESSAGE_SIZE, &message_size, sizeof(message_size));
+
+	len += fill_dhcp_option(&dhcp->vend[len], OPTION_TYPE_PARAMETER_REQUEST_LIST, parameter_req_list, sizeof(parameter_req_list));
+
+	len += fill_dhcp_option(&dhcp->vend[len], OPTION_TYPE_END, NULL, 0);
+
+	/* Make sure that the size of the option data is an even number. */
+	if((len % 2) != 0)
+		dhcp->vend[len++] = OPTION_TYPE_PAD;
+
+	return(len);
+}
+
+/****************************************************************************/
+
+/*
+ * Send DHCP DISCOVER message
+ */
+static int
+dhcp_discover(struct dhcp_scan *scan)
+{
+	int len;
+	/* The packet to be built includes the Ethernet header. There
+	 * must be room for up to 576 octets, which will be filled by
+	 * the IP header, the UDP header and the DHCP message. This
+	 * should not add up to more than 576 octets, which is the
+	 * minimum a DHCP server is required to receive and process
+	 * (RFC 2131, section 2).
+	 */
+	uint8_t packet[sizeof(struct ether_header)+576];
+	struct capture_frame frame;
+	struct udphdr *udp_header;
+	struct ip *ip_header;
+	bootp_t *dhcp;
+	ip4_t src_address = 0;
+	ip4_t dst_address = 0xFFFFFFFF; /* broadcast */
+	int result;
+
+	memset(packet,0,sizeof(packet));
+
+	ip_header = (struct ip *)&packet[sizeof(struct ether_header)];
+	udp_header = (struct udphdr *)&ip_header[1];
+	dhcp = (bootp_t *)&udp_header[1];
+
+	len = fill_dhcp_discover_options(dhcp, scan->interface_mtu);
+
+	len = dhcp_output(dhcp, scan->client_mac_address, scan->transaction_id, scan->use_broadcast, len);
+
+	/* The DHCP message must be at least 300 octets in size (RFC 1532, section 2.1).
+	 * The RFC documentation states that DHCP/BOOTP relay servers may drop
+	 * DHCP messages shorter than 300 octets. In practice DHCP servers (not
+	 * just relay servers, mind you) may ignore DHCP messages shorter than 300
+	 * octets altogether.
+	 *
+	 * Note that the 300 octets do not include the IP and UDP headers, which
+	 * add another 28 octets on top.
+	 */
+	if(len < 300)
+		len = 300;
+
+	assert( sizeof(struct ether_header) + sizeof(*ip_header) + sizeof(*udp_header) + len <= (int)sizeof(packet) );
+
+	len = udp_output(ip_header, src_address, dst_address, udp_header, scan->client_port, scan->server_port, len);
+	len = ip_output(ip_header, src_address, dst_address, len);
+
+	len = ether_output(packet, scan->client_mac_address, broadcast_mac_address, len);
+
+	frame.data = packet;
+	frame.length = len;
+
+	/* Send the packet on wire */
+	result = (*scan->backend->transmit)(scan->capture, &frame, 1);
+	if(result == 0)
+	{
+		snprintf(scan->error_buffer,sizeof(scan->error_buffer),"%s",strerror(ENOBUFS));
+		result = -1;
+	}
+	else if (result < 0)
+	{
+		snprintf(scan->error_buffer,sizeof(scan->error_buffer),"%s",(*scan->backend->get_error)(scan->capture));
+	}
+
+	return result;
+}
+
+/****************************************************************************/
+
+/* Add what the capture backend counted since the last time to the
+ * statistics of the scan, provided the capture is open and the backend
+ * can tell.
+ */
+static void
+update_capture_stats(struct dhcp_scan * scan)
+{
+	struct capture_stats capture_stats;
+
+	if(scan->capture != NULL && (*scan->backend->get_stats)(scan->capture, &capture_stats) == 0)
+	{
+		scan->stats.frames_received	+= capture_stats.received - scan->capture_stats_start.received;
+		scan->stats.frames_dropped	+= capture_stats.dropped - scan->capture_stats_start.dropped;
+
+		scan->capture_stats_start = capture_stats;
+	}
+}
+
+/****************************************************************************/
+
+/* Release the capture handle, if it is open. */
+static void
+close_capture(struct dhcp_scan * scan)
+{
+	if(scan->capture != NULL)
+	{
+		update_capture_stats(scan);
+
+		(*scan->backend->close)(scan->capture);
+
+		scan->capture = NULL;
+		scan->capture_fd = -1;
+	}
+}
+
+/****************************************************************************/
+
+/* Open the capture handle, unless it is open already. Returns -1 in case
+ * of error, with a description of the problem placed in the error buffer
+ * of the scan, and 0 otherwise.
+ */
+static int
+open_capture(struct dhcp_scan * scan)
+{
+	int result = -1;
+
+	if(scan->capture != NULL)
+	{
+		result = 0;
+		goto out;
+	}
+
+	/* Open the device and get a capture handle for it. We request snapshots
+	 * large enough to fill the MTU plus 14 bytes for the MAC header.
+	 */
+	scan->capture = (*scan->backend->open)(scan->interface_name, 14+scan->interface_mtu, &scan->capture_options, scan->error_buffer, sizeof(scan->error_buffer));
+	if (scan->capture == NULL)
+		goto out;
+
+	memset(&scan->capture_stats_start,0,sizeof(scan->capture_stats_start));
+
+	/* This may be -1 if the platform does not support it, in which
+	 * case poll() will ignore it and we fall back to checking for
+	 * new frames periodically.
+	 */
+	scan->capture_fd = (*scan->backend->get_fd)(scan->capture);
+
+	/* We are only interested in the DHCP server responses, which is why
+	 * we enable a packet filter here. This way we only get to see
+	 * suitable frames instead of everything else, too.
+	 */
+	if((*scan->backend->attach_filter)(scan->capture, scan->server_port) < 0)
+	{
+		snprintf(scan->error_buffer,sizeof(scan->error_buffer),"%s",(*scan->backend->get_error)(scan->capture));
+		goto out;
+	}
+
+	result = 0;
+
+ out:
+
+	if(result != 0)
+		close_capture(scan);
+
+	return(result);
+}
+
+/* Set up a scan on the named network interface, using the options
+ * provided. Returns NULL in case of error, with a description of the
+ * problem placed in the error buffer.
+ */
+struct dhcp_scan *
+open_dhcp_scan(const char * interface_name,const struct dhcp_scan_options * options,char * error_buffer,size_t error_buffer_size)
+{
+	struct dhcp_scan * result = NULL;
+	struct dhcp_scan * scan;
+
+	assert( interface_name != NULL && options != NULL );
+	assert( error_buffer != NULL && error_buffer_size > 0 );
+
+	error_buffer[0] = '\0';
+
+	scan = calloc(1,sizeof(*scan));
+	if(scan == NULL)
+	{
+		snprintf(error_buffer,error_buffer_size,"%s",strerror(errno));
+		goto out;
+	}
+
+	new_list(&scan->offer_list);
+
+	scan->offer_generation = 1;
+
+	scan->capture_fd = -1;
+
+	if(strlen(interface_name) >= sizeof(scan->interface_name))
+	{
+		snprintf(error_buffer,error_buffer_size,"interface name is too long");
+		goto out;
+	}
+
+	strcpy(scan->interface_name,interface_name);
+
+	scan->server_port		= (options->server_port != 0) ? options->server_port : DEFAULT_BOOTP_SERVER_PORT;
+	scan->client_port		= (options->client_port != 0) ? options->client_port : DEFAULT_BOOTP_CLIENT_PORT;
+	scan->use_broadcast		= options->use_broadcast;
+	scan->ignore_checksums	= options->ignore_checksums;
+	scan->max_responses		= options->max_responses;
+	scan->allowlist			= options->allowlist;
+	scan->offer_filter		= options->offer_filter;
+	scan->callback			= options->callback;
+	scan->user_data			= options->user_data;
+	scan->backend			= (options->capture_backend != NULL) ? options->capture_backend : get_default_capture_backend();
+	scan->clock				= (options->clock != NULL) ? options->clock : &system_scan_clock;
+
+	scan->capture_options.low_latency	= options->low_latency;
+	scan->capture_options.busy_poll		= options->busy_poll;
+
+	/* Get the MAC address and MTU of the interface, unless the caller
+	 * knows them already.
+	 */
+	if(options->interface_mac_address != NULL && options->interface_mtu > 0)
+	{
+		memmove(scan->client_mac_address, options->interface_mac_address, ETHER_ADDR_LEN);
+		scan->interface_mtu = options->interface_mtu;
+	}
+	else if (get_mac_address_and_mtu(scan->interface_name, scan->client_mac_address, &scan->interface_mtu) != 0)
+	{
+		snprintf(error_buffer,error_buffer_size,"cannot get MAC address and MTU (%s)",strerror(errno));
+		goto out;
+	}
+
+	/* The capture may be opened only once the scan starts, so that
+	 * scans which are not running do not tie down any resources.
+	 */
+	if(!options->defer_capture && open_capture(scan) < 0)
+	{
+		snprintf(error_buffer,error_buffer_size,"%s",scan->error_buffer);
+		goto out;
+	}
+
+	result = scan;
+	scan = NULL;
+
+ out:
+
+	if(scan != NULL)
+		close_dhcp_scan(scan);
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Release all the resources used by a scan, including the offers it
+ * recorded. This is safe to call with a NULL parameter.
+ */
+void
+close_dhcp_scan(struct dhcp_scan * scan)
+{
+	if(scan != NULL)
+	{
+		close_capture(scan);
+
+		clear_dhcp_offers(&scan->offer_list);
+		clear_offer_slots(scan);
+
+		free(scan);
+	}
+}
+
+/****************************************************************************/
+
+/* Send a DHCP DISCOVER message, using the given transaction number, and
+ * start collecting the offers which arrive in response. The offers
+ * recorded by the previous scan are discarded. Offers will be collected
+ * until the timeout (in seconds) has elapsed or enough of them have
+ * arrived. A timeout of 0 means waiting without a time limit. The
+ * capture is opened first if necessary. Returns -1 in case of error,
+ * and 0 otherwise.
+ */
+int
+start_dhcp_scan(struct dhcp_scan * scan,uint32_t transaction_id,int timeout)
+{
+	int result = -1;
+
+	clear_dhcp_scan_offers(scan);
+
+	/* Count only what arrives from now on. */
+	update_capture_stats(scan);
+	memset(&scan->stats,0,sizeof(scan->stats));
+
+	scan->transaction_id = transaction_id;
+	scan->max_responses_remaining = scan->max_responses;
+	scan->done = false;
+
+	scan->have_deadline = (timeout > 0);
+	if(scan->have_deadline)
+	{
+		(*scan->clock->get_monotonic_time)(scan->clock,&scan->deadline);
+		scan->deadline.tv_sec += timeout;
+	}
+
+	if(open_capture(scan) < 0)
+	{
+		scan->done = true;
+		goto out;
+	}
+
+	/* Send DHCP DISCOVER message */
+	if(dhcp_discover(scan) < 0)
+	{
+		scan->done = true;
+		goto out;
+	}
+
+	result = 0;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Close the capture of a scan which is done, keeping the offers it
+ * recorded. The capture is opened again when the scan is restarted.
+ * This frees up the resources which a capture ties down while the scan
+ * is not running, which matters when there are many of them.
+ */
+void
+release_dhcp_scan_capture(struct dhcp_scan * scan)
+{
+	close_capture(scan);
+}
+
+/****************************************************************************/
+
+/* The file descriptor to wait on for captured frames to arrive, which
+ * may be -1 if the platform does not support this or if the capture is
+ * not open.
+ */
+int
+get_dhcp_scan_fd(const struct dhcp_scan * scan)
+{
+	return(scan->capture_fd);
+}
+
+/****************************************************************************/
+
+/* How long to wait (in milliseconds) for captured frames to arrive before
+ * calling dispatch_dhcp_scan(). Not every platform will report that the
+ * capture file descriptor is ready to read once the PCAP read timeout has
+ * elapsed (BPF does not), which is why this is never longer than
+ * DHCP_SCAN_POLL_INTERVAL. In low latency mode, a capture without a file
+ * descriptor to wait for is checked every DHCP_SCAN_LOW_LATENCY_POLL_INTERVAL
+ * milliseconds instead.
+ */
+int
+get_dhcp_scan_poll_timeout(const struct dhcp_scan * scan)
+{
+	int result = DHCP_SCAN_POLL_INTERVAL;
+	int milliseconds;
+
+	if(scan->capture_options.low_latency && scan->capture != NULL && scan->capture_fd < 0)
+		result = DHCP_SCAN_LOW_LATENCY_POLL_INTERVAL;
+
+	if(scan->have_deadline)
+	{
+		milliseconds = get_scan_clock_milliseconds_until(scan->clock,&scan->deadline);
+		if(milliseconds < result)
+			result = milliseconds;
+	}
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Process all the frames which are ready to be read. The capture handle
+ * is in non-blocking mode, so this will not wait for more to arrive.
+ * Returns -1 in case of error, and 0 otherwise.
+ */
+int
+dispatch_dhcp_scan(struct dhcp_scan * scan)
+{
+	int result = -1;
+
+	/* Nothing can have arrived without a capture. */
+	if(scan->capture == NULL)
+	{
+		result = 0;
+		goto out;
+	}
+
+	if((*scan->backend->receive)(scan->capture, -1, ether_input, scan) < 0)
+	{
+		snprintf(scan->error_buffer,sizeof(scan->error_buffer),"%s",(*scan->backend->get_error)(scan->capture));
+		goto out;
+	}
+
+	result = 0;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Check if the scan is complete, either because enough offers have
+ * arrived or because the timeout has elapsed.
+ */
+bool
+is_dhcp_scan_done(const struct dhcp_scan * scan)
+{
+	bool result;
+
+	result = scan->done || (scan->have_deadline && get_scan_clock_milliseconds_until(scan->clock,&scan->deadline) == 0);
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Perform a complete scan, returning once it is done. This combines
+ * start_dhcp_scan() and a poll() loop which calls dispatch_dhcp_scan().
+ * Returns -1 in case of error, and 0 otherwise.
+ */
+int
+run_dhcp_scan(struct dhcp_scan * scan,uint32_t transaction_id,int timeout)
+{
+	struct pollfd pfd;
+	int result = -1;
+
+	if(start_dhcp_scan(scan,transaction_id,timeout) < 0)
+		goto out;
+
+	while(!is_dhcp_scan_done(scan))
+	{
+		pfd.fd = scan->capture_fd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+
+		if((*scan->clock->poll)(scan->clock,&pfd,1,get_dhcp_scan_poll_timeout(scan)) < 0)
+		{
+			if(errno == EINTR)
+				continue;
+
+			snprintf(scan->error_buffer,sizeof(scan->error_buffer),"%s",strerror(errno));
+			goto out;
+		}
+
+		if(dispatch_dhcp_scan(scan) < 0)
+			goto out;
+	}
+
+	result = 0;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* The offers recorded so far, in the order in which they arrived. */
+const struct List *
+get_dhcp_scan_offers(const struct dhcp_scan * scan)
+{
+	return(&scan->offer_list);
+}
+
+/****************************************************************************/
+
+/* The number of offers recorded so far. */
+int
+get_dhcp_scan_num_offers(const struct dhcp_scan * scan)
+{
+	return(scan->num_offers);
+}
+
+/****************************************************************************/
+
+/* How many frames the scan saw since it was started, up to the time
+ * its capture was released if it was.
+ */
+void
+get_dhcp_scan_stats(struct dhcp_scan * scan,struct dhcp_scan_stats * stats)
+{
+	update_capture_stats(scan);
+
+	(*stats) = scan->stats;
+}
+
+/****************************************************************************/
+
+/* Forget about all the offers recorded so far. */
+void
+clear_dhcp_scan_offers(struct dhcp_scan * scan)
+{
+	clear_dhcp_offers(&scan->offer_list);
+	clear_offer_slots(scan);
+
+	scan->num_offers = 0;
+}
+
+/****************************************************************************/
+
+/* Move all the offers recorded so far to the list provided, which must
+ * be empty, so that the caller can look at them while the scan goes on.
+ * This takes the same time regardless of how many offers were recorded.
+ * The scan carries on recording offers, but further responses by the
+ * servers whose offers were taken are still counted as duplicates, and
+ * they do not count towards the maximum number of responses.
+ */
+void
+take_dhcp_scan_offers(struct dhcp_scan * scan,struct List * offer_list)
+{
+	move_list(offer_list,&scan->offer_list);
+
+	scan->num_offers = 0;
+	scan->offer_generation++;
+}
+
+/****************************************************************************/
+
+/* Forget about the servers whose offers were taken by
+ * take_dhcp_scan_offers(), for when the caller discards these offers
+ * instead of handing them back. Further responses by these servers
+ * are then recorded as new ones. This takes the same time regardless
+ * of how many offers were taken.
+ */
+void
+forget_dhcp_scan_taken_offers(struct dhcp_scan * scan)
+{
+	scan->forgotten_generation = scan->offer_generation - 1;
+}
+
+/****************************************************************************/
+
+/* Hand back the offers taken by take_dhcp_scan_offers(), which are put
+ * in front of the offers recorded since. If a server was recorded again
+ * in the meantime, its new record is counted as a duplicate of the one
+ * handed back. The list provided will be empty afterwards.
+ */
+void
+return_dhcp_scan_offers(struct dhcp_scan * scan,struct List * offer_list)
+{
+	struct dhcp_offer * offer;
+	struct dhcp_offer * later_offer;
+	struct offer_slot * slot;
+	struct List later_offers;
+
+	for(offer = (struct dhcp_offer *)get_list_head(offer_list) ;
+		offer != NULL ;
+		offer = (struct dhcp_offer *)get_next_node(&offer->node))
+	{
+		slot = find_offer_slot(scan,offer->server_ipv4_address,offer->server_mac_address);
+		if(slot != NULL)
+		{
+			if(slot->generation == scan->offer_generation)
+			{
+				later_offer = slot->offer;
+
+				merge_dhcp_offer_duplicates(offer,later_offer);
+
+				remove_node(&later_offer->node);
+				delete_dhcp_offer(later_offer);
+
+				scan->num_offers--;
+			}
+
+			slot->offer = offer;
+			slot->generation = scan->offer_generation;
+		}
+		else
+		{
+			/* The offers were cleared in the meantime. Should there
+			 * not be enough memory to add the entry again, a further
+			 * response by this server is recorded separately.
+			 */
+			(void)add_offer_slot(scan,offer);
+		}
+
+		scan->num_offers++;
+	}
+
+	new_list(&later_offers);
+
+	move_list(&later_offers,&scan->offer_list);
+	move_list(&scan->offer_list,offer_list);
+	move_list(&scan->offer_list,&later_offers);
+}
+
+/****************************************************************************/
+
+/* Replace the allowlist in use. This must be called by the same thread
+ * which calls dispatch_dhcp_scan(), after which the previous allowlist
+ * is no longer referenced.
+ */
+void
+set_dhcp_scan_allowlist(struct dhcp_scan * scan,const struct allowlist * allowlist)
+{
+	scan->allowlist = allowlist;
+}
+
+/****************************************************************************/
+
+const char *
+get_dhcp_scan_interface_name(const struct dhcp_scan * scan)
+{
+	return(scan->interface_name);
+}
+
+/****************************************************************************/
+
+/* Describes why the last operation which returned -1 failed. */
+const char *
+get_dhcp_scan_error(const struct dhcp_scan * scan)
+{
+	return(scan->error_buffer);
+}
@@ -0,0 +1,125 @@
+/*
+ * Scan for DHCP servers on a network interface: send a DHCP DISCOVER
+ * message and collect the offers which arrive in response. All the
+ * state of a scan is kept in its own context, which means that several
+ * scans may run in different threads at the same time.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#ifndef _DHCP_SCAN_H
+#define _DHCP_SCAN_H
+
+/****************************************************************************/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/****************************************************************************/
+
+#include "list_node.h"
+#include "dhcp_offer.h"
+#include "allowlist.h"
+#include "offer_filter.h"
+#include "capture_backend.h"
+#include "scan_clock.h"
+
+/****************************************************************************/
+
+/* Longest time to wait (in milliseconds) before checking for newly
+ * captured frames.
+ */
+#define DHCP_SCAN_POLL_INTERVAL 100
+
+/* The same, in low latency mode, for captures which cannot be waited for. */
+#define DHCP_SCAN_LOW_LATENCY_POLL_INTERVAL 1
+
+/****************************************************************************/
+
+/* What became of an offer received. */
+enum
+{
+	DHCP_SCAN_OFFER_RECORDED=0,	/* First offer by this server, recorded */
+	DHCP_SCAN_OFFER_DUPLICATE,	/* Server already recorded, offer counted */
+	DHCP_SCAN_OFFER_NO_MEMORY	/* Not enough memory to record the offer */
+};
+
+/* Called for each offer received which was neither filtered out nor
+ * sent by an allowlisted server. For duplicate offers, the record of
+ * the first offer is provided, with its duplicates already counted;
+ * if that record was taken out of the scan, a separate record takes
+ * its place until it is handed back. Once the records taken are
+ * forgotten, further offers by their servers are recorded as new ones
+ * again. If the offer could not be recorded, only the server addresses
+ * are valid.
+ */
+typedef void (*dhcp_offer_callback)(const struct dhcp_offer *offer, int what, void *user_data);
+
+/****************************************************************************/
+
+/* How a scan should be performed. Zero port numbers select the
+ * default BOOTP server and client ports.
+ */
+struct dhcp_scan_options
+{
+	uint16_t					server_port;
+	uint16_t					client_port;
+	bool						use_broadcast;		/* Ask for broadcast responses */
+	bool						ignore_checksums;	/* Accept damaged IP/UDP headers */
+	int							max_responses;		/* Stop after this many; 0 for no limit */
+	const struct allowlist *	allowlist;			/* Servers to ignore; may be NULL */
+	const struct offer_filter *	offer_filter;		/* Offers to record; may be NULL */
+	dhcp_offer_callback			callback;			/* May be NULL */
+	void *						user_data;
+	const uint8_t *				interface_mac_address;	/* Looked up if NULL */
+	int							interface_mtu;			/* Looked up if 0 */
+	bool						defer_capture;			/* Open the capture only when the scan starts */
+	const struct capture_backend *	capture_backend;	/* libpcap if NULL */
+	struct scan_clock *			clock;					/* The system clock if NULL */
+	bool						low_latency;			/* Hand over each frame as soon as it arrives */
+	int							busy_poll;				/* Microseconds to busy-poll the device; 0 for not at all */
+};
+
+/* How many frames a scan saw since it was started. The capture backend
+ * counts the frames which arrived and those which the kernel dropped
+ * for lack of buffer space; the scan counts the frames it examined.
+ */
+struct dhcp_scan_stats
+{
+	uint64_t	frames_received;
+	uint64_t	frames_dropped;
+	uint64_t	frames_processed;
+};
+
+/****************************************************************************/
+
+struct dhcp_scan;
+
+/****************************************************************************/
+
+struct dhcp_scan *open_dhcp_scan(const char *interface_name, const struct dhcp_scan_options *options, char *error_buffer, size_t error_buffer_size);
+void close_dhcp_scan(struct dhcp_scan *scan);
+int start_dhcp_scan(struct dhcp_scan *scan, uint32_t transaction_id, int timeout);
+void release_dhcp_scan_capture(struct dhcp_scan *scan);
+int get_dhcp_scan_fd(const struct dhcp_scan *scan);
+int get_dhcp_scan_poll_timeout(const struct dhcp_scan *scan);
+int dispatch_dhcp_scan(struct dhcp_scan *scan);
+bool is_dhcp_scan_done(const struct dhcp_scan *scan);
+int run_dhcp_scan(struct dhcp_scan *scan, uint32_t transaction_id, int timeout);
+const struct List *get_dhcp_scan_offers(const struct dhcp_scan *scan);
+int get_dhcp_scan_num_offers(const struct dhcp_scan *scan);
+void clear_dhcp_scan_offers(struct dhcp_scan *scan);
+void take_dhcp_scan_offers(struct dhcp_scan *scan, struct List *offer_list);
+void return_dhcp_scan_offers(struct dhcp_scan *scan, struct List *offer_list);
+void forget_dhcp_scan_taken_offers(struct dhcp_scan *scan);
+void get_dhcp_scan_stats(struct dhcp_scan *scan, struct dhcp_scan_stats *stats);
+void set_dhcp_scan_allowlist(struct dhcp_scan *scan, const struct allowlist *allowlist);
+const char *get_dhcp_scan_interface_name(const struct dhcp_scan *scan);
+const char *get_dhcp_scan_error(const struct dhcp_scan *scan);
+
+/****************************************************************************/
+
+#endif /* _DHCP_SCAN_H */
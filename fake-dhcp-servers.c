@@ -0,0 +1,1130 @@
+/*
+ * Answer DHCP DISCOVER messages as any number of fake DHCP servers, so
+ * that find-dhcp-servers can be tested and measured without a network
+ * full of real DHCP servers.
+ *
+ * Each fake server has its own MAC address, IPv4 address and options,
+ * waits for a while before it responds and may fail to respond at all,
+ * as real servers do. The servers are either listed in a file, one per
+ * line, or made up:
+ *
+ *     # address   MAC address        [delay=<ms>] [loss=<percent>] [option=<code>:<hex>]...
+ *     10.0.0.1    02:00:00:00:00:01  delay=20 loss=10 option=119:076578616d706c6503636f6d00
+ *
+ * Which offers are lost, and how long the made up servers wait before
+ * they respond, is determined by a pseudo-random number generator
+ * started with a fixed seed, so that the same run may be repeated.
+ *
+ * Only offers are sent, never acknowledgements, which means that no
+ * client can obtain a lease from a fake server.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <net/ethernet.h>
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <arpa/inet.h>
+
+#ifdef __linux__
+/* This makes the 'struct udphdr' use the same
+ * field names as used in the BSD header files.
+ */
+#define __FAVOR_BSD
+#endif /* __linux__ */
+#include <netinet/udp.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <signal.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <errno.h>
+#include <time.h>
+
+#include <unistd.h>
+#include <getopt.h>
+#include <poll.h>
+
+/****************************************************************************/
+
+#include "capture_backend.h"
+#include "dhcp_protocol.h"
+#include "dhcp_message.h"
+#include "dhcp_frame.h"
+
+/****************************************************************************/
+
+/* Most fake servers supported, which is how many made up servers can
+ * have addresses of their own.
+ */
+#define MAX_SERVERS 65535
+
+/* Room for the options of a fake server, beyond those which every one
+ * of them sends, such that an offer still fits into a 1500 octet MTU.
+ */
+#define MAX_EXTRA_OPTIONS_SIZE 1024
+
+/* DHCP messages shorter than this may be dropped by relay servers
+ * (RFC 1532, section 2.1), which is why offers are padded to this
+ * length.
+ */
+#define MIN_DHCP_MESSAGE_SIZE 300
+
+/* Most offers sent at a time. */
+#define MAX_BATCH_SIZE 64
+
+/* How long to wait (in milliseconds) before trying again to send offers
+ * which did not fit into the send buffer.
+ */
+#define RETRY_INTERVAL 1
+
+/****************************************************************************/
+
+/* A fake DHCP server. */
+struct fake_server
+{
+	uint8_t		mac_address[ETHER_ADDR_LEN];
+	ip4_t		address;			/* Network byte order */
+	ip4_t		offered_address;	/* Network byte order */
+	int			delay;				/* Milliseconds before responding */
+	int			loss;				/* Percentage of DHCP DISCOVER messages ignored */
+
+	uint8_t *	extra_options;		/* NULL unless options were given */
+	int			extra_options_length;
+};
+
+/* An offer which is to be sent once its time has come. */
+struct pending_offer
+{
+	struct timespec	due;
+	int				server;
+	uint32_t		transaction_id;		/* Network byte order */
+	uint16_t		flags;				/* Network byte order */
+	uint8_t			client_mac_address[ETHER_ADDR_LEN];
+};
+
+/* All the fake servers, and what they are up to. */
+struct responder
+{
+	const struct capture_backend *	backend;
+	struct capture_handle *			capture;
+
+	struct fake_server *	servers;
+	int						num_servers;
+	int						servers_size;
+
+	/* The offers waiting to be sent, as a heap ordered by when they
+	 * are due.
+	 */
+	struct pending_offer *	pending;
+	int						num_pending;
+	int						pending_size;
+
+	uint64_t				random_state;
+
+	unsigned long			num_discovers;
+	unsigned long			num_offers_sent;
+	unsigned long			num_offers_lost;
+	unsigned long			num_offers_failed;
+};
+
+/****************************************************************************/
+
+const char * command_name;
+
+/* Global options, as defined by the command line parameters. */
+bool opt_verbose = false;
+bool opt_quiet = false;
+
+/* Set by the signal handler. */
+static volatile sig_atomic_t stop_requested;
+
+/****************************************************************************/
+
+static void
+stop_handler(int sig __attribute__((unused)))
+{
+	stop_requested = true;
+}
+
+/****************************************************************************/
+
+/* The next number produced by a xorshift64* pseudo-random number
+ * generator, which is good enough for picking offers to lose.
+ */
+static uint32_t
+get_random_number(uint64_t * state)
+{
+	uint64_t x = (*state);
+
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+
+	(*state) = x;
+
+	return((uint32_t)((x * 0x2545F4914F6CDD1DULL) >> 32));
+}
+
+/****************************************************************************/
+
+/* Check if one point in time comes before another. */
+static bool
+is_earlier(const struct timespec * a,const struct timespec * b)
+{
+	bool result;
+
+	result = (a->tv_sec < b->tv_sec || (a->tv_sec == b->tv_sec && a->tv_nsec < b->tv_nsec));
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Add an offer to the heap of those waiting to be sent. Returns -1 if
+ * not enough memory is available, and 0 otherwise.
+ */
+static int
+push_pending_offer(struct responder * responder,const struct pending_offer * offer)
+{
+	struct pending_offer * pending = responder->pending;
+	struct pending_offer swap;
+	int result = -1;
+	int size;
+	int parent;
+	int i;
+
+	if(responder->num_pending == responder->pending_size)
+	{
+		size = (responder->pending_size > 0) ? 2 * responder->pending_size : 1024;
+
+		pending = realloc(responder->pending,size * sizeof(*pending));
+		if(pending == NULL)
+			goto out;
+
+		responder->pending = pending;
+		responder->pending_size = size;
+	}
+
+	i = responder->num_pending++;
+
+	pending[i] = (*offer);
+
+	while(i > 0)
+	{
+		parent = (i - 1) / 2;
+
+		if(!is_earlier(&pending[i].due,&pending[parent].due))
+			break;
+
+		swap = pending[i];
+		pending[i] = pending[parent];
+		pending[parent] = swap;
+
+		i = parent;
+	}
+
+	result = 0;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Remove the offer which is due first from the heap. */
+static void
+pop_pending_offer(struct responder * responder,struct pending_offer * offer)
+{
+	struct pending_offer * pending = responder->pending;
+	struct pending_offer swap;
+	int smallest;
+	int child;
+	int i;
+
+	(*offer) = pending[0];
+
+	pending[0] = pending[--responder->num_pending];
+
+	for(i = 0 ; ; i = smallest)
+	{
+		smallest = i;
+
+		for(child = 2 * i + 1 ; child <= 2 * i + 2 && child < responder->num_pending ; child++)
+		{
+			if(is_earlier(&pending[child].due,&pending[smallest].due))
+				smallest = child;
+		}
+
+		if(smallest == i)
+			break;
+
+		swap = pending[i];
+		pending[i] = pending[smallest];
+		pending[smallest] = swap;
+	}
+}
+
+/****************************************************************************/
+
+/* Add another fake server to the table, with all its fields cleared.
+ * Returns NULL if not enough memory is available.
+ */
+static struct fake_server *
+add_server(struct responder * responder)
+{
+	struct fake_server * result = NULL;
+	struct fake_server * servers;
+	int size;
+
+	if(responder->num_servers == responder->servers_size)
+	{
+		size = (responder->servers_size > 0) ? 2 * responder->servers_size : 64;
+
+		servers = realloc(responder->servers,size * sizeof(*servers));
+		if(servers == NULL)
+			goto out;
+
+		responder->servers = servers;
+		responder->servers_size = size;
+	}
+
+	result = &responder->servers[responder->num_servers++];
+
+	memset(result,0,sizeof(*result));
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Build the offer a fake server sends in response to a DHCP DISCOVER
+ * message. Returns the length of the frame.
+ */
+static int
+build_offer(const struct fake_server * server,const struct pending_offer * offer,uint8_t * frame)
+{
+	static const uint8_t broadcast_mac_address[ETHER_ADDR_LEN] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+	static const uint8_t domain_name[] = "example.com";
+
+	struct ip * ip_header = (struct ip *)&frame[sizeof(struct ether_header)];
+	struct udphdr * udp_header = (struct udphdr *)&ip_header[1];
+	bootp_t * dhcp = (bootp_t *)&udp_header[1];
+	uint32_t lease_time = htonl(86400);
+	uint32_t subnet_mask = htonl(0xffffff00);
+	uint8_t message_type = MESSAGE_TYPE_OFFER;
+	const uint8_t * dst_mac_address;
+	ip4_t dst_address;
+	int len = 0;
+
+	/* The frame buffer is reused, so everything up to the end of the
+	 * padding must be cleared, not just the fixed part of the message.
+	 */
+	memset(frame,0,sizeof(struct ether_header) + sizeof(*ip_header) + sizeof(*udp_header) + MIN_DHCP_MESSAGE_SIZE);
+
+	len += fill_dhcp_option(&dhcp->vend[len], OPTION_TYPE_DHCP_MESSAGE_TYPE, &message_type, sizeof(message_type));
+	len += fill_dhcp_option(&dhcp->vend[len], OPTION_TYPE_SERVER_IDENTIFIER, &server->address, sizeof(server->address));
+	len += fill_dhcp_option(&dhcp->vend[len], OPTION_TYPE_IP_ADDRESS_LEASE_TIME, &lease_time, sizeof(lease_time));
+	len += fill_dhcp_option(&dhcp->vend[len], OPTION_TYPE_SUBNET_MASK, &subnet_mask, sizeof(subnet_mask));
+	len += fill_dhcp_option(&dhcp->vend[len], OPTION_TYPE_GATEWAY, &server->address, sizeof(server->address));
+	len += fill_dhcp_option(&dhcp->vend[len], OPTION_TYPE_DNS, &server->address, sizeof(server->address));
+	len += fill_dhcp_option(&dhcp->vend[len], OPTION_TYPE_DOMAIN_NAME, domain_name, sizeof(domain_name)-1);
+
+	if(server->extra_options != NULL)
+	{
+		memmove(&dhcp->vend[len], server->extra_options, server->extra_options_length);
+		len += server->extra_options_length;
+	}
+
+	len += fill_dhcp_option(&dhcp->vend[len], OPTION_TYPE_END, NULL, 0);
+
+	dhcp->opcode = BOOTREPLY;
+	dhcp->htype = BOOTP_HARDWARE_TYPE_10_ETHERNET;
+	dhcp->hlen = ETHER_ADDR_LEN;
+	dhcp->xid = offer->transaction_id;
+	dhcp->flags = offer->flags;
+	dhcp->yiaddr = server->offered_address;
+	memmove(dhcp->chaddr, offer->client_mac_address, ETHER_ADDR_LEN);
+	dhcp->magic_cookie = htonl(DHCP_MAGIC_COOKIE);
+
+	len += sizeof(*dhcp);
+
+	if(len < MIN_DHCP_MESSAGE_SIZE)
+		len = MIN_DHCP_MESSAGE_SIZE;
+
+	/* Respond by broadcast if the client asked for it (RFC 2131,
+	 * section 4.1).
+	 */
+	if(ntohs(offer->flags) & 0x8000)
+	{
+		dst_mac_address = broadcast_mac_address;
+		dst_address = 0xFFFFFFFF;
+	}
+	else
+	{
+		dst_mac_address = offer->client_mac_address;
+		dst_address = server->offered_address;
+	}
+
+	len = udp_output(ip_header, server->address, dst_address, udp_header, DEFAULT_BOOTP_SERVER_PORT, DEFAULT_BOOTP_CLIENT_PORT, len);
+	len = ip_output(ip_header, server->address, dst_address, len);
+	len = ether_output(frame, server->mac_address, dst_mac_address, len);
+
+	return(len);
+}
+
+/****************************************************************************/
+
+/* Send the offers which are due, a batch at a time. Returns -1 in case
+ * of error, and 0 otherwise.
+ */
+static int
+send_pending_offers(struct responder * responder)
+{
+	static uint8_t frames[MAX_BATCH_SIZE][ETHER_MAX_LEN];
+	struct pending_offer batch[MAX_BATCH_SIZE];
+	struct capture_frame output[MAX_BATCH_SIZE];
+	struct timespec now;
+	int num_frames;
+	int result = -1;
+	int n;
+	int i;
+
+	clock_gettime(CLOCK_MONOTONIC,&now);
+
+	while(responder->num_pending > 0 && !is_earlier(&now,&responder->pending[0].due))
+	{
+		for(num_frames = 0 ;
+		    num_frames < MAX_BATCH_SIZE && responder->num_pending > 0 && !is_earlier(&now,&responder->pending[0].due) ;
+		    num_frames++)
+		{
+			pop_pending_offer(responder,&batch[num_frames]);
+
+			output[num_frames].data = frames[num_frames];
+			output[num_frames].length = build_offer(&responder->servers[batch[num_frames].server],&batch[num_frames],frames[num_frames]);
+		}
+
+		n = (*responder->backend->transmit)(responder->capture,output,num_frames);
+		if(n < 0)
+		{
+			fprintf(stderr,"%s: Could not send offers (%s).\n",command_name,(*responder->backend->get_error)(responder->capture));
+			goto out;
+		}
+
+		responder->num_offers_sent += n;
+
+		/* The offers which did not fit into the send buffer are tried
+		 * again shortly.
+		 */
+		for(i = n ; i < num_frames ; i++)
+		{
+			if(push_pending_offer(responder,&batch[i]) < 0)
+				responder->num_offers_failed++;
+		}
+
+		if(n < num_frames)
+			break;
+	}
+
+	result = 0;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Have every fake server respond to a DHCP DISCOVER message, unless it
+ * decides to lose it.
+ */
+static void
+discover_received(struct responder * responder,const bootp_t * dhcp)
+{
+	const struct fake_server * server;
+	struct pending_offer offer;
+	struct timespec now;
+	int i;
+
+	responder->num_discovers++;
+
+	if(opt_verbose)
+	{
+		printf("%s: DHCP DISCOVER from %02x:%02x:%02x:%02x:%02x:%02x, transaction 0x%08x.\n",command_name,
+			dhcp->chaddr[0],dhcp->chaddr[1],dhcp->chaddr[2],dhcp->chaddr[3],dhcp->chaddr[4],dhcp->chaddr[5],
+			(unsigned int)ntohl(dhcp->xid));
+	}
+
+	clock_gettime(CLOCK_MONOTONIC,&now);
+
+	memset(&offer,0,sizeof(offer));
+
+	offer.transaction_id = dhcp->xid;
+	offer.flags = dhcp->flags;
+	memmove(offer.client_mac_address, dhcp->chaddr, ETHER_ADDR_LEN);
+
+	for(i = 0 ; i < responder->num_servers ; i++)
+	{
+		server = &responder->servers[i];
+
+		if(server->loss > 0 && (int)(get_random_number(&responder->random_state) % 100) < server->loss)
+		{
+			responder->num_offers_lost++;
+			continue;
+		}
+
+		offer.server = i;
+
+		offer.due = now;
+		offer.due.tv_sec += server->delay / 1000;
+		offer.due.tv_nsec += (server->delay % 1000) * 1000000L;
+
+		if(offer.due.tv_nsec >= 1000000000L)
+		{
+			offer.due.tv_sec++;
+			offer.due.tv_nsec -= 1000000000L;
+		}
+
+		if(push_pending_offer(responder,&offer) < 0)
+			responder->num_offers_failed++;
+	}
+}
+
+/****************************************************************************/
+
+/* Frame handler, invoked through the receive function of the capture
+ * backend. Only DHCP DISCOVER messages are of interest.
+ */
+static bool
+frame_received(const struct capture_frame * frame,void * user_data)
+{
+	struct responder * responder = user_data;
+	const struct ether_header * ethernet_frame = (const struct ether_header *)frame->data;
+	const struct ip * ip_packet = (const struct ip *)&ethernet_frame[1];
+	const struct udphdr * udp_packet;
+	struct dhcp_message message;
+	size_t offset;
+	int length;
+
+	if(frame->length < sizeof(*ethernet_frame) + sizeof(*ip_packet) + sizeof(*udp_packet))
+		goto out;
+
+	if(ntohs(ethernet_frame->ether_type) != ETHERTYPE_IP || ip_packet->ip_p != IPPROTO_UDP)
+		goto out;
+
+	offset = sizeof(*ethernet_frame) + ip_packet->ip_hl * 4;
+	if(offset + sizeof(*udp_packet) > frame->length)
+		goto out;
+
+	udp_packet = (const struct udphdr *)&frame->data[offset];
+
+	/* Our own offers are captured, too. */
+	if(ntohs(udp_packet->uh_dport) != DEFAULT_BOOTP_SERVER_PORT)
+		goto out;
+
+	offset += sizeof(*udp_packet);
+
+	length = ntohs(udp_packet->uh_ulen) - (int)sizeof(*udp_packet);
+	if(length < (int)sizeof(bootp_t) || offset + length > frame->length)
+		goto out;
+
+	if(decode_dhcp_message(&message, &frame->data[offset], length) < 0)
+		goto out;
+
+	if(message.opcode == BOOTREQUEST && message.has_magic_cookie && message.message_type == MESSAGE_TYPE_DISCOVER)
+		discover_received(responder,(const bootp_t *)&frame->data[offset]);
+
+ out:
+
+	return(true);
+}
+
+/****************************************************************************/
+
+/* Convert the text form of a MAC address into its binary form. Returns
+ * true if this worked.
+ */
+static bool
+parse_mac_address(const char * text,uint8_t * mac_address)
+{
+	unsigned int octets[ETHER_ADDR_LEN];
+	bool result = false;
+	char c;
+	int i;
+
+	if(sscanf(text,"%x:%x:%x:%x:%x:%x%c",&octets[0],&octets[1],&octets[2],&octets[3],&octets[4],&octets[5],&c) != ETHER_ADDR_LEN)
+		goto out;
+
+	for(i = 0 ; i < ETHER_ADDR_LEN ; i++)
+	{
+		if(octets[i] > 255)
+			goto out;
+
+		mac_address[i] = (uint8_t)octets[i];
+	}
+
+	result = true;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Convert a parameter into a number within the given range. Returns
+ * true if this worked.
+ */
+static bool
+parse_number(const char * text,long minimum,long maximum,long * value)
+{
+	bool result = false;
+	char * p;
+	long n;
+
+	n = strtol(text,&p,0);
+	if(p == text || (*p) != '\0' || n < minimum || n > maximum)
+		goto out;
+
+	(*value) = n;
+
+	result = true;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Add an option given as "<code>:<hex>" to those which a fake server
+ * sends. Returns true if this worked.
+ */
+static bool
+add_extra_option(struct fake_server * server,const char * text)
+{
+	uint8_t data[255];
+	bool result = false;
+	const char * s;
+	char digits[3];
+	char * p;
+	long code;
+	int len = 0;
+
+	code = strtol(text,&p,0);
+	if(p == text || (*p) != ':' || code < 1 || code > 254)
+		goto out;
+
+	for(s = p+1 ; (*s) != '\0' ; s += 2)
+	{
+		if(len == (int)sizeof(data) || !isxdigit((unsigned char)s[0]) || !isxdigit((unsigned char)s[1]))
+			goto out;
+
+		digits[0] = s[0];
+		digits[1] = s[1];
+		digits[2] = '\0';
+
+		data[len++] = (uint8_t)strtoul(digits,NULL,16);
+	}
+
+	if(server->extra_options_length + 2 + len > MAX_EXTRA_OPTIONS_SIZE)
+		goto out;
+
+	if(server->extra_options == NULL)
+	{
+		server->extra_options = malloc(MAX_EXTRA_OPTIONS_SIZE);
+		if(server->extra_options == NULL)
+			goto out;
+	}
+
+	server->extra_options_length += fill_dhcp_option(&server->extra_options[server->extra_options_length], (uint8_t)code, data, len);
+
+	result = true;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Read the fake servers listed in a file, adding them to the table.
+ * Returns -1 in case of error, and 0 otherwise.
+ */
+static int
+read_server_file(const char * file_name,struct responder * responder)
+{
+	struct fake_server * server;
+	struct in_addr address;
+	char line[4096];
+	char * word;
+	char * next;
+	FILE * file;
+	int line_number = 0;
+	int result = -1;
+	long n;
+
+	file = fopen(file_name,"r");
+	if(file == NULL)
+	{
+		fprintf(stderr,"%s: Could not open '%s' (%s).\n",command_name,file_name,strerror(errno));
+		goto out;
+	}
+
+	while(fgets(line,sizeof(line),file) != NULL)
+	{
+		line_number++;
+
+		/* Strip comments. */
+		word = strchr(line,'#');
+		if(word != NULL)
+			(*word) = '\0';
+
+		word = strtok_r(line," \t\r\n",&next);
+		if(word == NULL)
+			continue;
+
+		if(responder->num_servers == MAX_SERVERS)
+		{
+			fprintf(stderr,"%s: %s, line %d: Too many servers.\n",command_name,file_name,line_number);
+			goto out;
+		}
+
+		server = add_server(responder);
+		if(server == NULL)
+		{
+			fprintf(stderr,"%s: Not enough memory.\n",command_name);
+			goto out;
+		}
+
+		if(inet_pton(AF_INET,word,&address) != 1)
+		{
+			fprintf(stderr,"%s: %s, line %d: '%s' is not an IPv4 address.\n",command_name,file_name,line_number,word);
+			goto out;
+		}
+
+		server->address = address.s_addr;
+
+		/* The client is offered the 100th address of the /24 network
+		 * the server belongs to.
+		 */
+		server->offered_address = htonl((ntohl(address.s_addr) & 0xffffff00) | 100);
+
+		word = strtok_r(NULL," \t\r\n",&next);
+		if(word == NULL || !parse_mac_address(word,server->mac_address))
+		{
+			fprintf(stderr,"%s: %s, line %d: A MAC address is missing.\n",command_name,file_name,line_number);
+			goto out;
+		}
+
+		while((word = strtok_r(NULL," \t\r\n",&next)) != NULL)
+		{
+			if(strncmp(word,"delay=",6) == 0 && parse_number(word+6,0,60000,&n))
+			{
+				server->delay = (int)n;
+			}
+			else if (strncmp(word,"loss=",5) == 0 && parse_number(word+5,0,100,&n))
+			{
+				server->loss = (int)n;
+			}
+			else if (strncmp(word,"option=",7) == 0 && add_extra_option(server,word+7))
+			{
+				/* Nothing else to do. */
+			}
+			else
+			{
+				fprintf(stderr,"%s: %s, line %d: '%s' is not valid.\n",command_name,file_name,line_number,word);
+				goto out;
+			}
+		}
+	}
+
+	if(ferror(file))
+	{
+		fprintf(stderr,"%s: Could not read '%s' (%s).\n",command_name,file_name,strerror(errno));
+		goto out;
+	}
+
+	result = 0;
+
+ out:
+
+	if(file != NULL)
+		fclose(file);
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Make up fake servers until there are as many as requested. Each one
+ * has an address of its own in the 10.0.0.0/8 network, and a MAC address
+ * to match. The delay is picked at random from the range given. Returns
+ * -1 if not enough memory is available, and 0 otherwise.
+ */
+static int
+make_up_servers(struct responder * responder,int num_servers,int min_delay,int max_delay,int loss)
+{
+	struct fake_server * server;
+	int result = -1;
+	int number;
+
+	while(responder->num_servers < num_servers)
+	{
+		server = add_server(responder);
+		if(server == NULL)
+			goto out;
+
+		/* Counting from 1, which makes the first server 10.0.1.1. */
+		number = responder->num_servers;
+
+		server->address = htonl(0x0a000001 | (number << 8));
+		server->offered_address = htonl(0x0a000064 | (number << 8));
+
+		server->mac_address[0] = 0x02;	/* Locally administered */
+		server->mac_address[3] = (uint8_t)(number >> 16);
+		server->mac_address[4] = (uint8_t)(number >> 8);
+		server->mac_address[5] = (uint8_t)number;
+
+		server->delay = min_delay;
+		if(max_delay > min_delay)
+			server->delay += get_random_number(&responder->random_state) % (max_delay - min_delay + 1);
+
+		server->loss = loss;
+	}
+
+	result = 0;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* How long to wait (in milliseconds) until the next offer is due, or
+ * -1 if there is none.
+ */
+static int
+get_poll_timeout(const struct responder * responder)
+{
+	struct timespec now;
+	long long milliseconds;
+	int result = -1;
+
+	if(responder->num_pending > 0)
+	{
+		clock_gettime(CLOCK_MONOTONIC,&now);
+
+		/* Round up, so as not to wake up too early. */
+		milliseconds = (responder->pending[0].due.tv_sec - now.tv_sec) * 1000LL +
+		               (responder->pending[0].due.tv_nsec - now.tv_nsec + 999999) / 1000000;
+
+		if(milliseconds < RETRY_INTERVAL)
+			milliseconds = RETRY_INTERVAL;
+
+		result = (milliseconds > INT_MAX) ? INT_MAX : (int)milliseconds;
+	}
+
+	/* Without a file descriptor to wait on, the capture is checked
+	 * periodically.
+	 */
+	if((*responder->backend->get_fd)(responder->capture) == -1 && (result < 0 || result > 10))
+		result = 10;
+
+	return(result);
+}
+
+/****************************************************************************/
+
+static void
+print_usage(void)
+{
+	printf("Usage: %s "
+		"[--capture=<backend>] "
+		"[--delay=<milliseconds>[-<milliseconds>]] "
+		"[--loss=<percent>] "
+		"[--seed=<number>] "
+		"[--servers=<number>] "
+		"[--server-file=<file>] "
+		"[--help] "
+		"[--quiet] "
+		"[--verbose] "
+		"interface\n",
+		command_name);
+}
+
+/****************************************************************************/
+
+int
+main(int argc, char *argv[])
+{
+	static const struct option longopts[] =
+	{
+		{ "capture",			required_argument,	NULL,	'k'	},
+		{ "delay",				required_argument,	NULL,	'd'	},
+		{ "help",				no_argument,		NULL,	'h'	},
+		{ "loss",				required_argument,	NULL,	'L'	},
+		{ "quiet",				no_argument,		NULL,	'q'	},
+		{ "seed",				required_argument,	NULL,	'r'	},
+		{ "servers",			required_argument,	NULL,	'n'	},
+		{ "server-file",		required_argument,	NULL,	'F'	},
+		{ "verbose",			no_argument,		NULL,	'v'	},
+		{ NULL,					0,					NULL,	0	}
+	};
+
+	struct responder responder;
+	char error_buffer[CAPTURE_ERROR_SIZE];
+	const char * server_file_name = NULL;
+	const char * interface_name;
+	struct sigaction sa;
+	struct pollfd pfd;
+	int num_servers = 0;
+	int min_delay = 0;
+	int max_delay = 0;
+	int loss = 0;
+	int result = EXIT_FAILURE;
+	const char * s;
+	char * p;
+	long n;
+	int c;
+	int i;
+
+	/* Figure out the name of this command. Strip any
+	 * leading path from it.
+	 */
+	command_name = argv[0];
+
+	s = strrchr(command_name, '/');
+	if(s != NULL)
+		command_name = s+1;
+
+	memset(&responder,0,sizeof(responder));
+
+	responder.backend = get_default_capture_backend();
+	responder.random_state = 1;
+
+	while((c = getopt_long(argc,argv,"d:F:hk:L:n:qr:v",longopts,NULL)) != -1)
+	{
+		switch(c)
+		{
+			/* How long the made up servers wait before responding. */
+			case 'd':
+
+				n = strtol(optarg,&p,0);
+				if(p == optarg || n < 0 || n > 60000 || ((*p) != '\0' && (*p) != '-'))
+				{
+					fprintf(stderr,"%s: Parameter '--delay=%s' is not valid.\n",command_name,optarg);
+					goto out;
+				}
+
+				min_delay = max_delay = (int)n;
+
+				if((*p) == '-')
+				{
+					if(!parse_number(p+1,min_delay,60000,&n))
+					{
+						fprintf(stderr,"%s: Parameter '--delay=%s' is not valid.\n",command_name,optarg);
+						goto out;
+					}
+
+					max_delay = (int)n;
+				}
+
+				break;
+
+			/* The servers to pretend to be. */
+			case 'F':
+
+				server_file_name = optarg;
+				break;
+
+			/* Print the usage information. */
+			case 'h':
+
+				print_usage();
+
+				result = EXIT_SUCCESS;
+				goto out;
+
+			/* How to capture and send frames. */
+			case 'k':
+
+				responder.backend = find_capture_backend(optarg);
+				if(responder.backend == NULL)
+				{
+					fprintf(stderr,"%s: Parameter '--capture=%s' is not valid.\n",command_name,optarg);
+					goto out;
+				}
+
+				break;
+
+			/* How many DHCP DISCOVER messages the made up servers ignore. */
+			case 'L':
+
+				if(!parse_number(optarg,0,100,&n))
+				{
+					fprintf(stderr,"%s: Parameter '--loss=%s' is not valid.\n",command_name,optarg);
+					goto out;
+				}
+
+				loss = (int)n;
+				break;
+
+			/* How many servers to pretend to be. */
+			case 'n':
+
+				if(!parse_number(optarg,1,MAX_SERVERS,&n))
+				{
+					fprintf(stderr,"%s: Parameter '--servers=%s' is not valid.\n",command_name,optarg);
+					goto out;
+				}
+
+				num_servers = (int)n;
+				break;
+
+			/* Print only error messages. */
+			case 'q':
+
+				opt_quiet = true;
+				break;
+
+			/* Start the pseudo-random number generator differently. */
+			case 'r':
+
+				if(!parse_number(optarg,1,LONG_MAX,&n))
+				{
+					fprintf(stderr,"%s: Parameter '--seed=%s' is not valid.\n",command_name,optarg);
+					goto out;
+				}
+
+				responder.random_state = (uint64_t)n;
+				break;
+
+			/* Print each DHCP DISCOVER message received. */
+			case 'v':
+
+				opt_verbose = true;
+				break;
+
+			default:
+
+				fprintf(stderr,"%s: %s - %s\n",command_name,optarg,"option not known");
+				goto out;
+		}
+	}
+
+	argc -= optind;
+	argv += optind;
+
+	if(argc != 1)
+	{
+		print_usage();
+		goto out;
+	}
+
+	interface_name = argv[0];
+
+	if(server_file_name != NULL && read_server_file(server_file_name,&responder) < 0)
+		goto out;
+
+	/* Without a list of servers, there is one made up server. */
+	if(num_servers == 0 && responder.num_servers == 0)
+		num_servers = 1;
+
+	if(make_up_servers(&responder,num_servers,min_delay,max_delay,loss) < 0)
+	{
+		fprintf(stderr,"%s: Not enough memory.\n",command_name);
+		goto out;
+	}
+
+	responder.capture = (*responder.backend->open)(interface_name, ETHER_MAX_LEN, NULL, error_buffer, sizeof(error_buffer));
+	if(responder.capture == NULL)
+	{
+		fprintf(stderr,"%s: Could not capture on '%s' (%s).\n",command_name,interface_name,error_buffer);
+		goto out;
+	}
+
+	if((*responder.backend->attach_filter)(responder.capture, DEFAULT_BOOTP_SERVER_PORT) < 0)
+	{
+		fprintf(stderr,"%s: %s.\n",command_name,(*responder.backend->get_error)(responder.capture));
+		goto out;
+	}
+
+	/* Keep going until told to stop. */
+	memset(&sa,0,sizeof(sa));
+	sa.sa_handler = stop_handler;
+	sigemptyset(&sa.sa_mask);
+
+	sigaction(SIGINT,&sa,NULL);
+	sigaction(SIGTERM,&sa,NULL);
+
+	if(!opt_quiet)
+		printf("%s: Answering as %d DHCP servers on %s.\n",command_name,responder.num_servers,interface_name);
+
+	pfd.fd = (*responder.backend->get_fd)(responder.capture);
+	pfd.events = POLLIN;
+
+	while(!stop_requested)
+	{
+		pfd.revents = 0;
+
+		if(poll(&pfd,1,get_poll_timeout(&responder)) < 0)
+		{
+			if(errno == EINTR)
+				continue;
+
+			fprintf(stderr,"%s: %s.\n",command_name,strerror(errno));
+			goto out;
+		}
+
+		if((*responder.backend->receive)(responder.capture, -1, frame_received, &responder) < 0)
+		{
+			fprintf(stderr,"%s: %s.\n",command_name,(*responder.backend->get_error)(responder.capture));
+			goto out;
+		}
+
+		if(send_pending_offers(&responder) < 0)
+			goto out;
+	}
+
+	if(!opt_quiet)
+	{
+		printf("%s: Received %lu DHCP DISCOVER messages, sent %lu offers, lost %lu on purpose",
+			command_name,responder.num_discovers,responder.num_offers_sent,responder.num_offers_lost);
+
+		if(responder.num_offers_failed > 0)
+			printf(", %lu could not be sent",responder.num_offers_failed);
+
+		if(responder.num_pending > 0)
+			printf(", %d were still waiting to be sent",responder.num_pending);
+
+		printf(".\n");
+	}
+
+	result = EXIT_SUCCESS;
+
+ out:
+
+	if(responder.capture != NULL)
+		(*responder.backend->close)(responder.capture);
+
+	for(i = 0 ; i < responder.num_servers ; i++)
+		free(responder.servers[i].extra_options);
+
+	free(responder.pending);
+	free(responder.servers);
+
+	return(result);
+}
@@ -24,37 +24,20 @@
 
 #include <sys/types.h>
 #include <sys/socket.h>
-#include <sys/ioctl.h>
 #include <net/ethernet.h>
 #include <net/if.h>
-#ifndef __linux__
-#include <net/if_dl.h>
-#endif /* !__linux__ */
 #include <netinet/in.h>
-#include <netinet/ip.h>
-
-#ifdef __linux__
-/* This makes the 'struct udphdr' use the same
- * field names as used in the BSD header files.
- */
-#define __FAVOR_BSD
-#endif /* __linux__ */
-#include <netinet/udp.h>
-
-#include <ifaddrs.h>
+#include <arpa/inet.h>
 
 #include <sys/time.h>
 
 #include <stdbool.h>
-#include <stdarg.h>
 #include <signal.h>
 #include <stdlib.h>
 #include <stddef.h>
 #include <string.h>
 #include <stdint.h>
 #include <limits.h>
-#include <setjmp.h>
-#include <assert.h>
 #include <stdio.h>
 #include <errno.h>
 #include <time.h>
@@ -62,199 +45,75 @@
 #include <unistd.h>
 #include <getopt.h>
 #include <netdb.h>
+#include <poll.h>
+#include <pthread.h>
 #include <pcap.h>
 
 /****************************************************************************/
 
 #include "list_node.h"
+#include "dhcp_protocol.h"
+#include "dhcp_offer.h"
+#include "dhcp_scan.h"
+#include "allowlist.h"
+#include "allowlist_watch.h"
+#include "offer_filter.h"
+#include "baseline.h"
+#include "history.h"
+#include "shared_results.h"
+#include "collector.h"
+#include "record_ring.h"
+#include "offer_dump.h"
+#include "netns_sweep.h"
+#include "network_links.h"
+#include "link_watch.h"
+#include "scan_scheduler.h"
 
 /****************************************************************************/
 
-/* 32 bit IPv4 address. */
-typedef uint32_t ip4_t;
-
-/****************************************************************************/
-
-/* Combined IP and UDP headers, suitable for calculating
- * and verifying the UDP datagram checksum.
- */
-struct udp_pseudo_header
-{
-	uint32_t	ih_zero1[2];	/* set to zero */
-	uint8_t		ih_zero2;		/* set to zero */
-	uint8_t		ih_pr;			/* protocol */
-	uint16_t	ih_len;			/* protocol length */
-	ip4_t		ih_src;			/* source internet address */
-	ip4_t		ih_dst;			/* destination internet address */
-	
-	uint16_t	uh_sport;		/* source port */
-	uint16_t	uh_dport;		/* destination port */
-	int16_t		uh_ulen;		/* udp length */
-	uint16_t	uh_sum;			/* udp checksum */
-};
-
-/****************************************************************************/
-
-/* Source: http://www.tcpipguide.com/free/t_DHCPMessageFormat.htm
- *
- * This is actually the BOOTP packet (RFC 951) with the
- * vendor information format stored in the first four
- * octets of the vendor specific area (RFC 1048).
- */
-typedef struct
-{
-	uint8_t		opcode;			/* Packet op code / message type */
-	uint8_t		htype;			/* Hardware address type */
-	uint8_t		hlen;			/* Hardware address length */
-	uint8_t		hops;
-	uint32_t	xid;			/* Transaction ID */
-	uint16_t	secs;
-	uint16_t	flags;
-	ip4_t		ciaddr;			/* Client IP address; client sets this to 0 */
-	ip4_t		yiaddr;			/* Filled in by server if client doesn't know its own address */
-	ip4_t		siaddr;			/* Server IP address */
-	ip4_t		giaddr;			/* Gateway IP address */
-	uint8_t		chaddr[16];		/* Client hardware address */
-	char		sname[64];		/* Optional server host name */
-	char		file[128];		/* Boot file name */
-	uint32_t	magic_cookie;	/* Vendor information format (RFC 1048). */
-	uint8_t		vend[0];		/* Vendor-specific area; these should be 60 octets minimum. */
-} bootp_t;
-
-/****************************************************************************/
-
-/* This should be in bootp_t.opcode (RFC 951). */
-enum
-{
-	BOOTREQUEST=1,
-	BOOTREPLY=2
-};
-
-/****************************************************************************/
-
-/* This goes into bootp_t.htype (RFC 951). */
-#define BOOTP_HARDWARE_TYPE_10_ETHERNET	1
-
-/****************************************************************************/
-
-/* Selected BOOTP/DHCP option types (RFC 2132, etc.). */
-enum
-{
-	OPTION_TYPE_PAD=0,
-	OPTION_TYPE_SUBNET_MASK=1,
-	OPTION_TYPE_GATEWAY=3,
-	OPTION_TYPE_DNS=6,
-	OPTION_TYPE_DOMAIN_NAME=15,
-	OPTION_TYPE_INTERFACE_MTU=26,
-	OPTION_TYPE_BROADCAST_ADDRESS=28,
-	OPTION_TYPE_PERFORM_ROUTER_DISCOVERY=31,
-	OPTION_TYPE_STATIC_ROUTE=33,
-	OPTION_TYPE_NTP_SERVERS=42,
-	OPTION_TYPE_NETBIOS_OVER_TCP_IP_NAME_SERVER=44,
-	OPTION_TYPE_NETBIOS_OVER_TCP_IP_NODE_TYPE=46,
-	OPTION_TYPE_NETBIOS_OVER_TCP_IP_SCOPE=47,
-	OPTION_TYPE_IP_ADDRESS_LEASE_TIME=51,
-	OPTION_TYPE_DHCP_MESSAGE_TYPE=53,
-	OPTION_TYPE_SERVER_IDENTIFIER=54,
-	OPTION_TYPE_PARAMETER_REQUEST_LIST=55,
-	OPTION_TYPE_MESSAGE=56,
-	OPTION_TYPE_MAXIMUM_DHCP_MESSAGE_SIZE=57,
-	OPTION_TYPE_RENEWAL_TIME=58,
-	OPTION_TYPE_REBINDING_TIME=59,
-	OPTION_TYPE_LDAP_URL=95,
-	OPTION_TYPE_AUTO_CONFIGURE=116,
-	OPTION_TYPE_DOMAIN_SEARCH=119,
-	OPTION_TYPE_CLASSLESS_STATIC_ROUTE=121,
-	OPTION_TYPE_PROXY_AUTODISCOVERY=252,
-	OPTION_TYPE_END=255
-};
-
-/****************************************************************************/
-
-/* DHCP message types (RFC 1531, etc.). */
-enum
-{
-	MESSAGE_TYPE_DISCOVER=1,
-	MESSAGE_TYPE_OFFER=2,
-	MESSAGE_TYPE_REQUEST=3,
-	MESSAGE_TYPE_DECLINE=4,
-	MESSAGE_TYPE_ACK=5,
-	MESSAGE_TYPE_NAK=6,
-	MESSAGE_TYPE_RELEASE=7,
-	MESSAGE_TYPE_INFORM=8
-};
-
-/****************************************************************************/
-
-/* DHCP server and client port numbers. Actually, these
- * are really the BOOTP port numbers (RFC 951). We use
- * these values only as fallbacks if the "bootp" entries
- * are missing from the network database.
+/* What a DHCP server offered, boiled down to the server identity and a
+ * hash of the offer contents. In monitoring mode these are compared from
+ * one scan to the next in order to find out if anything changed.
  */
-enum
-{
-	DEFAULT_BOOTP_SERVER_PORT=67,
-	DEFAULT_BOOTP_CLIENT_PORT=68
-};
-
-/****************************************************************************/
-
-/* Magic cookie stored in the vendor-specific area (RFC 1048, etc.),
- * identifying the contents and structure of the data following
- * it. */
-#define DHCP_MAGIC_COOKIE 0x63825363
-
-/****************************************************************************/
-
-/* Stores a key and its associated value string. */
-struct kv_node
+struct server_fingerprint
 {
-	struct Node	node;
-	char *		key;
-	char *		value;
+	uint8_t		server_ipv4_address[4];
+	uint8_t		server_mac_address[ETHER_ADDR_LEN];
+	uint64_t	offer_hash;
 };
 
-/****************************************************************************/
-
-/* Store DHCP server response data; the server is uniquely identified
- * by the pair of its IPv4 and MAC address.
+/* What the writer thread needs to know about a DHCP server response in
+ * order to print it while the scan is still running.
  */
-struct dhcp_server_response_data
+struct stream_record
 {
-	struct Node		node;
-
 	struct timeval	stamp;
 	uint8_t			server_ipv4_address[4];
 	uint8_t			server_mac_address[ETHER_ADDR_LEN];
-
-	struct List		dhcp_response;
-	struct List		dhcp_option;
+	uint8_t			offered_ipv4_address[4];
+	char			interface_name[IF_NAMESIZE];
 };
 
-/****************************************************************************/
-
-/* Generic Ethernet broadcast group address. */
-const uint8_t broadcast_mac_address[ETHER_ADDR_LEN] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
-
-/* This is where the MAC address of the interface will be stored which the
- * DHCP message will be sent through.
- */
-uint8_t client_mac_address[ETHER_ADDR_LEN];
+/* How many DHCP server responses may be waiting to be printed. */
+#define STREAM_RING_CAPACITY 4096
 
-/****************************************************************************/
-
-/* Filled in with the BOOTP server and client port numbers. */
-uint16_t dhcp_server_port;
-uint16_t dhcp_client_port;
+/* How many DHCP server responses the writer thread prints in one go. */
+#define STREAM_BATCH_SIZE 64
 
 /****************************************************************************/
 
-struct List dhcp_server_response_list;
-uint32_t transaction_id;
-pcap_t * pcap_handle;
-const char * interface_name;
-jmp_buf alarm_jmp_buf;
+struct dhcp_scan ** scans;
+int num_scans;
+int num_scans_failed;
+struct scan_scheduler * scan_scheduler;
 const char * command_name;
+struct allowlist * allowlist;
+struct allowlist_watch * allowlist_watch;
+struct offer_filter * offer_filter;
+struct history * history;
+struct shared_results * shared_results;
+struct record_ring * stream_ring;
+struct offer_dump * offer_dump;
 
 /****************************************************************************/
 
@@ -267,55 +126,102 @@ bool opt_audible = false;
 bool opt_verbose = false;
 bool opt_quiet = false;
 bool opt_ignore_checksums = false;
+bool opt_monitor = false;
+bool opt_stream = false;
+int opt_concurrency = SCAN_SCHEDULER_DEFAULT_MAX_RUNNING;
+int opt_pace = 0;
+const struct capture_backend * opt_capture_backend = NULL;
+bool opt_low_latency = false;
+int opt_busy_poll = 0;
 
 /****************************************************************************/
 
-/* Prints the collected DHCP server responses, along with the DHCP
- * options transmitted.
+/* Convert a time stamp into ISO 8601 format, with second accuracy. */
+static void
+format_time_stamp(time_t stamp,char * buffer,size_t buffer_size)
+{
+	strftime(buffer,buffer_size,"%Y-%m-%dT%H:%M:%S%z",localtime(&stamp));
+}
+
+/****************************************************************************/
+
+/* Convert the date and time at which a DHCP server response arrived
+ * into ISO 8601 format, which covers microsecond accuracy. This may be
+ * called by the writer thread, too.
  */
 static void
-print_dhcp_server_data(void)
+format_time_received(const struct timeval * stamp,char * buffer,size_t buffer_size)
 {
-	struct dhcp_server_response_data * data;
-	struct kv_node * kvn;
-	const struct tm * converted_time;
+	struct tm converted_time;
 	char date_time_string[24];
 	char microsecond_string[10];
 	char time_zone_string[8];
-	bool printed = false;
 
-	for(data = (struct dhcp_server_response_data *)get_list_head(&dhcp_server_response_list) ;
+	localtime_r(&stamp->tv_sec,&converted_time);
+
+	/* Date and time without seconds. */
+	strftime(date_time_string,sizeof(date_time_string),"%Y-%m-%dT%H:%M",&converted_time);
+
+	/* Seconds with fractions (microseconds). */
+	snprintf(microsecond_string,sizeof(microsecond_string),"%02.6g",
+		(double)converted_time.tm_sec + ((double)stamp->tv_usec) / 1000000.0);
+
+	/* Just one significant digit? This should not happen, but it does :-( */
+	if(microsecond_string[1] == '.')
+	{
+		/* Prepend a leading '0'. */
+		memmove(&microsecond_string[1],microsecond_string,strlen(microsecond_string)+1);
+		microsecond_string[0] = '0';
+	}
+
+	/* Time zone offset. */
+	strftime(time_zone_string,sizeof(time_zone_string),"%z",&converted_time);
+
+	snprintf(buffer,buffer_size,"%s:%s%s",date_time_string,microsecond_string,time_zone_string);
+}
+
+/****************************************************************************/
+
+/* Prints the collected DHCP server responses, along with the DHCP
+ * options transmitted. Responses which the baseline already knew
+ * about are omitted. If anything was printed before, the responses
+ * are set apart from it by a blank line. Returns true if anything was
+ * printed, now or before.
+ */
+static bool
+print_dhcp_server_data(const struct List * offer_list,bool printed)
+{
+	struct dhcp_offer * data;
+	struct kv_node * kvn;
+	char time_received_string[48];
+	char first_seen_string[32];
+
+	for(data = (struct dhcp_offer *)get_list_head(offer_list) ;
 		data != NULL ;
-		data = (struct dhcp_server_response_data *)get_next_node(&data->node))
+		data = (struct dhcp_offer *)get_next_node(&data->node))
 	{
+		if(data->baseline_status == BASELINE_STATUS_UNCHANGED)
+			continue;
+
 		if(printed)
 			printf("\n");
 
-		/* Convert the date and time at which the DHCP server response
-		 * arrived into ISO 8601 format, which covers microsecond
-		 * accuracy.
-		 */
-		converted_time = localtime(&data->stamp.tv_sec);
-
-		/* Date and time without seconds. */
-		strftime(date_time_string,sizeof(date_time_string),"%Y-%m-%dT%H:%M",converted_time);
+		format_time_received(&data->stamp,time_received_string,sizeof(time_received_string));
 
-		/* Seconds with fractions (microseconds). */
-		snprintf(microsecond_string,sizeof(microsecond_string),"%02.6g",
-			(double)converted_time->tm_sec + ((double)data->stamp.tv_usec) / 1000000.0);
+		printf("time-received=%s\n",time_received_string);
 
-		/* Just one significant digit? This should not happen, but it does :-( */
-		if(microsecond_string[1] == '.')
+		/* What changed since the last run? */
+		if(data->baseline_status == BASELINE_STATUS_NEW)
 		{
-			/* Prepend a leading '0'. */
-			memmove(&microsecond_string[1],microsecond_string,strlen(microsecond_string)+1);
-			microsecond_string[0] = '0';
+			printf("baseline-status=new\n");
 		}
+		else if (data->baseline_status == BASELINE_STATUS_CHANGED)
+		{
+			format_time_stamp(data->first_seen,first_seen_string,sizeof(first_seen_string));
 
-		/* Time zone offset. */
-		strftime(time_zone_string,sizeof(time_zone_string),"%z",converted_time);
-
-		printf("time-received=%s:%s%s\n",date_time_string,microsecond_string,time_zone_string);
+			printf("baseline-status=changed\n");
+			printf("first-seen=%s\n",first_seen_string);
+		}
 
 		/* General response information. */
 		for(kvn = (struct kv_node *)get_list_head(&data->dhcp_response) ;
@@ -325,6 +231,18 @@ print_dhcp_server_data(void)
 			printf("%s=%s\n",kvn->key,kvn->value);
 		}
 
+		/* Did the server respond more than once? */
+		if(data->duplicates.count > 0)
+		{
+			format_time_received(&data->duplicates.last_stamp,time_received_string,sizeof(time_received_string));
+
+			printf("duplicate-responses=%lu\n",data->duplicates.count);
+			printf("last-time-received=%s\n",time_received_string);
+			printf("duplicate-interval-minimum=%.6f\n",data->duplicates.minimum_interval / 1000000.0);
+			printf("duplicate-interval-average=%.6f\n",(data->duplicates.total_interval / (double)data->duplicates.count) / 1000000.0);
+			printf("duplicate-interval-maximum=%.6f\n",data->duplicates.maximum_interval / 1000000.0);
+		}
+
 		/* BOOTP/DHCP options. */
 		for(kvn = (struct kv_node *)get_list_head(&data->dhcp_option) ;
 			kvn != NULL ;
@@ -335,1767 +253,1611 @@ print_dhcp_server_data(void)
 
 		printed = true;
 	}
+
+	return(printed);
 }
 
 /****************************************************************************/
 
-/* Check if we already keep track of a specific DHCP server, which uses
- * a known combination of IPv4 address and MAC address. Returns NULL
- * if no such DHCP server has been recorded yet.
+/* Prints the DHCP server responses collected on all the network
+ * interfaces, as print_dhcp_server_data() does. Returns true if anything
+ * was printed.
  */
-static struct dhcp_server_response_data *
-find_dhcp_server_data(const uint8_t * server_ipv4_address, const uint8_t * server_mac_address)
+static bool
+print_all_dhcp_server_data(void)
 {
-	struct dhcp_server_response_data * result = NULL;
-	struct dhcp_server_response_data * data;
+	bool printed = false;
+	int i;
 
-	for(data = (struct dhcp_server_response_data *)get_list_head(&dhcp_server_response_list) ;
-		data != NULL ;
-		data = (struct dhcp_server_response_data *)get_next_node(&data->node))
-	{
-		if(memcmp(data->server_ipv4_address,server_ipv4_address,sizeof(data->server_ipv4_address)) == 0 &&
-		   memcmp(data->server_mac_address,server_mac_address,sizeof(data->server_mac_address)) == 0)
-		{
-			result = data;
-			break;
-		}
-	}
+	for(i = 0 ; i < num_scans ; i++)
+		printed = print_dhcp_server_data(get_dhcp_scan_offers(scans[i]),printed);
 
-	return(result);
+	return(printed);
 }
 
 /****************************************************************************/
 
-/* Add a record for a DHCP server with given IPv4 address and MAC address. Returns
- * NULL if not enough memory available.
- */
-static struct dhcp_server_response_data *
-create_dhcp_server_data(const uint8_t * server_ipv4_address, const uint8_t * server_mac_address)
+/* Count the DHCP server responses collected on all the network interfaces. */
+static int
+get_num_offers(void)
 {
-	struct dhcp_server_response_data * result = NULL;
-	struct dhcp_server_response_data * data;
-
-	data = calloc(1,sizeof(*data));
-	if(data == NULL)
-		goto out;
-
-	gettimeofday(&data->stamp, NULL);
-
-	memmove(data->server_ipv4_address,server_ipv4_address,sizeof(data->server_ipv4_address));
-	memmove(data->server_mac_address,server_mac_address,sizeof(data->server_mac_address));
-
-	new_list(&data->dhcp_response);
-	new_list(&data->dhcp_option);
-
-	add_node_to_list_tail(&dhcp_server_response_list, &data->node);
-
-	result = data;
-	data = NULL;
+	int result = 0;
+	int i;
 
-out:
+	for(i = 0 ; i < num_scans ; i++)
+		result += get_dhcp_scan_num_offers(scans[i]);
 
 	return(result);
 }
 
 /****************************************************************************/
 
-/* Release memory allocated by create_kv_node(). This is safe to call
- * even if create_kv_node() failed.
+/* Prints the DHCP server responses recorded so far, in the same form as
+ * in monitoring mode. This is called by the dumper thread on request,
+ * while the scan goes on.
  */
 static void
-delete_kv_node(struct kv_node * kvn)
+dump_dhcp_server_data(const struct List * offer_list,void * user_data __attribute__((unused)))
 {
-	if(kvn != NULL)
-	{
-		if(kvn->key != NULL)
-			free(kvn->key);
+	const struct Node * node;
+	int num_servers = 0;
+
+	for(node = get_list_head(offer_list) ; node != NULL ; node = get_next_node(node))
+		num_servers++;
 
-		if(kvn->value != NULL)
-			free(kvn->value);
+	/* Keep the output of the writer thread from getting mixed up with this. */
+	flockfile(stdout);
 
-		free(kvn);
+	printf("number-of-servers=%d\n",num_servers);
+
+	if(num_servers > 0)
+	{
+		printf("\n");
+		print_dhcp_server_data(offer_list,false);
 	}
+
+	printf("\n");
+	fflush(stdout);
+
+	funlockfile(stdout);
 }
 
 /****************************************************************************/
 
-/* Allocate memory for a key-value record, with the key value
- * generated from a printf() style format spec. Returns NULL
- * in case of error.
+/* Prints a DHCP server which responded in the previous run, but not in
+ * this one. This is a callback function invoked by finish_baseline_run().
  */
-static struct kv_node *
-create_kv_node(const char * key,const char * string_format,va_list args)
+static void
+print_vanished_server(const struct baseline_server * server,void * user_data)
 {
-	struct kv_node * result = NULL;
-	struct kv_node * kvn;
+	bool * printed = user_data;
+	char first_seen_string[32];
+	char last_seen_string[32];
 
-	kvn = calloc(1,sizeof(*kvn));
-	if(kvn == NULL)
-		goto out;
+	if(opt_quiet)
+		return;
 
-	kvn->key = strdup(key);
-	if(kvn->key == NULL)
-		goto out;
+	if((*printed))
+		printf("\n");
 
-	if(vasprintf(&kvn->value,string_format,args) < 0)
-		goto out;
+	format_time_stamp(server->first_seen,first_seen_string,sizeof(first_seen_string));
+	format_time_stamp(server->last_seen,last_seen_string,sizeof(last_seen_string));
 
-	result = kvn;
-	kvn = NULL;
+	printf("baseline-status=vanished\n");
+	printf("network-interface=%s\n",server->interface_name);
 
-out:
+	printf("server-ipv4-address=%u.%u.%u.%u\n",
+		server->server_ipv4_address[0],
+		server->server_ipv4_address[1],
+		server->server_ipv4_address[2],
+		server->server_ipv4_address[3]);
 
-	if(kvn != NULL)
-		delete_kv_node(kvn);
+	printf("server-mac-address=%02x:%02x:%02x:%02x:%02x:%02x\n",
+		server->server_mac_address[0],
+		server->server_mac_address[1],
+		server->server_mac_address[2],
+		server->server_mac_address[3],
+		server->server_mac_address[4],
+		server->server_mac_address[5]);
 
-	return(result);
+	printf("first-seen=%s\n",first_seen_string);
+	printf("last-seen=%s\n",last_seen_string);
+
+	(*printed) = true;
 }
 
 /****************************************************************************/
 
-/* Remember a DHCP server response, with given name. The response value is
- * stored as a string, using the printf() style formatting provided.
+/* Order server fingerprints by IPv4 address, MAC address and offer hash,
+ * for use with qsort().
  */
-struct kv_node * __attribute__ ((format (printf, 3, 4)))
-add_dhcp_response(struct dhcp_server_response_data * data,const char * key,const char * string_format,...)
+static int
+compare_server_fingerprints(const void * a,const void * b)
 {
-	struct kv_node * result = NULL;
-	struct kv_node * kvn;
-	va_list args;
-
-	va_start(args, string_format);
-	kvn = create_kv_node(key,string_format,args);
-	va_end(args);
-
-	if(kvn == NULL)
-		goto out;
-
-	add_node_to_list_tail(&data->dhcp_response, &kvn->node);
+	const struct server_fingerprint * fa = a;
+	const struct server_fingerprint * fb = b;
+	int result;
 
-	result = kvn;
+	result = memcmp(fa->server_ipv4_address,fb->server_ipv4_address,sizeof(fa->server_ipv4_address));
+	if(result == 0)
+		result = memcmp(fa->server_mac_address,fb->server_mac_address,sizeof(fa->server_mac_address));
 
-out:
+	if(result == 0 && fa->offer_hash != fb->offer_hash)
+		result = (fa->offer_hash < fb->offer_hash) ? -1 : 1;
 
 	return(result);
 }
 
 /****************************************************************************/
 
-/* Remember a DHCP option, with given option name. The option value is
- * stored as a string, using the printf() style formatting provided.
+/* Build a sorted table of the (server, offer hash) pairs collected so far.
+ * The table must be freed eventually. Returns -1 if not enough memory is
+ * available, 0 otherwise.
  */
-struct kv_node * __attribute__ ((format (printf, 3, 4)))
-add_dhcp_option(struct dhcp_server_response_data * data,const char * key,const char * string_format,...)
+static int
+get_server_fingerprints(struct server_fingerprint ** table_ptr,int * table_size_ptr)
 {
-	struct kv_node * result = NULL;
-	struct kv_node * kvn;
-	va_list args;
+	const struct dhcp_offer * data;
+	struct server_fingerprint * table = NULL;
+	int table_size;
+	int result = -1;
+	int i, j;
 
-	va_start(args, string_format);
-	kvn = create_kv_node(key,string_format,args);
-	va_end(args);
+	table_size = get_num_offers();
 
-	if(kvn == NULL)
-		goto out;
+	if(table_size > 0)
+	{
+		table = calloc(table_size,sizeof(*table));
+		if(table == NULL)
+			goto out;
+
+		for(i = j = 0 ; j < num_scans ; j++)
+		{
+			for(data = (struct dhcp_offer *)get_list_head(get_dhcp_scan_offers(scans[j])) ;
+				data != NULL ;
+				i++, data = (struct dhcp_offer *)get_next_node(&data->node))
+			{
+				memmove(table[i].server_ipv4_address,data->server_ipv4_address,sizeof(table[i].server_ipv4_address));
+				memmove(table[i].server_mac_address,data->server_mac_address,sizeof(table[i].server_mac_address));
+
+				table[i].offer_hash = data->offer_hash;
+			}
+		}
+
+		qsort(table,table_size,sizeof(*table),compare_server_fingerprints);
+	}
 
-	add_node_to_list_tail(&data->dhcp_option, &kvn->node);
+	(*table_ptr) = table;
+	(*table_size_ptr) = table_size;
 
-	result = kvn;
+	result = 0;
 
-out:
+ out:
 
 	return(result);
 }
 
 /****************************************************************************/
 
-/*
- * Get MAC address of given link(dev_name)
+/* Check if two sorted server fingerprint tables describe the same set
+ * of servers and offers.
  */
-static int
-get_mac_address_and_mtu(const char *dev_name, uint8_t *mac_address, int * mtu)
+static bool
+same_server_fingerprints(const struct server_fingerprint * a,int a_size,
+	const struct server_fingerprint * b,int b_size)
 {
-	int result = -1;
-	struct ifreq ifr;
-	int fd;
+	bool result = false;
+	int i;
 
-	fd = socket(PF_INET, SOCK_DGRAM, IPPROTO_IP);
-	if(fd == -1)
+	if(a_size != b_size)
 		goto out;
 
-	memset(&ifr,0,sizeof(ifr));
-	strncpy(ifr.ifr_name, dev_name, sizeof(ifr.ifr_name));
+	for(i = 0 ; i < a_size ; i++)
+	{
+		if(compare_server_fingerprints(&a[i],&b[i]) != 0)
+			goto out;
+	}
 
-	if(ioctl(fd, SIOCGIFMTU, &ifr) == -1)
-		goto out;
+	result = true;
 
-	(*mtu) = ifr.ifr_mtu;
+ out:
 
-	#if defined(__linux__)
-	{
-		memset(&ifr,0,sizeof(ifr));
-		strncpy(ifr.ifr_name, dev_name, sizeof(ifr.ifr_name));
+	return(result);
+}
 
-		if(ioctl(fd, SIOCGIFHWADDR, &ifr) == -1)
-			goto out;
+/****************************************************************************/
 
-		memmove(mac_address, ifr.ifr_addr.sa_data, ETHER_ADDR_LEN);
-	}
-	#else
-	{
-		struct ifaddrs *ifap, *p;
+/* Prints the DHCP server responses which the capture thread hands over
+ * through the stream ring, in batches, until the ring is closed. This
+ * runs in its own thread, so that a slow reader of the output holds up
+ * only this thread and not the capture of the responses.
+ */
+static void *
+stream_writer(void * user_data __attribute__((unused)))
+{
+	struct stream_record records[STREAM_BATCH_SIZE];
+	const struct stream_record * record;
+	char time_received_string[48];
+	size_t num_records,i;
+	bool closed;
 
-		if (getifaddrs(&ifap) != 0)
-			goto out;
+	while(true)
+	{
+		/* Check for closing before popping the records, so that
+		 * none of the last records are missed.
+		 */
+		closed = is_record_ring_closed(stream_ring);
 
-		for (p = ifap ; p != NULL ; p = p->ifa_next)
+		num_records = pop_records(stream_ring,records,STREAM_BATCH_SIZE);
+		if(num_records == 0)
 		{
-			/* Check the device name */
-			if (strcmp(p->ifa_name, dev_name) == 0 && p->ifa_addr->sa_family == AF_LINK)
-			{
-				const struct sockaddr_dl * sdp;
+			if(closed)
+				break;
 
-				sdp = (struct sockaddr_dl *)p->ifa_addr;
-				memmove(mac_address, sdp->sdl_data + sdp->sdl_nlen, ETHER_ADDR_LEN);
+			wait_for_records(stream_ring);
+			continue;
+		}
 
-				break;
-			}
+		for(i = 0 ; i < num_records ; i++)
+		{
+			record = &records[i];
+
+			format_time_received(&record->stamp,time_received_string,sizeof(time_received_string));
+
+			printf("time-received=%s\n"
+				"network-interface=%s\n"
+				"server-ipv4-address=%u.%u.%u.%u\n"
+				"server-mac-address=%02x:%02x:%02x:%02x:%02x:%02x\n"
+				"offered-ipv4-address=%u.%u.%u.%u\n"
+				"\n",
+				time_received_string,
+				record->interface_name,
+				record->server_ipv4_address[0],record->server_ipv4_address[1],
+				record->server_ipv4_address[2],record->server_ipv4_address[3],
+				record->server_mac_address[0], record->server_mac_address[1], record->server_mac_address[2],
+				record->server_mac_address[3], record->server_mac_address[4], record->server_mac_address[5],
+				record->offered_ipv4_address[0],record->offered_ipv4_address[1],
+				record->offered_ipv4_address[2],record->offered_ipv4_address[3]);
 		}
 
-		freeifaddrs(ifap);
+		fflush(stdout);
 	}
-	#endif
-
-	result = 0;
 
-out:
-
-	if(fd != -1)
-		close(fd);
-
-	return(result);
+	return(NULL);
 }
 
 /****************************************************************************/
 
-/*
- * Return checksum for the given data.
- * Copied from FreeBSD
+/* Called for each DHCP server response received. Rings the bell and
+ * reports the responses which could not be recorded. In streaming mode
+ * the responses recorded are handed over to the writer thread, without
+ * waiting for it to catch up. Duplicate responses have already been
+ * counted by the scan, and are reported only along with the first
+ * response, once the scan is complete.
  */
-static unsigned short
-in_cksum(const void *_addr, int nleft)
+static void
+offer_received(const struct dhcp_offer * offer,int what,void * user_data __attribute__((unused)))
 {
-	const uint16_t *w = _addr;
-	int sum = 0;
-	uint16_t answer = 0;
-
-	/*
-	 * Our algorithm is simple, using a 32 bit accumulator (sum), we add
-	 * sequential 16 bit words to it, and at the end, fold back all the
-	 * carry bits from the top 16 bits into the lower 16 bits.
-	 */
-	while (nleft > 1)
+	if(what == DHCP_SCAN_OFFER_DUPLICATE)
+		return;
+
+	/* Ring the bell for each response? */
+	if(opt_audible)
 	{
-		sum += *w++;
-		nleft -= 2;
+		/* BEL = Ctrl+G */
+		fputc('G' & 0x1F,stderr);
+
+		/* stderr should be unbuffered, but you never know... */
+		fflush(stderr);
 	}
 
-	/* mop up an odd byte, if necessary */
-	if (nleft == 1)
+	if(what == DHCP_SCAN_OFFER_RECORDED && stream_ring != NULL)
 	{
-		*(uint8_t *)&answer = *(const uint8_t *)w;
-		sum += answer;
-	}
+		struct stream_record record;
 
-	/* add back carry outs from top 16 bits to low 16 bits */
-	sum = (sum >> 16) + (sum & 0xffff);	/* add hi 16 to low 16 */
-	sum += (sum >> 16);	/* add carry */
-	answer = ~sum;	/* truncate to 16 bits */
+		record.stamp = offer->stamp;
+		memmove(record.server_ipv4_address,offer->server_ipv4_address,sizeof(record.server_ipv4_address));
+		memmove(record.server_mac_address,offer->server_mac_address,sizeof(record.server_mac_address));
+		memmove(record.offered_ipv4_address,offer->offered_ipv4_address,sizeof(record.offered_ipv4_address));
+		strcpy(record.interface_name,offer->interface_name);
 
-	return (answer);
+		/* If the ring is full, the response is counted as an overflow. */
+		push_record(stream_ring,&record);
+	}
+	else if (what == DHCP_SCAN_OFFER_NO_MEMORY && !opt_quiet)
+	{
+		fprintf(stderr,"%s: Not enough memory to record response from DHCP server at "
+			"IPv4 address %u.%u.%u.%u/"
+			"MAC address %02x:%02x:%02x:%02x:%02x:%02x.\n",
+			command_name,
+			offer->server_ipv4_address[0],offer->server_ipv4_address[1],
+			offer->server_ipv4_address[2],offer->server_ipv4_address[3],
+			offer->server_mac_address[0], offer->server_mac_address[1], offer->server_mac_address[2],
+			offer->server_mac_address[3], offer->server_mac_address[4], offer->server_mac_address[5]);
+	}
 }
 
 /****************************************************************************/
 
-/* Search the DHCP options for the DHCP message type and then return it.
- * Returns -1 if no DHCP message type could be found.
+/* Swap in a new allowlist if the allowlist file changed and has been
+ * reloaded in the background. The old allowlist can be released right
+ * away because it is used only by dispatch_dhcp_scan(), in this same
+ * thread.
  */
-static int
-get_dhcp_message_type(const uint8_t * vendor_options,int vendor_options_length)
+static void
+check_for_allowlist_update(const struct pollfd * pfd)
 {
-	int option_type,option_length;
-	int result = -1;
-	int pos;
+	struct allowlist * new_allowlist;
+	struct allowlist * old_allowlist;
+	char error_buffer[256];
+	int i;
 
-	for(pos = 0 ; pos < vendor_options_length ; (void)NULL)
+	new_allowlist = check_allowlist_watch(allowlist_watch,pfd,error_buffer,sizeof(error_buffer));
+	if(new_allowlist != NULL)
 	{
-		option_type = vendor_options[pos++];
-
-		/* Padding is simply skipped. */
-		if(option_type == OPTION_TYPE_PAD)
-			continue;
+		old_allowlist = allowlist;
+		allowlist = new_allowlist;
 
-		/* We stop at the end marker, or if we reach the end of the option buffer. */
-		if(option_type == OPTION_TYPE_END || pos == vendor_options_length)
-			break;
+		for(i = 0 ; i < num_scans ; i++)
+			set_dhcp_scan_allowlist(scans[i],allowlist);
 
-		/* We stop when we reach the end of the option buffer. */
-		option_length = vendor_options[pos++];
-		if(pos == vendor_options_length)
-			break;
+		delete_allowlist(old_allowlist);
 
-		if(option_type == OPTION_TYPE_DHCP_MESSAGE_TYPE)
+		if(opt_verbose)
 		{
-			result = vendor_options[pos];
-			break;
+			printf("%s: Reloaded %zu known DHCP servers.\n",command_name,get_allowlist_size(allowlist));
+			fflush(stdout);
 		}
-
-		pos += option_length;
 	}
-
-	return(result);
+	else if (error_buffer[0] != '\0' && !opt_quiet)
+	{
+		fprintf(stderr,"%s: Unable to reload allowlist file (%s); keeping the previous version.\n",
+			command_name,error_buffer);
+	}
 }
 
 /****************************************************************************/
 
-/* Decode classless static route information (RFC 3442) into a text buffer. */
-static int decode_classless_static_route(const uint8_t * option_data, int option_length,
-	char * text_buffer, size_t text_buffer_size)
+/* Called as soon as the scan on one of the network interfaces is done.
+ * This is a callback function invoked by dispatch_scan_scheduler().
+ */
+static void
+scan_finished(const struct scheduled_scan_report * report,void * user_data __attribute__((unused)))
 {
-	int num_destination_octets;
-	uint8_t destination_octets[4];
-	uint8_t route_octets[4];
-	int num_routes_decoded = 0;
-	char decoded_route_buffer[256];
-	int decoded_route_buffer_len;
-	size_t len = 0;
-	int result = -1;
-	int pos;
-	int i;
-
-	/* One off for NUL-termination. */
-	if(text_buffer_size > 0)
-		text_buffer_size--;
+	struct dhcp_scan_stats stats;
 
-	for(pos = 0 ; pos < option_length ; )
+	if(report->error != NULL)
 	{
-		/* First octet states subnet mask. This must
-		 * be a value in the range 0-4.
-		 */
-		num_destination_octets = option_data[pos++];
-		if(num_destination_octets > 4)
-			goto out;
-
-		/* Number of octets to follow must be in the
-		 * buffer provided, not beyond it.
-		 */
-		if(pos + num_destination_octets > option_length)
-			goto out;
-
-		/* Copy the significant octets, then fill up
-		 * the remainder with zeroes.
-		 */
-		for(i = 0 ; i < num_destination_octets ; i++)
-			destination_octets[i] = option_data[pos++];
-
-		for( ; i < 4 ; i++)
-			destination_octets[i] = 0;
-
-		/* The router address must be in the buffer. */
-		if(pos + 4 > option_length)
-			goto out;
+		num_scans_failed++;
 
-		for(i = 0 ; i < 4 ; i++)
-			route_octets[i] = option_data[pos++];
-
-		/* No destination given? Then decode only the router address. */
-		if (num_destination_octets == 0)
+		if(!opt_quiet)
 		{
-			decoded_route_buffer_len = snprintf(decoded_route_buffer,sizeof(decoded_route_buffer),
-				"%u.%u.%u.%u",
-				route_octets[0],route_octets[1],
-				route_octets[2],route_octets[3]);
+			fprintf(stderr,"%s: Unable to scan network interface %s: %s.\n",command_name,
+				get_dhcp_scan_interface_name(report->scan),report->error);
 		}
-		/* 32 bit subnet mask given? Then omit the subnet mask from the decoded output. */
-		else if (num_destination_octets == 4)
+	}
+	else if (opt_verbose)
+	{
+		if(report->have_first_offer)
 		{
-			decoded_route_buffer_len = snprintf(decoded_route_buffer,sizeof(decoded_route_buffer),
-				"%u.%u.%u.%u -> %u.%u.%u.%u",
-				destination_octets[0],destination_octets[1],
-				destination_octets[2],destination_octets[3],
-				route_octets[0],route_octets[1],
-				route_octets[2],route_octets[3]);
+			printf("%s: Scanned network interface %s in %.3f seconds; %d DHCP servers responded, the first after %.3f seconds.\n",
+				command_name,get_dhcp_scan_interface_name(report->scan),report->duration,
+				get_dhcp_scan_num_offers(report->scan),report->first_offer_latency);
 		}
-		/* Default case: decode destination address and subnet size, as well
-		 * as the router address.
-		 */
 		else
 		{
-			decoded_route_buffer_len = snprintf(decoded_route_buffer,sizeof(decoded_route_buffer),
-				"%u.%u.%u.%u/%d -> %u.%u.%u.%u",
-				destination_octets[0],destination_octets[1],
-				destination_octets[2],destination_octets[3],
-				num_destination_octets * 8,
-				route_octets[0],route_octets[1],
-				route_octets[2],route_octets[3]);
-		}
-
-		assert( decoded_route_buffer_len > 0 );
-
-		/* If more than one single destination/subnet/router
-		 * was provided, separate the output by adding a
-		 * command and a blank space.
-		 */
-		if(len > 0)
-		{
-			/* Buffer overflow? */
-			if(len + 2 > text_buffer_size)
-				goto out;
-
-			text_buffer[len++] = ',';
-			text_buffer[len++] = ' ';
+			printf("%s: Scanned network interface %s in %.3f seconds; no DHCP server responded.\n",
+				command_name,get_dhcp_scan_interface_name(report->scan),report->duration);
 		}
 
-		/* Buffer overflow? */
-		if(len + decoded_route_buffer_len > text_buffer_size)
-			goto out;
-
-		memmove(&text_buffer[len], decoded_route_buffer, decoded_route_buffer_len);
+		get_dhcp_scan_stats(report->scan,&stats);
 
-		len += decoded_route_buffer_len;
+		printf("%s: Network interface %s received %llu frames, of which %llu were processed and %llu were dropped by the kernel.\n",
+			command_name,get_dhcp_scan_interface_name(report->scan),(unsigned long long)stats.frames_received,
+			(unsigned long long)stats.frames_processed,(unsigned long long)stats.frames_dropped);
 
-		text_buffer[len] = '\0';
-
-		num_routes_decoded++;
+		fflush(stdout);
 	}
-
-	text_buffer[len] = '\0';
-
-	result = num_routes_decoded;
-
- out:
-
-	return(result);
 }
 
 /****************************************************************************/
 
-/* Decode static route information (RFC 1533) into a text buffer. */
-static int decode_static_route(const uint8_t * option_data, int option_length,
-	char * text_buffer, size_t text_buffer_size)
+/* Scan all the network interfaces, only so many at a time, and collect
+ * DHCP server responses until all the scans are complete. Any changes
+ * to the allowlist file are picked up while waiting, and the responses
+ * recorded so far are printed on request. Returns -1 if not enough
+ * memory is available, 0 otherwise.
+ */
+static int
+wait_for_dhcp_server_responses(void)
 {
-	int num_routes;
-	uint8_t destination_octets[4];
-	uint8_t route_octets[4];
-	int num_routes_decoded = 0;
-	char decoded_route_buffer[256];
-	int decoded_route_buffer_len;
-	size_t len = 0;
+	struct scan_clock * clock = get_scan_scheduler_clock(scan_scheduler);
+	struct pollfd * pfd = NULL;
+	int allowlist_watch_index = 0;
+	int offer_dump_index = 0;
+	int num_fds;
 	int result = -1;
-	int pos;
-	int i;
+	int n;
 
-	/* One off for NUL-termination. */
-	if(text_buffer_size > 0)
-		text_buffer_size--;
+	num_scans_failed = 0;
 
-	for(pos = 0 ; pos < option_length ; )
-	{
-		num_routes = option_data[pos++];
-		if(num_routes == 0)
-			break;
+	if(begin_scan_schedule(scan_scheduler,scans,num_scans,(uint32_t)rand(),opt_timeout) < 0)
+		goto out;
 
-		/* Number of octets to follow must be in the
-		 * buffer provided, not beyond it.
-		 */
-		if(pos + 4 + 4 > option_length)
-			goto out;
-
-		for(i = 0 ; i < 4 ; i++)
-			destination_octets[i] = option_data[pos++];
+	pfd = calloc(get_scan_scheduler_num_fds(scan_scheduler) + ALLOWLIST_WATCH_NUM_FDS + OFFER_DUMP_NUM_FDS,sizeof(*pfd));
+	if(pfd == NULL)
+		goto out;
 
-		for(i = 0 ; i < 4 ; i++)
-			route_octets[i] = option_data[pos++];
+	while(!is_scan_schedule_done(scan_scheduler))
+	{
+		num_fds = fill_scan_scheduler_pollfds(scan_scheduler,pfd);
 
-		decoded_route_buffer_len = snprintf(decoded_route_buffer,sizeof(decoded_route_buffer),
-			"%u.%u.%u.%u -> %u.%u.%u.%u",
-			destination_octets[0],destination_octets[1],
-			destination_octets[2],destination_octets[3],
-			route_octets[0],route_octets[1],
-			route_octets[2],route_octets[3]);
+		if(allowlist_watch != NULL)
+		{
+			allowlist_watch_index = num_fds;
+			num_fds += fill_allowlist_watch_pollfds(allowlist_watch,&pfd[num_fds]);
+		}
 
-		assert( decoded_route_buffer_len > 0 );
+		if(offer_dump != NULL)
+		{
+			offer_dump_index = num_fds;
+			num_fds += fill_offer_dump_pollfds(offer_dump,&pfd[num_fds]);
+		}
 
-		/* If more than one single destination/subnet/router
-		 * was provided, separate the output by adding a
-		 * command and a blank space.
-		 */
-		if(len > 0)
+		n = (*clock->poll)(clock,pfd,num_fds,get_scan_scheduler_poll_timeout(scan_scheduler));
+		if(n < 0)
 		{
-			/* Buffer overflow? */
-			if(len + 2 > text_buffer_size)
-				goto out;
+			if(errno == EINTR)
+				continue;
 
-			text_buffer[len++] = ',';
-			text_buffer[len++] = ' ';
+			if(!opt_quiet)
+				fprintf(stderr,"%s: Unable to wait for DHCP server responses: %s.\n",command_name,strerror(errno));
+
+			break;
 		}
 
-		/* Buffer overflow? */
-		if(len + decoded_route_buffer_len > text_buffer_size)
-			goto out;
+		/* The scans also need to check whether their time is up, and
+		 * new ones may have to be started.
+		 */
+		dispatch_scan_scheduler(scan_scheduler);
 
-		memmove(&text_buffer[len], decoded_route_buffer, decoded_route_buffer_len);
+		if(allowlist_watch != NULL)
+			check_for_allowlist_update(&pfd[allowlist_watch_index]);
 
-		len += decoded_route_buffer_len;
+		if(offer_dump != NULL && check_offer_dump(offer_dump,&pfd[offer_dump_index],scans,num_scans) < 0 && !opt_quiet)
+			fprintf(stderr,"%s: Unable to print the DHCP server responses received so far: %s.\n",command_name,strerror(errno));
+	}
 
-		text_buffer[len] = '\0';
+	if(opt_verbose)
+	{
+		printf("%s: Scanned %d network interfaces in %.3f seconds.\n",command_name,num_scans,
+			get_scan_schedule_duration(scan_scheduler));
 
-		num_routes_decoded++;
+		fflush(stdout);
 	}
 
-	text_buffer[len] = '\0';
+	result = 0;
 
-	result = num_routes_decoded;
+ out:
 
-out:
+	/* The scan results must be complete before they are used. */
+	if(offer_dump != NULL)
+		finish_offer_dump(offer_dump,scans,num_scans);
+
+	if(pfd != NULL)
+		free(pfd);
 
 	return(result);
 }
 
 /****************************************************************************/
 
-/* Convert the number of seconds given for lease time and renewal/rebinding
- * interval into more than just a single number, detailing minutes/hours/days.
+/* Convert the DHCP server responses collected into history records, which
+ * must be freed by the caller. Returns -1 if not enough memory is available,
+ * 0 otherwise.
  */
-static void
-convert_seconds_to_readable_form(uint32_t seconds,char * buffer,size_t buffer_size)
+static int
+get_history_records(struct history_record ** records_ptr,size_t * num_records_ptr)
 {
-	if(seconds < 60)
-	{
-		assert( buffer_size > 0 );
-		
-		strcpy(buffer,"");
-	}
-	else if (seconds < 60 * 60)
-	{
-		int minutes = seconds / 60;
+	struct dhcp_offer * data;
+	struct history_record * records = NULL;
+	struct history_record * record;
+	size_t num_records;
+	int result = -1;
+	int i;
 
-		snprintf(buffer,buffer_size,minutes > 1 ? " (%u:%02u minutes)" : " (%u:%02u minute)",
-			minutes,
-			seconds % 60);
-	}
-	else if (seconds < 24 * 60 * 60)
-	{
-		int hours = seconds / (60 * 60);
+	num_records = get_num_offers();
 
-		snprintf(buffer,buffer_size,hours > 1 ? " (%u:%02u:%02u hours)" : " (%u:%02u:%02u hour)",
-			hours,
-			(seconds / 60) % 60,
-			seconds % 60);
-	}
-	else
+	if(num_records > 0)
 	{
-		int days = seconds / (24 * 60 * 60);
-
-		snprintf(buffer,buffer_size,days > 1 ? " (%u:%02u:%02u:%02u days)" : " (%u:%02u:%02u:%02u day)",
-			days,
-			(seconds / (60 * 60)) % 24,
-			(seconds / 60) % 60,
-			seconds % 60);
+		records = calloc(num_records,sizeof(*records));
+		if(records == NULL)
+			goto out;
 	}
-}
-
-/****************************************************************************/
 
-/* Search for DHCP options of a specific type, aggregating their data into
- * a single consecutive memory buffer. Returns true if any DHCP options
- * could be found and a buffer was allocated for them, false otherwise.
- * The buffer allocated must be freed eventually.
- *
- * Aggregated option data is described in RFC 3396 ("Encoding long options
- * in the Dynamic Host Configuration Protocol (DHCPv4)").
- */
-static bool
-fill_aggregate_buffer_from_option(const uint8_t * vendor_options,int vendor_options_length,
-	int aggregate_option_type, uint8_t ** aggregate_buffer_ptr,size_t * aggregate_buffer_size_ptr)
-{
-	bool option_data_found = false;
-	uint8_t * aggregate_buffer = NULL;
-	size_t required_size = 0;
-	int option_type;
-	int option_length;
-	int output_pos;
-	int read_pos;
-	
-	assert( 0 < aggregate_option_type && aggregate_option_type < 255 );
-	assert( aggregate_buffer_ptr != NULL );
-	assert( aggregate_buffer_size_ptr != NULL );
-
-	/* Find out how much memory is required to store all
-	 * the data for a specific option type.
+	/* The responses are listed in the order in which they arrived on
+	 * each interface.
 	 */
-	for(read_pos = 0 ; read_pos < vendor_options_length ; (void)NULL)
+	for(i = 0, record = records ; i < num_scans ; i++)
 	{
-		option_type = vendor_options[read_pos++];
+		for(data = (struct dhcp_offer *)get_list_head(get_dhcp_scan_offers(scans[i])) ;
+			data != NULL ;
+			data = (struct dhcp_offer *)get_next_node(&data->node), record++)
+		{
+			record->time = data->stamp.tv_sec;
 
-		/* Skip the padding octet. */
-		if(option_type == OPTION_TYPE_PAD)
-			continue;
+			memmove(record->server_ipv4_address,data->server_ipv4_address,sizeof(record->server_ipv4_address));
+			memmove(record->server_mac_address,data->server_mac_address,sizeof(record->server_mac_address));
+			strncpy(record->interface_name,data->interface_name,sizeof(record->interface_name));
 
-		/* Stop at the end marker, or the end of the options buffer. */
-		if(option_type == OPTION_TYPE_END || read_pos == vendor_options_length)
-			break;
+			record->offer_hash = data->offer_hash;
+		}
+	}
 
-		option_length = vendor_options[read_pos++];
+	(*records_ptr) = records;
+	(*num_records_ptr) = num_records;
 
-		/* Stop at the end of the options buffer. */
-		if(read_pos == vendor_options_length)
-			break;
-		
-		if(option_type == aggregate_option_type)
-			required_size += option_length;
-	}
+	result = 0;
 
-	/* No option data found? Then we have failed... */
-	if(required_size == 0)
-		goto out;
+ out:
 
-	/* Allocate memory for storing the aggregated data in.
-	 * The buffer address and how much memory was allocated
-	 * will be provided to the caller.
-	 */
-	aggregate_buffer = malloc(required_size);
-	if(aggregate_buffer == NULL)
-		goto out;
-	
-	(*aggregate_buffer_ptr) = aggregate_buffer;
-	(*aggregate_buffer_size_ptr) = required_size;
-	
-	for(read_pos = output_pos = 0 ; read_pos < vendor_options_length ; (void)NULL)
-	{
-		option_type = vendor_options[read_pos++];
+	return(result);
+}
 
-		/* Skip the padding octet. */
-		if(option_type == OPTION_TYPE_PAD)
-			continue;
+/****************************************************************************/
 
-		/* Stop at the end marker, or the end of the options buffer. */
-		if(option_type == OPTION_TYPE_END || read_pos == vendor_options_length)
-			break;
+/* Add the DHCP server responses collected to the history. Returns -1 in
+ * case of error, with errno set, and 0 otherwise.
+ */
+static int
+record_history(void)
+{
+	struct history_record * records = NULL;
+	size_t num_records = 0;
+	int result = -1;
 
-		option_length = vendor_options[read_pos++];
+	if(get_history_records(&records,&num_records) < 0)
+		goto out;
 
-		/* Stop at the end of the options buffer. */
-		if(read_pos == vendor_options_length)
-			break;
-		
-		if(option_type == aggregate_option_type)
-		{
-			assert( output_pos + option_length <= (int)required_size );
-			
-			memmove(&aggregate_buffer[output_pos],&vendor_options[read_pos],option_length);
+	result = append_history(history,records,num_records);
 
-			read_pos += option_length;
-			output_pos += option_length;
-		}
-	}
-	
-	option_data_found = true;
-	
  out:
-	
-	return(option_data_found);
+
+	if(records != NULL)
+		free(records);
+
+	return(result);
 }
 
 /****************************************************************************/
 
-/* Find out how much space is required for storing a complete,
- * encoded domain name. The name either ends with a root marker
- * or a compression pointer (RFC 1035, section 4.1.4). Returns
- * number of octets used or 0 for buffer overflow/encoding
- * error.
+/* Send the DHCP server responses collected to the collector. Returns -1
+ * in case of error, with errno set, and 0 otherwise.
  */
-static size_t
-get_domain_name_size(const uint8_t * buffer,size_t buffer_size)
+static int
+report_to_collector(const char * socket_path)
 {
-	int length,compression;
-	size_t result = 0;
-	size_t pos;
-	
-	for(pos = 0 ; pos < buffer_size ; (void)NULL)
-	{
-		length = buffer[pos++];
-		if(length == 0)
-			break;
-
-		/* A label begins with a length field which
-		 * could also be a compression pointer.
-		 */
-		compression = length & 0xc0;
+	struct history_record * records = NULL;
+	size_t num_records = 0;
+	char sensor_name[COLLECTOR_SENSOR_NAME_SIZE];
+	int result = -1;
 
-		/* Is this a length field? */
-		if (compression == 0)
-		{
-			/* Check for buffer overflow. */
-			if(pos + length > buffer_size)
-				goto out;
+	/* Sensors are identified by their host names. */
+	if(gethostname(sensor_name,sizeof(sensor_name)) < 0)
+		goto out;
 
-			pos += length;
-		}
-		/* Is this a compression pointer? */
-		else if (compression == 0xc0)
-		{
-			/* Check for buffer overflow. */
-			if(pos == buffer_size)
-				goto out;
+	sensor_name[sizeof(sensor_name)-1] = '\0';
 
-			/* Domain name continues where the
-			 * compression pointer leads to.
-			 */
-			pos++;
-			break;
-		}
-		/* Undefined encoding scheme. */
-		else
-		{
-			goto out;
-		}
-	}
+	if(get_history_records(&records,&num_records) < 0)
+		goto out;
 
-	result = pos;
+	result = send_collector_report(socket_path,sensor_name,records,num_records);
 
  out:
 
+	if(records != NULL)
+		free(records);
+
 	return(result);
 }
 
 /****************************************************************************/
 
-/* Decode a domain name stored in a DNS record, decompressing it as
- * necessary (RFC 1035, section 4.1.4). Returns the length of the
- * decoded domain name or 0 for decoding error.
+/* Make the DHCP server responses collected available to other processes,
+ * replacing those of the previous scan.
  */
-static size_t
-decode_domain_name(const uint8_t * input_buffer,size_t input_buffer_size,size_t input_pos,
-	char * output_buffer,size_t output_buffer_size)
+static void
+publish_results(void)
 {
-	int length,compression;
-	size_t output_pos = 0;
-	size_t result = 0;
+	struct dhcp_offer * data;
+	struct shared_server servers[SHARED_RESULTS_CAPACITY];
+	size_t num_servers = 0;
+	int i;
 
-	assert( output_buffer_size > 0 );
-	
-	while(input_pos < input_buffer_size)
+	for(i = 0 ; i < num_scans ; i++)
 	{
-		length = input_buffer[input_pos++];
-		if(length == 0)
-			break;
-		
-		/* A label begins with a length field which
-		 * could also be a compression pointer.
-		 */
-		compression = length & 0xc0;
-
-		/* Is this a length field? */
-		if (compression == 0)
+		for(data = (struct dhcp_offer *)get_list_head(get_dhcp_scan_offers(scans[i])) ;
+			data != NULL ;
+			data = (struct dhcp_offer *)get_next_node(&data->node))
 		{
-			/* Check for buffer overflow. */
-			if(input_pos + length > input_buffer_size)
-				goto out;
-
-			/* Append the label to the output buffer if there is room. */
-			if(output_pos + length + 1 < output_buffer_size)
+			/* Those which do not fit are counted, but not published. */
+			if(num_servers < SHARED_RESULTS_CAPACITY)
 			{
-				/* Add the label separator if there already is a
-				 * label in the output buffer.
-				 */
-				if(output_pos > 0)
-					output_buffer[output_pos++] = '.';
+				struct shared_server * server = &servers[num_servers];
 
-				memmove(&output_buffer[output_pos],&input_buffer[input_pos],length);
-				output_pos += length;
+				memset(server,0,sizeof(*server));
+
+				memmove(server->server_ipv4_address,data->server_ipv4_address,sizeof(server->server_ipv4_address));
+				memmove(server->server_mac_address,data->server_mac_address,sizeof(server->server_mac_address));
+				memmove(server->offered_ipv4_address,data->offered_ipv4_address,sizeof(server->offered_ipv4_address));
+				strncpy(server->interface_name,data->interface_name,sizeof(server->interface_name));
+
+				server->time_received = data->stamp.tv_sec;
+				server->offer_hash = data->offer_hash;
 			}
-			
-			input_pos += length;
-		}
-		/* Is this a compression pointer? */
-		else if (compression == 0xc0)
-		{
-			size_t pointer;
-			
-			/* Check for buffer overflow. */
-			if(input_pos == input_buffer_size)
-				goto out;
-			
-			pointer = ((length & ~0xc0) << 8) | input_buffer[input_pos++];
-			
-			/* Check for buffer overflow. */
-			if(pointer >= input_buffer_size)
-				goto out;
 
-			/* Domain name continues where the compression
-			 * pointer leads.
-			 */
-			input_pos = pointer;
-		}
-		/* Undefined encoding scheme. */
-		else
-		{
-			goto out;
+			num_servers++;
 		}
 	}
 
-	assert( output_pos < output_buffer_size );
-	output_buffer[output_pos] = '\0';
-
-	result = output_pos;
-
- out:
-	
-	return(result);
+	publish_shared_results(shared_results,servers,num_servers,time(NULL));
 }
 
 /****************************************************************************/
 
-/* Decode DHCP option 119 (Domain search, RFC 3397). The domain data may
- * be broken up into several DHCP data options (RFC 3396) which first
- * need to be aggregated. Returns true if the data could be decoded,
- * false otherwise.
+/* Open the device and prepare for capturing the DHCP server responses on
+ * one more network interface. Returns -1 in case of error, which has
+ * been reported already, and 0 otherwise.
  */
-static bool
-decode_domain_search(const uint8_t * vendor_options,int vendor_options_length,
-	int aggregate_option_type,char * buffer,size_t buffer_size)
+static int
+open_one_dhcp_scan(const char * interface_name,const struct dhcp_scan_options * scan_options)
 {
-	/* The maximum length of a domain name, including "." separators,
-	 * would be 255 characters (RFC 2181, section 11 "Name syntax").
-	 * Space is reserved for the terminating NUL byte, too.
-	 */
-	char domain_name_buffer[256];
-	size_t domain_name_length;
-	uint8_t * aggregate_buffer = NULL;
-	size_t aggregate_buffer_size = 0;
-	bool found = false;
-	size_t buffer_pos = 0;
-	size_t pos;
-	size_t encoded_domain_size;
-
-	assert( buffer != NULL );
-	assert( buffer_size > 0 );
-
-	/* Aggregate all option 119 data. */
-	if(!fill_aggregate_buffer_from_option(vendor_options,vendor_options_length,
-			aggregate_option_type,&aggregate_buffer,&aggregate_buffer_size))
-		goto out;
+	struct dhcp_scan ** new_scans;
+	struct dhcp_scan * scan;
+	char errbuf[PCAP_ERRBUF_SIZE];
+	int result = -1;
 
-	/* Process the aggregated data, decoding each domain name stored. */
-	for(pos = 0 ; pos < aggregate_buffer_size ; pos += encoded_domain_size)
+	new_scans = realloc(scans,(num_scans + 1) * sizeof(*new_scans));
+	if(new_scans == NULL)
 	{
-		/* How much room will this encoded domain name take up? */
-		encoded_domain_size = get_domain_name_size(&aggregate_buffer[pos],aggregate_buffer_size - pos);
-		if(encoded_domain_size == 0)
-			break;
+		if(!opt_quiet)
+			fprintf(stderr,"%s: Unable to open device %s: %s.\n",command_name,interface_name,strerror(errno));
 
-		/* Attempt to decode this domain name. */
-		domain_name_length = decode_domain_name(aggregate_buffer,aggregate_buffer_size,pos,
-			domain_name_buffer,sizeof(domain_name_buffer));
+		goto out;
+	}
 
-		if(domain_name_length > 0)
-		{
-			/* If there is more than one domain name in the output buffer
-			 * already, add a separator.
-			 */
-			if(buffer_pos > 0 && buffer_pos + 2 < buffer_size)
-			{
-				buffer[buffer_pos++] = ',';
-				buffer[buffer_pos++] = ' ';
-			}
+	scans = new_scans;
 
-			/* Add the decoded domain name, if there is stil room. */
-			if(buffer_pos + domain_name_length < buffer_size)
-			{
-				memmove(&buffer[buffer_pos],domain_name_buffer,domain_name_length);
-				buffer_pos += domain_name_length;
-			}
-		}
+	scan = open_dhcp_scan(interface_name,scan_options,errbuf,sizeof(errbuf));
+	if(scan == NULL)
+	{
+		if(!opt_quiet)
+			fprintf(stderr,"%s: Unable to open device %s: %s.\n",command_name,interface_name,errbuf);
+
+		goto out;
 	}
-	
-	found = true;
-	
- out:
 
-	/* Provide NUL termination for the output buffer. */
-	if(buffer_pos < buffer_size)
-		buffer[buffer_pos] = '\0';
+	scans[num_scans++] = scan;
 
-	/* Free the memory which we allocated for the
-	 * aggregated option 119 data.
-	 */
-	if(aggregate_buffer != NULL)
-		free(aggregate_buffer);
+	result = 0;
+
+ out:
 
-	return(found);
+	return(result);
 }
 
 /****************************************************************************/
 
-/*
- * This function will be called for any incoming DHCP responses
+/* Open a scan on every network interface which is up and running. The
+ * hardware address and MTU are already known, which saves looking them
+ * up again. Returns -1 in case of error, which has been reported already,
+ * and 0 otherwise.
  */
-static void
-dhcp_input(const struct ether_header * eframe,
-	const struct ip * ip_packet,
-	const struct udphdr * udp_packet __attribute__((unused)),
-	const bootp_t * dhcp,
-	uint32_t transaction_id,
-	int length)
+static int
+open_all_dhcp_scans(const struct network_link * links,size_t num_links,const struct dhcp_scan_options * scan_options)
 {
-	uint8_t ignore_option[256 / 8];
-	ip4_t server_address;
-	ip4_t ipv4_address;
-	const uint8_t * vendor_options;
-	int vendor_options_length;
-	int pos;
-	uint8_t server_ipv4_address[4];
-	char text_buffer[1500];
-	int option_type,option_length;
-
-	/* We copy the option data to a 32 bit word-aligned
-	 * buffer because we may need to access 32 bit words
-	 * inside it and we cannot expect the option data to
-	 * be aligned appropriately.
-	 */
-	uint32_t aligned_buffer[256 / sizeof(uint32_t)+1];
-	uint8_t * option_data = (uint8_t *)aligned_buffer;
-	struct dhcp_server_response_data * server_data;
-
-	/* We ignore no vendor option yet. */
-	memset(ignore_option,0,sizeof(ignore_option));
-
-	vendor_options = dhcp->vend;
-	vendor_options_length = length - offsetof(bootp_t,vend);
-
-	/* This should be a DHCP server response, the transaction number must match
-	 * the request we made and DHCP server should have responded with an
-	 * offer.
-	 */
-	if (dhcp->opcode != BOOTREPLY || ntohl(dhcp->magic_cookie) != DHCP_MAGIC_COOKIE ||
-		ntohl(dhcp->xid) != transaction_id ||
-		get_dhcp_message_type(vendor_options,vendor_options_length) != MESSAGE_TYPE_OFFER)
-	{
-		return;
-	}
+	struct dhcp_scan_options link_scan_options;
+	const struct network_link * link;
+	const struct network_link * other;
+	int result = -1;
+	size_t i;
 
-	/* Ring the bell for each response? */
-	if(opt_audible)
+	for(i = 0 ; i < num_links ; i++)
 	{
-		/* BEL = Ctrl+G */
-		fputc('G' & 0x1F,stderr);
+		link = &links[i];
 
-		/* stderr should be unbuffered, but you never know... */
-		fflush(stderr);
-	}
+		if(!is_network_link_scannable(link))
+		{
+			/* Say why a port of a bridge or bond is left out, since
+			 * this may come as a surprise.
+			 */
+			if(opt_verbose && link->master_index != 0)
+			{
+				other = find_network_link(links,num_links,link->master_index);
 
-	server_address = ntohl(ip_packet->ip_src.s_addr);
+				printf("%s: Skipping network interface %s, which belongs to %s.\n",command_name,
+					link->name,(other != NULL) ? other->name : "another interface");
+			}
 
-	server_ipv4_address[0] = (server_address >> 24) & 0xff;
-	server_ipv4_address[1] = (server_address >> 16) & 0xff;
-	server_ipv4_address[2] = (server_address >> 8) & 0xff;
-	server_ipv4_address[3] = server_address & 0xff;
+			continue;
+		}
 
-	/* We only store one response per server. Do we already have
-	 * a record of this one? If so, ignore its response.
-	 */
-	server_data = find_dhcp_server_data(server_ipv4_address, eframe->ether_shost);
-	if(server_data != NULL)
-	{
-		if(!opt_quiet)
+		if(opt_verbose)
 		{
-			fprintf(stderr,"%s: Duplicate response from DHCP server at "
-				"IPv4 address %u.%u.%u.%u/"
-				"MAC address %02x:%02x:%02x:%02x:%02x:%02x ignored.\n",
-				command_name,
-				server_ipv4_address[0],server_ipv4_address[1],
-				server_ipv4_address[2],server_ipv4_address[3],
-				eframe->ether_shost[0], eframe->ether_shost[1], eframe->ether_shost[2],
-				eframe->ether_shost[3], eframe->ether_shost[4], eframe->ether_shost[5]);
+			other = (link->parent_index != 0) ? find_network_link(links,num_links,link->parent_index) : NULL;
+
+			printf("%s: Found network interface %s (%s%s%s, MTU %d).\n",command_name,
+				link->name,
+				(link->kind[0] != '\0') ? link->kind : "hardware",
+				(other != NULL) ? " on " : "",
+				(other != NULL) ? other->name : "",
+				link->mtu);
 		}
 
-		return;
+		link_scan_options = (*scan_options);
+
+		link_scan_options.interface_mac_address = link->mac_address;
+		link_scan_options.interface_mtu = link->mtu;
+
+		if(open_one_dhcp_scan(link->name,&link_scan_options) < 0)
+			goto out;
 	}
 
-	/* Register a new server response. */
-	server_data = create_dhcp_server_data(server_ipv4_address, eframe->ether_shost);
-	if(server_data == NULL)
+	if(num_scans == 0)
 	{
 		if(!opt_quiet)
-		{
-			fprintf(stderr,"%s: Not enough memory to record response from DHCP server at "
-				"IPv4 address %u.%u.%u.%u/"
-				"MAC address %02x:%02x:%02x:%02x:%02x:%02x.\n",
-				command_name,
-				server_ipv4_address[0],server_ipv4_address[1],
-				server_ipv4_address[2],server_ipv4_address[3],
-				eframe->ether_shost[0], eframe->ether_shost[1], eframe->ether_shost[2],
-				eframe->ether_shost[3], eframe->ether_shost[4], eframe->ether_shost[5]);
-		}
+			fprintf(stderr,"%s: Unable to pick network interface: none is up and running.\n",command_name);
 
-		return;
+		goto out;
 	}
 
-	add_dhcp_response(server_data,"network-interface","%s (%02x:%02x:%02x:%02x:%02x:%02x)",
-		interface_name,
-		client_mac_address[0], client_mac_address[1], client_mac_address[2],
-		client_mac_address[3], client_mac_address[4], client_mac_address[5]);
+	result = 0;
 
-	/* The server name, if not empty, should be NUL-terminated. We cannot
-	 * assume that it will be, which is why we add another NUL termination.
-	 */
-	memmove(text_buffer, dhcp->sname, sizeof(dhcp->sname));
-	text_buffer[sizeof(dhcp->sname)] = '\0';
+ out:
 
-	if(text_buffer[0] != '\0')
-		add_dhcp_response(server_data,"server-name","\"%s\"",text_buffer);
+	return(result);
+}
 
-	add_dhcp_response(server_data,"server-ipv4-address","%u.%u.%u.%u",
-		server_ipv4_address[0],server_ipv4_address[1],
-		server_ipv4_address[2],server_ipv4_address[3]);
+/****************************************************************************/
 
-	add_dhcp_response(server_data,"server-mac-address","%02x:%02x:%02x:%02x:%02x:%02x",
-		eframe->ether_shost[0], eframe->ether_shost[1], eframe->ether_shost[2],
-		eframe->ether_shost[3], eframe->ether_shost[4], eframe->ether_shost[5]);
+/* Convert a date and time given in local time, either as "YYYY-MM-DD",
+ * "YYYY-MM-DDTHH:MM" or "YYYY-MM-DDTHH:MM:SS", into a time stamp.
+ * Alternatively, the number of seconds since the epoch may be given
+ * with a leading '@'. Returns false if the text could not be converted.
+ */
+static bool
+parse_time_stamp(const char * text,time_t * stamp_ptr)
+{
+	int year, month, day, hour = 0, minute = 0, second = 0;
+	bool result = false;
+	int length = 0;
+	struct tm tm;
+	time_t stamp;
+	char * end;
+	long long n;
+
+	if(text[0] == '@')
+	{
+		n = strtoll(&text[1],&end,10);
+		if(end == &text[1] || (*end) != '\0')
+			goto out;
 
-	add_dhcp_response(server_data,"destination-mac-address","%02x:%02x:%02x:%02x:%02x:%02x (%s)",
-		eframe->ether_dhost[0], eframe->ether_dhost[1], eframe->ether_dhost[2],
-		eframe->ether_dhost[3], eframe->ether_dhost[4], eframe->ether_dhost[5],
-		memcmp(eframe->ether_dhost,broadcast_mac_address,ETHER_ADDR_LEN) == 0 ? "broadcast" : "unicast");
+		stamp = (time_t)n;
+	}
+	else
+	{
+		/* Try the longest form first. */
+		if(sscanf(text,"%d-%d-%dT%d:%d:%d%n",&year,&month,&day,&hour,&minute,&second,&length) != 6 || text[length] != '\0')
+		{
+			second = 0;
+			length = 0;
 
-	ipv4_address = ntohl(dhcp->yiaddr);
+			if(sscanf(text,"%d-%d-%dT%d:%d%n",&year,&month,&day,&hour,&minute,&length) != 5 || text[length] != '\0')
+			{
+				hour = minute = 0;
+				length = 0;
 
-	add_dhcp_response(server_data,"offered-ipv4-address","%u.%u.%u.%u",
-		(ipv4_address >> 24) & 0xff, (ipv4_address >> 16) & 0xff,
-		(ipv4_address >> 8) & 0xff, (ipv4_address) & 0xff);
+				if(sscanf(text,"%d-%d-%d%n",&year,&month,&day,&length) != 3 || text[length] != '\0')
+					goto out;
+			}
+		}
 
-	ipv4_address = ntohl(dhcp->siaddr);
-	if(ipv4_address)
-	{
-		add_dhcp_response(server_data,"next-server-ipv4-address","%u.%u.%u.%u",
-			(ipv4_address >> 24) & 0xff, (ipv4_address >> 16) & 0xff,
-			(ipv4_address >> 8) & 0xff, (ipv4_address) & 0xff);
-	}
+		if(month < 1 || month > 12 || day < 1 || day > 31 ||
+		   hour < 0 || hour > 23 || minute < 0 || minute > 59 || second < 0 || second > 60)
+		{
+			goto out;
+		}
 
-	ipv4_address = ntohl(dhcp->giaddr);
-	if(ipv4_address)
-	{
-		add_dhcp_response(server_data,"relay-agent-ipv4-address","%u.%u.%u.%u",
-			(ipv4_address >> 24) & 0xff, (ipv4_address >> 16) & 0xff,
-			(ipv4_address >> 8) & 0xff, (ipv4_address) & 0xff);
-	}
+		memset(&tm,0,sizeof(tm));
 
-	/* The file name, if not empty, should be NUL-terminated. We cannot
-	 * assume that it will be, which is why we add another NUL termination.
-	 */
-	memmove(text_buffer, dhcp->file, sizeof(dhcp->file));
-	text_buffer[sizeof(dhcp->file)] = '\0';
+		tm.tm_year	= year - 1900;
+		tm.tm_mon	= month - 1;
+		tm.tm_mday	= day;
+		tm.tm_hour	= hour;
+		tm.tm_min	= minute;
+		tm.tm_sec	= second;
+		tm.tm_isdst	= -1;
 
-	if(text_buffer[0] != '\0')
-		add_dhcp_response(server_data,"boot-file-name","\"%s\"",text_buffer);
+		stamp = mktime(&tm);
+		if(stamp == (time_t)-1)
+			goto out;
+	}
 
-	/* Process the BOOTP/DHCP options and print information for a
-	 * selection of options.
-	 */
-	for(pos = 0 ; pos < vendor_options_length ; (void)NULL)
-	{
-		option_type = vendor_options[pos++];
+	(*stamp_ptr) = stamp;
 
-		/* Skip the padding octet. */
-		if(option_type == OPTION_TYPE_PAD)
-			continue;
+	result = true;
 
-		/* Stop at the end marker, or the end of the options buffer. */
-		if(option_type == OPTION_TYPE_END || pos == vendor_options_length)
-			break;
+ out:
 
-		/* Stop at the end of the options buffer. */
-		option_length = vendor_options[pos++];
-		if(pos == vendor_options_length)
-			break;
+	return(result);
+}
 
-		/* Move the option data to a 32-bit word aligned buffer for
-		 * safe access.
-		 */
-		memmove(aligned_buffer,&vendor_options[pos],option_length);
-		option_data[option_length] = '\0';
+/****************************************************************************/
 
-		pos += option_length;
+/* The "query" command: print the DHCP servers recorded in the history
+ * which were seen during a particular period.
+ */
+static int
+query_main(int argc, char *argv[])
+{
+	static const struct option longopts[] =
+	{
+		{ "history",			required_argument,	NULL,	'H'	},
+		{ "since",				required_argument,	NULL,	's'	},
+		{ "until",				required_argument,	NULL,	'u'	},
+		{ "help",				no_argument,		NULL,	'h'	},
+		{ NULL,					0,					NULL,	0	}
+	};
 
-		/* Ignore this option? */
-		if(ignore_option[option_type / 8] & (1 << (option_type % 8)))
-			continue;
+	struct history_server * servers = NULL;
+	const char * history_directory_name = NULL;
+	const char * query_interface_name = NULL;
+	char first_seen_string[32];
+	char last_seen_string[32];
+	int result = EXIT_FAILURE;
+	size_t num_servers = 0;
+	time_t since = 0;
+	time_t until = time(NULL);
+	size_t i;
+	int c;
 
-		switch(option_type)
+	while((c = getopt_long(argc,argv,"hH:s:u:",longopts,NULL)) != -1)
+	{
+		switch(c)
 		{
-			/* DHCP message type */
-			case OPTION_TYPE_DHCP_MESSAGE_TYPE:
+			/* Where the history is kept. */
+			case 'H':
 
-				if(MESSAGE_TYPE_DISCOVER <= option_data[0] && option_data[0] <= MESSAGE_TYPE_INFORM)
-				{
-					static const char * message_types[8] =
-					{
-						"discover",
-						"offer",
-						"request",
-						"decline",
-						"acknowledge",
-						"negative acknowledgement",
-						"release",
-						"inform",
-					};
-
-					add_dhcp_option(server_data,"dhcp-message-type","%u (%s)", option_data[0],
-						message_types[option_data[0] - MESSAGE_TYPE_DISCOVER]);
-				}
-				else
+				history_directory_name = optarg;
+				break;
+
+			/* Beginning of the period. */
+			case 's':
+
+				if(!parse_time_stamp(optarg,&since))
 				{
-					add_dhcp_option(server_data,"dhcp-message-type","%u", option_data[0]);
+					fprintf(stderr,"%s: Parameter '--since=%s' is not a valid date and time.\n",command_name,optarg);
+					goto out;
 				}
 
 				break;
 
-			/* Server identifier */
-			case OPTION_TYPE_SERVER_IDENTIFIER:
+			/* End of the period. */
+			case 'u':
 
-				/* Minimum length is 4 octets. */
-				if(option_length >= 4)
+				if(!parse_time_stamp(optarg,&until))
 				{
-					add_dhcp_option(server_data,"server-identifier","%u.%u.%u.%u",
-						option_data[0],option_data[1],option_data[2],option_data[3]);
+					fprintf(stderr,"%s: Parameter '--until=%s' is not a valid date and time.\n",command_name,optarg);
+					goto out;
 				}
 
 				break;
 
-			/* IP address lease time */
-			case OPTION_TYPE_IP_ADDRESS_LEASE_TIME:
+			case 'h':
 
-				/* Minimum length is 4 octets. */
-				if(option_length >= 4)
-				{
-					uint32_t seconds = ntohl(*(uint32_t *)option_data);
+				printf("Usage: %s query --history=<directory> [--since=<time>] [--until=<time>] [interface]\n",command_name);
 
-					convert_seconds_to_readable_form(seconds,text_buffer,sizeof(text_buffer));
+				result = EXIT_SUCCESS;
+				goto out;
 
-					add_dhcp_option(server_data,"ip-address-lease-time","%u seconds%s",seconds,text_buffer);
-				}
+			default:
 
-				break;
+				fprintf(stderr,"%s: %s - %s\n",command_name,optarg,"option not known");
+				goto out;
+		}
+	}
 
-			/* Subnet mask */
-			case OPTION_TYPE_SUBNET_MASK:
+	argc -= optind;
+	argv += optind;
 
-				/* Minimum length is 4 octets. */
-				if(option_length >= 4)
-				{
-					add_dhcp_option(server_data,"subnet-mask","%u.%u.%u.%u",
-						option_data[0],option_data[1],option_data[2],option_data[3]);
-				}
+	if(history_directory_name == NULL)
+	{
+		fprintf(stderr,"%s: Parameter '--history' is required.\n",command_name);
+		goto out;
+	}
 
-				break;
+	if(argc > 0)
+		query_interface_name = argv[0];
 
-			/* Gateway */
-			case OPTION_TYPE_GATEWAY:
+	if(query_history(history_directory_name,query_interface_name,since,until,&servers,&num_servers) < 0)
+	{
+		fprintf(stderr,"%s: Unable to read history in '%s': %s.\n",command_name,history_directory_name,strerror(errno));
+		goto out;
+	}
 
-				/* Minimum length is 4 octets, and the payload must
-				 * be a multiple of 4, too.
-				 */
-				if(option_length >= 4 && (option_length % 4) == 0)
-				{
-					int i;
+	for(i = 0 ; i < num_servers ; i++)
+	{
+		if(i > 0)
+			printf("\n");
 
-					for(i = 0 ; i < option_length ; i += 4)
-					{
-						add_dhcp_option(server_data,"gateway","%u.%u.%u.%u",
-							option_data[i],option_data[i+1],option_data[i+2],option_data[i+3]);
-					}
-				}
+		format_time_stamp(servers[i].first_seen,first_seen_string,sizeof(first_seen_string));
+		format_time_stamp(servers[i].last_seen,last_seen_string,sizeof(last_seen_string));
 
-				break;
+		printf("network-interface=%s\n",servers[i].interface_name);
 
-			/* Domain name server */
-			case OPTION_TYPE_DNS:
+		printf("server-ipv4-address=%u.%u.%u.%u\n",
+			servers[i].server_ipv4_address[0],
+			servers[i].server_ipv4_address[1],
+			servers[i].server_ipv4_address[2],
+			servers[i].server_ipv4_address[3]);
 
-				/* Minimum length is 4 octets, and the payload must
-				 * be a multiple of 4, too.
-				 */
-				if(option_length >= 4 && (option_length % 4) == 0)
-				{
-					int i;
+		printf("server-mac-address=%02x:%02x:%02x:%02x:%02x:%02x\n",
+			servers[i].server_mac_address[0],
+			servers[i].server_mac_address[1],
+			servers[i].server_mac_address[2],
+			servers[i].server_mac_address[3],
+			servers[i].server_mac_address[4],
+			servers[i].server_mac_address[5]);
 
-					for(i = 0 ; i < option_length ; i += 4)
-					{
-						add_dhcp_option(server_data,"domain-name-server","%u.%u.%u.%u",
-							option_data[i],option_data[i+1],option_data[i+2],option_data[i+3]);
-					}
-				}
+		printf("first-seen=%s\n",first_seen_string);
+		printf("last-seen=%s\n",last_seen_string);
+		printf("times-seen=%lu\n",servers[i].times_seen);
+	}
 
-				break;
+	result = EXIT_SUCCESS;
 
-			/* Domain name */
-			case OPTION_TYPE_DOMAIN_NAME:
+ out:
 
-				add_dhcp_option(server_data,"domain-name","%s",option_data);
-				break;
+	if(servers != NULL)
+		free(servers);
 
-			/* Maximum DHCP message size */
-			case OPTION_TYPE_MAXIMUM_DHCP_MESSAGE_SIZE:
+	return(result);
+}
 
-				if(option_length >= 4)
-					add_dhcp_option(server_data,"maximum-dhcp-message-size","%u",ntohs(*(uint16_t *)option_data));
+/****************************************************************************/
 
-				break;
+/* The "collect" command: merge the scan results reported by many
+ * sensors, or show what the collector found.
+ */
+static int
+collect_main(int argc, char *argv[])
+{
+	static const struct option longopts[] =
+	{
+		{ "socket",				required_argument,	NULL,	's'	},
+		{ "list",				no_argument,		NULL,	'l'	},
+		{ "verbose",			no_argument,		NULL,	'v'	},
+		{ "help",				no_argument,		NULL,	'h'	},
+		{ NULL,					0,					NULL,	0	}
+	};
 
-			/* Renewal time value */
-			case OPTION_TYPE_RENEWAL_TIME:
+	struct collector * collector = NULL;
+	const char * socket_path = NULL;
+	int result = EXIT_FAILURE;
+	bool list = false;
+	bool verbose = false;
+	int c;
 
-				if(option_length >= 4)
-				{
-					uint32_t seconds = ntohl(*(uint32_t *)option_data);
+	while((c = getopt_long(argc,argv,"hls:v",longopts,NULL)) != -1)
+	{
+		switch(c)
+		{
+			/* Where the collector receives reports and queries. */
+			case 's':
 
-					convert_seconds_to_readable_form(seconds,text_buffer,sizeof(text_buffer));
+				socket_path = optarg;
+				break;
 
-					add_dhcp_option(server_data,"renewal-time","%u seconds%s",seconds,text_buffer);
-				}
+			/* Ask the collector what it found. */
+			case 'l':
 
+				list = true;
 				break;
 
-			/* Rebinding time value */
-			case OPTION_TYPE_REBINDING_TIME:
+			case 'v':
 
-				if(option_length >= 4)
-				{
-					uint32_t seconds = ntohl(*(uint32_t *)option_data);
+				verbose = true;
+				break;
 
-					convert_seconds_to_readable_form(seconds,text_buffer,sizeof(text_buffer));
+			case 'h':
 
-					add_dhcp_option(server_data,"rebinding-time","%u seconds%s",seconds,text_buffer);
-				}
+				printf("Usage: %s collect --socket=<path> [--list] [--verbose]\n",command_name);
 
-				break;
+				result = EXIT_SUCCESS;
+				goto out;
+
+			default:
 
-			/* Static route */
-			case OPTION_TYPE_STATIC_ROUTE:
+				fprintf(stderr,"%s: %s - %s\n",command_name,optarg,"option not known");
+				goto out;
+		}
+	}
 
-				if(decode_static_route(option_data, option_length, text_buffer, sizeof(text_buffer)) > 0)
-					add_dhcp_option(server_data,"static-route","%s",text_buffer);
+	if(socket_path == NULL)
+	{
+		fprintf(stderr,"%s: Parameter '--socket' is required.\n",command_name);
+		goto out;
+	}
 
-				break;
+	if(list)
+	{
+		if(query_collector(socket_path,stdout) < 0)
+		{
+			fprintf(stderr,"%s: Unable to query collector at '%s': %s.\n",command_name,socket_path,strerror(errno));
+			goto out;
+		}
 
-			/* Message from server */
-			case OPTION_TYPE_MESSAGE:
+		result = EXIT_SUCCESS;
+	}
+	else
+	{
+		collector = create_collector();
+		if(collector == NULL)
+		{
+			fprintf(stderr,"%s: Not enough memory to start collector.\n",command_name);
+			goto out;
+		}
 
-				add_dhcp_option(server_data,"message","%s",option_data);
-				break;
+		/* This returns only if something went wrong. */
+		run_collector(collector,socket_path,verbose);
 
-			/* Domain search (RFC 3397) */
-			case OPTION_TYPE_DOMAIN_SEARCH:
+		fprintf(stderr,"%s: Collector stopped: %s.\n",command_name,strerror(errno));
+	}
 
-				/* The data used by this option can be spread across
-				 * several options. We aggregate them and then decode
-				 * them all in one step. This is why we process this
-				 * option only once.
-				 */
-				ignore_option[option_type / 8] |= (1 << (option_type % 8));
+ out:
 
-				if(decode_domain_search(vendor_options,vendor_options_length,option_type,text_buffer, sizeof(text_buffer)))
-					add_dhcp_option(server_data,"domain-search","%s",text_buffer);
+	delete_collector(collector);
 
-				break;
+	return(result);
+}
 
-			/* Classless static routes (RFC 3442) */
-			case OPTION_TYPE_CLASSLESS_STATIC_ROUTE:
+/****************************************************************************/
 
-				if(decode_classless_static_route(option_data, option_length, text_buffer, sizeof(text_buffer)) > 0)
-					add_dhcp_option(server_data,"classless-static-route","%s",text_buffer);
+/* Figure out the port numbers to use for sending and receiving DHCP messages. */
+static void
+get_port_numbers(struct dhcp_scan_options * scan_options)
+{
+	struct servent * service_entry;
 
-				break;
+	service_entry = getservbyname("bootps", "udp");
+	if(service_entry != NULL)
+	{
+		scan_options->server_port = ntohs(service_entry->s_port);
+	}
+	else
+	{
+		scan_options->server_port = DEFAULT_BOOTP_SERVER_PORT;
 
-			/* Web proxy auto-discovery protocol (RFC draft). */
-			case OPTION_TYPE_PROXY_AUTODISCOVERY:
+		if(!opt_quiet)
+			fprintf(stderr,"%s: Using default DHCP server port number %d.\n",command_name,scan_options->server_port);
+	}
 
-				add_dhcp_option(server_data,"web-proxy-auto-discovery","%s",option_data);
-				break;
+	service_entry = getservbyname("bootpc", "udp");
+	if(service_entry != NULL)
+	{
+		scan_options->client_port = ntohs(service_entry->s_port);
+	}
+	else
+	{
+		scan_options->client_port = DEFAULT_BOOTP_CLIENT_PORT;
 
-			/* LDAP URL (RFC draft). */
-			case OPTION_TYPE_LDAP_URL:
+		if(!opt_quiet)
+			fprintf(stderr,"%s: Using default DHCP client port number %d.\n",command_name,scan_options->client_port);
+	}
+}
 
-				add_dhcp_option(server_data,"ldap-url","%s",option_data);
-				break;
+/****************************************************************************/
 
-			/* NetBIOS over TCP/IP name servers */
-			case OPTION_TYPE_NETBIOS_OVER_TCP_IP_NAME_SERVER:
+/* The "sweep" command: scan every network namespace on this host for
+ * DHCP servers, several of them at the same time.
+ */
+static int
+sweep_main(int argc, char *argv[])
+{
+	static const struct option longopts[] =
+	{
+		{ "allowlist",			required_argument,	NULL,	'l'	},
+		{ "broadcast",			no_argument,		NULL,	'b'	},
+		{ "filter",				required_argument,	NULL,	'f'	},
+		{ "help",				no_argument,		NULL,	'h'	},
+		{ "ignore-checksums",	no_argument,		NULL,	'i'	},
+		{ "quiet",				no_argument,		NULL,	'q'	},
+		{ "threads",			required_argument,	NULL,	'T'	},
+		{ "timeout",			required_argument,	NULL,	't'	},
+		{ "verbose",			no_argument,		NULL,	'v'	},
+		{ NULL,					0,					NULL,	0	}
+	};
 
-				/* Minimum length is 4 octets, and the payload must
-				 * be a multiple of 4, too.
-				 */
-				if(option_length >= 4 && (option_length % 4) == 0)
-				{
-					int i;
+	struct netns_scan * namespaces = NULL;
+	size_t num_namespaces = 0;
+	size_t num_failed = 0;
+	int num_servers = 0;
+	struct dhcp_scan_options scan_options;
+	struct allowlist * sweep_allowlist = NULL;
+	struct offer_filter * sweep_offer_filter = NULL;
+	const char * allowlist_file_name = NULL;
+	const char * filter_expression = NULL;
+	const char * sweep_interface_name = "eth0";
+	char errbuf[256];
+	int num_threads = 16;
+	int result = EXIT_FAILURE;
+	char * p;
+	long n;
+	size_t i;
+	int c;
 
-					for(i = 0 ; i < option_length ; i += 4)
-					{
-						add_dhcp_option(server_data,"netbios-over-tcp-ip-name-server","%u.%u.%u.%u",
-							option_data[i],option_data[i+1],option_data[i+2],option_data[i+3]);
-					}
-				}
+	while((c = getopt_long(argc,argv,"bf:hil:qT:t:v",longopts,NULL)) != -1)
+	{
+		switch(c)
+		{
+			/* Request that the DHCP server responds by sending a broadcast message. */
+			case 'b':
 
+				opt_broadcast = true;
 				break;
 
-			/* NetBIOS over TCP/IP node type */
-			case OPTION_TYPE_NETBIOS_OVER_TCP_IP_NODE_TYPE:
+			/* Record only offers which match this expression. */
+			case 'f':
 
-				add_dhcp_option(server_data,"netbios-over-tcp-ip-node-type","%u",option_data[0]);
+				filter_expression = optarg;
 				break;
 
-			/* NetBIOS over TCP/IP scope */
-			case OPTION_TYPE_NETBIOS_OVER_TCP_IP_SCOPE:
+			/* Ignore IP and UDP checksums. */
+			case 'i':
 
-				add_dhcp_option(server_data,"netbios-over-tcp-ip-scope","%s",option_data);
+				opt_ignore_checksums = true;
 				break;
 
-			/* Perform router discovery */
-			case OPTION_TYPE_PERFORM_ROUTER_DISCOVERY:
+			/* Known DHCP servers which are not to be reported. */
+			case 'l':
 
-				add_dhcp_option(server_data,"perform-router-discovery","%s",option_data[0] ? "yes" : "no");
+				allowlist_file_name = optarg;
 				break;
 
-			/* Interface MTU */
-			case OPTION_TYPE_INTERFACE_MTU:
+			/* Minimize output. */
+			case 'q':
+
+				opt_quiet = true;
+				opt_verbose = false;
 
-				add_dhcp_option(server_data,"interface-mtu","%u",ntohs(*(uint16_t *)option_data));
 				break;
 
-			/* Network time protocol server */
-			case OPTION_TYPE_NTP_SERVERS:
+			/* How many namespaces to scan at the same time. */
+			case 'T':
 
-				/* Minimum length is 4 octets, and the payload must
-				 * be a multiple of 4, too.
+				/* Convert text into number; balk if the conversion
+				 * failed or the resulting value is out of range.
 				 */
-				if(option_length >= 4 && (option_length % 4) == 0)
+				n = strtol(optarg,&p,0);
+
+				if((n == 0 && p == optarg) || n < 1 || n > NETNS_SWEEP_MAX_THREADS)
 				{
-					int i;
+					fprintf(stderr,"%s: Parameter '--threads=%s' is not valid.\n",command_name,optarg);
+					goto out;
+				}
+
+				num_threads = (int)n;
+				break;
+
+			/* How long to wait for DHCP server responses to trickle in. */
+			case 't':
+
+				/* Convert text into number; balk if the conversion
+				 * failed or the resulting value is out of range. Each
+				 * scan has to end at some point.
+				 */
+				n = strtol(optarg,&p,0);
 
-					for(i = 0 ; i < option_length ; i += 4)
-					{
-						add_dhcp_option(server_data,"network-time-protocol-server","%u.%u.%u.%u",
-							option_data[i],option_data[i+1],option_data[i+2],option_data[i+3]);
-					}
+				if((n == 0 && p == optarg) || n < 1 || n > INT_MAX)
+				{
+					fprintf(stderr,"%s: Parameter '--timeout=%s' is not valid.\n",command_name,optarg);
+					goto out;
 				}
 
+				opt_timeout = (int)n;
 				break;
 
-			/* Broadcast address */
-			case OPTION_TYPE_BROADCAST_ADDRESS:
+			/* Print additional processing information. */
+			case 'v':
 
-				/* Minimum length is 4 octets. */
-				if(option_length >= 4)
-				{
-					add_dhcp_option(server_data,"broadcast-address","%u.%u.%u.%u",
-						option_data[0],option_data[1],option_data[2],option_data[3]);
-				}
+				opt_verbose = true;
+				opt_quiet = false;
 
 				break;
 
-			/* Auto-configure (RFC 2563) */
-			case OPTION_TYPE_AUTO_CONFIGURE:
+			case 'h':
 
-				add_dhcp_option(server_data,"auto-configure","%s",
-					option_data[0] ? "AutoConfigure" : "DoNotAutoConfigure");
+				printf("Usage: %s sweep [--allowlist=<file>] [--broadcast] [--filter=<expression>] [--ignore-checksums] "
+					"[--quiet] [--threads=<number>] [--timeout=<seconds>] [--verbose] [interface]\n",command_name);
 
-				break;
+				result = EXIT_SUCCESS;
+				goto out;
 
 			default:
 
-				snprintf(text_buffer,sizeof(text_buffer),"option-%u",option_type);
+				fprintf(stderr,"%s: %s - %s\n",command_name,optarg,"option not known");
+				goto out;
+		}
+	}
 
-				add_dhcp_option(server_data,text_buffer,"%u data bytes",option_length);
-				break;
+	argc -= optind;
+	argv += optind;
+
+	/* The same interface name is used in every namespace. */
+	if(argc > 0)
+		sweep_interface_name = argv[0];
+
+	if(filter_expression != NULL)
+	{
+		sweep_offer_filter = compile_offer_filter(filter_expression,errbuf,sizeof(errbuf));
+		if(sweep_offer_filter == NULL)
+		{
+			fprintf(stderr,"%s: Parameter '--filter=%s' is not valid: %s.\n",command_name,filter_expression,errbuf);
+			goto out;
 		}
 	}
 
-	/* Only read a limited number of DHCP server responses? */
-	if(opt_max_response_count > 0)
+	if(allowlist_file_name != NULL)
 	{
-		/* Stop looking for more DHCP server responses? */
-		opt_max_response_count--;
-		if(opt_max_response_count == 0)
-			pcap_breakloop(pcap_handle);
+		sweep_allowlist = load_allowlist(allowlist_file_name,errbuf,sizeof(errbuf));
+		if(sweep_allowlist == NULL)
+		{
+			if(!opt_quiet)
+				fprintf(stderr,"%s: Unable to load allowlist file '%s': %s.\n",command_name,allowlist_file_name,errbuf);
+
+			goto out;
+		}
 	}
-}
 
-/****************************************************************************/
+	if(find_network_namespaces(&namespaces,&num_namespaces) < 0)
+	{
+		if(!opt_quiet)
+			fprintf(stderr,"%s: Unable to find the network namespaces: %s.\n",command_name,strerror(errno));
 
-/*
- * UDP packet handler
- */
-static void
-udp_input(const struct ether_header *eframe,struct ip * ip_packet,const struct udphdr * udp_packet,uint32_t transaction_id)
-{
-	int checksum;
+		goto out;
+	}
 
-	/* Verify the UDP datagram checksum? */
-	if(udp_packet->uh_sum != 0)
+	if(opt_verbose)
 	{
-		struct ip ip_copy;
-		struct udp_pseudo_header * udp_pseudo_header;
+		printf("%s: Scanning network interface %s in %zu network namespaces, up to %d at a time.\n",
+			command_name,sweep_interface_name,num_namespaces,num_threads);
 
-		/* We will clobber the IP header for the calculation,
-		 * so let's save it first.
-		 */
-		ip_copy = (*ip_packet);
-
-		udp_pseudo_header = (struct udp_pseudo_header *)ip_packet;
-		udp_pseudo_header->ih_zero1[0] = udp_pseudo_header->ih_zero1[1] = 0;
-		udp_pseudo_header->ih_zero2 = 0;
-		udp_pseudo_header->ih_len = udp_pseudo_header->uh_ulen;
-	
-		checksum = in_cksum(ip_packet,sizeof(*ip_packet) + ntohs(udp_pseudo_header->uh_ulen));
-	
-		/* Restore the damage. */
-		(*ip_packet) = ip_copy;
-	}
-	/* No checksum was given. */
-	else
+		fflush(stdout);
+	}
+
+	memset(&scan_options,0,sizeof(scan_options));
+
+	get_port_numbers(&scan_options);
+
+	scan_options.use_broadcast = opt_broadcast;
+	scan_options.ignore_checksums = opt_ignore_checksums;
+	scan_options.allowlist = sweep_allowlist;
+	scan_options.offer_filter = sweep_offer_filter;
+
+	srand((unsigned)time(NULL) + getpid());
+
+	if(sweep_network_namespaces(namespaces,num_namespaces,sweep_interface_name,&scan_options,(uint32_t)rand(),opt_timeout,num_threads) < 0)
 	{
-		checksum = 0;
+		if(!opt_quiet)
+			fprintf(stderr,"%s: Unable to scan the network namespaces: %s.\n",command_name,strerror(errno));
+
+		goto out;
 	}
-	
-	/* Check if there is a response from DHCP server. */
-	if ((opt_ignore_checksums || checksum == 0) && ntohs(udp_packet->uh_sport) == dhcp_server_port)
+
+	/* Show what was found in each namespace, or why it could not be scanned. */
+	for(i = 0 ; i < num_namespaces ; i++)
 	{
-		int length;
+		if(namespaces[i].error[0] != '\0')
+		{
+			if(opt_verbose)
+				fprintf(stderr,"%s: Unable to scan network namespace '%s': %s.\n",command_name,namespaces[i].name,namespaces[i].error);
+
+			num_failed++;
+			continue;
+		}
+
+		num_servers += namespaces[i].num_offers;
+
+		if(!opt_quiet)
+		{
+			printf("network-namespace=%s\n",namespaces[i].name);
+			printf("number-of-servers=%d\n",namespaces[i].num_offers);
 
-		length = ntohs(udp_packet->uh_ulen) - sizeof(struct udphdr);
+			if(namespaces[i].num_offers > 0)
+			{
+				printf("\n");
+				print_dhcp_server_data(&namespaces[i].offer_list,false);
+			}
 
-		dhcp_input(eframe,ip_packet,udp_packet,(bootp_t *)&udp_packet[1],transaction_id,length);
+			printf("\n");
+		}
 	}
-}
 
-/****************************************************************************/
+	if(num_failed > 0 && !opt_quiet)
+		fprintf(stderr,"%s: %zu of %zu network namespaces could not be scanned.\n",command_name,num_failed,num_namespaces);
 
-/*
- * IP Packet handler
- */
-static void
-ip_input(const struct ether_header *eframe,struct ip * ip_packet,uint32_t transaction_id)
-{
-	/* Verify the IP header checksum. */
-	int checksum = in_cksum(ip_packet,sizeof(*ip_packet));
-	
-	/* Care only about UDP - since DHCP sits over UDP */
-	if ((opt_ignore_checksums || checksum == 0) && ip_packet->ip_p == IPPROTO_UDP)
-		udp_input(eframe,ip_packet,(struct udphdr *)&ip_packet[1],transaction_id);
+	/* Only unknown DHCP servers are recorded. Success means that at
+	 * least one of them responded.
+	 */
+	if(sweep_allowlist != NULL && num_servers == 0)
+		goto out;
+
+	result = EXIT_SUCCESS;
+
+ out:
+
+	delete_network_namespaces(namespaces,num_namespaces);
+	delete_allowlist(sweep_allowlist);
+	delete_offer_filter(sweep_offer_filter);
+
+	return(result);
 }
 
 /****************************************************************************/
 
-/* Check if this Ethernet frame was sent for us to process. This means it either
- * was sent to the broadcast address group or it was sent to the address of the
- * interface which we are listening to.
- */
-static bool
-is_ethernet_frame_for_us(const struct ether_header *ethernet_frame)
+/* The number of seconds between two points in time. */
+static double
+get_seconds_between(const struct timeval * from,const struct timeval * to)
 {
-	bool result;
+	double result;
 
-	result = (memcmp(ethernet_frame->ether_dhost,client_mac_address,ETHER_ADDR_LEN) == 0 ||
-			  memcmp(ethernet_frame->ether_dhost,broadcast_mac_address,ETHER_ADDR_LEN) == 0);
+	result = (to->tv_sec - from->tv_sec) + (to->tv_usec - from->tv_usec) / 1000000.0;
 
 	return(result);
 }
 
 /****************************************************************************/
 
-/*
- * Ethernet packet handler
+/* Prints what the scan triggered by a network interface coming up found,
+ * and how long it took. This is a callback function invoked by
+ * run_link_watch().
  */
 static void
-ether_input(uint8_t *args __attribute__((unused)), const struct pcap_pkthdr *header __attribute__((unused)), const uint8_t *frame)
+print_link_scan_report(const struct link_scan_report * report,void * user_data __attribute__((unused)))
 {
-	const struct ether_header *ethernet_frame = (struct ether_header *)frame;
+	char time_string[48];
 
-	/* This must be an Ethernet frame (not ARP), and the destination address must
-	 * either refer to the network interface we listen to or it must be
-	 * the broadcast group address.
-	 */
-	if (htons(ethernet_frame->ether_type) == ETHERTYPE_IP && is_ethernet_frame_for_us(ethernet_frame))
-		ip_input(ethernet_frame,(struct ip *)&ethernet_frame[1],transaction_id);
-}
+	if(report->error != NULL)
+	{
+		if(!opt_quiet)
+			fprintf(stderr,"%s: Unable to scan network interface %s: %s.\n",command_name,report->interface_name,report->error);
 
-/****************************************************************************/
+		return;
+	}
 
-/*
- * Ethernet output handler - Fills appropriate bytes in ethernet header
- */
-static int
-ether_output(pcap_t *pcap_handle,const uint8_t *frame, const uint8_t *client_mac_address, int len)
-{
-	struct ether_header *eframe = (struct ether_header *)frame;
-	int result;
+	if(opt_quiet)
+		return;
 
-	len += sizeof(*eframe);
+	format_time_received(&report->link_up,time_string,sizeof(time_string));
 
-	memmove(eframe->ether_shost, client_mac_address, ETHER_ADDR_LEN);
-	memmove(eframe->ether_dhost, broadcast_mac_address, ETHER_ADDR_LEN);
+	printf("network-interface=%s\n",report->interface_name);
+	printf("link-up=%s\n",time_string);
+	printf("time-to-discover=%.6f\n",get_seconds_between(&report->link_up,&report->discover_sent));
 
-	eframe->ether_type = htons(ETHERTYPE_IP);
+	if(report->have_first_offer)
+		printf("time-to-first-offer=%.6f\n",get_seconds_between(&report->link_up,&report->first_offer));
 
-	/* Send the packet on wire */
-	result = pcap_inject(pcap_handle, frame, len);
+	printf("number-of-servers=%d\n",report->num_offers);
 
-	return(result);
-}
+	if(report->num_offers > 0)
+	{
+		printf("\n");
+		print_dhcp_server_data(report->offer_list,false);
+	}
 
-/****************************************************************************/
+	printf("\n");
 
-/*
- * IP Output handler - Fills appropriate bytes in IP header
- */
-static int
-ip_output(struct ip *ip_header, ip4_t src_address, ip4_t dst_address, int len)
-{
-	len += sizeof(struct ip);
-
-	ip_header->ip_hl = 5;
-	ip_header->ip_v = IPVERSION;
-	ip_header->ip_tos = 0x10; /* minimize delay (RFC 1349) */
-	ip_header->ip_len = htons(len);
-	ip_header->ip_id = htons(0xffff);
-	ip_header->ip_off = 0;
-	ip_header->ip_ttl = 16;
-	ip_header->ip_p = IPPROTO_UDP;
-	ip_header->ip_sum = 0;
-	ip_header->ip_src.s_addr = src_address;
-	ip_header->ip_dst.s_addr = dst_address;
-
-	ip_header->ip_sum = in_cksum(ip_header, sizeof(struct ip));
-
-	return(len);
+	/* Whoever reads this wants to know right away. */
+	fflush(stdout);
 }
 
 /****************************************************************************/
 
-/*
- * UDP output - Fills appropriate bytes in UDP header
+/* The "watch" command: scan each network interface as soon as it comes
+ * up, until this command is stopped.
  */
 static int
-udp_output(struct ip *ip_header, ip4_t src_address, ip4_t dst_address, struct udphdr *udp_header, int len)
+watch_main(int argc, char *argv[])
 {
-	struct udp_pseudo_header * udp_pseudo_header;
-	
-	/* Length must be even. */
-	if ((len % 2) != 0)
-		len++;
+	static const struct option longopts[] =
+	{
+		{ "allowlist",			required_argument,	NULL,	'l'	},
+		{ "broadcast",			no_argument,		NULL,	'b'	},
+		{ "filter",				required_argument,	NULL,	'f'	},
+		{ "help",				no_argument,		NULL,	'h'	},
+		{ "ignore-checksums",	no_argument,		NULL,	'i'	},
+		{ "quiet",				no_argument,		NULL,	'q'	},
+		{ "settle",				required_argument,	NULL,	's'	},
+		{ "timeout",			required_argument,	NULL,	't'	},
+		{ "verbose",			no_argument,		NULL,	'v'	},
+		{ NULL,					0,					NULL,	0	}
+	};
+
+	struct link_watch * watch = NULL;
+	struct dhcp_scan_options scan_options;
+	struct allowlist * watch_allowlist = NULL;
+	struct offer_filter * watch_offer_filter = NULL;
+	const char * allowlist_file_name = NULL;
+	const char * filter_expression = NULL;
+	int settle_time = LINK_WATCH_DEFAULT_SETTLE_TIME;
+	char errbuf[256];
+	int result = EXIT_FAILURE;
+	char * p;
+	long n;
+	int c;
+
+	while((c = getopt_long(argc,argv,"bf:hil:qs:t:v",longopts,NULL)) != -1)
+	{
+		switch(c)
+		{
+			/* Request that the DHCP server responds by sending a broadcast message. */
+			case 'b':
 
-	len += sizeof(struct udphdr);
+				opt_broadcast = true;
+				break;
 
-	udp_header->uh_sport = htons(dhcp_client_port);
-	udp_header->uh_dport = htons(dhcp_server_port);
-	udp_header->uh_ulen = htons(len);
-	udp_header->uh_sum = 0;
+			/* Record only offers which match this expression. */
+			case 'f':
 
-	/* We fill the IP/UDP pseudo-header with defaults with regard
-	 * to protocol, source IPv4 address and destination IPv4 address.
-	 */
-	udp_pseudo_header = (struct udp_pseudo_header *)ip_header;
-	udp_pseudo_header->ih_zero1[0] = udp_pseudo_header->ih_zero1[1] = 0;
-	udp_pseudo_header->ih_zero2 = 0;
-	udp_pseudo_header->ih_pr = IPPROTO_UDP;
-	udp_pseudo_header->ih_src = src_address;
-	udp_pseudo_header->ih_dst = dst_address;
-	udp_pseudo_header->ih_len = udp_pseudo_header->uh_ulen;
-	
-	udp_header->uh_sum = in_cksum(ip_header,sizeof(*ip_header) + ntohs(udp_pseudo_header->uh_ulen));
-	
-	return(len);
-}
+				filter_expression = optarg;
+				break;
 
-/****************************************************************************/
+			/* Ignore IP and UDP checksums. */
+			case 'i':
 
-/*
- * DHCP output - Just fills DHCP "discover" message
- */
-static int
-dhcp_output(bootp_t *dhcp, const uint8_t *client_mac_address, uint32_t transaction_id, bool use_broadcast, int len)
-{
-	memset(dhcp, 0, sizeof(*dhcp));
+				opt_ignore_checksums = true;
+				break;
 
-	dhcp->opcode = BOOTREQUEST;
-	dhcp->htype = BOOTP_HARDWARE_TYPE_10_ETHERNET;
+			/* Known DHCP servers which are not to be reported. */
+			case 'l':
 
-	/* Request that the server responds by broadcast rather
-	 * than unicast (RFC1531, section 2).
-	 */
-	if(use_broadcast)
-		dhcp->flags = htons(0x8000);
+				allowlist_file_name = optarg;
+				break;
 
-	dhcp->hlen = ETHER_ADDR_LEN;
-	memmove(dhcp->chaddr, client_mac_address, ETHER_ADDR_LEN);
+			/* Minimize output. */
+			case 'q':
 
-	dhcp->xid = htonl(transaction_id);
+				opt_quiet = true;
+				opt_verbose = false;
 
-	dhcp->magic_cookie = htonl(DHCP_MAGIC_COOKIE);
+				break;
 
-	len += sizeof(*dhcp);
+			/* How long the carrier has to stay up (in milliseconds). */
+			case 's':
 
-	return(len);
-}
+				/* Convert text into number; balk if the conversion
+				 * failed or the resulting value is out of range.
+				 */
+				n = strtol(optarg,&p,0);
 
-/****************************************************************************/
+				if((n == 0 && p == optarg) || n < 0 || n > 60000)
+				{
+					fprintf(stderr,"%s: Parameter '--settle=%s' is not valid.\n",command_name,optarg);
+					goto out;
+				}
 
-/*
- * Adds DHCP option to the bytestream
- */
-static int
-fill_dhcp_option(uint8_t *option_buffer, uint8_t option_code, const void *option_data, int len)
-{
-	assert( 0 <= len && len < 256 );
+				settle_time = (int)n;
+				break;
 
-	option_buffer[0] = option_code;
-	option_buffer[1] = len;
+			/* How long to wait for DHCP server responses to trickle in. */
+			case 't':
 
-	if(len > 0)
-	{
-		assert( option_data != NULL );
+				/* Convert text into number; balk if the conversion
+				 * failed or the resulting value is out of range. Each
+				 * scan has to end at some point.
+				 */
+				n = strtol(optarg,&p,0);
 
-		memmove(&option_buffer[2], option_data, len);
-	}
+				if((n == 0 && p == optarg) || n < 1 || n > INT_MAX)
+				{
+					fprintf(stderr,"%s: Parameter '--timeout=%s' is not valid.\n",command_name,optarg);
+					goto out;
+				}
 
-	len += sizeof(uint8_t) * 2;
+				opt_timeout = (int)n;
+				break;
 
-	return(len);
-}
+			/* Print additional processing information. */
+			case 'v':
 
-/****************************************************************************/
+				opt_verbose = true;
+				opt_quiet = false;
 
-/*
- * Fill DHCP options
- */
-static int
-fill_dhcp_discover_options(bootp_t *dhcp, int interface_mtu)
-{
-	static const uint8_t parameter_req_list[] =
-	{
-		OPTION_TYPE_SUBNET_MASK,
-		OPTION_TYPE_GATEWAY,
-		OPTION_TYPE_DNS,
-		OPTION_TYPE_DOMAIN_NAME,
-		OPTION_TYPE_INTERFACE_MTU,
-		OPTION_TYPE_BROADCAST_ADDRESS,
-		OPTION_TYPE_PERFORM_ROUTER_DISCOVERY,
-		OPTION_TYPE_STATIC_ROUTE,
-		OPTION_TYPE_NTP_SERVERS,
-		OPTION_TYPE_NETBIOS_OVER_TCP_IP_NAME_SERVER,
-		OPTION_TYPE_NETBIOS_OVER_TCP_IP_NODE_TYPE,
-		OPTION_TYPE_NETBIOS_OVER_TCP_IP_SCOPE,
-		OPTION_TYPE_IP_ADDRESS_LEASE_TIME,
-		OPTION_TYPE_DHCP_MESSAGE_TYPE,
-		OPTION_TYPE_SERVER_IDENTIFIER,
-		OPTION_TYPE_PARAMETER_REQUEST_LIST,
-		OPTION_TYPE_MESSAGE,
-		OPTION_TYPE_MAXIMUM_DHCP_MESSAGE_SIZE,
-		OPTION_TYPE_RENEWAL_TIME,
-		OPTION_TYPE_REBINDING_TIME,
-		OPTION_TYPE_LDAP_URL,
-		OPTION_TYPE_AUTO_CONFIGURE,
-		OPTION_TYPE_DOMAIN_SEARCH,
-		OPTION_TYPE_CLASSLESS_STATIC_ROUTE,
-		OPTION_TYPE_PROXY_AUTODISCOVERY
-	};
+				break;
+
+			case 'h':
 
-	uint8_t message_type;
-	uint16_t message_size;
-	int len = 0;
+				printf("Usage: %s watch [--allowlist=<file>] [--broadcast] [--filter=<expression>] [--ignore-checksums] "
+					"[--quiet] [--settle=<milliseconds>] [--timeout=<seconds>] [--verbose] [interface ...]\n",command_name);
 
-	message_type = MESSAGE_TYPE_DISCOVER;
-	len += fill_dhcp_option(&dhcp->vend[len], OPTION_TYPE_DHCP_MESSAGE_TYPE, &message_type, sizeof(message_type));
+				result = EXIT_SUCCESS;
+				goto out;
 
-	assert( 0 < interface_mtu && interface_mtu < 65536 );
+			default:
 
-	message_size = htons(interface_mtu);
-	len += fill_dhcp_option(&dhcp->vend[len], OPTION_TYPE_MAXIMUM_DHCP_MESSAGE_SIZE, &message_size, sizeof(message_size));
+				fprintf(stderr,"%s: %s - %s\n",command_name,optarg,"option not known");
+				goto out;
+		}
+	}
 
-	len += fill_dhcp_option(&dhcp->vend[len], OPTION_TYPE_PARAMETER_REQUEST_LIST, parameter_req_list, sizeof(parameter_req_list));
+	argc -= optind;
+	argv += optind;
 
-	len += fill_dhcp_option(&dhcp->vend[len], OPTION_TYPE_END, NULL, 0);
+	if(filter_expression != NULL)
+	{
+		watch_offer_filter = compile_offer_filter(filter_expression,errbuf,sizeof(errbuf));
+		if(watch_offer_filter == NULL)
+		{
+			fprintf(stderr,"%s: Parameter '--filter=%s' is not valid: %s.\n",command_name,filter_expression,errbuf);
+			goto out;
+		}
+	}
 
-	/* Make sure that the size of the option data is an even number. */
-	if((len % 2) != 0)
-		dhcp->vend[len++] = OPTION_TYPE_PAD;
+	if(allowlist_file_name != NULL)
+	{
+		watch_allowlist = load_allowlist(allowlist_file_name,errbuf,sizeof(errbuf));
+		if(watch_allowlist == NULL)
+		{
+			if(!opt_quiet)
+				fprintf(stderr,"%s: Unable to load allowlist file '%s': %s.\n",command_name,allowlist_file_name,errbuf);
 
-	return(len);
-}
+			goto out;
+		}
+	}
 
-/****************************************************************************/
+	memset(&scan_options,0,sizeof(scan_options));
 
-/*
- * Send DHCP DISCOVER message
- */
-static int
-dhcp_discover(pcap_t *pcap_handle, const uint8_t *client_mac_address, int interface_mtu, uint32_t transaction_id, bool use_broadcast)
-{
-	int len;
-	/* The packet to be built includes the Ethernet header. There
-	 * must be room for up to 576 octets, which will be filled by
-	 * the IP header, the UDP header and the DHCP message. This
-	 * should not add up to more than 576 octets, which is the
-	 * minimum a DHCP server is required to receive and process
-	 * (RFC 2131, section 2).
-	 */
-	uint8_t packet[sizeof(struct ether_header)+576];
-	struct udphdr *udp_header;
-	struct ip *ip_header;
-	bootp_t *dhcp;
-	ip4_t src_address = 0;
-	ip4_t dst_address = 0xFFFFFFFF; /* broadcast */
-	int result;
+	get_port_numbers(&scan_options);
 
-	memset(packet,0,sizeof(packet));
+	scan_options.use_broadcast = opt_broadcast;
+	scan_options.ignore_checksums = opt_ignore_checksums;
+	scan_options.allowlist = watch_allowlist;
+	scan_options.offer_filter = watch_offer_filter;
 
-	ip_header = (struct ip *)&packet[sizeof(struct ether_header)];
-	udp_header = (struct udphdr *)&ip_header[1];
-	dhcp = (bootp_t *)&udp_header[1];
+	srand((unsigned)time(NULL) + getpid());
 
-	len = fill_dhcp_discover_options(dhcp, interface_mtu);
+	/* Watch the interfaces named, or all of them if none were. */
+	watch = create_link_watch((const char * const *)argv,argc,&scan_options,(uint32_t)rand(),
+		settle_time,opt_timeout,print_link_scan_report,NULL);
+	if(watch == NULL)
+	{
+		if(!opt_quiet)
+			fprintf(stderr,"%s: Unable to watch the network interfaces: %s.\n",command_name,strerror(errno));
 
-	len = dhcp_output(dhcp, client_mac_address, transaction_id, use_broadcast, len);
+		goto out;
+	}
 
-	/* The DHCP message must be at least 300 octets in size (RFC 1532, section 2.1).
-	 * The RFC documentation states that DHCP/BOOTP relay servers may drop
-	 * DHCP messages shorter than 300 octets. In practice DHCP servers (not
-	 * just relay servers, mind you) may ignore DHCP messages shorter than 300
-	 * octets altogether.
-	 *
-	 * Note that the 300 octets do not include the IP and UDP headers, which
-	 * add another 28 octets on top.
-	 */
-	if(len < 300)
-		len = 300;
+	if(opt_verbose)
+	{
+		printf("%s: Watching for network interfaces coming up (%d up already, which will not be scanned).\n",
+			command_name,get_link_watch_num_links(watch));
 
-	assert( sizeof(struct ether_header) + sizeof(*ip_header) + sizeof(*udp_header) + len <= (int)sizeof(packet) );
+		fflush(stdout);
+	}
 
-	len = udp_output(ip_header, src_address, dst_address, udp_header, len);
-	len = ip_output(ip_header, src_address, dst_address, len);
+	/* This returns only if something went wrong. */
+	run_link_watch(watch);
 
-	result = ether_output(pcap_handle,packet, client_mac_address, len);
+	if(!opt_quiet)
+		fprintf(stderr,"%s: Unable to watch the network interfaces: %s.\n",command_name,strerror(errno));
 
-	return result;
-}
+ out:
 
-/****************************************************************************/
+	delete_link_watch(watch);
+	delete_allowlist(watch_allowlist);
+	delete_offer_filter(watch_offer_filter);
 
-/* This stops the packet capture operation when the timer elapses. */
-static void
-alarm_signal_handler(int unused_signal __attribute__((unused)))
-{
-	longjmp(alarm_jmp_buf, 1);
+	return(result);
 }
 
 /****************************************************************************/
@@ -2104,17 +1866,36 @@ static void
 print_usage(void)
 {
 	printf("Usage: %s "
+		"[--allowlist=<file>] "
 		"[--audible] "
+		"[--baseline=<file>] "
 		"[--broadcast] "
+		"[--busy-poll=<microseconds>] "
+		"[--capture=<backend>] "
+		"[--concurrency=<number>] "
+		"[--filter=<expression>] "
+		"[--history=<directory>] "
+		"[--low-latency] "
 		"[--max-responses=<number>] "
 		"[--min-responses=<number>] "
+		"[--monitor] "
+		"[--pace=<milliseconds>] "
+		"[--publish=<name>] "
+		"[--report=<socket>] "
+		"[--stream] "
 		"[--timeout=<seconds>] "
 		"[--help] "
 		"[--ignore-checksums] "
 		"[--quiet] "
 		"[--verbose] "
-		"[interface]\n",
-		command_name);
+		"[interface ...]\n"
+		"       %s query --history=<directory> [--since=<time>] [--until=<time>] [interface]\n"
+		"       %s collect --socket=<path> [--list] [--verbose]\n"
+		"       %s sweep [--allowlist=<file>] [--broadcast] [--filter=<expression>] [--ignore-checksums]\n"
+		"             [--quiet] [--threads=<number>] [--timeout=<seconds>] [--verbose] [interface]\n"
+		"       %s watch [--allowlist=<file>] [--broadcast] [--filter=<expression>] [--ignore-checksums]\n"
+		"             [--quiet] [--settle=<milliseconds>] [--timeout=<seconds>] [--verbose] [interface ...]\n",
+		command_name,command_name,command_name,command_name,command_name);
 }
 
 /****************************************************************************/
@@ -2124,29 +1905,56 @@ main(int argc, char *argv[])
 {
 	static const struct option longopts[] =
 	{
+		{ "allowlist",			required_argument,	NULL,	'l'	},
 		{ "audible",			no_argument,		NULL,	'a'	},
+		{ "baseline",			required_argument,	NULL,	'B'	},
 		{ "broadcast",			no_argument,		NULL,	'b'	},
+		{ "busy-poll",			required_argument,	NULL,	'u'	},
+		{ "capture",			required_argument,	NULL,	'k'	},
+		{ "concurrency",		required_argument,	NULL,	'C'	},
+		{ "filter",				required_argument,	NULL,	'f'	},
 		{ "max-responses",		required_argument,	NULL,	'c'	},
 		{ "help",				no_argument,		NULL,	'h'	},
+		{ "history",			required_argument,	NULL,	'H'	},
 		{ "ignore-checksums",	no_argument,		NULL,	'i'	},
+		{ "low-latency",		no_argument,		NULL,	'L'	},
 		{ "min-responses",		required_argument,	NULL,	'm'	},
+		{ "monitor",			no_argument,		NULL,	'M'	},
+		{ "pace",				required_argument,	NULL,	'p'	},
+		{ "publish",			required_argument,	NULL,	'P'	},
+		{ "report",				required_argument,	NULL,	'R'	},
 		{ "quiet",				no_argument,		NULL,	'q'	},
+		{ "stream",				no_argument,		NULL,	'S'	},
 		{ "timeout",			required_argument,	NULL,	't'	},
 		{ "verbose",			no_argument,		NULL,	'v'	},
 		{ NULL,					0,					NULL,	0	}
 	};
 
-	struct servent * service_entry;
-	char filter_command[256];
+	struct server_fingerprint * fingerprints = NULL;
+	struct server_fingerprint * previous_fingerprints = NULL;
+	int num_fingerprints = 0;
+	int num_previous_fingerprints = 0;
 	int result = EXIT_FAILURE;
 	char errbuf[PCAP_ERRBUF_SIZE];
-	struct bpf_program filter_program;
+	struct dhcp_scan_options scan_options;
 	time_t now = time(NULL);
-	int interface_mtu = 0;
+	const char * allowlist_file_name = NULL;
+	const char * baseline_file_name = NULL;
+	const char * history_directory_name = NULL;
+	const char * shared_results_name = NULL;
+	const char * collector_socket_path = NULL;
+	struct baseline * baseline = NULL;
+	const char * filter_expression = NULL;
+	pthread_t stream_thread;
+	bool stream_thread_running = false;
+	const char * interface_name;
+	struct network_link * links = NULL;
+	size_t num_links = 0;
 	const char * s;
 	char * p;
 	long n;
 	int c;
+	int i;
 
 	/* Figure out the name of this command. Strip any
 	 * leading path from it.
@@ -2157,19 +1965,51 @@ main(int argc, char *argv[])
 	if(s != NULL)
 		command_name = s+1;
 
-	memset(&filter_program,0,sizeof(filter_program));
+	/* Look up past scan results instead of scanning? */
+	if(argc > 1 && strcmp(argv[1],"query") == 0)
+	{
+		result = query_main(argc-1,argv+1);
+		goto out;
+	}
+
+	/* Run the collector for the results of many sensors instead? */
+	if(argc > 1 && strcmp(argv[1],"collect") == 0)
+	{
+		result = collect_main(argc-1,argv+1);
+		goto out;
+	}
+
+	/* Scan all the network namespaces instead? */
+	if(argc > 1 && strcmp(argv[1],"sweep") == 0)
+	{
+		result = sweep_main(argc-1,argv+1);
+		goto out;
+	}
+
+	/* Scan the network interfaces as soon as they come up instead? */
+	if(argc > 1 && strcmp(argv[1],"watch") == 0)
+	{
+		result = watch_main(argc-1,argv+1);
+		goto out;
+	}
 
-	new_list(&dhcp_server_response_list);
+	memset(&scan_options,0,sizeof(scan_options));
 
 	/* Look at the command line parameters, if any. */
-	while((c = getopt_long(argc,argv,"ac:him:qt:v",longopts,NULL)) != -1)
+	while((c = getopt_long(argc,argv,"aB:c:C:f:hH:ik:l:Lm:Mp:P:qR:St:u:v",longopts,NULL)) != -1)
 	{
 		switch(c)
 		{
 			/* Send a ^G to the terminal for each DHCP response received. */
 			case 'a':
 
-				opt_audible = true;
+				opt_audible = true;
+				break;
+
+			/* Report only what changed since the previous run. */
+			case 'B':
+
+				baseline_file_name = optarg;
 				break;
 
 			/* Request that the DHCP server responds by sending a broadcast message. */
@@ -2178,6 +2018,12 @@ main(int argc, char *argv[])
 				opt_broadcast = true;
 				break;
 
+			/* Record only offers which match this expression. */
+			case 'f':
+
+				filter_expression = optarg;
+				break;
+
 			/* Maximum number of DHCP server responses to process. */
 			case 'c':
 
@@ -2195,6 +2041,23 @@ main(int argc, char *argv[])
 				opt_max_response_count = (int)n;
 				break;
 
+			/* How many network interfaces to scan at the same time. */
+			case 'C':
+
+				/* Convert text into number; balk if the conversion
+				 * failed or the resulting value is out of range.
+				 */
+				n = strtol(optarg,&p,0);
+
+				if((n == 0 && p == optarg) || n < 0 || n > INT_MAX)
+				{
+					fprintf(stderr,"%s: Parameter '--concurrency=%s' is not valid.\n",command_name,optarg);
+					goto out;
+				}
+
+				opt_concurrency = (int)n;
+				break;
+
 			/* Print the usage information. */
 			case 'h':
 
@@ -2209,6 +2072,53 @@ main(int argc, char *argv[])
 				opt_ignore_checksums = true;
 				break;
 				
+			/* How to capture and send frames. */
+			case 'k':
+
+				opt_capture_backend = find_capture_backend(optarg);
+				if(opt_capture_backend == NULL)
+				{
+					fprintf(stderr,"%s: Parameter '--capture=%s' is not valid.\n",command_name,optarg);
+					goto out;
+				}
+
+				break;
+
+			/* Known DHCP servers which are not to be reported. */
+			case 'l':
+
+				allowlist_file_name = optarg;
+				break;
+
+			/* Hand over each frame as soon as it arrives. */
+			case 'L':
+
+				opt_low_latency = true;
+				break;
+
+			/* Busy-poll the network device for frames. */
+			case 'u':
+
+				/* Convert text into number; balk if the conversion
+				 * failed or the resulting value is out of range.
+				 */
+				n = strtol(optarg,&p,0);
+
+				if((n == 0 && p == optarg) || n < 1 || n > INT_MAX)
+				{
+					fprintf(stderr,"%s: Parameter '--busy-poll=%s' is not valid.\n",command_name,optarg);
+					goto out;
+				}
+
+				opt_busy_poll = (int)n;
+				break;
+
+			/* Keep a record of every scan. */
+			case 'H':
+
+				history_directory_name = optarg;
+				break;
+
 			/* Minimum number of DHCP server responses required. */
 			case 'm':
 
@@ -2226,6 +2136,47 @@ main(int argc, char *argv[])
 				opt_min_response_count = (int)n;
 				break;
 
+			/* Keep scanning, reporting only changes. */
+			case 'M':
+
+				opt_monitor = true;
+				break;
+
+			/* Make the results available to other processes. */
+			case 'P':
+
+				shared_results_name = optarg;
+				break;
+
+			/* Send the results to a collector. */
+			case 'R':
+
+				collector_socket_path = optarg;
+				break;
+
+			/* How long to wait between starting two scans (in milliseconds). */
+			case 'p':
+
+				/* Convert text into number; balk if the conversion
+				 * failed or the resulting value is out of range.
+				 */
+				n = strtol(optarg,&p,0);
+
+				if((n == 0 && p == optarg) || n < 0 || n > 60000)
+				{
+					fprintf(stderr,"%s: Parameter '--pace=%s' is not valid.\n",command_name,optarg);
+					goto out;
+				}
+
+				opt_pace = (int)n;
+				break;
+
+			/* Print the DHCP server responses as soon as they arrive. */
+			case 'S':
+
+				opt_stream = true;
+				break;
+
 			/* How long to wait for DHCP server responses to trickle in. */
 			case 't':
 
@@ -2269,155 +2220,390 @@ main(int argc, char *argv[])
 	argc -= optind;
 	argv += optind;
 
-	/* No interface name provided? Pick the one which the PCAP
-	 * API suggests.
-	 */
-	if(argc == 0)
+	/* Each monitoring cycle has to end at some point. */
+	if(opt_monitor && opt_timeout == 0)
 	{
-		interface_name = pcap_lookupdev(errbuf);
-		if(interface_name == NULL)
-		{
-			if(!opt_quiet)
-				fprintf(stderr,"%s: Unable to pick network interface: %s.\n",command_name,errbuf);
+		fprintf(stderr,"%s: Parameter '--monitor' requires a timeout greater than 0.\n",command_name);
+		goto out;
+	}
 
-			goto out;
-		}
+	/* Monitoring mode already reports only what changed. */
+	if(opt_monitor && baseline_file_name != NULL)
+	{
+		fprintf(stderr,"%s: Parameter '--baseline' cannot be used together with '--monitor'.\n",command_name);
+		goto out;
 	}
-	else
+
+	/* The baseline can only be compared against once the scan is complete. */
+	if(opt_stream && baseline_file_name != NULL)
 	{
-		interface_name = argv[0];
+		fprintf(stderr,"%s: Parameter '--stream' cannot be used together with '--baseline'.\n",command_name);
+		goto out;
 	}
 
-	/* Show the preset options, or in the case of the network interface,
-	 * whatever the PCAP API may have picked.
+	/* Print the DHCP server responses received so far on request. This
+	 * must happen before any threads are started, which must not receive
+	 * these signals.
 	 */
-	if(opt_verbose)
+	offer_dump = create_offer_dump(dump_dhcp_server_data,NULL);
+	if(offer_dump == NULL && opt_verbose)
+		printf("%s: SIGUSR1 and SIGUSR2 will not be handled (%s).\n",command_name,strerror(errno));
+
+	/* Compile the filter expression once, to be used for every offer. */
+	if(filter_expression != NULL)
 	{
-		printf("%s: Using network interface %s.\n",command_name,interface_name);
-		printf("%s: Will wait for up to %d seconds for DHCP responses to arrive.\n",command_name,opt_timeout);
+		offer_filter = compile_offer_filter(filter_expression,errbuf,sizeof(errbuf));
+		if(offer_filter == NULL)
+		{
+			fprintf(stderr,"%s: Parameter '--filter=%s' is not valid: %s.\n",command_name,filter_expression,errbuf);
+			goto out;
+		}
 	}
 
-	/* Get the MAC address and MTU of the interface */
-	if (get_mac_address_and_mtu(interface_name, client_mac_address, &interface_mtu) != 0)
+	/* Load the known DHCP servers, if any. */
+	if(allowlist_file_name != NULL)
 	{
-		if(!opt_quiet)
-			fprintf(stderr,"%s: Unable to get MAC address and MTU for %s.\n",command_name,interface_name);
+		allowlist = load_allowlist(allowlist_file_name,errbuf,sizeof(errbuf));
+		if(allowlist == NULL)
+		{
+			if(!opt_quiet)
+				fprintf(stderr,"%s: Unable to load allowlist file '%s': %s.\n",command_name,allowlist_file_name,errbuf);
 
-		goto out;
+			goto out;
+		}
+
+		if(opt_verbose)
+			printf("%s: Loaded %zu known DHCP servers from '%s'.\n",command_name,get_allowlist_size(allowlist),allowlist_file_name);
+
+		/* Only unknown DHCP servers are recorded. Unless told otherwise,
+		 * success means that at least one of them responded.
+		 */
+		if(opt_min_response_count == 0)
+			opt_min_response_count = 1;
+
+		/* Pick up changes to the allowlist file while we keep running. */
+		if(opt_monitor)
+		{
+			allowlist_watch = create_allowlist_watch(allowlist_file_name,errbuf,sizeof(errbuf));
+			if(allowlist_watch == NULL && !opt_quiet)
+				fprintf(stderr,"%s: Changes to allowlist file '%s' will be ignored (%s).\n",command_name,allowlist_file_name,errbuf);
+		}
 	}
 
-	/* Open the device and get PCAP handle for it. We request snapshots large
-	 * enough to fill the MTU plus 14 bytes for the MAC header, promiscuous mode is
-	 * disabled (not needed), and we wait up to 10 milliseconds for multiple frames
-	 * to arrive (we don't want to read just one single frame at a time).
-	 */
-	pcap_handle = pcap_open_live(interface_name, 14+interface_mtu, false, 10, errbuf);
-	if (pcap_handle == NULL)
+	/* Open the record of the DHCP servers seen before, if any. */
+	if(baseline_file_name != NULL)
 	{
-		if(!opt_quiet)
-			fprintf(stderr,"%s: Unable to open device %s: %s.\n",command_name,interface_name,errbuf);
+		baseline = open_baseline(baseline_file_name);
+		if(baseline == NULL)
+		{
+			if(!opt_quiet)
+				fprintf(stderr,"%s: Unable to open baseline file '%s': %s.\n",command_name,baseline_file_name,strerror(errno));
 
-		goto out;
+			goto out;
+		}
 	}
 
-	/* Figure out the port numbers to use for sending and receiving DHCP messages. */
-	service_entry = getservbyname("bootps", "udp");
-	if(service_entry != NULL)
+	/* Prepare for recording the scan results. */
+	if(history_directory_name != NULL)
 	{
-		dhcp_server_port = ntohs(service_entry->s_port);
+		history = open_history(history_directory_name);
+		if(history == NULL)
+		{
+			if(!opt_quiet)
+				fprintf(stderr,"%s: Unable to open history directory '%s': %s.\n",command_name,history_directory_name,strerror(errno));
+
+			goto out;
+		}
 	}
-	else
+
+	/* Set up the shared memory object for the results. */
+	if(shared_results_name != NULL)
 	{
-		dhcp_server_port = DEFAULT_BOOTP_SERVER_PORT;
+		shared_results = create_shared_results(shared_results_name);
+		if(shared_results == NULL)
+		{
+			if(!opt_quiet)
+				fprintf(stderr,"%s: Unable to create shared memory object '%s': %s.\n",command_name,shared_results_name,strerror(errno));
 
-		if(!opt_quiet)
-			fprintf(stderr,"%s: Using default DHCP server port number %d.\n",command_name,dhcp_server_port);
+			goto out;
+		}
 	}
 
-	service_entry = getservbyname("bootpc", "udp");
-	if(service_entry != NULL)
+	get_port_numbers(&scan_options);
+
+	scan_options.use_broadcast = opt_broadcast;
+	scan_options.ignore_checksums = opt_ignore_checksums;
+	scan_options.max_responses = opt_max_response_count;
+	scan_options.allowlist = allowlist;
+	scan_options.offer_filter = offer_filter;
+	scan_options.callback = offer_received;
+	scan_options.capture_backend = opt_capture_backend;
+	scan_options.low_latency = opt_low_latency;
+	scan_options.busy_poll = opt_busy_poll;
+
+	/* Only the scans which are running need a capture. */
+	scan_options.defer_capture = true;
+
+	/* No interface name provided? Scan all the interfaces which are
+	 * up and running, or if they cannot be listed, the one which the
+	 * PCAP API suggests.
+	 */
+	if(argc == 0)
 	{
-		dhcp_client_port = ntohs(service_entry->s_port);
+		if(get_network_links(&links,&num_links) == 0)
+		{
+			if(open_all_dhcp_scans(links,num_links,&scan_options) < 0)
+				goto out;
+		}
+		else
+		{
+			if(opt_verbose)
+				printf("%s: Unable to list the network interfaces (%s).\n",command_name,strerror(errno));
+
+			interface_name = pcap_lookupdev(errbuf);
+			if(interface_name == NULL)
+			{
+				if(!opt_quiet)
+					fprintf(stderr,"%s: Unable to pick network interface: %s.\n",command_name,errbuf);
+
+				goto out;
+			}
+
+			if(open_one_dhcp_scan(interface_name,&scan_options) < 0)
+				goto out;
+		}
 	}
 	else
 	{
-		dhcp_client_port = DEFAULT_BOOTP_CLIENT_PORT;
+		for(i = 0 ; i < argc ; i++)
+		{
+			if(open_one_dhcp_scan(argv[i],&scan_options) < 0)
+				goto out;
+		}
+	}
 
+	/* Keep the DHCP servers and relays from being flooded if there
+	 * are many network interfaces to be scanned.
+	 */
+	scan_scheduler = create_scan_scheduler(opt_concurrency,opt_pace,scan_finished,NULL);
+	if(scan_scheduler == NULL)
+	{
 		if(!opt_quiet)
-			fprintf(stderr,"%s: Using default DHCP client port number %d.\n",command_name,dhcp_client_port);
+			fprintf(stderr,"%s: Not enough memory to schedule the scans.\n",command_name);
+
+		goto out;
 	}
 
-	/* We are only interested in the DHCP server responses, which is why
-	 * we enable a BPF filter program here. This way we only get to see
-	 * suitable frames instead of everything else, too.
+	/* Show the preset options, or in the case of the network interfaces,
+	 * whatever was picked.
 	 */
-	snprintf(filter_command, sizeof(filter_command), "udp port %d", dhcp_server_port);
+	if(opt_verbose)
+	{
+		for(i = 0 ; i < num_scans ; i++)
+			printf("%s: Using network interface %s.\n",command_name,get_dhcp_scan_interface_name(scans[i]));
+
+		printf("%s: Will wait for up to %d seconds for DHCP responses to arrive.\n",command_name,opt_timeout);
+
+		if(opt_concurrency > 0 && opt_concurrency < num_scans)
+			printf("%s: Will scan up to %d network interfaces at a time.\n",command_name,opt_concurrency);
+	}
 
-	if(pcap_compile(pcap_handle,&filter_program,filter_command,1,0) < 0 || pcap_setfilter(pcap_handle,&filter_program) < 0)
+	/* Hand the DHCP server responses over to a separate thread for
+	 * printing, so that a slow reader of the output cannot hold up the
+	 * capture. Nothing will be printed in quiet mode anyway.
+	 */
+	if(opt_stream && !opt_quiet)
 	{
-		if(!opt_quiet)
-			fprintf(stderr,"%s: Unable to set up packet filter for device %s.\n",command_name,interface_name);
+		stream_ring = create_record_ring(STREAM_RING_CAPACITY,sizeof(struct stream_record));
+		if(stream_ring == NULL)
+		{
+			fprintf(stderr,"%s: Unable to set up streaming output: %s.\n",command_name,strerror(errno));
+			goto out;
+		}
 
-		goto out;
+		errno = pthread_create(&stream_thread,NULL,stream_writer,NULL);
+		if(errno != 0)
+		{
+			fprintf(stderr,"%s: Unable to set up streaming output: %s.\n",command_name,strerror(errno));
+			goto out;
+		}
+
+		stream_thread_running = true;
 	}
 
-	/* We need a transaction ID to match our DHCP DISCOVER message
-	 * against the DHCP server response.
-	 *
-	 * The DHCP transaction number should be reasonably unique.
+	/* The DHCP transaction number should be reasonably unique.
 	 * We use a pseudo-random number, which is why we need to
 	 * prime the generator with a seed value.
 	 */
 	srand((unsigned)now + getpid() + argc);
 
-	transaction_id = (uint32_t)rand();
-
-	/* Send DHCP DISCOVER message */
-	if (dhcp_discover(pcap_handle,client_mac_address,interface_mtu,transaction_id,opt_broadcast) < 0)
+	/* In monitoring mode the scan is repeated until this command
+	 * is stopped, otherwise a single scan is performed.
+	 */
+	do
 	{
-		if(!opt_quiet)
-			fprintf(stderr,"%s: Unable to send DHCP DISCOVER on device %s: %s.\n",command_name,interface_name,pcap_geterr(pcap_handle));
+		/* Send the DHCP DISCOVER messages, each using a transaction
+		 * ID to match it against the DHCP server responses, and
+		 * listen till the DHCP OFFERs come.
+		 */
+		if(wait_for_dhcp_server_responses() < 0)
+		{
+			if(!opt_quiet)
+				fprintf(stderr,"%s: Not enough memory to wait for DHCP server responses.\n",command_name);
 
-		goto out;
+			goto out;
+		}
+
+		/* Nothing more can be done if not a single scan worked. */
+		if(num_scans_failed == num_scans)
+			goto out;
+
+		if(history != NULL && record_history() < 0)
+		{
+			if(!opt_quiet)
+				fprintf(stderr,"%s: Unable to add scan results to history directory '%s': %s.\n",command_name,history_directory_name,strerror(errno));
+
+			goto out;
+		}
+
+		if(shared_results != NULL)
+			publish_results();
+
+		/* The collector may not be running right now, which is why
+		 * this is not treated as a fatal error.
+		 */
+		if(collector_socket_path != NULL && report_to_collector(collector_socket_path) < 0 && !opt_quiet)
+			fprintf(stderr,"%s: Unable to send results to collector at '%s': %s.\n",command_name,collector_socket_path,strerror(errno));
+
+		if(opt_monitor)
+		{
+			if(get_server_fingerprints(&fingerprints,&num_fingerprints) < 0)
+			{
+				if(!opt_quiet)
+					fprintf(stderr,"%s: Not enough memory to compare DHCP server responses.\n",command_name);
+
+				goto out;
+			}
+
+			/* Report the DHCP server responses only if a server was
+			 * added, removed or changed its offer since the last scan.
+			 */
+			if(!same_server_fingerprints(fingerprints,num_fingerprints,previous_fingerprints,num_previous_fingerprints))
+			{
+				if(!opt_quiet && !opt_stream)
+				{
+					printf("number-of-servers=%d\n",num_fingerprints);
+
+					if(num_fingerprints > 0)
+					{
+						printf("\n");
+						print_all_dhcp_server_data();
+					}
+
+					printf("\n");
+					fflush(stdout);
+				}
+			}
+			else if (opt_verbose)
+			{
+				printf("%s: No change in DHCP server responses.\n",command_name);
+				fflush(stdout);
+			}
+
+			if(previous_fingerprints != NULL)
+				free(previous_fingerprints);
+
+			previous_fingerprints = fingerprints;
+			num_previous_fingerprints = num_fingerprints;
+
+			fingerprints = NULL;
+			num_fingerprints = 0;
+		}
 	}
+	while(opt_monitor);
 
-	/* Wait a limited time for all DHCP server responses to trickle in?
-	 * Once this timeout has elapsed no further responses will be
-	 * recorded and this command will exit.
-	 */
-	if(opt_timeout > 0)
+	/* Compare what was received against what was seen before. */
+	if(baseline != NULL)
 	{
-		if(setjmp(alarm_jmp_buf) == 0)
+		struct dhcp_offer * data;
+		struct baseline_server previous;
+		const char ** interface_names;
+		bool printed = false;
+		int status;
+
+		interface_names = calloc(num_scans,sizeof(*interface_names));
+		if(interface_names == NULL)
+		{
+			if(!opt_quiet)
+				fprintf(stderr,"%s: Unable to update baseline file '%s': %s.\n",command_name,baseline_file_name,strerror(errno));
+
+			goto out;
+		}
+
+		if(begin_baseline_run(baseline,time(NULL)) < 0)
 		{
-			signal(SIGALRM, alarm_signal_handler);
+			if(!opt_quiet)
+				fprintf(stderr,"%s: Unable to update baseline file '%s': %s.\n",command_name,baseline_file_name,strerror(errno));
+
+			free(interface_names);
+			goto out;
+		}
+
+		for(i = 0 ; i < num_scans ; i++)
+		{
+			interface_names[i] = get_dhcp_scan_interface_name(scans[i]);
+
+			for(data = (struct dhcp_offer *)get_list_head(get_dhcp_scan_offers(scans[i])) ;
+				data != NULL ;
+				data = (struct dhcp_offer *)get_next_node(&data->node))
+			{
+				data->baseline_status = update_baseline_server(baseline,data->server_ipv4_address,data->server_mac_address,
+					data->interface_name,data->offer_hash,&previous);
 
-			alarm((unsigned)opt_timeout);
+				if(data->baseline_status < 0)
+				{
+					if(!opt_quiet)
+						fprintf(stderr,"%s: Unable to update baseline file '%s': %s.\n",command_name,baseline_file_name,strerror(errno));
+
+					free(interface_names);
+					goto out;
+				}
+
+				if(data->baseline_status == BASELINE_STATUS_CHANGED)
+					data->first_seen = previous.first_seen;
+			}
+		}
+
+		/* Show the new and changed servers first, followed by those
+		 * which did not respond this time.
+		 */
+		if(!opt_quiet)
+			printed = print_all_dhcp_server_data();
+
+		status = finish_baseline_run(baseline,interface_names,num_scans,print_vanished_server,&printed);
+
+		free(interface_names);
 
-			/* Listen till the DHCP OFFERs come. */
-			pcap_loop(pcap_handle, -1, ether_input, NULL);
+		if(status < 0 ||
+		   commit_baseline(baseline) < 0)
+		{
+			if(!opt_quiet)
+				fprintf(stderr,"%s: Unable to update baseline file '%s': %s.\n",command_name,baseline_file_name,strerror(errno));
+
+			goto out;
 		}
 	}
-	else
+	/* Show what was received, unless it was shown already. */
+	else if (!opt_quiet && !opt_stream)
 	{
-		/* Listen till the DHCP OFFERs come. */
-		pcap_loop(pcap_handle, -1, ether_input, NULL);
+		print_all_dhcp_server_data();
 	}
 
-	/* Show what was received. */
-	if(!opt_quiet)
-		print_dhcp_server_data();
-
 	/* Should we check if more than one DHCP server responded? */
 	if(opt_min_response_count > 0)
 	{
-		int num_responses_received = 0;
-		const struct Node * node;
-
-		for(node = get_list_head(&dhcp_server_response_list) ; node != NULL ; node = get_next_node(node))
-			num_responses_received++;
-
 		/* Fewer reponses received than required? */
-		if(num_responses_received < opt_min_response_count)
+		if(get_num_offers() < opt_min_response_count)
 			goto out;
 	}
 
@@ -2425,12 +2611,46 @@ main(int argc, char *argv[])
 
  out:
 
-	if(pcap_handle != NULL)
+	/* Let the writer thread print what is left before shutting down. */
+	if(stream_thread_running)
 	{
-		pcap_freecode(&filter_program);
+		close_record_ring(stream_ring);
+		pthread_join(stream_thread,NULL);
 
-		pcap_close(pcap_handle);
+		if(get_record_ring_overflows(stream_ring) > 0)
+		{
+			fprintf(stderr,"%s: %llu DHCP server responses could not be printed because the output did not keep up.\n",
+				command_name,(unsigned long long)get_record_ring_overflows(stream_ring));
+		}
 	}
 
+	delete_record_ring(stream_ring);
+
+	delete_offer_dump(offer_dump);
+
+	delete_scan_scheduler(scan_scheduler);
+
+	for(i = 0 ; i < num_scans ; i++)
+		close_dhcp_scan(scans[i]);
+
+	if(scans != NULL)
+		free(scans);
+
+	if(links != NULL)
+		free(links);
+
+	delete_allowlist_watch(allowlist_watch);
+	delete_allowlist(allowlist);
+	delete_offer_filter(offer_filter);
+	close_baseline(baseline);
+	close_history(history);
+	delete_shared_results(shared_results);
+
+	if(fingerprints != NULL)
+		free(fingerprints);
+
+	if(previous_fingerprints != NULL)
+		free(previous_fingerprints);
+
 	return(result);
 }
@@ -0,0 +1,32 @@
+/*
+ * 64 bit FNV-1a hash function (Fowler/Noll/Vo)
+ *
+ * This is a quick, non-cryptographic hash function which is good
+ * enough for hash tables and for telling data apart.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#include "fnv_hash.h"
+
+/****************************************************************************/
+
+/* Update a 64 bit FNV-1a hash value with the given data. Start with
+ * FNV1A_64_OFFSET_BASIS as the initial hash value.
+ */
+uint64_t
+fnv1a_64(uint64_t hash,const void * data,size_t size)
+{
+	const uint8_t * octets = data;
+	size_t i;
+
+	for(i = 0 ; i < size ; i++)
+	{
+		hash ^= octets[i];
+		hash *= FNV1A_64_PRIME;
+	}
+
+	return(hash);
+}
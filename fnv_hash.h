@@ -0,0 +1,31 @@
+/*
+ * 64 bit FNV-1a hash function (Fowler/Noll/Vo)
+ *
+ * This is a quick, non-cryptographic hash function which is good
+ * enough for hash tables and for telling data apart.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#ifndef _FNV_HASH_H
+#define _FNV_HASH_H
+
+/****************************************************************************/
+
+#include <stddef.h>
+#include <stdint.h>
+
+/****************************************************************************/
+
+#define FNV1A_64_OFFSET_BASIS	0xcbf29ce484222325ULL
+#define FNV1A_64_PRIME			0x00000100000001b3ULL
+
+/****************************************************************************/
+
+uint64_t fnv1a_64(uint64_t hash, const void *data, size_t size);
+
+/****************************************************************************/
+
+#endif /* _FNV_HASH_H */
@@ -0,0 +1,1013 @@
+/*
+ * Append-only history of scan results, stored as a series of segment
+ * files in a directory, each with an index of the servers it contains.
+ *
+ * Each scan appends one record per responding DHCP server to the current
+ * segment file. The records in a segment are in chronological order.
+ * Once a segment is full, or if the system clock went backwards, the
+ * segment is sealed: an index file is written for it, which lists each
+ * server seen in the segment (sorted by interface name, IPv4 address and
+ * MAC address) along with the time it was first and last seen, and a new
+ * segment is started. Sealed segments are never modified again.
+ *
+ * Segments are named after their sequence number in hexadecimal notation,
+ * e.g. "0000002a.seg", and the index files use the same name with the
+ * ".idx" suffix.
+ *
+ * A query for the servers seen in a particular period only has to look
+ * at the segments whose time range overlaps that period. If a segment
+ * lies completely within the period, its index answers the question.
+ * Otherwise the segment is mapped into memory and the records for the
+ * period are found by binary search.
+ *
+ * If a record was only partially written, e.g. because the process
+ * stopped, it is discarded when the segment is opened again. The files
+ * use the native byte order of the machine which created them.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <limits.h>
+#include <unistd.h>
+#include <assert.h>
+
+/****************************************************************************/
+
+#include "history.h"
+
+/****************************************************************************/
+
+#define SEGMENT_MAGIC		"DHCPHSEG"
+#define INDEX_MAGIC			"DHCPHIDX"
+#define HISTORY_VERSION		1
+
+/* Maximum number of records in a segment. */
+#define SEGMENT_CAPACITY	16384
+
+/****************************************************************************/
+
+/* At the beginning of each segment file. */
+struct segment_header
+{
+	char		magic[8];
+	uint32_t	version;
+	uint32_t	record_size;
+	uint8_t		reserved[48];
+};
+
+/* At the beginning of each index file, followed by the index entries. */
+struct index_header
+{
+	char		magic[8];
+	uint32_t	version;
+	uint32_t	num_records;	/* Number of records in the segment */
+	uint32_t	num_entries;	/* Number of entries in the index */
+	uint32_t	reserved1;
+	int64_t		first_time;		/* Time of the first record in the segment */
+	int64_t		last_time;		/* Time of the last record in the segment */
+	uint8_t		reserved2[24];
+};
+
+/* What the segment knows about a server. */
+struct index_entry
+{
+	uint8_t		server_ipv4_address[4];
+	uint8_t		server_mac_address[6];
+	uint8_t		reserved1[2];
+	char		interface_name[16];
+	uint32_t	reserved2;
+	int64_t		first_seen;
+	int64_t		last_seen;
+	uint32_t	times_seen;
+	uint32_t	reserved3;
+};
+
+/****************************************************************************/
+
+struct history
+{
+	char *		directory_name;
+
+	/* The segment which records are currently appended to. */
+	unsigned	segment_number;
+	int			segment_fd;
+	uint32_t	num_records;
+	int64_t		last_time;
+};
+
+/****************************************************************************/
+
+/* Collects the results of query_history(). */
+struct query
+{
+	const char *			interface_name;
+	int64_t					from;
+	int64_t					until;
+
+	struct history_server *	servers;
+	size_t					num_servers;
+	size_t					servers_size;
+};
+
+/****************************************************************************/
+
+/* Build the name of a segment or index file. */
+static void
+get_segment_file_name(char * buffer,size_t buffer_size,const char * directory_name,unsigned number,const char * suffix)
+{
+	snprintf(buffer,buffer_size,"%s/%08x%s",directory_name,number,suffix);
+}
+
+/****************************************************************************/
+
+/* Sort segment numbers in ascending order. */
+static int
+compare_segment_numbers(const void * a,const void * b)
+{
+	unsigned x = (*(const unsigned *)a);
+	unsigned y = (*(const unsigned *)b);
+	int result;
+
+	if(x < y)
+		result = -1;
+	else if (x > y)
+		result = 1;
+	else
+		result = 0;
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Find all the segment files in a directory and return their numbers
+ * in ascending order. Returns -1 in case of error, with errno set,
+ * and 0 otherwise.
+ */
+static int
+list_segments(const char * directory_name,unsigned ** numbers_ptr,size_t * num_numbers_ptr)
+{
+	unsigned * numbers = NULL;
+	size_t num_numbers = 0;
+	size_t numbers_size = 0;
+	unsigned * new_numbers;
+	const struct dirent * entry;
+	unsigned long number;
+	int result = -1;
+	DIR * dir;
+	char * end;
+
+	dir = opendir(directory_name);
+	if(dir == NULL)
+		goto out;
+
+	while((entry = readdir(dir)) != NULL)
+	{
+		if(strlen(entry->d_name) != 8 + strlen(".seg"))
+			continue;
+
+		number = strtoul(entry->d_name,&end,16);
+		if(end != &entry->d_name[8] || strcmp(end,".seg") != 0 || number > UINT_MAX)
+			continue;
+
+		if(num_numbers == numbers_size)
+		{
+			numbers_size = (numbers_size > 0) ? 2 * numbers_size : 64;
+
+			new_numbers = realloc(numbers,numbers_size * sizeof(*numbers));
+			if(new_numbers == NULL)
+				goto out;
+
+			numbers = new_numbers;
+		}
+
+		numbers[num_numbers++] = (unsigned)number;
+	}
+
+	qsort(numbers,num_numbers,sizeof(*numbers),compare_segment_numbers);
+
+	(*numbers_ptr) = numbers;
+	(*num_numbers_ptr) = num_numbers;
+
+	numbers = NULL;
+
+	result = 0;
+
+ out:
+
+	if(dir != NULL)
+		closedir(dir);
+
+	if(numbers != NULL)
+		free(numbers);
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Sort index entries by interface name, IPv4 address and MAC address. */
+static int
+compare_index_entries(const void * a,const void * b)
+{
+	const struct index_entry * x = a;
+	const struct index_entry * y = b;
+	int result;
+
+	result = strncmp(x->interface_name,y->interface_name,sizeof(x->interface_name));
+	if(result == 0)
+		result = memcmp(x->server_ipv4_address,y->server_ipv4_address,sizeof(x->server_ipv4_address));
+
+	if(result == 0)
+		result = memcmp(x->server_mac_address,y->server_mac_address,sizeof(x->server_mac_address));
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Sort query results in the same order as index entries. */
+static int
+compare_history_servers(const void * a,const void * b)
+{
+	const struct history_server * x = a;
+	const struct history_server * y = b;
+	int result;
+
+	result = strncmp(x->interface_name,y->interface_name,sizeof(x->interface_name));
+	if(result == 0)
+		result = memcmp(x->server_ipv4_address,y->server_ipv4_address,sizeof(x->server_ipv4_address));
+
+	if(result == 0)
+		result = memcmp(x->server_mac_address,y->server_mac_address,sizeof(x->server_mac_address));
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Open the segment which new records will be appended to, creating it
+ * if necessary. Returns -1 in case of error, with errno set, and 0
+ * otherwise.
+ */
+static int
+open_segment(struct history * history)
+{
+	struct segment_header header;
+	struct history_record record;
+	unsigned * numbers = NULL;
+	size_t num_numbers = 0;
+	char file_name[PATH_MAX];
+	unsigned number = 0;
+	int result = -1;
+	struct stat st;
+	int fd = -1;
+	size_t n;
+
+	assert( history->segment_fd < 0 );
+
+	if(list_segments(history->directory_name,&numbers,&num_numbers) < 0)
+		goto out;
+
+	/* Pick the most recent segment, unless it has been sealed already. */
+	if(num_numbers > 0)
+	{
+		number = numbers[num_numbers-1];
+
+		get_segment_file_name(file_name,sizeof(file_name),history->directory_name,number,".idx");
+		if(access(file_name,F_OK) == 0)
+			number++;
+	}
+
+	get_segment_file_name(file_name,sizeof(file_name),history->directory_name,number,".seg");
+
+	fd = open(file_name,O_RDWR|O_CREAT|O_APPEND,0644);
+	if(fd < 0)
+		goto out;
+
+	if(fstat(fd,&st) < 0)
+		goto out;
+
+	if(st.st_size < (off_t)sizeof(header))
+	{
+		/* This is a new segment. */
+		memset(&header,0,sizeof(header));
+
+		memmove(header.magic,SEGMENT_MAGIC,sizeof(header.magic));
+		header.version = HISTORY_VERSION;
+		header.record_size = sizeof(struct history_record);
+
+		if(ftruncate(fd,0) < 0)
+			goto out;
+
+		if(write(fd,&header,sizeof(header)) != sizeof(header))
+		{
+			if(errno == 0)
+				errno = ENOSPC;
+
+			goto out;
+		}
+
+		n = 0;
+	}
+	else
+	{
+		if(pread(fd,&header,sizeof(header),0) != sizeof(header))
+			goto out;
+
+		if(memcmp(header.magic,SEGMENT_MAGIC,sizeof(header.magic)) != 0 ||
+		   header.version != HISTORY_VERSION ||
+		   header.record_size != sizeof(struct history_record))
+		{
+			errno = EINVAL;
+			goto out;
+		}
+
+		n = (st.st_size - sizeof(header)) / sizeof(record);
+
+		/* Drop a record which was only partially written. */
+		if(sizeof(header) + n * sizeof(record) != (size_t)st.st_size)
+		{
+			if(ftruncate(fd,sizeof(header) + n * sizeof(record)) < 0)
+				goto out;
+		}
+	}
+
+	history->last_time = INT64_MIN;
+
+	if(n > 0)
+	{
+		if(pread(fd,&record,sizeof(record),sizeof(header) + (n-1) * sizeof(record)) != sizeof(record))
+			goto out;
+
+		history->last_time = record.time;
+	}
+
+	history->segment_number = number;
+	history->segment_fd = fd;
+	history->num_records = (uint32_t)n;
+
+	fd = -1;
+
+	result = 0;
+
+ out:
+
+	if(fd >= 0)
+		close(fd);
+
+	if(numbers != NULL)
+		free(numbers);
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Write the index for the current segment, which seals it, and close
+ * the segment. Returns -1 in case of error, with errno set, and 0
+ * otherwise.
+ */
+static int
+seal_segment(struct history * history)
+{
+	const struct history_record * records;
+	struct index_entry * entries = NULL;
+	struct index_header header;
+	char temporary_name[PATH_MAX];
+	char index_name[PATH_MAX];
+	size_t num_entries;
+	void * map = MAP_FAILED;
+	size_t map_size;
+	int result = -1;
+	ssize_t size;
+	size_t i;
+	int fd = -1;
+
+	assert( history->segment_fd >= 0 && history->num_records > 0 );
+
+	/* Nothing may be indexed which is not safely stored. */
+	if(fsync(history->segment_fd) < 0)
+		goto out;
+
+	map_size = sizeof(struct segment_header) + history->num_records * sizeof(*records);
+
+	map = mmap(NULL,map_size,PROT_READ,MAP_SHARED,history->segment_fd,0);
+	if(map == MAP_FAILED)
+		goto out;
+
+	records = (const struct history_record *)((const uint8_t *)map + sizeof(struct segment_header));
+
+	entries = calloc(history->num_records,sizeof(*entries));
+	if(entries == NULL)
+		goto out;
+
+	for(i = 0 ; i < history->num_records ; i++)
+	{
+		memmove(entries[i].server_ipv4_address,records[i].server_ipv4_address,sizeof(entries[i].server_ipv4_address));
+		memmove(entries[i].server_mac_address,records[i].server_mac_address,sizeof(entries[i].server_mac_address));
+		memmove(entries[i].interface_name,records[i].interface_name,sizeof(entries[i].interface_name));
+
+		entries[i].first_seen = entries[i].last_seen = records[i].time;
+		entries[i].times_seen = 1;
+	}
+
+	/* Merge the entries for the same server. */
+	qsort(entries,history->num_records,sizeof(*entries),compare_index_entries);
+
+	for(i = 1, num_entries = 1 ; i < history->num_records ; i++)
+	{
+		if(compare_index_entries(&entries[num_entries-1],&entries[i]) == 0)
+		{
+			if(entries[num_entries-1].first_seen > entries[i].first_seen)
+				entries[num_entries-1].first_seen = entries[i].first_seen;
+
+			if(entries[num_entries-1].last_seen < entries[i].last_seen)
+				entries[num_entries-1].last_seen = entries[i].last_seen;
+
+			entries[num_entries-1].times_seen++;
+		}
+		else
+		{
+			entries[num_entries++] = entries[i];
+		}
+	}
+
+	memset(&header,0,sizeof(header));
+
+	memmove(header.magic,INDEX_MAGIC,sizeof(header.magic));
+	header.version = HISTORY_VERSION;
+	header.num_records = history->num_records;
+	header.num_entries = (uint32_t)num_entries;
+	header.first_time = records[0].time;
+	header.last_time = records[history->num_records-1].time;
+
+	/* The index must be complete before it appears under its
+	 * proper name.
+	 */
+	get_segment_file_name(temporary_name,sizeof(temporary_name),history->directory_name,history->segment_number,".tmp");
+	get_segment_file_name(index_name,sizeof(index_name),history->directory_name,history->segment_number,".idx");
+
+	fd = open(temporary_name,O_WRONLY|O_CREAT|O_TRUNC,0644);
+	if(fd < 0)
+		goto out;
+
+	size = num_entries * sizeof(*entries);
+
+	if(write(fd,&header,sizeof(header)) != sizeof(header) ||
+	   write(fd,entries,size) != size)
+	{
+		if(errno == 0)
+			errno = ENOSPC;
+
+		goto out;
+	}
+
+	if(fsync(fd) < 0)
+		goto out;
+
+	close(fd);
+	fd = -1;
+
+	if(rename(temporary_name,index_name) < 0)
+		goto out;
+
+	close(history->segment_fd);
+	history->segment_fd = -1;
+
+	result = 0;
+
+ out:
+
+	if(fd >= 0)
+	{
+		close(fd);
+		unlink(temporary_name);
+	}
+
+	if(map != MAP_FAILED)
+		munmap(map,map_size);
+
+	if(entries != NULL)
+		free(entries);
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Release the resources allocated by open_history(). Returns -1 if the
+ * current segment could not be closed properly. This is safe to call
+ * with a NULL parameter.
+ */
+int
+close_history(struct history * history)
+{
+	int result = 0;
+
+	if(history != NULL)
+	{
+		if(history->segment_fd >= 0 && close(history->segment_fd) < 0)
+			result = -1;
+
+		if(history->directory_name != NULL)
+			free(history->directory_name);
+
+		free(history);
+	}
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Prepare for adding scan results to the history kept in the given
+ * directory, which is created if necessary. Returns NULL in case of
+ * error, with errno set.
+ */
+struct history *
+open_history(const char * directory_name)
+{
+	struct history * result = NULL;
+	struct history * history;
+
+	history = calloc(1,sizeof(*history));
+	if(history == NULL)
+		goto out;
+
+	history->segment_fd = -1;
+
+	history->directory_name = strdup(directory_name);
+	if(history->directory_name == NULL)
+		goto out;
+
+	if(mkdir(directory_name,0755) < 0 && errno != EEXIST)
+		goto out;
+
+	result = history;
+	history = NULL;
+
+ out:
+
+	if(history != NULL)
+	{
+		int error = errno;
+
+		close_history(history);
+
+		errno = error;
+	}
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Append records to the history; the records should be in chronological
+ * order. Returns -1 in case of error, with errno set, and 0 otherwise.
+ */
+int
+append_history(struct history * history,const struct history_record * records,size_t num_records)
+{
+	int result = -1;
+	ssize_t size;
+	size_t i,j;
+
+	for(i = 0 ; i < num_records ; i = j)
+	{
+		if(history->segment_fd < 0 && open_segment(history) < 0)
+			goto out;
+
+		/* Start a new segment if this one is full, or if the records
+		 * would no longer be in chronological order.
+		 */
+		if(history->num_records > 0 &&
+		   (history->num_records == SEGMENT_CAPACITY || records[i].time < history->last_time))
+		{
+			if(seal_segment(history) < 0)
+				goto out;
+
+			j = i;
+			continue;
+		}
+
+		/* How many of the records can go into this segment? */
+		for(j = i + 1 ;
+			j < num_records && history->num_records + (j - i) < SEGMENT_CAPACITY && records[j].time >= records[j-1].time ;
+			j++)
+		{
+			(void)NULL;
+		}
+
+		size = (j - i) * sizeof(*records);
+
+		if(write(history->segment_fd,&records[i],size) != size)
+		{
+			if(errno == 0)
+				errno = ENOSPC;
+
+			/* Start over, so that a partially written record
+			 * will be dropped.
+			 */
+			close(history->segment_fd);
+			history->segment_fd = -1;
+
+			goto out;
+		}
+
+		history->num_records += (uint32_t)(j - i);
+		history->last_time = records[j-1].time;
+	}
+
+	result = 0;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Add a server to the query results. Returns -1 if not enough memory is
+ * available, 0 otherwise.
+ */
+static int
+add_query_result(struct query * query,const uint8_t * server_ipv4_address,const uint8_t * server_mac_address,
+	const char * interface_name,int64_t first_seen,int64_t last_seen,unsigned long times_seen)
+{
+	struct history_server * servers;
+	struct history_server * server;
+	size_t servers_size;
+	int result = -1;
+
+	if(query->num_servers == query->servers_size)
+	{
+		servers_size = (query->servers_size > 0) ? 2 * query->servers_size : 64;
+
+		servers = realloc(query->servers,servers_size * sizeof(*servers));
+		if(servers == NULL)
+			goto out;
+
+		query->servers = servers;
+		query->servers_size = servers_size;
+	}
+
+	server = &query->servers[query->num_servers++];
+
+	memset(server,0,sizeof(*server));
+
+	memmove(server->server_ipv4_address,server_ipv4_address,sizeof(server->server_ipv4_address));
+	memmove(server->server_mac_address,server_mac_address,sizeof(server->server_mac_address));
+	memmove(server->interface_name,interface_name,sizeof(server->interface_name));
+
+	server->first_seen = (time_t)first_seen;
+	server->last_seen = (time_t)last_seen;
+	server->times_seen = times_seen;
+
+	result = 0;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Merge the query results for the same server, so that each server
+ * is listed only once.
+ */
+static void
+merge_query_results(struct query * query)
+{
+	struct history_server * servers = query->servers;
+	size_t num_servers = 0;
+	size_t i;
+
+	if(query->num_servers == 0)
+		return;
+
+	qsort(servers,query->num_servers,sizeof(*servers),compare_history_servers);
+
+	for(i = 1, num_servers = 1 ; i < query->num_servers ; i++)
+	{
+		if(compare_history_servers(&servers[num_servers-1],&servers[i]) == 0)
+		{
+			if(servers[num_servers-1].first_seen > servers[i].first_seen)
+				servers[num_servers-1].first_seen = servers[i].first_seen;
+
+			if(servers[num_servers-1].last_seen < servers[i].last_seen)
+				servers[num_servers-1].last_seen = servers[i].last_seen;
+
+			servers[num_servers-1].times_seen += servers[i].times_seen;
+		}
+		else
+		{
+			servers[num_servers++] = servers[i];
+		}
+	}
+
+	query->num_servers = num_servers;
+}
+
+/****************************************************************************/
+
+/* Check if a server was seen on the interface the query is about. */
+static bool
+is_query_interface(const struct query * query,const char * interface_name)
+{
+	return(query->interface_name == NULL || strncmp(query->interface_name,interface_name,16) == 0);
+}
+
+/****************************************************************************/
+
+/* Answer the query from a segment's index, which is possible if the
+ * segment lies completely within the period queried. Returns -1 in
+ * case of error, with errno set, and 0 otherwise.
+ */
+static int
+query_index(struct query * query,int fd,const struct index_header * header)
+{
+	const struct index_entry * entries;
+	struct index_entry key;
+	void * map = MAP_FAILED;
+	size_t map_size;
+	int result = -1;
+	size_t lo,hi,mid;
+	size_t i;
+
+	map_size = sizeof(*header) + header->num_entries * sizeof(*entries);
+
+	map = mmap(NULL,map_size,PROT_READ,MAP_SHARED,fd,0);
+	if(map == MAP_FAILED)
+		goto out;
+
+	entries = (const struct index_entry *)((const uint8_t *)map + sizeof(*header));
+
+	/* The entries are sorted by interface name first, so the
+	 * entries for the interface are next to each other.
+	 */
+	lo = 0;
+	hi = header->num_entries;
+
+	if(query->interface_name != NULL)
+	{
+		memset(&key,0,sizeof(key));
+		strncpy(key.interface_name,query->interface_name,sizeof(key.interface_name));
+
+		while(lo < hi)
+		{
+			mid = lo + (hi - lo) / 2;
+
+			if(strncmp(entries[mid].interface_name,key.interface_name,sizeof(key.interface_name)) < 0)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+
+		hi = header->num_entries;
+	}
+
+	for(i = lo ; i < hi && is_query_interface(query,entries[i].interface_name) ; i++)
+	{
+		if(add_query_result(query,entries[i].server_ipv4_address,entries[i].server_mac_address,
+			entries[i].interface_name,entries[i].first_seen,entries[i].last_seen,entries[i].times_seen) < 0)
+		{
+			goto out;
+		}
+	}
+
+	result = 0;
+
+ out:
+
+	if(map != MAP_FAILED)
+		munmap(map,map_size);
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Answer the query from the records in a segment, looking only at the
+ * period queried. Returns -1 in case of error, with errno set, and 0
+ * otherwise.
+ */
+static int
+query_segment(struct query * query,const char * file_name)
+{
+	const struct history_record * records;
+	struct segment_header header;
+	struct history_record first,last;
+	void * map = MAP_FAILED;
+	size_t map_size = 0;
+	int result = -1;
+	size_t lo,hi,mid;
+	struct stat st;
+	int fd;
+	size_t n;
+	size_t i;
+
+	fd = open(file_name,O_RDONLY);
+	if(fd < 0)
+		goto out;
+
+	if(fstat(fd,&st) < 0)
+		goto out;
+
+	if(st.st_size < (off_t)sizeof(header))
+	{
+		result = 0;
+		goto out;
+	}
+
+	if(pread(fd,&header,sizeof(header),0) != sizeof(header))
+		goto out;
+
+	if(memcmp(header.magic,SEGMENT_MAGIC,sizeof(header.magic)) != 0 ||
+	   header.version != HISTORY_VERSION ||
+	   header.record_size != sizeof(*records))
+	{
+		errno = EINVAL;
+		goto out;
+	}
+
+	n = (st.st_size - sizeof(header)) / sizeof(*records);
+	if(n == 0)
+	{
+		result = 0;
+		goto out;
+	}
+
+	/* Skip the segment unless it overlaps the period queried. */
+	if(pread(fd,&first,sizeof(first),sizeof(header)) != sizeof(first) ||
+	   pread(fd,&last,sizeof(last),sizeof(header) + (n-1) * sizeof(last)) != sizeof(last))
+	{
+		goto out;
+	}
+
+	if(first.time > query->until || last.time < query->from)
+	{
+		result = 0;
+		goto out;
+	}
+
+	map_size = sizeof(header) + n * sizeof(*records);
+
+	map = mmap(NULL,map_size,PROT_READ,MAP_SHARED,fd,0);
+	if(map == MAP_FAILED)
+		goto out;
+
+	records = (const struct history_record *)((const uint8_t *)map + sizeof(header));
+
+	/* Find the first record of the period. */
+	lo = 0;
+	hi = n;
+
+	while(lo < hi)
+	{
+		mid = lo + (hi - lo) / 2;
+
+		if(records[mid].time < query->from)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	for(i = lo ; i < n && records[i].time <= query->until ; i++)
+	{
+		if(!is_query_interface(query,records[i].interface_name))
+			continue;
+
+		if(add_query_result(query,records[i].server_ipv4_address,records[i].server_mac_address,
+			records[i].interface_name,records[i].time,records[i].time,1) < 0)
+		{
+			goto out;
+		}
+	}
+
+	result = 0;
+
+ out:
+
+	if(map != MAP_FAILED)
+		munmap(map,map_size);
+
+	if(fd >= 0)
+		close(fd);
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Find the servers which were seen on the given interface (or on any
+ * interface if NULL) between the two points in time, inclusive. The
+ * results are sorted by interface name, IPv4 address and MAC address,
+ * and must be freed by the caller. Returns -1 in case of error, with
+ * errno set, and 0 otherwise.
+ */
+int
+query_history(const char * directory_name,const char * interface_name,time_t from,time_t until,
+	struct history_server ** servers_ptr,size_t * num_servers_ptr)
+{
+	struct index_header header;
+	unsigned * numbers = NULL;
+	size_t num_numbers = 0;
+	char file_name[PATH_MAX];
+	struct query query;
+	struct stat st;
+	int result = -1;
+	bool use_index;
+	int fd = -1;
+	size_t i;
+
+	memset(&query,0,sizeof(query));
+
+	query.interface_name = interface_name;
+	query.from = from;
+	query.until = until;
+
+	if(list_segments(directory_name,&numbers,&num_numbers) < 0)
+		goto out;
+
+	for(i = 0 ; i < num_numbers ; i++)
+	{
+		use_index = false;
+
+		/* Sealed segments have an index which tells which period
+		 * they cover.
+		 */
+		get_segment_file_name(file_name,sizeof(file_name),directory_name,numbers[i],".idx");
+
+		fd = open(file_name,O_RDONLY);
+		if(fd >= 0)
+		{
+			if(fstat(fd,&st) == 0 &&
+			   pread(fd,&header,sizeof(header),0) == sizeof(header) &&
+			   memcmp(header.magic,INDEX_MAGIC,sizeof(header.magic)) == 0 &&
+			   header.version == HISTORY_VERSION &&
+			   (off_t)(sizeof(header) + header.num_entries * sizeof(struct index_entry)) == st.st_size)
+			{
+				if(header.first_time > query.until || header.last_time < query.from)
+				{
+					close(fd);
+					fd = -1;
+
+					continue;
+				}
+
+				use_index = (query.from <= header.first_time && header.last_time <= query.until);
+			}
+
+			if(use_index && query_index(&query,fd,&header) < 0)
+				goto out;
+
+			close(fd);
+			fd = -1;
+		}
+
+		if(!use_index)
+		{
+			get_segment_file_name(file_name,sizeof(file_name),directory_name,numbers[i],".seg");
+
+			if(query_segment(&query,file_name) < 0)
+				goto out;
+		}
+
+		/* Keep the number of results in check. */
+		merge_query_results(&query);
+	}
+
+	(*servers_ptr) = query.servers;
+	(*num_servers_ptr) = query.num_servers;
+
+	query.servers = NULL;
+
+	result = 0;
+
+ out:
+
+	if(fd >= 0)
+		close(fd);
+
+	if(query.servers != NULL)
+		free(query.servers);
+
+	if(numbers != NULL)
+		free(numbers);
+
+	return(result);
+}
@@ -0,0 +1,61 @@
+/*
+ * Append-only history of scan results, stored as a series of segment
+ * files in a directory, each with an index of the servers it contains.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#ifndef _HISTORY_H
+#define _HISTORY_H
+
+/****************************************************************************/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+/****************************************************************************/
+
+/* A DHCP server which responded to a scan, as stored in a segment file. */
+struct history_record
+{
+	int64_t		time;
+	uint8_t		server_ipv4_address[4];
+	uint8_t		server_mac_address[6];
+	uint8_t		reserved1[2];
+	char		interface_name[16];
+	uint32_t	reserved2;
+	uint64_t	offer_hash;
+};
+
+/****************************************************************************/
+
+/* A DHCP server found by query_history(), with the time it was first and
+ * last seen in the period queried, and in how many scans it responded.
+ */
+struct history_server
+{
+	uint8_t			server_ipv4_address[4];
+	uint8_t			server_mac_address[6];
+	char			interface_name[16];
+	time_t			first_seen;
+	time_t			last_seen;
+	unsigned long	times_seen;
+};
+
+/****************************************************************************/
+
+struct history;
+
+/****************************************************************************/
+
+struct history *open_history(const char *directory_name);
+int close_history(struct history *history);
+int append_history(struct history *history, const struct history_record *records, size_t num_records);
+int query_history(const char *directory_name, const char *interface_name, time_t from, time_t until, struct history_server **servers_ptr, size_t *num_servers_ptr);
+
+/****************************************************************************/
+
+#endif /* _HISTORY_H */
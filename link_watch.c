@@ -0,0 +1,612 @@
+/*
+ * Scan a network interface for DHCP servers as soon as it comes up.
+ *
+ * Rogue DHCP servers tend to show up when a switch port comes up, which
+ * is why waiting for the next periodic scan leaves them unnoticed for too
+ * long. Instead, the kernel's notifications of network interface changes
+ * are watched, and a scan is started shortly after an interface gains its
+ * carrier. The carrier may come and go a few times while the link is being
+ * negotiated, which is why the scan starts only once the interface has
+ * stayed up for the settle time. Should it go down again before then, the
+ * scan is called off.
+ *
+ * The notifications describe the interfaces completely, including their
+ * hardware addresses and MTUs, which are kept for opening the scans. This
+ * saves looking them up again at the very moment the scan should start.
+ * Should the kernel drop notifications because they were not picked up
+ * in time, the state of all the interfaces is read again.
+ *
+ * This is supported only on Linux, because it relies upon the link
+ * monitor.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <stdio.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+
+/****************************************************************************/
+
+#include "link_watch.h"
+#include "network_links.h"
+#include "dhcp_offer.h"
+
+/****************************************************************************/
+
+/* A network interface being watched, and the scan triggered by its
+ * coming up, if any.
+ */
+struct watched_link
+{
+	struct Node				node;
+	struct link_watch *		watch;
+
+	struct network_link		link;			/* As last reported by the kernel */
+	bool					scannable;		/* Up and running */
+	bool					seen;			/* Still there after reading them all again */
+
+	bool					scan_pending;	/* Waiting for the carrier to settle */
+	struct timespec			scan_due;
+
+	struct timeval			link_up;
+	struct timeval			discover_sent;
+	bool					have_first_offer;
+	struct timeval			first_offer;
+	struct dhcp_scan *		scan;
+};
+
+struct link_watch
+{
+	const char * const *		interface_names;	/* NULL for all of them */
+	int							num_interface_names;
+
+	struct dhcp_scan_options	options;
+	struct scan_clock *			clock;				/* Same as the scans use */
+	uint32_t					transaction_id;
+	int							settle_time;
+	int							timeout;
+
+	link_scan_function			function;
+	void *						user_data;
+
+	struct link_monitor *		monitor;
+	struct List					link_list;
+	bool						initializing;		/* No scans for the interfaces found at first */
+
+	struct pollfd *				pfd;
+	int							pfd_size;
+};
+
+/****************************************************************************/
+
+/* Check if the network interface is one of those to be watched. */
+static bool
+is_link_watched(const struct link_watch * watch,const char * interface_name)
+{
+	bool result = false;
+	int i;
+
+	if(watch->interface_names == NULL)
+	{
+		result = true;
+	}
+	else
+	{
+		for(i = 0 ; i < watch->num_interface_names ; i++)
+		{
+			if(strcmp(watch->interface_names[i],interface_name) == 0)
+			{
+				result = true;
+				break;
+			}
+		}
+	}
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Hand what the scan found over to the caller, and close the scan. */
+static void
+finish_link_scan(struct link_watch * watch,struct watched_link * wl,const char * error)
+{
+	struct link_scan_report report;
+	struct List empty_list;
+
+	new_list(&empty_list);
+
+	memset(&report,0,sizeof(report));
+
+	report.interface_name	= wl->link.name;
+	report.link_up			= wl->link_up;
+	report.discover_sent	= wl->discover_sent;
+	report.have_first_offer	= wl->have_first_offer;
+	report.first_offer		= wl->first_offer;
+	report.error			= error;
+
+	if(wl->scan != NULL)
+	{
+		report.offer_list = get_dhcp_scan_offers(wl->scan);
+		report.num_offers = get_dhcp_scan_num_offers(wl->scan);
+	}
+	else
+	{
+		report.offer_list = &empty_list;
+	}
+
+	(*watch->function)(&report,watch->user_data);
+
+	close_dhcp_scan(wl->scan);
+	wl->scan = NULL;
+}
+
+/****************************************************************************/
+
+/* Called for each offer received by one of the scans. The time at which
+ * the first one arrived is noted before the offer is passed on to the
+ * callback function the caller provided, if any.
+ */
+static void
+link_offer_received(const struct dhcp_offer * offer,int what,void * user_data)
+{
+	struct watched_link * wl = user_data;
+	struct link_watch * watch = wl->watch;
+
+	if(what == DHCP_SCAN_OFFER_RECORDED && !wl->have_first_offer)
+	{
+		wl->first_offer = offer->stamp;
+		wl->have_first_offer = true;
+	}
+
+	if(watch->options.callback != NULL)
+		(*watch->options.callback)(offer,what,watch->options.user_data);
+}
+
+/****************************************************************************/
+
+/* Open the scan on a network interface which has come up, and send the
+ * DHCP DISCOVER message, using the hardware address and MTU which the
+ * kernel reported.
+ */
+static void
+start_link_scan(struct link_watch * watch,struct watched_link * wl)
+{
+	struct dhcp_scan_options options;
+	char error_buffer[256];
+
+	wl->scan_pending = false;
+	wl->have_first_offer = false;
+
+	options = watch->options;
+
+	options.interface_mac_address	= wl->link.mac_address;
+	options.interface_mtu			= wl->link.mtu;
+	options.callback				= link_offer_received;
+	options.user_data				= wl;
+
+	wl->scan = open_dhcp_scan(wl->link.name,&options,error_buffer,sizeof(error_buffer));
+	if(wl->scan == NULL)
+	{
+		finish_link_scan(watch,wl,error_buffer);
+		return;
+	}
+
+	if(start_dhcp_scan(wl->scan,watch->transaction_id++,watch->timeout) < 0)
+	{
+		snprintf(error_buffer,sizeof(error_buffer),"%s",get_dhcp_scan_error(wl->scan));
+
+		finish_link_scan(watch,wl,error_buffer);
+		return;
+	}
+
+	(*watch->clock->get_time_of_day)(watch->clock,&wl->discover_sent);
+}
+
+/****************************************************************************/
+
+/* Forget about a network interface, calling off its scan. */
+static void
+remove_watched_link(struct link_watch * watch,struct watched_link * wl,const char * reason)
+{
+	if(wl->scan != NULL)
+		finish_link_scan(watch,wl,reason);
+
+	remove_node(&wl->node);
+	free(wl);
+}
+
+/****************************************************************************/
+
+/* Find a network interface by its index. */
+static struct watched_link *
+find_watched_link(const struct link_watch * watch,int index)
+{
+	struct watched_link * result = NULL;
+	struct watched_link * wl;
+
+	for(wl = (struct watched_link *)get_list_head(&watch->link_list) ;
+		wl != NULL ;
+		wl = (struct watched_link *)get_next_node(&wl->node))
+	{
+		if(wl->link.index == index)
+		{
+			result = wl;
+			break;
+		}
+	}
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Called for each change to a network interface which the kernel
+ * reports. A scan is scheduled when an interface comes up, and called
+ * off when it goes down again.
+ */
+static void
+link_changed(const struct network_link * link,bool removed,void * user_data)
+{
+	struct link_watch * watch = user_data;
+	struct watched_link * wl;
+	bool was_scannable;
+
+	wl = find_watched_link(watch,link->index);
+
+	/* The interface may have been renamed into or out of the set to be
+	 * watched, too.
+	 */
+	if(removed || !is_link_watched(watch,link->name))
+	{
+		if(wl != NULL)
+			remove_watched_link(watch,wl,"network interface is gone");
+
+		return;
+	}
+
+	if(wl == NULL)
+	{
+		wl = calloc(1,sizeof(*wl));
+
+		/* This interface will just have to be left out. */
+		if(wl == NULL)
+			return;
+
+		wl->watch = watch;
+
+		add_node_to_list_tail(&watch->link_list,&wl->node);
+	}
+
+	was_scannable = wl->scannable;
+
+	wl->link = (*link);
+	wl->scannable = is_network_link_scannable(link);
+	wl->seen = true;
+
+	if(!was_scannable && wl->scannable)
+	{
+		/* The interfaces which are up already when the watch begins
+		 * are not scanned.
+		 */
+		if(!watch->initializing)
+		{
+			(*watch->clock->get_time_of_day)(watch->clock,&wl->link_up);
+
+			(*watch->clock->get_monotonic_time)(watch->clock,&wl->scan_due);
+
+			wl->scan_due.tv_sec += watch->settle_time / 1000;
+			wl->scan_due.tv_nsec += (watch->settle_time % 1000) * 1000000L;
+
+			if(wl->scan_due.tv_nsec >= 1000000000L)
+			{
+				wl->scan_due.tv_sec++;
+				wl->scan_due.tv_nsec -= 1000000000L;
+			}
+
+			wl->scan_pending = true;
+		}
+	}
+	else if (was_scannable && !wl->scannable)
+	{
+		wl->scan_pending = false;
+
+		if(wl->scan != NULL)
+			finish_link_scan(watch,wl,"network interface went down");
+	}
+}
+
+/****************************************************************************/
+
+/* Find out where all the network interfaces stand, either because the
+ * watch has just begun or because the kernel had to drop some of the
+ * notifications. Returns -1 in case of error, with errno set, and 0
+ * otherwise.
+ */
+static int
+read_all_links(struct link_watch * watch)
+{
+	struct network_link * links = NULL;
+	struct watched_link * wl;
+	struct watched_link * next_wl;
+	size_t num_links = 0;
+	int result = -1;
+	size_t i;
+
+	if(get_network_links(&links,&num_links) < 0)
+		goto out;
+
+	for(wl = (struct watched_link *)get_list_head(&watch->link_list) ;
+		wl != NULL ;
+		wl = (struct watched_link *)get_next_node(&wl->node))
+	{
+		wl->seen = false;
+	}
+
+	for(i = 0 ; i < num_links ; i++)
+		link_changed(&links[i],false,watch);
+
+	/* Those which were not listed any more must have been removed. */
+	for(wl = (struct watched_link *)get_list_head(&watch->link_list) ;
+		wl != NULL ;
+		wl = next_wl)
+	{
+		next_wl = (struct watched_link *)get_next_node(&wl->node);
+
+		if(!wl->seen)
+			remove_watched_link(watch,wl,"network interface is gone");
+	}
+
+	result = 0;
+
+ out:
+
+	free(links);
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Stop watching, calling off any scans which are still running. This is
+ * safe to call with a NULL parameter.
+ */
+void
+delete_link_watch(struct link_watch * watch)
+{
+	struct watched_link * wl;
+
+	if(watch != NULL)
+	{
+		while((wl = (struct watched_link *)get_list_head(&watch->link_list)) != NULL)
+		{
+			close_dhcp_scan(wl->scan);
+
+			remove_node(&wl->node);
+			free(wl);
+		}
+
+		close_link_monitor(watch->monitor);
+
+		free(watch->pfd);
+		free(watch);
+	}
+}
+
+/****************************************************************************/
+
+/* Start watching the named network interfaces, or all of them if none
+ * are named, for coming up. Each scan uses the options given, waiting for
+ * up to timeout seconds for responses, and the function is invoked once
+ * it is done. The names must remain valid while the watch is running.
+ * Returns NULL in case of error, with errno set.
+ */
+struct link_watch *
+create_link_watch(const char * const * interface_names,int num_interface_names,
+	const struct dhcp_scan_options * options,uint32_t transaction_id,
+	int settle_time,int timeout,link_scan_function function,void * user_data)
+{
+	struct link_watch * result = NULL;
+	struct link_watch * watch;
+
+	watch = calloc(1,sizeof(*watch));
+	if(watch == NULL)
+		goto out;
+
+	new_list(&watch->link_list);
+
+	watch->interface_names		= (num_interface_names > 0) ? interface_names : NULL;
+	watch->num_interface_names	= num_interface_names;
+	watch->options				= (*options);
+	watch->clock				= (options->clock != NULL) ? options->clock : &system_scan_clock;
+	watch->transaction_id		= transaction_id;
+	watch->settle_time			= (settle_time > 0) ? settle_time : 0;
+	watch->timeout				= timeout;
+	watch->function				= function;
+	watch->user_data			= user_data;
+
+	/* Listen before looking, so that no change goes unnoticed. */
+	watch->monitor = open_link_monitor();
+	if(watch->monitor == NULL)
+		goto out;
+
+	watch->initializing = true;
+
+	if(read_all_links(watch) < 0)
+		goto out;
+
+	watch->initializing = false;
+
+	result = watch;
+	watch = NULL;
+
+ out:
+
+	if(watch != NULL)
+	{
+		int error = errno;
+
+		delete_link_watch(watch);
+
+		errno = error;
+	}
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Count the network interfaces being watched which are up and running. */
+int
+get_link_watch_num_links(const struct link_watch * watch)
+{
+	const struct watched_link * wl;
+	int result = 0;
+
+	for(wl = (const struct watched_link *)get_list_head(&watch->link_list) ;
+		wl != NULL ;
+		wl = (const struct watched_link *)get_next_node(&wl->node))
+	{
+		if(wl->scannable)
+			result++;
+	}
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Watch the network interfaces and run the scans until something goes
+ * wrong. Returns -1 with errno set.
+ */
+int
+run_link_watch(struct link_watch * watch)
+{
+	struct watched_link * wl;
+	struct watched_link * next_wl;
+	struct pollfd * pfd;
+	int num_links;
+	int num_fds;
+	int timeout;
+	int poll_timeout;
+
+	while(true)
+	{
+		num_links = 0;
+
+		for(wl = (struct watched_link *)get_list_head(&watch->link_list) ;
+			wl != NULL ;
+			wl = (struct watched_link *)get_next_node(&wl->node))
+		{
+			num_links++;
+		}
+
+		if(watch->pfd_size < 1 + num_links)
+		{
+			pfd = realloc(watch->pfd,(1 + num_links) * sizeof(*pfd));
+			if(pfd == NULL)
+				break;
+
+			watch->pfd = pfd;
+			watch->pfd_size = 1 + num_links;
+		}
+
+		pfd = watch->pfd;
+
+		pfd[0].fd = get_link_monitor_fd(watch->monitor);
+		pfd[0].events = POLLIN;
+		pfd[0].revents = 0;
+
+		num_fds = 1;
+		poll_timeout = -1;
+
+		/* Wake up in time for whichever scan needs it first, or for
+		 * the carrier to have settled down.
+		 */
+		for(wl = (struct watched_link *)get_list_head(&watch->link_list) ;
+			wl != NULL ;
+			wl = (struct watched_link *)get_next_node(&wl->node))
+		{
+			if(wl->scan != NULL)
+			{
+				pfd[num_fds].fd = get_dhcp_scan_fd(wl->scan);
+				pfd[num_fds].events = POLLIN;
+				pfd[num_fds].revents = 0;
+
+				num_fds++;
+
+				timeout = get_dhcp_scan_poll_timeout(wl->scan);
+			}
+			else if (wl->scan_pending)
+			{
+				timeout = get_scan_clock_milliseconds_until(watch->clock,&wl->scan_due);
+			}
+			else
+			{
+				continue;
+			}
+
+			if(poll_timeout < 0 || timeout < poll_timeout)
+				poll_timeout = timeout;
+		}
+
+		if((*watch->clock->poll)(watch->clock,pfd,num_fds,poll_timeout) < 0)
+		{
+			if(errno == EINTR)
+				continue;
+
+			break;
+		}
+
+		if(pfd[0].revents & POLLIN)
+		{
+			if(read_link_monitor(watch->monitor,link_changed,watch) < 0)
+			{
+				/* Some changes were lost, which is why everything has
+				 * to be looked at again.
+				 */
+				if(errno != ENOBUFS || read_all_links(watch) < 0)
+					break;
+			}
+		}
+
+		/* The scans may finish or be started, but the interfaces
+		 * remain where they are.
+		 */
+		for(wl = (struct watched_link *)get_list_head(&watch->link_list) ;
+			wl != NULL ;
+			wl = next_wl)
+		{
+			next_wl = (struct watched_link *)get_next_node(&wl->node);
+
+			if(wl->scan != NULL)
+			{
+				if(dispatch_dhcp_scan(wl->scan) < 0)
+				{
+					char error_buffer[256];
+
+					snprintf(error_buffer,sizeof(error_buffer),"%s",get_dhcp_scan_error(wl->scan));
+
+					finish_link_scan(watch,wl,error_buffer);
+				}
+				else if (is_dhcp_scan_done(wl->scan))
+				{
+					finish_link_scan(watch,wl,NULL);
+				}
+			}
+			else if (wl->scan_pending && get_scan_clock_milliseconds_until(watch->clock,&wl->scan_due) == 0)
+			{
+				start_link_scan(watch,wl);
+			}
+		}
+	}
+
+	return(-1);
+}
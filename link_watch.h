@@ -0,0 +1,62 @@
+/*
+ * Scan a network interface for DHCP servers as soon as it comes up.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#ifndef _LINK_WATCH_H
+#define _LINK_WATCH_H
+
+/****************************************************************************/
+
+#include <sys/time.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/****************************************************************************/
+
+#include "list_node.h"
+#include "dhcp_scan.h"
+
+/****************************************************************************/
+
+/* How long to wait (in milliseconds) by default for the carrier to settle
+ * down before the scan is started.
+ */
+#define LINK_WATCH_DEFAULT_SETTLE_TIME 50
+
+/****************************************************************************/
+
+/* What the scan triggered by a network interface coming up found. */
+struct link_scan_report
+{
+	const char *		interface_name;
+	struct timeval		link_up;			/* When the carrier was detected */
+	struct timeval		discover_sent;		/* When the DHCP DISCOVER went out */
+	bool				have_first_offer;
+	struct timeval		first_offer;		/* When the first offer was recorded */
+	const struct List *	offer_list;			/* Offers recorded, in the order in which they arrived */
+	int					num_offers;
+	const char *		error;				/* NULL unless the scan failed */
+};
+
+/* Invoked once the scan triggered by a network interface coming up is done. */
+typedef void (*link_scan_function)(const struct link_scan_report *report, void *user_data);
+
+/****************************************************************************/
+
+struct link_watch;
+
+/****************************************************************************/
+
+struct link_watch *create_link_watch(const char * const *interface_names, int num_interface_names, const struct dhcp_scan_options *options, uint32_t transaction_id, int settle_time, int timeout, link_scan_function function, void *user_data);
+void delete_link_watch(struct link_watch *watch);
+int get_link_watch_num_links(const struct link_watch *watch);
+int run_link_watch(struct link_watch *watch);
+
+/****************************************************************************/
+
+#endif /* _LINK_WATCH_H */
@@ -170,6 +170,36 @@ remove_list_tail(struct List * list)
 
 /****************************************************************************/
 
+/* Move all the nodes of one list to the end of another list, leaving the
+ * first list empty. This takes the same time regardless of how many
+ * nodes are moved.
+ */
+void
+move_list(
+	struct List * to,
+	struct List * from)
+{
+	struct Node * tail;
+	struct Node * tailPred;
+
+	assert(to != NULL && from != NULL);
+	assert(to->lh_TailPred != NULL && from->lh_Head != NULL);
+
+	if(from->lh_Head->ln_Succ != NULL)
+	{
+		tail						= (struct Node *)&to->lh_Tail;
+		tailPred					= tail->ln_Pred;
+		tailPred->ln_Succ			= from->lh_Head;
+		from->lh_Head->ln_Pred		= tailPred;
+		from->lh_TailPred->ln_Succ	= tail;
+		tail->ln_Pred				= from->lh_TailPred;
+
+		new_list(from);
+	}
+}
+
+/****************************************************************************/
+
 bool
 is_list_empty(const struct List * list)
 {
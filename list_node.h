@@ -40,6 +40,7 @@ void insert_node(struct List *list __attribute__((unused)), struct Node *list_no
 void remove_node(struct Node *node);
 struct Node *remove_list_head(struct List *list);
 struct Node *remove_list_tail(struct List *list);
+void move_list(struct List *to, struct List *from);
 bool is_list_empty(const struct List *list);
 const struct Node *get_list_head(const struct List *list);
 const struct Node *get_list_tail(const struct List *list);
@@ -0,0 +1,442 @@
+/*
+ * Scan for DHCP servers in many network namespaces at the same time.
+ *
+ * The network namespaces are found in /run/netns, where "ip netns"
+ * keeps the named ones, and through /proc/<pid>/ns/net for those which
+ * are only in use by processes, e.g. containers. The same namespace
+ * may be found through several of these paths, which is why they are
+ * told apart by device and inode number.
+ *
+ * The scans are performed by a fixed number of worker threads, each of
+ * which picks the next namespace to be scanned, switches to it with
+ * setns() and scans it. This affects only the worker thread itself, and
+ * the capture socket, once opened, stays in the namespace in which it
+ * was created.
+ *
+ * This is supported only on Linux.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif /* __linux__ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <stdio.h>
+#include <errno.h>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+#endif /* __linux__ */
+
+/****************************************************************************/
+
+#include "netns_sweep.h"
+#include "dhcp_offer.h"
+
+/****************************************************************************/
+
+/* Where "ip netns" keeps the named network namespaces. */
+#define NAMED_NETNS_DIRECTORY "/run/netns"
+
+/****************************************************************************/
+
+/* Release the namespaces found by find_network_namespaces(), along with
+ * the offers recorded by sweep_network_namespaces(). This is safe to
+ * call with a NULL parameter.
+ */
+void
+delete_network_namespaces(struct netns_scan * scans,size_t num_scans)
+{
+	size_t i;
+
+	if(scans != NULL)
+	{
+		for(i = 0 ; i < num_scans ; i++)
+		{
+			clear_dhcp_offers(&scans[i].offer_list);
+
+			free(scans[i].name);
+			free(scans[i].path);
+		}
+
+		free(scans);
+	}
+}
+
+/****************************************************************************/
+
+#ifdef __linux__
+
+/****************************************************************************/
+
+/* The namespaces found so far. */
+struct netns_table
+{
+	struct netns_scan *	scans;
+	struct stat *		files;		/* Tells the namespaces apart */
+	size_t				num_scans;
+	size_t				table_size;
+};
+
+/* What the worker threads share. */
+struct netns_sweep
+{
+	struct netns_scan *					scans;
+	size_t								num_scans;
+	size_t								next_scan;	/* Picked with __atomic_fetch_add() */
+
+	const char *						interface_name;
+	const struct dhcp_scan_options *	options;
+	uint32_t							transaction_id;
+	int									timeout;
+};
+
+/****************************************************************************/
+
+/* Add a namespace to the table, unless it is already known or the path
+ * does not refer to a namespace which can be looked at. Returns -1 if
+ * not enough memory is available, 0 otherwise.
+ */
+static int
+add_network_namespace(struct netns_table * table,const char * name,const char * path)
+{
+	struct netns_scan * scan;
+	struct stat st;
+	int result = -1;
+	size_t i;
+
+	/* The process may have exited, or it belongs to a different user. */
+	if(stat(path,&st) < 0)
+	{
+		result = 0;
+		goto out;
+	}
+
+	for(i = 0 ; i < table->num_scans ; i++)
+	{
+		if(table->files[i].st_dev == st.st_dev && table->files[i].st_ino == st.st_ino)
+		{
+			result = 0;
+			goto out;
+		}
+	}
+
+	if(table->num_scans == table->table_size)
+	{
+		size_t new_table_size = (table->table_size == 0) ? 16 : 2 * table->table_size;
+		struct netns_scan * new_scans;
+		struct stat * new_files;
+
+		new_scans = realloc(table->scans,new_table_size * sizeof(*new_scans));
+		if(new_scans == NULL)
+			goto out;
+
+		table->scans = new_scans;
+
+		new_files = realloc(table->files,new_table_size * sizeof(*new_files));
+		if(new_files == NULL)
+			goto out;
+
+		table->files = new_files;
+
+		table->table_size = new_table_size;
+	}
+
+	scan = &table->scans[table->num_scans];
+
+	memset(scan,0,sizeof(*scan));
+
+	scan->name = strdup(name);
+	scan->path = strdup(path);
+
+	if(scan->name == NULL || scan->path == NULL)
+	{
+		free(scan->name);
+		free(scan->path);
+
+		goto out;
+	}
+
+	table->files[table->num_scans++] = st;
+
+	result = 0;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Find all the network namespaces on this host, named ones first, which
+ * must be released with delete_network_namespaces(). Returns -1 in case
+ * of error, with errno set, and 0 otherwise.
+ */
+int
+find_network_namespaces(struct netns_scan ** scans_ptr,size_t * num_scans_ptr)
+{
+	struct netns_table table;
+	char path[PATH_MAX];
+	char name[sizeof("pid:") + NAME_MAX];
+	struct dirent * entry;
+	DIR * dir;
+	int result = -1;
+	char * end;
+	size_t i;
+
+	memset(&table,0,sizeof(table));
+
+	/* The named namespaces may not exist at all. */
+	dir = opendir(NAMED_NETNS_DIRECTORY);
+	if(dir != NULL)
+	{
+		while((entry = readdir(dir)) != NULL)
+		{
+			if(entry->d_name[0] == '.')
+				continue;
+
+			snprintf(path,sizeof(path),"%s/%s",NAMED_NETNS_DIRECTORY,entry->d_name);
+
+			if(add_network_namespace(&table,entry->d_name,path) < 0)
+			{
+				closedir(dir);
+				goto out;
+			}
+		}
+
+		closedir(dir);
+	}
+
+	dir = opendir("/proc");
+	if(dir == NULL)
+		goto out;
+
+	while((entry = readdir(dir)) != NULL)
+	{
+		/* Only the process directories matter. */
+		if(strtoul(entry->d_name,&end,10) == 0 || (*end) != '\0')
+			continue;
+
+		snprintf(path,sizeof(path),"/proc/%s/ns/net",entry->d_name);
+		snprintf(name,sizeof(name),"pid:%s",entry->d_name);
+
+		if(add_network_namespace(&table,name,path) < 0)
+		{
+			closedir(dir);
+			goto out;
+		}
+	}
+
+	closedir(dir);
+
+	/* The lists must not be moved in memory once they have been
+	 * initialized, which is why this happens only now.
+	 */
+	for(i = 0 ; i < table.num_scans ; i++)
+		new_list(&table.scans[i].offer_list);
+
+	(*scans_ptr) = table.scans;
+	(*num_scans_ptr) = table.num_scans;
+
+	table.scans = NULL;
+	table.num_scans = 0;
+
+	result = 0;
+
+ out:
+
+	for(i = 0 ; i < table.num_scans ; i++)
+	{
+		free(table.scans[i].name);
+		free(table.scans[i].path);
+	}
+
+	free(table.scans);
+	free(table.files);
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Switch the calling thread to a network namespace and scan it there,
+ * keeping the offers recorded.
+ */
+static void
+scan_network_namespace(const struct netns_sweep * sweep,struct netns_scan * netns,uint32_t transaction_id)
+{
+	struct dhcp_scan * scan = NULL;
+	int fd;
+
+	fd = open(netns->path,O_RDONLY|O_CLOEXEC);
+	if(fd < 0)
+	{
+		snprintf(netns->error,sizeof(netns->error),"%s",strerror(errno));
+		goto out;
+	}
+
+	if(setns(fd,CLONE_NEWNET) < 0)
+	{
+		snprintf(netns->error,sizeof(netns->error),"%s",strerror(errno));
+
+		close(fd);
+		goto out;
+	}
+
+	close(fd);
+
+	scan = open_dhcp_scan(sweep->interface_name,sweep->options,netns->error,sizeof(netns->error));
+	if(scan == NULL)
+		goto out;
+
+	if(run_dhcp_scan(scan,transaction_id,sweep->timeout) < 0)
+	{
+		snprintf(netns->error,sizeof(netns->error),"%s",get_dhcp_scan_error(scan));
+		goto out;
+	}
+
+	netns->num_offers = get_dhcp_scan_num_offers(scan);
+	take_dhcp_scan_offers(scan,&netns->offer_list);
+
+	netns->error[0] = '\0';
+
+ out:
+
+	close_dhcp_scan(scan);
+}
+
+/****************************************************************************/
+
+/* This runs in its own thread, scanning one namespace after the other
+ * until none are left.
+ */
+static void *
+sweep_worker_thread(void * arg)
+{
+	struct netns_sweep * sweep = arg;
+	size_t i;
+
+	while((i = __atomic_fetch_add(&sweep->next_scan,1,__ATOMIC_RELAXED)) < sweep->num_scans)
+		scan_network_namespace(sweep,&sweep->scans[i],sweep->transaction_id + (uint32_t)i);
+
+	return(NULL);
+}
+
+/****************************************************************************/
+
+/* Scan all the namespaces given, using the same network interface name
+ * in each of them, with up to num_threads scans running at the same
+ * time. The namespaces in which the scan failed have their error text
+ * filled in. The options are shared by all scans, which means that the
+ * callback function may be invoked by several threads at the same time.
+ * Returns -1 if not even a single worker thread could be started, with
+ * errno set, and 0 otherwise.
+ */
+int
+sweep_network_namespaces(struct netns_scan * scans,size_t num_scans,
+	const char * interface_name,const struct dhcp_scan_options * options,
+	uint32_t transaction_id,int timeout,int num_threads)
+{
+	pthread_t threads[NETNS_SWEEP_MAX_THREADS];
+	struct netns_sweep sweep;
+	int num_threads_started = 0;
+	int result = -1;
+	int error = 0;
+	size_t n;
+	int i;
+
+	memset(&sweep,0,sizeof(sweep));
+
+	sweep.scans				= scans;
+	sweep.num_scans			= num_scans;
+	sweep.interface_name	= interface_name;
+	sweep.options			= options;
+	sweep.transaction_id	= transaction_id;
+	sweep.timeout			= timeout;
+
+	if(num_threads < 1)
+		num_threads = 1;
+	else if (num_threads > NETNS_SWEEP_MAX_THREADS)
+		num_threads = NETNS_SWEEP_MAX_THREADS;
+
+	if((size_t)num_threads > num_scans)
+		num_threads = (int)num_scans;
+
+	for(n = 0 ; n < num_scans ; n++)
+		snprintf(scans[n].error,sizeof(scans[n].error),"%s","Not scanned");
+
+	/* If fewer threads can be started than requested, the ones which
+	 * were started will just have to do more of the work.
+	 */
+	for(i = 0 ; i < num_threads ; i++)
+	{
+		error = pthread_create(&threads[num_threads_started],NULL,sweep_worker_thread,&sweep);
+		if(error != 0)
+			break;
+
+		num_threads_started++;
+	}
+
+	for(i = 0 ; i < num_threads_started ; i++)
+		pthread_join(threads[i],NULL);
+
+	if(num_threads_started == 0 && num_scans > 0)
+	{
+		errno = error;
+		goto out;
+	}
+
+	result = 0;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+#else
+
+/****************************************************************************/
+
+int
+find_network_namespaces(struct netns_scan ** scans_ptr __attribute__((unused)),
+	size_t * num_scans_ptr __attribute__((unused)))
+{
+	errno = ENOSYS;
+
+	return(-1);
+}
+
+/****************************************************************************/
+
+int
+sweep_network_namespaces(struct netns_scan * scans __attribute__((unused)),
+	size_t num_scans __attribute__((unused)),
+	const char * interface_name __attribute__((unused)),
+	const struct dhcp_scan_options * options __attribute__((unused)),
+	uint32_t transaction_id __attribute__((unused)),
+	int timeout __attribute__((unused)),
+	int num_threads __attribute__((unused)))
+{
+	errno = ENOSYS;
+
+	return(-1);
+}
+
+/****************************************************************************/
+
+#endif /* __linux__ */
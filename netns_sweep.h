@@ -0,0 +1,48 @@
+/*
+ * Scan for DHCP servers in many network namespaces at the same time.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#ifndef _NETNS_SWEEP_H
+#define _NETNS_SWEEP_H
+
+/****************************************************************************/
+
+#include <stddef.h>
+#include <stdint.h>
+
+/****************************************************************************/
+
+#include "list_node.h"
+#include "dhcp_scan.h"
+
+/****************************************************************************/
+
+/* Upper limit for the number of scans running at the same time. */
+#define NETNS_SWEEP_MAX_THREADS 256
+
+/****************************************************************************/
+
+/* A network namespace, and what the scan in it found. */
+struct netns_scan
+{
+	char *		name;			/* As listed in /run/netns, or "pid:<number>" */
+	char *		path;			/* Namespace file to be opened for setns() */
+
+	struct List	offer_list;		/* Offers recorded, in the order in which they arrived */
+	int			num_offers;
+	char		error[256];		/* Empty unless the scan failed */
+};
+
+/****************************************************************************/
+
+int find_network_namespaces(struct netns_scan **scans_ptr, size_t *num_scans_ptr);
+void delete_network_namespaces(struct netns_scan *scans, size_t num_scans);
+int sweep_network_namespaces(struct netns_scan *scans, size_t num_scans, const char *interface_name, const struct dhcp_scan_options *options, uint32_t transaction_id, int timeout, int num_threads);
+
+/****************************************************************************/
+
+#endif /* _NETNS_SWEEP_H */
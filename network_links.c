@@ -0,0 +1,563 @@
+/*
+ * Find the network interfaces, along with everything needed to decide
+ * whether they should be scanned, through a single netlink request.
+ *
+ * A single RTM_GETLINK dump request returns the name, hardware address,
+ * MTU, flags and carrier state of every network interface, as well as
+ * the bridge or bond it belongs to and the interface a VLAN sits on,
+ * which would otherwise take several ioctl() calls per interface.
+ *
+ * The same information arrives unasked whenever an interface changes,
+ * e.g. when it gains or loses its carrier, once a netlink socket has
+ * joined the RTNLGRP_LINK group.
+ *
+ * This is supported only on Linux.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#ifdef __linux__
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <net/if_arp.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#endif /* __linux__ */
+
+/****************************************************************************/
+
+#include "network_links.h"
+
+/****************************************************************************/
+
+/* Look up a network interface by its index. Returns NULL if there is no
+ * such interface.
+ */
+const struct network_link *
+find_network_link(const struct network_link * links,size_t num_links,int index)
+{
+	const struct network_link * result = NULL;
+	size_t i;
+
+	for(i = 0 ; i < num_links ; i++)
+	{
+		if(links[i].index == index)
+		{
+			result = &links[i];
+			break;
+		}
+	}
+
+	return(result);
+}
+
+/****************************************************************************/
+
+#ifdef __linux__
+
+/****************************************************************************/
+
+/* Large enough for the messages which describe several interfaces. */
+#define RECEIVE_BUFFER_SIZE 32768
+
+/* How much the kernel may queue up for the link monitor before it has to
+ * drop change notifications; many interfaces may change at once when a
+ * switch restarts.
+ */
+#define LINK_MONITOR_SOCKET_BUFFER_SIZE (1024 * 1024)
+
+/* The C library header files may not define this one. */
+#ifndef IFF_LOWER_UP
+#define IFF_LOWER_UP 0x10000
+#endif /* IFF_LOWER_UP */
+
+/****************************************************************************/
+
+/* Check if a network interface is worth scanning: it must be up, have a
+ * carrier, support broadcasts and use Ethernet framing. Interfaces which
+ * belong to a bridge or bond are left out, since the bridge or bond is
+ * scanned in their place.
+ */
+bool
+is_network_link_scannable(const struct network_link * link)
+{
+	bool result;
+
+	result = (link->flags & IFF_UP) != 0 &&
+	         (link->flags & IFF_BROADCAST) != 0 &&
+	         (link->flags & IFF_LOOPBACK) == 0 &&
+	         link->carrier &&
+	         link->type == ARPHRD_ETHER &&
+	         link->mac_address_length == 6 &&
+	         link->mtu > 0 && link->mtu < 65536 &&
+	         link->master_index == 0;
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Copy the kind of interface from the nested link information. */
+static void
+get_link_kind(const struct rtattr * link_info,struct network_link * link)
+{
+	const struct rtattr * attribute;
+	int length;
+
+	length = RTA_PAYLOAD(link_info);
+
+	for(attribute = RTA_DATA(link_info) ; RTA_OK(attribute,length) ; attribute = RTA_NEXT(attribute,length))
+	{
+		if(attribute->rta_type == IFLA_INFO_KIND)
+		{
+			length = RTA_PAYLOAD(attribute);
+			if(length >= (int)sizeof(link->kind))
+				length = sizeof(link->kind) - 1;
+
+			memmove(link->kind,RTA_DATA(attribute),length);
+			link->kind[length] = '\0';
+
+			break;
+		}
+	}
+}
+
+/****************************************************************************/
+
+/* Fill in the description of a network interface from an RTM_NEWLINK
+ * message. Returns false if the message is not complete.
+ */
+static bool
+decode_link_message(const struct nlmsghdr * message,struct network_link * link)
+{
+	const struct ifinfomsg * info;
+	const struct rtattr * attribute;
+	bool result = false;
+	int length;
+
+	if(message->nlmsg_len < NLMSG_LENGTH(sizeof(*info)))
+		goto out;
+
+	info = NLMSG_DATA(message);
+
+	memset(link,0,sizeof(*link));
+
+	link->index = info->ifi_index;
+	link->type = info->ifi_type;
+	link->flags = info->ifi_flags;
+
+	/* Older kernels do not report the carrier separately. */
+	link->carrier = (info->ifi_flags & IFF_LOWER_UP) != 0;
+
+	length = IFLA_PAYLOAD(message);
+
+	for(attribute = IFLA_RTA(info) ; RTA_OK(attribute,length) ; attribute = RTA_NEXT(attribute,length))
+	{
+		switch(attribute->rta_type)
+		{
+			case IFLA_IFNAME:
+
+				if(RTA_PAYLOAD(attribute) <= sizeof(link->name))
+				{
+					memmove(link->name,RTA_DATA(attribute),RTA_PAYLOAD(attribute));
+					link->name[sizeof(link->name)-1] = '\0';
+				}
+
+				break;
+
+			case IFLA_ADDRESS:
+
+				if(RTA_PAYLOAD(attribute) <= sizeof(link->mac_address))
+				{
+					memmove(link->mac_address,RTA_DATA(attribute),RTA_PAYLOAD(attribute));
+					link->mac_address_length = RTA_PAYLOAD(attribute);
+				}
+
+				break;
+
+			case IFLA_MTU:
+
+				if(RTA_PAYLOAD(attribute) >= sizeof(uint32_t))
+					link->mtu = (int)(*(const uint32_t *)RTA_DATA(attribute));
+
+				break;
+
+			case IFLA_CARRIER:
+
+				if(RTA_PAYLOAD(attribute) >= sizeof(uint8_t))
+					link->carrier = (*(const uint8_t *)RTA_DATA(attribute)) != 0;
+
+				break;
+
+			case IFLA_MASTER:
+
+				if(RTA_PAYLOAD(attribute) >= sizeof(uint32_t))
+					link->master_index = (int)(*(const uint32_t *)RTA_DATA(attribute));
+
+				break;
+
+			case IFLA_LINK:
+
+				if(RTA_PAYLOAD(attribute) >= sizeof(uint32_t))
+					link->parent_index = (int)(*(const uint32_t *)RTA_DATA(attribute));
+
+				break;
+
+			case IFLA_LINKINFO:
+
+				get_link_kind(attribute,link);
+				break;
+		}
+	}
+
+	/* Some interfaces name themselves as their parent. */
+	if(link->parent_index == link->index)
+		link->parent_index = 0;
+
+	result = (link->name[0] != '\0');
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Find all the network interfaces, which must be freed by the caller.
+ * Returns -1 in case of error, with errno set, and 0 otherwise.
+ */
+int
+get_network_links(struct network_link ** links_ptr,size_t * num_links_ptr)
+{
+	struct
+	{
+		struct nlmsghdr		header;
+		struct ifinfomsg	info;
+	} request;
+
+	struct network_link * links = NULL;
+	struct network_link * new_links;
+	size_t num_links = 0;
+	size_t table_size = 0;
+	const struct nlmsghdr * message;
+	struct sockaddr_nl address;
+	uint8_t * buffer = NULL;
+	uint32_t sequence;
+	bool done = false;
+	int result = -1;
+	ssize_t length;
+	int fd;
+
+	fd = socket(AF_NETLINK,SOCK_RAW|SOCK_CLOEXEC,NETLINK_ROUTE);
+	if(fd < 0)
+		goto out;
+
+	buffer = malloc(RECEIVE_BUFFER_SIZE);
+	if(buffer == NULL)
+		goto out;
+
+	sequence = (uint32_t)time(NULL);
+
+	memset(&request,0,sizeof(request));
+
+	request.header.nlmsg_len = NLMSG_LENGTH(sizeof(request.info));
+	request.header.nlmsg_type = RTM_GETLINK;
+	request.header.nlmsg_flags = NLM_F_REQUEST|NLM_F_DUMP;
+	request.header.nlmsg_seq = sequence;
+	request.info.ifi_family = AF_UNSPEC;
+
+	memset(&address,0,sizeof(address));
+	address.nl_family = AF_NETLINK;
+
+	if(sendto(fd,&request,request.header.nlmsg_len,0,(struct sockaddr *)&address,sizeof(address)) < 0)
+		goto out;
+
+	while(!done)
+	{
+		length = recv(fd,buffer,RECEIVE_BUFFER_SIZE,0);
+		if(length < 0)
+		{
+			if(errno == EINTR)
+				continue;
+
+			goto out;
+		}
+
+		if(length == 0)
+		{
+			errno = EPROTO;
+			goto out;
+		}
+
+		for(message = (const struct nlmsghdr *)buffer ;
+			NLMSG_OK(message,(size_t)length) ;
+			message = NLMSG_NEXT(message,length))
+		{
+			if(message->nlmsg_seq != sequence)
+				continue;
+
+			if(message->nlmsg_type == NLMSG_DONE)
+			{
+				done = true;
+				break;
+			}
+
+			if(message->nlmsg_type == NLMSG_ERROR)
+			{
+				const struct nlmsgerr * error = NLMSG_DATA(message);
+
+				errno = (message->nlmsg_len >= NLMSG_LENGTH(sizeof(*error)) && error->error < 0) ? -error->error : EPROTO;
+				goto out;
+			}
+
+			if(message->nlmsg_type != RTM_NEWLINK)
+				continue;
+
+			if(num_links == table_size)
+			{
+				size_t new_table_size = (table_size == 0) ? 16 : 2 * table_size;
+
+				new_links = realloc(links,new_table_size * sizeof(*new_links));
+				if(new_links == NULL)
+					goto out;
+
+				links = new_links;
+				table_size = new_table_size;
+			}
+
+			if(decode_link_message(message,&links[num_links]))
+				num_links++;
+		}
+	}
+
+	(*links_ptr) = links;
+	(*num_links_ptr) = num_links;
+
+	links = NULL;
+
+	result = 0;
+
+ out:
+
+	if(fd >= 0)
+	{
+		int error = errno;
+
+		close(fd);
+
+		errno = error;
+	}
+
+	free(buffer);
+	free(links);
+
+	return(result);
+}
+
+/****************************************************************************/
+
+struct link_monitor
+{
+	int			fd;
+	uint8_t		buffer[RECEIVE_BUFFER_SIZE];
+};
+
+/****************************************************************************/
+
+/* Release the resources allocated by open_link_monitor(). This is safe
+ * to call with a NULL parameter.
+ */
+void
+close_link_monitor(struct link_monitor * monitor)
+{
+	if(monitor != NULL)
+	{
+		if(monitor->fd != -1)
+			close(monitor->fd);
+
+		free(monitor);
+	}
+}
+
+/****************************************************************************/
+
+/* Start listening for changes to the network interfaces. Returns NULL in
+ * case of error, with errno set.
+ */
+struct link_monitor *
+open_link_monitor(void)
+{
+	struct link_monitor * result = NULL;
+	struct link_monitor * monitor;
+	struct sockaddr_nl address;
+	int group = RTNLGRP_LINK;
+	int size = LINK_MONITOR_SOCKET_BUFFER_SIZE;
+
+	monitor = malloc(sizeof(*monitor));
+	if(monitor == NULL)
+		goto out;
+
+	monitor->fd = socket(AF_NETLINK,SOCK_RAW|SOCK_CLOEXEC|SOCK_NONBLOCK,NETLINK_ROUTE);
+	if(monitor->fd < 0)
+		goto out;
+
+	memset(&address,0,sizeof(address));
+	address.nl_family = AF_NETLINK;
+
+	if(bind(monitor->fd,(struct sockaddr *)&address,sizeof(address)) < 0)
+		goto out;
+
+	if(setsockopt(monitor->fd,SOL_NETLINK,NETLINK_ADD_MEMBERSHIP,&group,sizeof(group)) < 0)
+		goto out;
+
+	/* This is merely a precaution, which is why it may fail. */
+	(void)setsockopt(monitor->fd,SOL_SOCKET,SO_RCVBUF,&size,sizeof(size));
+
+	result = monitor;
+	monitor = NULL;
+
+ out:
+
+	if(monitor != NULL)
+	{
+		int error = errno;
+
+		close_link_monitor(monitor);
+
+		errno = error;
+	}
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* The file descriptor to be watched by poll() for changes. */
+int
+get_link_monitor_fd(const struct link_monitor * monitor)
+{
+	return(monitor->fd);
+}
+
+/****************************************************************************/
+
+/* Invoke the callback function for each change to a network interface
+ * which has been reported since the last call, without waiting for more.
+ * Returns -1 in case of error, with errno set, and 0 otherwise. If errno
+ * is ENOBUFS, the kernel had to drop some of the changes, and the caller
+ * should find out through get_network_links() where things stand now.
+ */
+int
+read_link_monitor(struct link_monitor * monitor,link_monitor_callback callback,void * user_data)
+{
+	const struct nlmsghdr * message;
+	struct network_link link;
+	int result = -1;
+	ssize_t length;
+
+	while(true)
+	{
+		length = recv(monitor->fd,monitor->buffer,sizeof(monitor->buffer),0);
+		if(length < 0)
+		{
+			if(errno == EINTR)
+				continue;
+
+			if(errno == EAGAIN || errno == EWOULDBLOCK)
+				break;
+
+			goto out;
+		}
+
+		for(message = (const struct nlmsghdr *)monitor->buffer ;
+			NLMSG_OK(message,(size_t)length) ;
+			message = NLMSG_NEXT(message,length))
+		{
+			if(message->nlmsg_type != RTM_NEWLINK && message->nlmsg_type != RTM_DELLINK)
+				continue;
+
+			if(decode_link_message(message,&link))
+				(*callback)(&link,message->nlmsg_type == RTM_DELLINK,user_data);
+		}
+	}
+
+	result = 0;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+#else
+
+/****************************************************************************/
+
+bool
+is_network_link_scannable(const struct network_link * link __attribute__((unused)))
+{
+	return(false);
+}
+
+/****************************************************************************/
+
+int
+get_network_links(struct network_link ** links_ptr __attribute__((unused)),
+	size_t * num_links_ptr __attribute__((unused)))
+{
+	errno = ENOSYS;
+
+	return(-1);
+}
+
+/****************************************************************************/
+
+struct link_monitor *
+open_link_monitor(void)
+{
+	errno = ENOSYS;
+
+	return(NULL);
+}
+
+/****************************************************************************/
+
+void
+close_link_monitor(struct link_monitor * monitor __attribute__((unused)))
+{
+}
+
+/****************************************************************************/
+
+int
+get_link_monitor_fd(const struct link_monitor * monitor __attribute__((unused)))
+{
+	return(-1);
+}
+
+/****************************************************************************/
+
+int
+read_link_monitor(struct link_monitor * monitor __attribute__((unused)),
+	link_monitor_callback callback __attribute__((unused)),
+	void * user_data __attribute__((unused)))
+{
+	errno = ENOSYS;
+
+	return(-1);
+}
+
+/****************************************************************************/
+
+#endif /* __linux__ */
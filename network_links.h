@@ -0,0 +1,61 @@
+/*
+ * Find the network interfaces, along with everything needed to decide
+ * whether they should be scanned, through a single netlink request, and
+ * watch them change.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#ifndef _NETWORK_LINKS_H
+#define _NETWORK_LINKS_H
+
+/****************************************************************************/
+
+#include <net/if.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/****************************************************************************/
+
+/* A network interface, as the kernel describes it. */
+struct network_link
+{
+	int			index;
+	char		name[IF_NAMESIZE];
+	char		kind[16];			/* e.g. "vlan", "bridge" or "bond"; empty for hardware */
+	int			type;				/* One of ARPHRD_* */
+	unsigned	flags;				/* IFF_* */
+	bool		carrier;
+	int			mtu;
+	uint8_t		mac_address[6];
+	int			mac_address_length;
+	int			master_index;		/* Bridge or bond this one belongs to, 0 if none */
+	int			parent_index;		/* e.g. the interface a VLAN sits on, 0 if none */
+};
+
+/****************************************************************************/
+
+/* Invoked for each change to a network interface which the kernel reports. */
+typedef void (*link_monitor_callback)(const struct network_link *link, bool removed, void *user_data);
+
+/****************************************************************************/
+
+struct link_monitor;
+
+/****************************************************************************/
+
+int get_network_links(struct network_link **links_ptr, size_t *num_links_ptr);
+const struct network_link *find_network_link(const struct network_link *links, size_t num_links, int index);
+bool is_network_link_scannable(const struct network_link *link);
+struct link_monitor *open_link_monitor(void);
+void close_link_monitor(struct link_monitor *monitor);
+int get_link_monitor_fd(const struct link_monitor *monitor);
+int read_link_monitor(struct link_monitor *monitor, link_monitor_callback callback, void *user_data);
+
+/****************************************************************************/
+
+#endif /* _NETWORK_LINKS_H */
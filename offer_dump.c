@@ -0,0 +1,410 @@
+/*
+ * Print the offers recorded so far on request, through SIGUSR1 and
+ * SIGUSR2, without holding up the scan.
+ *
+ * The signals are blocked and picked up by the event loop through a
+ * signalfd. When one arrives, the offers recorded so far are taken from
+ * the scans, which just moves the list headers, and a thread is started
+ * which prints them while the scans go on. Once it is done, it wakes
+ * up the event loop through a pipe. Following SIGUSR1 the event loop
+ * hands the offers back to the scans, whereas following SIGUSR2 they are
+ * discarded, so that the scans start over. Further signals which arrive
+ * while the thread is busy remain pending until it is done.
+ *
+ * This is supported only on Linux.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#ifdef __linux__
+#include <sys/signalfd.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#endif /* __linux__ */
+
+/****************************************************************************/
+
+#include "offer_dump.h"
+#include "dhcp_offer.h"
+
+/****************************************************************************/
+
+#ifdef __linux__
+
+/****************************************************************************/
+
+struct offer_dump
+{
+	offer_dump_function	function;
+	void *				user_data;
+
+	int					signal_fd;
+	int					wakeup_pipe[2];
+
+	pthread_t			thread;
+	bool				dump_running;	/* Dumper thread was started */
+	bool				reset;			/* Discard the offers once printed */
+
+	/* Taken from the scans while the dumper thread is running. */
+	struct List			offer_list;
+};
+
+/****************************************************************************/
+
+/* This runs in its own thread, printing the offers and then waking up
+ * the event loop.
+ */
+static void *
+offer_dumper_thread(void * arg)
+{
+	struct offer_dump * dump = arg;
+	char c = 0;
+
+	(*dump->function)(&dump->offer_list,dump->user_data);
+
+	/* Wake up the event loop. */
+	while(write(dump->wakeup_pipe[1],&c,1) < 0 && errno == EINTR)
+		(void)NULL;
+
+	return(NULL);
+}
+
+/****************************************************************************/
+
+/* Release the resources allocated by create_offer_dump(), waiting for
+ * the dumper thread to finish if necessary. Any offers which are still
+ * being printed are discarded. This is safe to call with a NULL
+ * parameter.
+ */
+void
+delete_offer_dump(struct offer_dump * dump)
+{
+	if(dump != NULL)
+	{
+		if(dump->dump_running)
+		{
+			pthread_join(dump->thread,NULL);
+
+			clear_dhcp_offers(&dump->offer_list);
+		}
+
+		if(dump->signal_fd != -1)
+			close(dump->signal_fd);
+
+		if(dump->wakeup_pipe[0] != -1)
+			close(dump->wakeup_pipe[0]);
+
+		if(dump->wakeup_pipe[1] != -1)
+			close(dump->wakeup_pipe[1]);
+
+		free(dump);
+	}
+}
+
+/****************************************************************************/
+
+/* Start listening for SIGUSR1 and SIGUSR2, which are blocked from then on.
+ * This must be called before any other threads are started, so that they
+ * inherit the blocked signals. Returns NULL in case of error, with errno
+ * set.
+ */
+struct offer_dump *
+create_offer_dump(offer_dump_function function,void * user_data)
+{
+	struct offer_dump * result = NULL;
+	struct offer_dump * dump;
+	sigset_t mask;
+	int error;
+
+	dump = calloc(1,sizeof(*dump));
+	if(dump == NULL)
+		goto out;
+
+	dump->signal_fd = dump->wakeup_pipe[0] = dump->wakeup_pipe[1] = -1;
+
+	dump->function = function;
+	dump->user_data = user_data;
+
+	new_list(&dump->offer_list);
+
+	if(pipe(dump->wakeup_pipe) < 0)
+		goto out;
+
+	if(fcntl(dump->wakeup_pipe[0],F_SETFL,O_NONBLOCK) < 0 ||
+	   fcntl(dump->wakeup_pipe[0],F_SETFD,FD_CLOEXEC) < 0 ||
+	   fcntl(dump->wakeup_pipe[1],F_SETFD,FD_CLOEXEC) < 0)
+	{
+		goto out;
+	}
+
+	sigemptyset(&mask);
+	sigaddset(&mask,SIGUSR1);
+	sigaddset(&mask,SIGUSR2);
+
+	dump->signal_fd = signalfd(-1,&mask,SFD_NONBLOCK|SFD_CLOEXEC);
+	if(dump->signal_fd < 0)
+		goto out;
+
+	/* The signals must not be delivered the usual way, which would
+	 * terminate the process.
+	 */
+	error = pthread_sigmask(SIG_BLOCK,&mask,NULL);
+	if(error != 0)
+	{
+		errno = error;
+		goto out;
+	}
+
+	result = dump;
+	dump = NULL;
+
+ out:
+
+	delete_offer_dump(dump);
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Fill in the poll() table entries for the file descriptors to be
+ * watched. There must be room for OFFER_DUMP_NUM_FDS entries. Returns
+ * the number of entries filled in.
+ */
+int
+fill_offer_dump_pollfds(const struct offer_dump * dump,struct pollfd * pfd)
+{
+	/* Signals remain pending while the dumper thread is busy. */
+	pfd[0].fd = dump->dump_running ? -1 : dump->signal_fd;
+	pfd[0].events = POLLIN;
+	pfd[0].revents = 0;
+
+	pfd[1].fd = dump->wakeup_pipe[0];
+	pfd[1].events = POLLIN;
+	pfd[1].revents = 0;
+
+	return(OFFER_DUMP_NUM_FDS);
+}
+
+/****************************************************************************/
+
+/* Take the offers recorded so far from all the scans. */
+static void
+take_offers(struct offer_dump * dump,struct dhcp_scan * const * scans,int num_scans)
+{
+	struct List offer_list;
+	int i;
+
+	for(i = 0 ; i < num_scans ; i++)
+	{
+		new_list(&offer_list);
+
+		take_dhcp_scan_offers(scans[i],&offer_list);
+		move_list(&dump->offer_list,&offer_list);
+	}
+}
+
+/****************************************************************************/
+
+/* Hand the offers back to the scans which recorded them, telling them
+ * apart by network interface.
+ */
+static void
+return_offers(struct offer_dump * dump,struct dhcp_scan * const * scans,int num_scans)
+{
+	struct dhcp_offer * offer;
+	struct dhcp_offer * next_offer;
+	struct List offer_list;
+	const char * interface_name;
+	int i;
+
+	for(i = 0 ; i < num_scans ; i++)
+	{
+		interface_name = get_dhcp_scan_interface_name(scans[i]);
+
+		new_list(&offer_list);
+
+		for(offer = (struct dhcp_offer *)get_list_head(&dump->offer_list) ;
+			offer != NULL ;
+			offer = next_offer)
+		{
+			next_offer = (struct dhcp_offer *)get_next_node(&offer->node);
+
+			if(strcmp(offer->interface_name,interface_name) == 0)
+			{
+				remove_node(&offer->node);
+				add_node_to_list_tail(&offer_list,&offer->node);
+			}
+		}
+
+		return_dhcp_scan_offers(scans[i],&offer_list);
+	}
+
+	/* There should not be any left. */
+	clear_dhcp_offers(&dump->offer_list);
+}
+
+/****************************************************************************/
+
+/* Discard the offers, and have the scans forget about the servers which
+ * sent them, so that they are reported as new ones when they respond
+ * again.
+ */
+static void
+forget_offers(struct offer_dump * dump,struct dhcp_scan * const * scans,int num_scans)
+{
+	int i;
+
+	clear_dhcp_offers(&dump->offer_list);
+
+	for(i = 0 ; i < num_scans ; i++)
+		forget_dhcp_scan_taken_offers(scans[i]);
+}
+
+/****************************************************************************/
+
+/* Wait for the dumper thread to finish, if it is running, and then hand
+ * the offers back to the scans or discard them, as requested.
+ */
+void
+finish_offer_dump(struct offer_dump * dump,struct dhcp_scan * const * scans,int num_scans)
+{
+	if(dump->dump_running)
+	{
+		pthread_join(dump->thread,NULL);
+		dump->dump_running = false;
+
+		if(dump->reset)
+			forget_offers(dump,scans,num_scans);
+		else
+			return_offers(dump,scans,num_scans);
+	}
+}
+
+/****************************************************************************/
+
+/* Process the poll() results for the file descriptors filled in by
+ * fill_offer_dump_pollfds(). This must be called by the same thread
+ * which calls dispatch_dhcp_scan() for all the scans given. Returns -1
+ * if the dumper thread could not be started, with errno set, and 0
+ * otherwise.
+ */
+int
+check_offer_dump(struct offer_dump * dump,const struct pollfd * pfd,struct dhcp_scan * const * scans,int num_scans)
+{
+	struct signalfd_siginfo info;
+	bool dump_requested = false;
+	bool reset = false;
+	int result = -1;
+	int error;
+	char c;
+
+	/* Is the dumper thread done? */
+	if((pfd[1].revents & POLLIN) && dump->dump_running)
+	{
+		while(read(dump->wakeup_pipe[0],&c,1) > 0)
+			(void)NULL;
+
+		finish_offer_dump(dump,scans,num_scans);
+	}
+
+	/* Was a dump requested? Several signals may have arrived in the
+	 * meantime, which are handled by a single dump.
+	 */
+	if(pfd[0].revents & POLLIN)
+	{
+		while(read(dump->signal_fd,&info,sizeof(info)) == sizeof(info))
+		{
+			dump_requested = true;
+
+			if(info.ssi_signo == SIGUSR2)
+				reset = true;
+		}
+	}
+
+	if(dump_requested && !dump->dump_running)
+	{
+		dump->reset = reset;
+
+		take_offers(dump,scans,num_scans);
+
+		error = pthread_create(&dump->thread,NULL,offer_dumper_thread,dump);
+		if(error != 0)
+		{
+			return_offers(dump,scans,num_scans);
+
+			errno = error;
+			goto out;
+		}
+
+		dump->dump_running = true;
+	}
+
+	result = 0;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+#else
+
+/****************************************************************************/
+
+struct offer_dump *
+create_offer_dump(offer_dump_function function __attribute__((unused)),void * user_data __attribute__((unused)))
+{
+	errno = ENOSYS;
+
+	return(NULL);
+}
+
+/****************************************************************************/
+
+void
+delete_offer_dump(struct offer_dump * dump __attribute__((unused)))
+{
+}
+
+/****************************************************************************/
+
+int
+fill_offer_dump_pollfds(const struct offer_dump * dump __attribute__((unused)),
+	struct pollfd * pfd __attribute__((unused)))
+{
+	return(0);
+}
+
+/****************************************************************************/
+
+int
+check_offer_dump(struct offer_dump * dump __attribute__((unused)),
+	const struct pollfd * pfd __attribute__((unused)),
+	struct dhcp_scan * const * scans __attribute__((unused)),
+	int num_scans __attribute__((unused)))
+{
+	return(0);
+}
+
+/****************************************************************************/
+
+void
+finish_offer_dump(struct offer_dump * dump __attribute__((unused)),
+	struct dhcp_scan * const * scans __attribute__((unused)),
+	int num_scans __attribute__((unused)))
+{
+}
+
+/****************************************************************************/
+
+#endif /* __linux__ */
@@ -0,0 +1,46 @@
+/*
+ * Print the offers recorded so far on request, through SIGUSR1 and
+ * SIGUSR2, without holding up the scan.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#ifndef _OFFER_DUMP_H
+#define _OFFER_DUMP_H
+
+/****************************************************************************/
+
+#include <poll.h>
+
+/****************************************************************************/
+
+#include "list_node.h"
+#include "dhcp_scan.h"
+
+/****************************************************************************/
+
+/* Number of file descriptors which need to be watched by poll(). */
+#define OFFER_DUMP_NUM_FDS 2
+
+/****************************************************************************/
+
+/* Prints the offers; this is called by the dumper thread. */
+typedef void (*offer_dump_function)(const struct List *offer_list, void *user_data);
+
+/****************************************************************************/
+
+struct offer_dump;
+
+/****************************************************************************/
+
+struct offer_dump *create_offer_dump(offer_dump_function function, void *user_data);
+void delete_offer_dump(struct offer_dump *dump);
+int fill_offer_dump_pollfds(const struct offer_dump *dump, struct pollfd *pfd);
+int check_offer_dump(struct offer_dump *dump, const struct pollfd *pfd, struct dhcp_scan * const *scans, int num_scans);
+void finish_offer_dump(struct offer_dump *dump, struct dhcp_scan * const *scans, int num_scans);
+
+/****************************************************************************/
+
+#endif /* _OFFER_DUMP_H */
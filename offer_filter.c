@@ -0,0 +1,1035 @@
+/*
+ * Offer filter expressions, such as
+ *
+ *     router != 10.0.0.1 or dns not in 10.0.0.0/8 or lease-time < 600
+ *
+ * which are compiled once and then evaluated against the option index
+ * of each DHCP offer received.
+ *
+ * The grammar looks like this:
+ *
+ *     expression := term { "or" term }
+ *     term       := factor { "and" factor }
+ *     factor     := "not" factor | "(" expression ")" | test
+ *     test       := field [ comparison value | [ "not" ] "in" network ]
+ *     comparison := "==" | "=" | "!=" | "<" | "<=" | ">" | ">="
+ *
+ * A field name on its own tests if the offer contains the respective
+ * option. Values are numbers, IPv4 addresses or quoted strings, and
+ * networks are given in CIDR notation ("10.0.0.0/8"). Options which
+ * can hold several addresses, such as "dns", pass a test if at least
+ * one of their addresses passes it. Tests on options which are missing
+ * from the offer always fail.
+ *
+ * The expression is compiled into a sequence of instructions in postfix
+ * order, which are evaluated using a small stack of truth values.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#include <arpa/inet.h>
+
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <errno.h>
+#include <assert.h>
+
+/****************************************************************************/
+
+#include "offer_filter.h"
+
+/****************************************************************************/
+
+/* Where the data of a field comes from. */
+enum
+{
+	FIELD_SOURCE_OPTION,
+	FIELD_SOURCE_SERVER_ADDRESS,
+	FIELD_SOURCE_OFFERED_ADDRESS,
+	FIELD_SOURCE_NEXT_SERVER_ADDRESS,
+	FIELD_SOURCE_RELAY_AGENT_ADDRESS
+};
+
+/* How the data of a field is to be interpreted. */
+enum
+{
+	FIELD_TYPE_ADDRESS,
+	FIELD_TYPE_ADDRESS_LIST,
+	FIELD_TYPE_NUMBER_8,
+	FIELD_TYPE_NUMBER_16,
+	FIELD_TYPE_NUMBER_32,
+	FIELD_TYPE_STRING,
+	FIELD_TYPE_ANY		/* Can only be tested for presence */
+};
+
+struct filter_field
+{
+	const char *	name;
+	uint8_t			source;
+	uint8_t			option_type;
+	uint8_t			type;
+};
+
+static const struct filter_field filter_fields[] =
+{
+	{ "server-address",			FIELD_SOURCE_SERVER_ADDRESS,		0,									FIELD_TYPE_ADDRESS		},
+	{ "offered-address",		FIELD_SOURCE_OFFERED_ADDRESS,		0,									FIELD_TYPE_ADDRESS		},
+	{ "next-server-address",	FIELD_SOURCE_NEXT_SERVER_ADDRESS,	0,									FIELD_TYPE_ADDRESS		},
+	{ "relay-agent-address",	FIELD_SOURCE_RELAY_AGENT_ADDRESS,	0,									FIELD_TYPE_ADDRESS		},
+	{ "subnet-mask",			FIELD_SOURCE_OPTION,				OPTION_TYPE_SUBNET_MASK,			FIELD_TYPE_ADDRESS		},
+	{ "router",					FIELD_SOURCE_OPTION,				OPTION_TYPE_GATEWAY,				FIELD_TYPE_ADDRESS_LIST	},
+	{ "gateway",				FIELD_SOURCE_OPTION,				OPTION_TYPE_GATEWAY,				FIELD_TYPE_ADDRESS_LIST	},
+	{ "dns",					FIELD_SOURCE_OPTION,				OPTION_TYPE_DNS,					FIELD_TYPE_ADDRESS_LIST	},
+	{ "domain-name",			FIELD_SOURCE_OPTION,				OPTION_TYPE_DOMAIN_NAME,			FIELD_TYPE_STRING		},
+	{ "interface-mtu",			FIELD_SOURCE_OPTION,				OPTION_TYPE_INTERFACE_MTU,			FIELD_TYPE_NUMBER_16	},
+	{ "broadcast-address",		FIELD_SOURCE_OPTION,				OPTION_TYPE_BROADCAST_ADDRESS,		FIELD_TYPE_ADDRESS		},
+	{ "ntp",					FIELD_SOURCE_OPTION,				OPTION_TYPE_NTP_SERVERS,			FIELD_TYPE_ADDRESS_LIST	},
+	{ "lease-time",				FIELD_SOURCE_OPTION,				OPTION_TYPE_IP_ADDRESS_LEASE_TIME,	FIELD_TYPE_NUMBER_32	},
+	{ "message-type",			FIELD_SOURCE_OPTION,				OPTION_TYPE_DHCP_MESSAGE_TYPE,		FIELD_TYPE_NUMBER_8		},
+	{ "server-identifier",		FIELD_SOURCE_OPTION,				OPTION_TYPE_SERVER_IDENTIFIER,		FIELD_TYPE_ADDRESS		},
+	{ "renewal-time",			FIELD_SOURCE_OPTION,				OPTION_TYPE_RENEWAL_TIME,			FIELD_TYPE_NUMBER_32	},
+	{ "rebinding-time",			FIELD_SOURCE_OPTION,				OPTION_TYPE_REBINDING_TIME,			FIELD_TYPE_NUMBER_32	},
+	{ "domain-search",			FIELD_SOURCE_OPTION,				OPTION_TYPE_DOMAIN_SEARCH,			FIELD_TYPE_ANY			},
+	{ "classless-static-route",	FIELD_SOURCE_OPTION,				OPTION_TYPE_CLASSLESS_STATIC_ROUTE,	FIELD_TYPE_ANY			},
+	{ "static-route",			FIELD_SOURCE_OPTION,				OPTION_TYPE_STATIC_ROUTE,			FIELD_TYPE_ANY			},
+	{ "web-proxy-auto-discovery",FIELD_SOURCE_OPTION,				OPTION_TYPE_PROXY_AUTODISCOVERY,	FIELD_TYPE_ANY			}
+};
+
+/****************************************************************************/
+
+/* Instruction operation codes. */
+enum
+{
+	OPCODE_TEST,	/* Push the result of comparing a field against a value */
+	OPCODE_EXISTS,	/* Push true if the field is present */
+	OPCODE_NOT,		/* Negate the topmost value */
+	OPCODE_AND,		/* Replace the two topmost values by their conjunction */
+	OPCODE_OR		/* Replace the two topmost values by their disjunction */
+};
+
+/* Comparison operators. */
+enum
+{
+	COMPARISON_EQUAL,
+	COMPARISON_NOT_EQUAL,
+	COMPARISON_LESS,
+	COMPARISON_LESS_OR_EQUAL,
+	COMPARISON_GREATER,
+	COMPARISON_GREATER_OR_EQUAL,
+	COMPARISON_IN,
+	COMPARISON_NOT_IN
+};
+
+struct filter_instruction
+{
+	uint8_t		opcode;
+	uint8_t		source;
+	uint8_t		option_type;
+	uint8_t		type;
+	uint8_t		comparison;
+
+	uint32_t	value;		/* Number or address, or network address */
+	uint32_t	mask;		/* Network mask for COMPARISON_IN */
+
+	char *		string;		/* For FIELD_TYPE_STRING */
+	size_t		string_length;
+};
+
+/* The stack of truth values never grows deeper than this. */
+#define MAXIMUM_STACK_DEPTH 64
+
+/* Parentheses and "not" may be nested no deeper than this, which keeps
+ * the parser, which calls itself for each of them, from running out of
+ * stack space.
+ */
+#define MAXIMUM_NESTING_DEPTH 64
+
+struct offer_filter
+{
+	struct filter_instruction *	code;
+	int							code_length;
+};
+
+/****************************************************************************/
+
+/* Token types produced by the scanner. */
+enum
+{
+	TOKEN_END,
+	TOKEN_NAME,
+	TOKEN_NUMBER,
+	TOKEN_ADDRESS,
+	TOKEN_NETWORK,
+	TOKEN_STRING,
+	TOKEN_COMPARISON,
+	TOKEN_LEFT_PARENTHESIS,
+	TOKEN_RIGHT_PARENTHESIS,
+	TOKEN_INVALID
+};
+
+struct filter_parser
+{
+	const char *				input;
+
+	int							token;
+	char						token_text[256];
+	uint32_t					token_value;
+	uint32_t					token_mask;
+	int							token_comparison;
+
+	struct filter_instruction *	code;
+	int							code_length;
+	int							code_size;
+
+	int							stack_depth;
+	int							nesting_depth;
+
+	char *						error_buffer;
+	size_t						error_buffer_size;
+	bool						failed;
+};
+
+/****************************************************************************/
+
+/* Record the first error which occured while parsing the expression. */
+static void __attribute__ ((format (printf, 2, 3)))
+set_parser_error(struct filter_parser * parser,const char * format,...)
+{
+	va_list args;
+
+	if(!parser->failed)
+	{
+		va_start(args,format);
+		vsnprintf(parser->error_buffer,parser->error_buffer_size,format,args);
+		va_end(args);
+
+		parser->failed = true;
+	}
+}
+
+/****************************************************************************/
+
+/* Read the next token from the input. */
+static void
+next_token(struct filter_parser * parser)
+{
+	const char * input = parser->input;
+	size_t len = 0;
+	char * slash;
+	long prefix_length;
+	char * end;
+
+	while(isspace((unsigned char)(*input)))
+		input++;
+
+	parser->token_text[0] = '\0';
+
+	if((*input) == '\0')
+	{
+		parser->token = TOKEN_END;
+	}
+	else if ((*input) == '(')
+	{
+		parser->token = TOKEN_LEFT_PARENTHESIS;
+		input++;
+	}
+	else if ((*input) == ')')
+	{
+		parser->token = TOKEN_RIGHT_PARENTHESIS;
+		input++;
+	}
+	else if (strchr("=!<>",(*input)) != NULL)
+	{
+		parser->token = TOKEN_COMPARISON;
+
+		if(strncmp(input,"==",2) == 0)
+		{
+			parser->token_comparison = COMPARISON_EQUAL;
+			input += 2;
+		}
+		else if (strncmp(input,"!=",2) == 0)
+		{
+			parser->token_comparison = COMPARISON_NOT_EQUAL;
+			input += 2;
+		}
+		else if (strncmp(input,"<=",2) == 0)
+		{
+			parser->token_comparison = COMPARISON_LESS_OR_EQUAL;
+			input += 2;
+		}
+		else if (strncmp(input,">=",2) == 0)
+		{
+			parser->token_comparison = COMPARISON_GREATER_OR_EQUAL;
+			input += 2;
+		}
+		else if ((*input) == '=')
+		{
+			parser->token_comparison = COMPARISON_EQUAL;
+			input++;
+		}
+		else if ((*input) == '<')
+		{
+			parser->token_comparison = COMPARISON_LESS;
+			input++;
+		}
+		else if ((*input) == '>')
+		{
+			parser->token_comparison = COMPARISON_GREATER;
+			input++;
+		}
+		else
+		{
+			parser->token = TOKEN_INVALID;
+		}
+	}
+	else if ((*input) == '"')
+	{
+		input++;
+
+		while((*input) != '\0' && (*input) != '"' && len + 1 < sizeof(parser->token_text))
+			parser->token_text[len++] = (*input++);
+
+		parser->token_text[len] = '\0';
+
+		if((*input) == '"')
+		{
+			parser->token = TOKEN_STRING;
+			input++;
+		}
+		else
+		{
+			parser->token = TOKEN_INVALID;
+		}
+	}
+	else if (isalpha((unsigned char)(*input)))
+	{
+		while((isalnum((unsigned char)(*input)) || (*input) == '-' || (*input) == '_') && len + 1 < sizeof(parser->token_text))
+			parser->token_text[len++] = (*input++);
+
+		parser->token_text[len] = '\0';
+		parser->token = TOKEN_NAME;
+	}
+	else if (isdigit((unsigned char)(*input)))
+	{
+		while((isdigit((unsigned char)(*input)) || (*input) == '.' || (*input) == '/') && len + 1 < sizeof(parser->token_text))
+			parser->token_text[len++] = (*input++);
+
+		parser->token_text[len] = '\0';
+		parser->token = TOKEN_INVALID;
+
+		/* A network address with a prefix length? */
+		slash = strchr(parser->token_text,'/');
+		if(slash != NULL)
+		{
+			(*slash) = '\0';
+
+			prefix_length = strtol(&slash[1],&end,10);
+
+			if(end != &slash[1] && (*end) == '\0' && 0 <= prefix_length && prefix_length <= 32 &&
+			   inet_pton(AF_INET,parser->token_text,&parser->token_value) == 1)
+			{
+				parser->token_value = ntohl(parser->token_value);
+				parser->token_mask = (prefix_length > 0) ? (0xffffffffUL << (32 - prefix_length)) : 0;
+				parser->token = TOKEN_NETWORK;
+			}
+
+			/* Restore the text for error messages. */
+			(*slash) = '/';
+		}
+		/* An IPv4 address? */
+		else if (strchr(parser->token_text,'.') != NULL)
+		{
+			if(inet_pton(AF_INET,parser->token_text,&parser->token_value) == 1)
+			{
+				parser->token_value = ntohl(parser->token_value);
+				parser->token = TOKEN_ADDRESS;
+			}
+		}
+		/* A plain number. */
+		else
+		{
+			unsigned long n;
+
+			errno = 0;
+
+			n = strtoul(parser->token_text,&end,10);
+			if(errno == 0 && (*end) == '\0' && n <= 0xffffffffUL)
+			{
+				parser->token_value = (uint32_t)n;
+				parser->token = TOKEN_NUMBER;
+			}
+		}
+	}
+	else
+	{
+		parser->token_text[0] = (*input);
+		parser->token_text[1] = '\0';
+		parser->token = TOKEN_INVALID;
+	}
+
+	if(parser->token == TOKEN_INVALID)
+		set_parser_error(parser,"'%s' is not valid",parser->token_text);
+
+	parser->input = input;
+}
+
+/****************************************************************************/
+
+/* Append an instruction to the program, keeping track of how deep
+ * the stack will grow when the program runs.
+ */
+static void
+emit_instruction(struct filter_parser * parser,const struct filter_instruction * instruction)
+{
+	struct filter_instruction * code;
+	int code_size;
+
+	if(parser->failed)
+		return;
+
+	if(parser->code_length == parser->code_size)
+	{
+		code_size = (parser->code_size > 0) ? 2 * parser->code_size : 16;
+
+		code = realloc(parser->code,code_size * sizeof(*code));
+		if(code == NULL)
+		{
+			set_parser_error(parser,"%s",strerror(errno));
+			return;
+		}
+
+		parser->code = code;
+		parser->code_size = code_size;
+	}
+
+	switch(instruction->opcode)
+	{
+		case OPCODE_TEST:
+		case OPCODE_EXISTS:
+
+			parser->stack_depth++;
+			break;
+
+		case OPCODE_AND:
+		case OPCODE_OR:
+
+			parser->stack_depth--;
+			break;
+	}
+
+	if(parser->stack_depth > MAXIMUM_STACK_DEPTH)
+	{
+		set_parser_error(parser,"expression is too complex");
+		return;
+	}
+
+	parser->code[parser->code_length++] = (*instruction);
+}
+
+/****************************************************************************/
+
+static void parse_expression(struct filter_parser * parser);
+
+/****************************************************************************/
+
+/* Parse a field test, which may be a comparison or just a
+ * test for the presence of an option.
+ */
+static void
+parse_test(struct filter_parser * parser)
+{
+	struct filter_instruction instruction;
+	bool field_found = false;
+	bool negate = false;
+	size_t i;
+	char * end;
+
+	if(parser->token != TOKEN_NAME)
+	{
+		set_parser_error(parser,"field name expected");
+		return;
+	}
+
+	memset(&instruction,0,sizeof(instruction));
+
+	for(i = 0 ; i < sizeof(filter_fields) / sizeof(filter_fields[0]) ; i++)
+	{
+		if(strcmp(parser->token_text,filter_fields[i].name) == 0)
+		{
+			instruction.source = filter_fields[i].source;
+			instruction.option_type = filter_fields[i].option_type;
+			instruction.type = filter_fields[i].type;
+
+			field_found = true;
+			break;
+		}
+	}
+
+	/* Any option can be tested for presence by its number,
+	 * e.g. "option-252".
+	 */
+	if(!field_found && strncmp(parser->token_text,"option-",7) == 0)
+	{
+		unsigned long n;
+
+		n = strtoul(&parser->token_text[7],&end,10);
+		if(end != &parser->token_text[7] && (*end) == '\0' && 0 < n && n < 255)
+		{
+			instruction.source = FIELD_SOURCE_OPTION;
+			instruction.option_type = (uint8_t)n;
+			instruction.type = FIELD_TYPE_ANY;
+
+			field_found = true;
+		}
+	}
+
+	if(!field_found)
+	{
+		set_parser_error(parser,"'%s' is not a known field name",parser->token_text);
+		return;
+	}
+
+	next_token(parser);
+
+	/* "not in"? */
+	if(parser->token == TOKEN_NAME && strcmp(parser->token_text,"not") == 0)
+	{
+		next_token(parser);
+
+		if(parser->token != TOKEN_NAME || strcmp(parser->token_text,"in") != 0)
+		{
+			set_parser_error(parser,"'in' expected after 'not'");
+			return;
+		}
+
+		negate = true;
+	}
+
+	/* Is this a network membership test? */
+	if(parser->token == TOKEN_NAME && strcmp(parser->token_text,"in") == 0)
+	{
+		if(instruction.type != FIELD_TYPE_ADDRESS && instruction.type != FIELD_TYPE_ADDRESS_LIST)
+		{
+			set_parser_error(parser,"'in' requires an address field");
+			return;
+		}
+
+		next_token(parser);
+
+		if(parser->token != TOKEN_NETWORK && parser->token != TOKEN_ADDRESS)
+		{
+			set_parser_error(parser,"network address expected after 'in'");
+			return;
+		}
+
+		instruction.opcode = OPCODE_TEST;
+		instruction.comparison = negate ? COMPARISON_NOT_IN : COMPARISON_IN;
+		instruction.mask = (parser->token == TOKEN_NETWORK) ? parser->token_mask : 0xffffffffUL;
+		instruction.value = parser->token_value & instruction.mask;
+
+		next_token(parser);
+	}
+	/* Is this a comparison? */
+	else if (parser->token == TOKEN_COMPARISON)
+	{
+		instruction.opcode = OPCODE_TEST;
+		instruction.comparison = parser->token_comparison;
+
+		next_token(parser);
+
+		switch(instruction.type)
+		{
+			case FIELD_TYPE_ADDRESS:
+			case FIELD_TYPE_ADDRESS_LIST:
+
+				if(parser->token != TOKEN_ADDRESS)
+				{
+					set_parser_error(parser,"IPv4 address expected");
+					return;
+				}
+
+				instruction.value = parser->token_value;
+				break;
+
+			case FIELD_TYPE_NUMBER_8:
+			case FIELD_TYPE_NUMBER_16:
+			case FIELD_TYPE_NUMBER_32:
+
+				if(parser->token != TOKEN_NUMBER)
+				{
+					set_parser_error(parser,"number expected");
+					return;
+				}
+
+				instruction.value = parser->token_value;
+				break;
+
+			case FIELD_TYPE_STRING:
+
+				if(parser->token != TOKEN_STRING)
+				{
+					set_parser_error(parser,"quoted string expected");
+					return;
+				}
+
+				if(instruction.comparison != COMPARISON_EQUAL && instruction.comparison != COMPARISON_NOT_EQUAL)
+				{
+					set_parser_error(parser,"strings can only be tested for equality");
+					return;
+				}
+
+				instruction.string_length = strlen(parser->token_text);
+
+				instruction.string = strdup(parser->token_text);
+				if(instruction.string == NULL)
+				{
+					set_parser_error(parser,"%s",strerror(errno));
+					return;
+				}
+
+				break;
+
+			default:
+
+				set_parser_error(parser,"this field can only be tested for presence");
+				return;
+		}
+
+		next_token(parser);
+	}
+	/* Just test for the presence of the field. */
+	else
+	{
+		instruction.opcode = OPCODE_EXISTS;
+	}
+
+	emit_instruction(parser,&instruction);
+
+	/* If the instruction could not be added, don't
+	 * leak the string.
+	 */
+	if(parser->failed && instruction.string != NULL)
+		free(instruction.string);
+}
+
+/****************************************************************************/
+
+/* factor := "not" factor | "(" expression ")" | test */
+static void
+parse_factor(struct filter_parser * parser)
+{
+	struct filter_instruction instruction;
+
+	if(parser->failed)
+		return;
+
+	memset(&instruction,0,sizeof(instruction));
+
+	if(parser->token == TOKEN_NAME && strcmp(parser->token_text,"not") == 0)
+	{
+		if(++parser->nesting_depth > MAXIMUM_NESTING_DEPTH)
+		{
+			set_parser_error(parser,"expression is nested too deeply");
+			return;
+		}
+
+		next_token(parser);
+		parse_factor(parser);
+
+		parser->nesting_depth--;
+
+		instruction.opcode = OPCODE_NOT;
+		emit_instruction(parser,&instruction);
+	}
+	else if (parser->token == TOKEN_LEFT_PARENTHESIS)
+	{
+		if(++parser->nesting_depth > MAXIMUM_NESTING_DEPTH)
+		{
+			set_parser_error(parser,"expression is nested too deeply");
+			return;
+		}
+
+		next_token(parser);
+		parse_expression(parser);
+
+		parser->nesting_depth--;
+
+		if(parser->token != TOKEN_RIGHT_PARENTHESIS)
+		{
+			set_parser_error(parser,"')' expected");
+			return;
+		}
+
+		next_token(parser);
+	}
+	else
+	{
+		parse_test(parser);
+	}
+}
+
+/****************************************************************************/
+
+/* term := factor { "and" factor } */
+static void
+parse_term(struct filter_parser * parser)
+{
+	struct filter_instruction instruction;
+
+	memset(&instruction,0,sizeof(instruction));
+	instruction.opcode = OPCODE_AND;
+
+	parse_factor(parser);
+
+	while(!parser->failed && parser->token == TOKEN_NAME && strcmp(parser->token_text,"and") == 0)
+	{
+		next_token(parser);
+		parse_factor(parser);
+
+		emit_instruction(parser,&instruction);
+	}
+}
+
+/****************************************************************************/
+
+/* expression := term { "or" term } */
+static void
+parse_expression(struct filter_parser * parser)
+{
+	struct filter_instruction instruction;
+
+	memset(&instruction,0,sizeof(instruction));
+	instruction.opcode = OPCODE_OR;
+
+	parse_term(parser);
+
+	while(!parser->failed && parser->token == TOKEN_NAME && strcmp(parser->token_text,"or") == 0)
+	{
+		next_token(parser);
+		parse_term(parser);
+
+		emit_instruction(parser,&instruction);
+	}
+}
+
+/****************************************************************************/
+
+/* Release the memory allocated by compile_offer_filter(). This is safe
+ * to call with a NULL parameter.
+ */
+void
+delete_offer_filter(struct offer_filter * filter)
+{
+	int i;
+
+	if(filter != NULL)
+	{
+		if(filter->code != NULL)
+		{
+			for(i = 0 ; i < filter->code_length ; i++)
+			{
+				if(filter->code[i].string != NULL)
+					free(filter->code[i].string);
+			}
+
+			free(filter->code);
+		}
+
+		free(filter);
+	}
+}
+
+/****************************************************************************/
+
+/* Compile a filter expression. Returns NULL in case of error, with a
+ * description of the problem in the error buffer provided.
+ */
+struct offer_filter *
+compile_offer_filter(const char * expression,char * error_buffer,size_t error_buffer_size)
+{
+	struct offer_filter * result = NULL;
+	struct filter_parser parser;
+	struct offer_filter * filter;
+
+	assert( expression != NULL && error_buffer != NULL && error_buffer_size > 0 );
+
+	memset(&parser,0,sizeof(parser));
+
+	parser.input = expression;
+	parser.error_buffer = error_buffer;
+	parser.error_buffer_size = error_buffer_size;
+
+	filter = calloc(1,sizeof(*filter));
+	if(filter == NULL)
+	{
+		snprintf(error_buffer,error_buffer_size,"%s",strerror(errno));
+		goto out;
+	}
+
+	next_token(&parser);
+	parse_expression(&parser);
+
+	if(!parser.failed && parser.token != TOKEN_END)
+	{
+		if(parser.token == TOKEN_RIGHT_PARENTHESIS)
+			set_parser_error(&parser,"unexpected ')'");
+		else
+			set_parser_error(&parser,"unexpected '%s'",parser.token_text);
+	}
+
+	/* The program owns the instructions from now on. */
+	filter->code = parser.code;
+	filter->code_length = parser.code_length;
+
+	if(parser.failed)
+		goto out;
+
+	assert( parser.stack_depth == 1 );
+
+	result = filter;
+	filter = NULL;
+
+ out:
+
+	delete_offer_filter(filter);
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Compare two numbers or addresses. */
+static bool
+compare_values(int comparison,uint32_t a,uint32_t b)
+{
+	bool result;
+
+	switch(comparison)
+	{
+		case COMPARISON_EQUAL:
+
+			result = (a == b);
+			break;
+
+		case COMPARISON_NOT_EQUAL:
+
+			result = (a != b);
+			break;
+
+		case COMPARISON_LESS:
+
+			result = (a < b);
+			break;
+
+		case COMPARISON_LESS_OR_EQUAL:
+
+			result = (a <= b);
+			break;
+
+		case COMPARISON_GREATER:
+
+			result = (a > b);
+			break;
+
+		case COMPARISON_GREATER_OR_EQUAL:
+
+			result = (a >= b);
+			break;
+
+		default:
+
+			result = false;
+			break;
+	}
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Compare an address against the value of an instruction, which may be
+ * a network membership test.
+ */
+static bool
+test_address(const struct filter_instruction * instruction,uint32_t address)
+{
+	bool result;
+
+	if(instruction->comparison == COMPARISON_IN)
+		result = ((address & instruction->mask) == instruction->value);
+	else if (instruction->comparison == COMPARISON_NOT_IN)
+		result = ((address & instruction->mask) != instruction->value);
+	else
+		result = compare_values(instruction->comparison,address,instruction->value);
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Read a 32 bit word in network byte order, which need not be aligned. */
+static uint32_t
+get_uint32(const uint8_t * data)
+{
+	return(((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | data[3]);
+}
+
+/****************************************************************************/
+
+/* Run a single test instruction against the offer. */
+static bool
+execute_test(const struct filter_instruction * instruction,const struct offer_index * index)
+{
+	const uint8_t * data;
+	bool result = false;
+	int length;
+	int i;
+
+	switch(instruction->source)
+	{
+		case FIELD_SOURCE_SERVER_ADDRESS:
+
+			result = test_address(instruction,index->server_address);
+			goto out;
+
+		case FIELD_SOURCE_OFFERED_ADDRESS:
+
+			result = test_address(instruction,index->offered_address);
+			goto out;
+
+		case FIELD_SOURCE_NEXT_SERVER_ADDRESS:
+
+			result = test_address(instruction,index->next_server_address);
+			goto out;
+
+		case FIELD_SOURCE_RELAY_AGENT_ADDRESS:
+
+			result = test_address(instruction,index->relay_agent_address);
+			goto out;
+	}
+
+	if(!is_option_present(index,instruction->option_type))
+		goto out;
+
+	data = &index->options[index->option_offset[instruction->option_type]];
+	length = index->option_length[instruction->option_type];
+
+	switch(instruction->type)
+	{
+		case FIELD_TYPE_ADDRESS:
+
+			if(length >= 4)
+				result = test_address(instruction,get_uint32(data));
+
+			break;
+
+		case FIELD_TYPE_ADDRESS_LIST:
+
+			for(i = 0 ; i + 4 <= length ; i += 4)
+			{
+				if(test_address(instruction,get_uint32(&data[i])))
+				{
+					result = true;
+					break;
+				}
+			}
+
+			break;
+
+		case FIELD_TYPE_NUMBER_8:
+
+			if(length >= 1)
+				result = compare_values(instruction->comparison,data[0],instruction->value);
+
+			break;
+
+		case FIELD_TYPE_NUMBER_16:
+
+			if(length >= 2)
+				result = compare_values(instruction->comparison,((uint32_t)data[0] << 8) | data[1],instruction->value);
+
+			break;
+
+		case FIELD_TYPE_NUMBER_32:
+
+			if(length >= 4)
+				result = compare_values(instruction->comparison,get_uint32(data),instruction->value);
+
+			break;
+
+		case FIELD_TYPE_STRING:
+
+			/* The string may or may not be NUL-terminated. */
+			while(length > 0 && data[length-1] == '\0')
+				length--;
+
+			result = ((size_t)length == instruction->string_length &&
+			          memcmp(data,instruction->string,length) == 0);
+
+			if(instruction->comparison == COMPARISON_NOT_EQUAL)
+				result = !result;
+
+			break;
+	}
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Check if an offer matches the filter expression. */
+bool
+evaluate_offer_filter(const struct offer_filter * filter,const struct offer_index * index)
+{
+	const struct filter_instruction * instruction;
+	bool stack[MAXIMUM_STACK_DEPTH];
+	int stack_depth = 0;
+	int i;
+
+	for(i = 0 ; i < filter->code_length ; i++)
+	{
+		instruction = &filter->code[i];
+
+		switch(instruction->opcode)
+		{
+			case OPCODE_TEST:
+
+				stack[stack_depth++] = execute_test(instruction,index);
+				break;
+
+			case OPCODE_EXISTS:
+
+				stack[stack_depth++] = (instruction->source != FIELD_SOURCE_OPTION ||
+				                        is_option_present(index,instruction->option_type));
+				break;
+
+			case OPCODE_NOT:
+
+				stack[stack_depth-1] = !stack[stack_depth-1];
+				break;
+
+			case OPCODE_AND:
+
+				stack_depth--;
+				stack[stack_depth-1] = stack[stack_depth-1] && stack[stack_depth];
+				break;
+
+			case OPCODE_OR:
+
+				stack_depth--;
+				stack[stack_depth-1] = stack[stack_depth-1] || stack[stack_depth];
+				break;
+		}
+	}
+
+	assert( stack_depth == 1 );
+
+	return(stack[0]);
+}
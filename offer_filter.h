@@ -0,0 +1,38 @@
+/*
+ * Offer filter expressions, such as
+ *
+ *     router != 10.0.0.1 or dns not in 10.0.0.0/8 or lease-time < 600
+ *
+ * which are compiled once and then evaluated against the option index
+ * of each DHCP offer received.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#ifndef _OFFER_FILTER_H
+#define _OFFER_FILTER_H
+
+/****************************************************************************/
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/****************************************************************************/
+
+#include "offer_index.h"
+
+/****************************************************************************/
+
+struct offer_filter;
+
+/****************************************************************************/
+
+struct offer_filter *compile_offer_filter(const char *expression, char *error_buffer, size_t error_buffer_size);
+void delete_offer_filter(struct offer_filter *filter);
+bool evaluate_offer_filter(const struct offer_filter *filter, const struct offer_index *index);
+
+/****************************************************************************/
+
+#endif /* _OFFER_FILTER_H */
@@ -0,0 +1,75 @@
+/*
+ * Index of the options contained in a DHCP offer, for quick access to
+ * the raw option data without decoding all of it.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#include <arpa/inet.h>
+
+#include <string.h>
+
+/****************************************************************************/
+
+#include "offer_index.h"
+
+/****************************************************************************/
+
+/* Fill in the option part of the index. Only the first instance of each
+ * option type is recorded, and options which would extend beyond the
+ * end of the options buffer are ignored.
+ */
+void
+build_option_index(struct offer_index * index,const uint8_t * vendor_options,int vendor_options_length)
+{
+	int option_type,option_length;
+	int pos;
+
+	index->options = vendor_options;
+
+	memset(index->option_present,0,sizeof(index->option_present));
+
+	for(pos = 0 ; pos < vendor_options_length ; (void)NULL)
+	{
+		option_type = vendor_options[pos++];
+
+		/* Skip the padding octet. */
+		if(option_type == OPTION_TYPE_PAD)
+			continue;
+
+		/* Stop at the end marker, or the end of the options buffer. */
+		if(option_type == OPTION_TYPE_END || pos == vendor_options_length)
+			break;
+
+		/* Stop at the end of the options buffer. */
+		option_length = vendor_options[pos++];
+		if(pos + option_length > vendor_options_length)
+			break;
+
+		if(!is_option_present(index,option_type))
+		{
+			index->option_present[option_type / 8] |= (1 << (option_type % 8));
+			index->option_offset[option_type] = pos;
+			index->option_length[option_type] = option_length;
+		}
+
+		pos += option_length;
+	}
+}
+
+/****************************************************************************/
+
+/* Fill in the index for a DHCP offer. */
+void
+build_offer_index(struct offer_index * index,uint32_t server_address,const bootp_t * dhcp,
+	const uint8_t * vendor_options,int vendor_options_length)
+{
+	index->server_address		= server_address;
+	index->offered_address		= ntohl(dhcp->yiaddr);
+	index->next_server_address	= ntohl(dhcp->siaddr);
+	index->relay_agent_address	= ntohl(dhcp->giaddr);
+
+	build_option_index(index,vendor_options,vendor_options_length);
+}
@@ -0,0 +1,57 @@
+/*
+ * Index of the options contained in a DHCP offer, for quick access to
+ * the raw option data without decoding all of it.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#ifndef _OFFER_INDEX_H
+#define _OFFER_INDEX_H
+
+/****************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/****************************************************************************/
+
+#include "dhcp_protocol.h"
+
+/****************************************************************************/
+
+/* Where to find the data of the first instance of each option type,
+ * along with the BOOTP header fields. All addresses are stored in
+ * host byte order.
+ */
+struct offer_index
+{
+	uint32_t		server_address;			/* IPv4 source address */
+	uint32_t		offered_address;		/* yiaddr */
+	uint32_t		next_server_address;	/* siaddr */
+	uint32_t		relay_agent_address;	/* giaddr */
+
+	const uint8_t *	options;
+	uint8_t			option_present[256 / 8];
+	uint16_t		option_offset[256];
+	uint8_t			option_length[256];
+};
+
+/****************************************************************************/
+
+void build_option_index(struct offer_index *index, const uint8_t *vendor_options, int vendor_options_length);
+void build_offer_index(struct offer_index *index, uint32_t server_address, const bootp_t *dhcp, const uint8_t *vendor_options, int vendor_options_length);
+
+/****************************************************************************/
+
+/* Check if the offer contains an option of the given type. */
+static inline bool
+is_option_present(const struct offer_index * index,int option_type)
+{
+	return((index->option_present[option_type / 8] & (1 << (option_type % 8))) != 0);
+}
+
+/****************************************************************************/
+
+#endif /* _OFFER_INDEX_H */
@@ -0,0 +1,470 @@
+/*
+ * Print the DHCP servers which "find-dhcp-servers --monitor --publish=<name>"
+ * found in its most recent scan, as published in a POSIX shared memory
+ * object. This does not require any special privileges, nor does it
+ * disturb the monitoring process.
+ *
+ * With the --stress option, the shared memory access is tested instead:
+ * one thread keeps publishing changing data while several other threads
+ * keep reading it, checking that each copy they obtain is consistent.
+ *
+ * License : BSD
+ */
+
+#include <sys/types.h>
+#include <sys/mman.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <signal.h>
+#include <stdio.h>
+#include <errno.h>
+#include <time.h>
+
+#include <unistd.h>
+#include <getopt.h>
+#include <pthread.h>
+
+/****************************************************************************/
+
+#include "shared_results.h"
+
+/****************************************************************************/
+
+/* Name of the shared memory object, unless a different one is given. */
+#define DEFAULT_SHARED_RESULTS_NAME "/find-dhcp-servers"
+
+/* Number of reader threads used by the stress test. */
+#define NUM_STRESS_READERS 4
+
+/****************************************************************************/
+
+const char * command_name;
+
+/****************************************************************************/
+
+/* Shared by the threads of the stress test. */
+struct stress_test
+{
+	struct shared_results *	publisher;
+	struct shared_results *	reader;
+	volatile bool			stop;
+	uint64_t				num_published;
+};
+
+/* What each reader thread of the stress test found. */
+struct stress_reader
+{
+	pthread_t				thread;
+	struct stress_test *	test;
+	uint64_t				num_read;
+	uint64_t				num_inconsistent;
+	uint64_t				num_failed;
+	struct shared_snapshot	snapshot;
+};
+
+/****************************************************************************/
+
+/* Convert a time stamp into ISO 8601 format, with second accuracy. */
+static void
+format_time_stamp(time_t stamp,char * buffer,size_t buffer_size)
+{
+	strftime(buffer,buffer_size,"%Y-%m-%dT%H:%M:%S%z",localtime(&stamp));
+}
+
+/****************************************************************************/
+
+/* Fill in the server table for the given generation of the stress test.
+ * Each entry depends on the generation, so that readers can tell if the
+ * entries they read belong together.
+ */
+static size_t
+fill_stress_servers(struct shared_server * servers,uint64_t generation)
+{
+	size_t num_servers = 1 + (generation % SHARED_RESULTS_CAPACITY);
+	size_t i;
+
+	for(i = 0 ; i < num_servers ; i++)
+	{
+		memset(&servers[i],0,sizeof(servers[i]));
+
+		servers[i].server_ipv4_address[0] = 10;
+		servers[i].server_ipv4_address[3] = (uint8_t)i;
+		servers[i].time_received = (int64_t)generation;
+		servers[i].offer_hash = generation * 0x9e3779b97f4a7c15ULL + i;
+	}
+
+	return(num_servers);
+}
+
+/****************************************************************************/
+
+/* Keep publishing new server tables until told to stop. */
+static void *
+stress_publisher(void * user_data)
+{
+	struct stress_test * test = user_data;
+	struct shared_server servers[SHARED_RESULTS_CAPACITY];
+	uint64_t generation;
+	size_t num_servers;
+
+	for(generation = 1 ; !test->stop ; generation++)
+	{
+		num_servers = fill_stress_servers(servers,generation);
+
+		publish_shared_results(test->publisher,servers,num_servers,(time_t)generation);
+
+		test->num_published = generation;
+	}
+
+	return(NULL);
+}
+
+/****************************************************************************/
+
+/* Keep reading the server table, checking every copy, until told
+ * to stop.
+ */
+static void *
+stress_reader(void * user_data)
+{
+	struct stress_reader * reader = user_data;
+	const struct shared_snapshot * snapshot = &reader->snapshot;
+	uint64_t generation;
+	bool consistent;
+	size_t i;
+
+	while(!reader->test->stop)
+	{
+		if(read_shared_results(reader->test->reader,&reader->snapshot) < 0)
+		{
+			reader->num_failed++;
+			continue;
+		}
+
+		reader->num_read++;
+
+		generation = snapshot->generation;
+
+		/* Nothing published yet? */
+		if(generation == 0)
+			continue;
+
+		consistent = (snapshot->num_servers == 1 + (generation % SHARED_RESULTS_CAPACITY) &&
+		              snapshot->num_servers_found == snapshot->num_servers &&
+		              snapshot->updated == (time_t)generation);
+
+		for(i = 0 ; consistent && i < snapshot->num_servers ; i++)
+		{
+			consistent = (snapshot->servers[i].time_received == (int64_t)generation &&
+			              snapshot->servers[i].offer_hash == generation * 0x9e3779b97f4a7c15ULL + i);
+		}
+
+		if(!consistent)
+			reader->num_inconsistent++;
+	}
+
+	return(NULL);
+}
+
+/****************************************************************************/
+
+/* Run the stress test for the given number of seconds, using a shared
+ * memory object of its own. Returns true if all readers only ever saw
+ * consistent data.
+ */
+static bool
+run_stress_test(int seconds)
+{
+	struct stress_reader readers[NUM_STRESS_READERS];
+	struct stress_test test;
+	pthread_t publisher_thread;
+	bool publisher_started = false;
+	int num_readers_started = 0;
+	uint64_t num_read = 0;
+	uint64_t num_inconsistent = 0;
+	uint64_t num_failed = 0;
+	char name[64];
+	bool result = false;
+	int error;
+	int i;
+
+	memset(&test,0,sizeof(test));
+	memset(readers,0,sizeof(readers));
+
+	snprintf(name,sizeof(name),"/%s-stress-%d",command_name,(int)getpid());
+
+	test.publisher = create_shared_results(name);
+	if(test.publisher == NULL)
+	{
+		fprintf(stderr,"%s: Unable to create shared memory object '%s': %s.\n",command_name,name,strerror(errno));
+		goto out;
+	}
+
+	test.reader = attach_shared_results(name);
+	if(test.reader == NULL)
+	{
+		fprintf(stderr,"%s: Unable to open shared memory object '%s': %s.\n",command_name,name,strerror(errno));
+		goto out;
+	}
+
+	error = pthread_create(&publisher_thread,NULL,stress_publisher,&test);
+	if(error != 0)
+	{
+		fprintf(stderr,"%s: Unable to start publisher thread: %s.\n",command_name,strerror(error));
+		goto out;
+	}
+
+	publisher_started = true;
+
+	for(i = 0 ; i < NUM_STRESS_READERS ; i++)
+	{
+		readers[i].test = &test;
+
+		error = pthread_create(&readers[i].thread,NULL,stress_reader,&readers[i]);
+		if(error != 0)
+		{
+			fprintf(stderr,"%s: Unable to start reader thread: %s.\n",command_name,strerror(error));
+			goto out;
+		}
+
+		num_readers_started++;
+	}
+
+	sleep(seconds);
+
+	result = true;
+
+ out:
+
+	test.stop = true;
+
+	if(publisher_started)
+		pthread_join(publisher_thread,NULL);
+
+	for(i = 0 ; i < num_readers_started ; i++)
+	{
+		pthread_join(readers[i].thread,NULL);
+
+		num_read += readers[i].num_read;
+		num_inconsistent += readers[i].num_inconsistent;
+		num_failed += readers[i].num_failed;
+	}
+
+	if(result)
+	{
+		printf("tables-published=%llu\n",(unsigned long long)test.num_published);
+		printf("tables-read=%llu\n",(unsigned long long)num_read);
+		printf("tables-inconsistent=%llu\n",(unsigned long long)num_inconsistent);
+		printf("reads-failed=%llu\n",(unsigned long long)num_failed);
+
+		result = (num_inconsistent == 0 && num_read > 0);
+	}
+
+	delete_shared_results(test.reader);
+
+	if(test.publisher != NULL)
+	{
+		delete_shared_results(test.publisher);
+		shm_unlink(name);
+	}
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Print what the shared memory object contains. Returns true if this
+ * worked.
+ */
+static bool
+print_shared_results(const char * name)
+{
+	struct shared_results * shared_results;
+	struct shared_snapshot * snapshot;
+	const struct shared_server * server;
+	char time_string[32];
+	bool result = false;
+	bool running;
+	uint32_t i;
+
+	snapshot = malloc(sizeof(*snapshot));
+	if(snapshot == NULL)
+	{
+		fprintf(stderr,"%s: Not enough memory.\n",command_name);
+		goto out;
+	}
+
+	shared_results = attach_shared_results(name);
+	if(shared_results == NULL)
+	{
+		fprintf(stderr,"%s: Unable to open shared memory object '%s': %s.\n",command_name,name,strerror(errno));
+		goto out;
+	}
+
+	if(read_shared_results(shared_results,snapshot) < 0)
+	{
+		fprintf(stderr,"%s: Unable to read shared memory object '%s': %s.\n",command_name,name,strerror(errno));
+
+		delete_shared_results(shared_results);
+		goto out;
+	}
+
+	delete_shared_results(shared_results);
+
+	/* Is the publisher still around? */
+	running = (kill(snapshot->publisher_pid,0) == 0 || errno == EPERM);
+
+	printf("generation=%llu\n",(unsigned long long)snapshot->generation);
+
+	if(snapshot->generation > 0)
+	{
+		format_time_stamp(snapshot->updated,time_string,sizeof(time_string));
+		printf("time-updated=%s\n",time_string);
+	}
+
+	printf("publisher-pid=%d (%s)\n",(int)snapshot->publisher_pid,running ? "running" : "not running");
+	printf("number-of-servers=%u\n",snapshot->num_servers_found);
+
+	for(i = 0 ; i < snapshot->num_servers ; i++)
+	{
+		server = &snapshot->servers[i];
+
+		format_time_stamp((time_t)server->time_received,time_string,sizeof(time_string));
+
+		printf("\n");
+		printf("time-received=%s\n",time_string);
+		printf("network-interface=%.*s\n",(int)sizeof(server->interface_name),server->interface_name);
+
+		printf("server-ipv4-address=%u.%u.%u.%u\n",
+			server->server_ipv4_address[0],
+			server->server_ipv4_address[1],
+			server->server_ipv4_address[2],
+			server->server_ipv4_address[3]);
+
+		printf("server-mac-address=%02x:%02x:%02x:%02x:%02x:%02x\n",
+			server->server_mac_address[0],
+			server->server_mac_address[1],
+			server->server_mac_address[2],
+			server->server_mac_address[3],
+			server->server_mac_address[4],
+			server->server_mac_address[5]);
+
+		printf("offered-ipv4-address=%u.%u.%u.%u\n",
+			server->offered_ipv4_address[0],
+			server->offered_ipv4_address[1],
+			server->offered_ipv4_address[2],
+			server->offered_ipv4_address[3]);
+	}
+
+	result = true;
+
+ out:
+
+	if(snapshot != NULL)
+		free(snapshot);
+
+	return(result);
+}
+
+/****************************************************************************/
+
+static void
+print_usage(void)
+{
+	printf("Usage: %s "
+		"[--stress[=<seconds>]] "
+		"[--help] "
+		"[name]\n",
+		command_name);
+}
+
+/****************************************************************************/
+
+int
+main(int argc, char *argv[])
+{
+	static const struct option longopts[] =
+	{
+		{ "stress",				optional_argument,	NULL,	's'	},
+		{ "help",				no_argument,		NULL,	'h'	},
+		{ NULL,					0,					NULL,	0	}
+	};
+
+	const char * name = DEFAULT_SHARED_RESULTS_NAME;
+	int result = EXIT_FAILURE;
+	int stress_seconds = 0;
+	const char * s;
+	char * p;
+	long n;
+	int c;
+
+	/* Figure out the name of this command. Strip any
+	 * leading path from it.
+	 */
+	command_name = argv[0];
+
+	s = strrchr(command_name, '/');
+	if(s != NULL)
+		command_name = s+1;
+
+	while((c = getopt_long(argc,argv,"hs::",longopts,NULL)) != -1)
+	{
+		switch(c)
+		{
+			/* Test the shared memory access for a while. */
+			case 's':
+
+				stress_seconds = 5;
+
+				if(optarg != NULL)
+				{
+					n = strtol(optarg,&p,0);
+					if(p == optarg || (*p) != '\0' || n < 1 || n > 3600)
+					{
+						fprintf(stderr,"%s: Parameter '--stress=%s' is not a valid number of seconds.\n",command_name,optarg);
+						goto out;
+					}
+
+					stress_seconds = (int)n;
+				}
+
+				break;
+
+			case 'h':
+
+				print_usage();
+
+				result = EXIT_SUCCESS;
+				goto out;
+
+			default:
+
+				fprintf(stderr,"%s: %s - %s\n",command_name,optarg,"option not known");
+				goto out;
+		}
+	}
+
+	argc -= optind;
+	argv += optind;
+
+	if(argc > 0)
+		name = argv[0];
+
+	if(stress_seconds > 0)
+	{
+		if(run_stress_test(stress_seconds))
+			result = EXIT_SUCCESS;
+	}
+	else
+	{
+		if(print_shared_results(name))
+			result = EXIT_SUCCESS;
+	}
+
+ out:
+
+	return(result);
+}
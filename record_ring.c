@@ -0,0 +1,302 @@
+/*
+ * Lock-free ring buffer of fixed-size records, passed from a single
+ * producer thread to a single consumer thread.
+ *
+ * The producer owns the head position and the consumer owns the tail
+ * position; each one only reads the other's position, which is why
+ * no locks are needed. The producer never waits: if the ring is full,
+ * the record is dropped and counted as an overflow.
+ *
+ * The consumer may sleep while the ring is empty. Before it does so, it
+ * announces this through a flag, which the producer checks after adding
+ * a record, waking the consumer through a pipe only if necessary. This
+ * keeps the producer free of system calls while the consumer keeps up.
+ *
+ * The memory ordering is implemented with the GCC/clang __atomic builtin
+ * functions.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+/****************************************************************************/
+
+#include "record_ring.h"
+
+/****************************************************************************/
+
+/* Keeps the producer and consumer positions in separate cache lines. */
+#define CACHE_LINE_SIZE 64
+
+/****************************************************************************/
+
+struct record_ring
+{
+	/* Written by the producer. */
+	uint64_t	head;
+	uint64_t	overflows;
+	bool		closed;
+	uint8_t		padding1[CACHE_LINE_SIZE - 2 * sizeof(uint64_t) - sizeof(bool)];
+
+	/* Written by the consumer. */
+	uint64_t	tail;
+	bool		consumer_waiting;
+	uint8_t		padding2[CACHE_LINE_SIZE - sizeof(uint64_t) - sizeof(bool)];
+
+	/* Not changed after the ring has been created. */
+	size_t		capacity;		/* Always a power of 2 */
+	size_t		record_size;
+	uint8_t *	records;
+	int			wakeup_pipe[2];
+};
+
+/****************************************************************************/
+
+/* Wake up the consumer if it is waiting for records to arrive. This is
+ * called by the producer.
+ */
+static void
+wake_consumer(struct record_ring * ring)
+{
+	/* The position or the closed flag must be visible to the consumer
+	 * before the flag is checked, or the wakeup could get lost.
+	 */
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	if(__atomic_load_n(&ring->consumer_waiting,__ATOMIC_RELAXED) &&
+	   __atomic_exchange_n(&ring->consumer_waiting,false,__ATOMIC_ACQ_REL))
+	{
+		/* If the pipe is full, the consumer will wake up anyway. */
+		(void)write(ring->wakeup_pipe[1],"",1);
+	}
+}
+
+/****************************************************************************/
+
+/* Create a ring which holds at least the given number of records, each
+ * of the given size. Returns NULL in case of error, with errno set.
+ */
+struct record_ring *
+create_record_ring(size_t capacity,size_t record_size)
+{
+	struct record_ring * result = NULL;
+	struct record_ring * ring = NULL;
+	size_t rounded_capacity;
+	int i;
+
+	if(capacity == 0 || record_size == 0 || capacity > ((size_t)-1) / 2 / record_size)
+	{
+		errno = EINVAL;
+		goto out;
+	}
+
+	for(rounded_capacity = 1 ; rounded_capacity < capacity ; rounded_capacity *= 2)
+		;
+
+	ring = calloc(1,sizeof(*ring));
+	if(ring == NULL)
+		goto out;
+
+	ring->wakeup_pipe[0] = ring->wakeup_pipe[1] = -1;
+
+	ring->capacity = rounded_capacity;
+	ring->record_size = record_size;
+
+	ring->records = malloc(rounded_capacity * record_size);
+	if(ring->records == NULL)
+		goto out;
+
+	if(pipe(ring->wakeup_pipe) < 0)
+		goto out;
+
+	for(i = 0 ; i < 2 ; i++)
+	{
+		if(fcntl(ring->wakeup_pipe[i],F_SETFL,fcntl(ring->wakeup_pipe[i],F_GETFL) | O_NONBLOCK) < 0)
+			goto out;
+	}
+
+	result = ring;
+	ring = NULL;
+
+ out:
+
+	delete_record_ring(ring);
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Release a ring. Neither the producer nor the consumer may still be
+ * using it. This is safe to call with a NULL parameter.
+ */
+void
+delete_record_ring(struct record_ring * ring)
+{
+	int error = errno;
+	int i;
+
+	if(ring != NULL)
+	{
+		for(i = 0 ; i < 2 ; i++)
+		{
+			if(ring->wakeup_pipe[i] != -1)
+				close(ring->wakeup_pipe[i]);
+		}
+
+		free(ring->records);
+		free(ring);
+	}
+
+	errno = error;
+}
+
+/****************************************************************************/
+
+/* Add a copy of a record to the ring. This is called by the producer and
+ * never blocks. Returns false if the ring is full, in which case the
+ * record is dropped and counted as an overflow.
+ */
+bool
+push_record(struct record_ring * ring,const void * record)
+{
+	uint64_t tail;
+	bool result = false;
+
+	tail = __atomic_load_n(&ring->tail,__ATOMIC_ACQUIRE);
+
+	if(ring->head - tail == ring->capacity)
+	{
+		__atomic_store_n(&ring->overflows,ring->overflows + 1,__ATOMIC_RELAXED);
+		goto out;
+	}
+
+	memcpy(&ring->records[(ring->head & (ring->capacity - 1)) * ring->record_size],record,ring->record_size);
+
+	__atomic_store_n(&ring->head,ring->head + 1,__ATOMIC_RELEASE);
+
+	wake_consumer(ring);
+
+	result = true;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Tell the consumer that no further records will be added. This is
+ * called by the producer.
+ */
+void
+close_record_ring(struct record_ring * ring)
+{
+	__atomic_store_n(&ring->closed,true,__ATOMIC_RELEASE);
+
+	wake_consumer(ring);
+}
+
+/****************************************************************************/
+
+/* Remove up to max_records records from the ring, copying them to the
+ * buffer provided. This is called by the consumer and never blocks.
+ * Returns the number of records removed.
+ */
+size_t
+pop_records(struct record_ring * ring,void * records,size_t max_records)
+{
+	uint8_t * buffer = records;
+	uint64_t head;
+	size_t num_records;
+	size_t first,count;
+
+	head = __atomic_load_n(&ring->head,__ATOMIC_ACQUIRE);
+
+	num_records = head - ring->tail;
+	if(num_records > max_records)
+		num_records = max_records;
+
+	if(num_records > 0)
+	{
+		/* The records may wrap around the end of the buffer. */
+		first = ring->tail & (ring->capacity - 1);
+
+		count = ring->capacity - first;
+		if(count > num_records)
+			count = num_records;
+
+		memcpy(buffer,&ring->records[first * ring->record_size],count * ring->record_size);
+
+		if(count < num_records)
+			memcpy(&buffer[count * ring->record_size],ring->records,(num_records - count) * ring->record_size);
+
+		__atomic_store_n(&ring->tail,ring->tail + num_records,__ATOMIC_RELEASE);
+	}
+
+	return(num_records);
+}
+
+/****************************************************************************/
+
+/* Check if the producer has closed the ring. Records may still be left
+ * in the ring when this returns true. This is called by the consumer.
+ */
+bool
+is_record_ring_closed(struct record_ring * ring)
+{
+	return(__atomic_load_n(&ring->closed,__ATOMIC_ACQUIRE));
+}
+
+/****************************************************************************/
+
+/* Wait until the ring holds records or has been closed. This is called by
+ * the consumer, and it may return early.
+ */
+void
+wait_for_records(struct record_ring * ring)
+{
+	struct pollfd pfd;
+	char buffer[64];
+
+	__atomic_store_n(&ring->consumer_waiting,true,__ATOMIC_RELAXED);
+
+	/* The flag must be visible to the producer before the position and the
+	 * closed flag are checked, or the wakeup could get lost.
+	 */
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	if(__atomic_load_n(&ring->head,__ATOMIC_RELAXED) == ring->tail && !__atomic_load_n(&ring->closed,__ATOMIC_RELAXED))
+	{
+		pfd.fd = ring->wakeup_pipe[0];
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+
+		(void)poll(&pfd,1,-1);
+	}
+
+	__atomic_store_n(&ring->consumer_waiting,false,__ATOMIC_RELAXED);
+
+	/* Discard the wakeup signals, including any which were sent too late
+	 * to matter.
+	 */
+	while(read(ring->wakeup_pipe[0],buffer,sizeof(buffer)) > 0)
+		;
+}
+
+/****************************************************************************/
+
+/* The number of records which were dropped because the ring was full. */
+uint64_t
+get_record_ring_overflows(struct record_ring * ring)
+{
+	return(__atomic_load_n(&ring->overflows,__ATOMIC_RELAXED));
+}
@@ -0,0 +1,36 @@
+/*
+ * Lock-free ring buffer of fixed-size records, passed from a single
+ * producer thread to a single consumer thread.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#ifndef _RECORD_RING_H
+#define _RECORD_RING_H
+
+/****************************************************************************/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/****************************************************************************/
+
+struct record_ring;
+
+/****************************************************************************/
+
+struct record_ring *create_record_ring(size_t capacity, size_t record_size);
+void delete_record_ring(struct record_ring *ring);
+bool push_record(struct record_ring *ring, const void *record);
+void close_record_ring(struct record_ring *ring);
+size_t pop_records(struct record_ring *ring, void *records, size_t max_records);
+bool is_record_ring_closed(struct record_ring *ring);
+void wait_for_records(struct record_ring *ring);
+uint64_t get_record_ring_overflows(struct record_ring *ring);
+
+/****************************************************************************/
+
+#endif /* _RECORD_RING_H */
@@ -0,0 +1,297 @@
+/*
+ * Reading and writing captured Ethernet frames in the file format which
+ * libpcap and tcpdump use, without depending upon libpcap. Files which
+ * were written on a machine with a different byte order, or with
+ * nanosecond resolution timestamps, can be read, too.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+
+/****************************************************************************/
+
+#include "savefile.h"
+
+/****************************************************************************/
+
+/* Identifies the file format, and which resolution the timestamps have. */
+#define SAVEFILE_MAGIC				0xa1b2c3d4
+#define SAVEFILE_MAGIC_NANOSECONDS	0xa1b23c4d
+
+#define SAVEFILE_VERSION_MAJOR	2
+#define SAVEFILE_VERSION_MINOR	4
+
+/* The only kind of link layer header supported. */
+#define LINKTYPE_ETHERNET 1
+
+/****************************************************************************/
+
+/* The header at the start of the file. */
+struct savefile_header
+{
+	uint32_t	magic;
+	uint16_t	version_major;
+	uint16_t	version_minor;
+	int32_t		time_zone;
+	uint32_t	timestamp_accuracy;
+	uint32_t	snapshot_length;
+	uint32_t	link_type;
+};
+
+/* The header in front of each frame. */
+struct savefile_record
+{
+	uint32_t	seconds;
+	uint32_t	fraction;	/* Microseconds or nanoseconds */
+	uint32_t	captured_length;
+	uint32_t	original_length;
+};
+
+/****************************************************************************/
+
+static uint32_t
+get_uint32(const uint8_t * data,bool swapped)
+{
+	uint32_t value;
+
+	memmove(&value,data,sizeof(value));
+
+	if(swapped)
+	{
+		value = ((value & 0x000000ff) << 24) |
+		        ((value & 0x0000ff00) <<  8) |
+		        ((value & 0x00ff0000) >>  8) |
+		        ((value & 0xff000000) >> 24);
+	}
+
+	return(value);
+}
+
+/****************************************************************************/
+
+/* Read all the frames stored in a file. Returns -1 in case of error,
+ * with a description of the problem placed in the error buffer, and
+ * 0 otherwise. The frames must be freed with free_savefile() eventually.
+ */
+int
+read_savefile(const char * file_name,struct savefile * file,char * error_buffer,size_t error_buffer_size)
+{
+	uint8_t * contents = NULL;
+	size_t size = 0;
+	size_t contents_size = 0;
+	struct capture_frame * frames = NULL;
+	int num_frames = 0;
+	int frames_size = 0;
+	bool swapped;
+	bool nanoseconds;
+	uint32_t magic;
+	uint32_t captured_length;
+	uint32_t fraction;
+	size_t pos;
+	size_t n;
+	FILE * in;
+	int result = -1;
+
+	memset(file,0,sizeof(*file));
+
+	in = fopen(file_name,"rb");
+	if(in == NULL)
+	{
+		snprintf(error_buffer,error_buffer_size,"%s",strerror(errno));
+		goto out;
+	}
+
+	/* Read the entire file; the frames will point into it. */
+	do
+	{
+		if(size == contents_size)
+		{
+			size_t new_size = (contents_size > 0) ? 2 * contents_size : 65536;
+			uint8_t * new_contents;
+
+			new_contents = realloc(contents,new_size);
+			if(new_contents == NULL)
+			{
+				snprintf(error_buffer,error_buffer_size,"%s",strerror(errno));
+				goto out;
+			}
+
+			contents = new_contents;
+			contents_size = new_size;
+		}
+
+		n = fread(&contents[size],1,contents_size - size,in);
+		size += n;
+	}
+	while(n > 0);
+
+	if(ferror(in))
+	{
+		snprintf(error_buffer,error_buffer_size,"%s",strerror(errno));
+		goto out;
+	}
+
+	if(size < sizeof(struct savefile_header))
+	{
+		snprintf(error_buffer,error_buffer_size,"file is too short");
+		goto out;
+	}
+
+	magic = get_uint32(&contents[offsetof(struct savefile_header,magic)],false);
+
+	if(magic == SAVEFILE_MAGIC || magic == SAVEFILE_MAGIC_NANOSECONDS)
+		swapped = false;
+	else if (get_uint32(&contents[0],true) == SAVEFILE_MAGIC || get_uint32(&contents[0],true) == SAVEFILE_MAGIC_NANOSECONDS)
+		swapped = true;
+	else
+	{
+		snprintf(error_buffer,error_buffer_size,"not a capture file");
+		goto out;
+	}
+
+	nanoseconds = (get_uint32(&contents[0],swapped) == SAVEFILE_MAGIC_NANOSECONDS);
+
+	if(get_uint32(&contents[offsetof(struct savefile_header,link_type)],swapped) != LINKTYPE_ETHERNET)
+	{
+		snprintf(error_buffer,error_buffer_size,"only Ethernet frames are supported");
+		goto out;
+	}
+
+	for(pos = sizeof(struct savefile_header) ; pos < size ; pos += captured_length)
+	{
+		if(pos + sizeof(struct savefile_record) > size)
+		{
+			snprintf(error_buffer,error_buffer_size,"frame %d is truncated",num_frames+1);
+			goto out;
+		}
+
+		captured_length = get_uint32(&contents[pos + offsetof(struct savefile_record,captured_length)],swapped);
+		if(captured_length > SAVEFILE_MAX_FRAME_SIZE || pos + sizeof(struct savefile_record) + captured_length > size)
+		{
+			snprintf(error_buffer,error_buffer_size,"frame %d is truncated",num_frames+1);
+			goto out;
+		}
+
+		if(num_frames == frames_size)
+		{
+			int new_size = (frames_size > 0) ? 2 * frames_size : 256;
+			struct capture_frame * new_frames;
+
+			new_frames = realloc(frames,new_size * sizeof(*frames));
+			if(new_frames == NULL)
+			{
+				snprintf(error_buffer,error_buffer_size,"%s",strerror(errno));
+				goto out;
+			}
+
+			frames = new_frames;
+			frames_size = new_size;
+		}
+
+		fraction = get_uint32(&contents[pos + offsetof(struct savefile_record,fraction)],swapped);
+
+		frames[num_frames].stamp.tv_sec		= get_uint32(&contents[pos + offsetof(struct savefile_record,seconds)],swapped);
+		frames[num_frames].stamp.tv_usec	= nanoseconds ? fraction / 1000 : fraction;
+
+		pos += sizeof(struct savefile_record);
+
+		frames[num_frames].data		= &contents[pos];
+		frames[num_frames].length	= captured_length;
+
+		num_frames++;
+	}
+
+	file->contents		= contents;
+	file->frames		= frames;
+	file->num_frames	= num_frames;
+
+	contents = NULL;
+	frames = NULL;
+
+	result = 0;
+
+ out:
+
+	if(in != NULL)
+		fclose(in);
+
+	free(contents);
+	free(frames);
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Release the frames read from a file. */
+void
+free_savefile(struct savefile * file)
+{
+	free(file->contents);
+	free(file->frames);
+
+	memset(file,0,sizeof(*file));
+}
+
+/****************************************************************************/
+
+/* Write the header which every file has to begin with. Returns -1 in
+ * case of error, and 0 otherwise.
+ */
+int
+write_savefile_header(FILE * out,int snapshot_length)
+{
+	struct savefile_header header;
+	int result = -1;
+
+	memset(&header,0,sizeof(header));
+
+	header.magic			= SAVEFILE_MAGIC;
+	header.version_major	= SAVEFILE_VERSION_MAJOR;
+	header.version_minor	= SAVEFILE_VERSION_MINOR;
+	header.snapshot_length	= snapshot_length;
+	header.link_type		= LINKTYPE_ETHERNET;
+
+	if(fwrite(&header,sizeof(header),1,out) != 1)
+		goto out;
+
+	result = 0;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Add a frame to a file. Returns -1 in case of error, and 0 otherwise. */
+int
+write_savefile_frame(FILE * out,const struct capture_frame * frame)
+{
+	struct savefile_record record;
+	int result = -1;
+
+	record.seconds			= frame->stamp.tv_sec;
+	record.fraction			= frame->stamp.tv_usec;
+	record.captured_length	= frame->length;
+	record.original_length	= frame->length;
+
+	if(fwrite(&record,sizeof(record),1,out) != 1)
+		goto out;
+
+	if(frame->length > 0 && fwrite(frame->data,frame->length,1,out) != 1)
+		goto out;
+
+	result = 0;
+
+ out:
+
+	return(result);
+}
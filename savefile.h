@@ -0,0 +1,47 @@
+/*
+ * Reading and writing captured Ethernet frames in the file format which
+ * libpcap and tcpdump use, without depending upon libpcap.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#ifndef _SAVEFILE_H
+#define _SAVEFILE_H
+
+/****************************************************************************/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/****************************************************************************/
+
+#include "capture_backend.h"
+
+/****************************************************************************/
+
+/* Largest frame which will be read from a file. */
+#define SAVEFILE_MAX_FRAME_SIZE 65535
+
+/****************************************************************************/
+
+/* All the frames read from a file, which are held in memory. */
+struct savefile
+{
+	uint8_t *				contents;
+	struct capture_frame *	frames;
+	int						num_frames;
+};
+
+/****************************************************************************/
+
+int read_savefile(const char *file_name, struct savefile *file, char *error_buffer, size_t error_buffer_size);
+void free_savefile(struct savefile *file);
+int write_savefile_header(FILE *out, int snapshot_length);
+int write_savefile_frame(FILE *out, const struct capture_frame *frame);
+
+/****************************************************************************/
+
+#endif /* _SAVEFILE_H */
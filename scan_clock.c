@@ -0,0 +1,223 @@
+/*
+ * Where scans get the time from, and how they wait for it to pass.
+ *
+ * The system clock is used unless a scan is told otherwise. The
+ * simulated clock only moves forward when it is told to, or when a
+ * scan waits for it, and then it skips ahead right away, which means
+ * that scans which take seconds in real time can be played through in
+ * microseconds, always with the same outcome.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+
+/****************************************************************************/
+
+#include "scan_clock.h"
+
+/****************************************************************************/
+
+static void
+system_get_monotonic_time(struct scan_clock * clock __attribute__((unused)),struct timespec * now)
+{
+	clock_gettime(CLOCK_MONOTONIC,now);
+}
+
+/****************************************************************************/
+
+static void
+system_get_time_of_day(struct scan_clock * clock __attribute__((unused)),struct timeval * now)
+{
+	gettimeofday(now,NULL);
+}
+
+/****************************************************************************/
+
+static int
+system_poll(struct scan_clock * clock __attribute__((unused)),struct pollfd * pfd,int num_fds,int timeout)
+{
+	return(poll(pfd,num_fds,timeout));
+}
+
+/****************************************************************************/
+
+struct scan_clock system_scan_clock =
+{
+	"system",
+	system_get_monotonic_time,
+	system_get_time_of_day,
+	system_poll
+};
+
+/****************************************************************************/
+
+/* Return the number of milliseconds left on the given clock until the
+ * given time has come, or 0 if it has come already. This is what poll()
+ * timeouts are made of.
+ */
+int
+get_scan_clock_milliseconds_until(struct scan_clock * clock,const struct timespec * when)
+{
+	struct timespec now;
+	long long milliseconds;
+	int result = 0;
+
+	(*clock->get_monotonic_time)(clock,&now);
+
+	milliseconds = (when->tv_sec - now.tv_sec) * 1000LL + (when->tv_nsec - now.tv_nsec) / 1000000;
+	if(milliseconds > 0)
+		result = (milliseconds > INT_MAX) ? INT_MAX : (int)milliseconds;
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Check if one point in time comes before another. */
+static bool
+is_earlier(const struct timespec * a,const struct timespec * b)
+{
+	return(a->tv_sec < b->tv_sec || (a->tv_sec == b->tv_sec && a->tv_nsec < b->tv_nsec));
+}
+
+/****************************************************************************/
+
+static void
+simulated_get_monotonic_time(struct scan_clock * clock,struct timespec * now)
+{
+	struct simulated_scan_clock * sc = (struct simulated_scan_clock *)clock;
+
+	(*now) = sc->now;
+}
+
+/****************************************************************************/
+
+static void
+simulated_get_time_of_day(struct scan_clock * clock,struct timeval * now)
+{
+	struct simulated_scan_clock * sc = (struct simulated_scan_clock *)clock;
+
+	now->tv_sec = sc->time_of_day_start.tv_sec + sc->now.tv_sec;
+	now->tv_usec = sc->time_of_day_start.tv_usec + sc->now.tv_nsec / 1000;
+
+	if(now->tv_usec >= 1000000)
+	{
+		now->tv_sec++;
+		now->tv_usec -= 1000000;
+	}
+}
+
+/****************************************************************************/
+
+/* Skip ahead to the wakeup time, if it comes before the timeout has
+ * elapsed, or else to the end of the timeout. Waiting without a time
+ * limit and without a wakeup time would never end, which is reported
+ * as an error.
+ */
+static int
+simulated_poll(struct scan_clock * clock,struct pollfd * pfd,int num_fds,int timeout)
+{
+	struct simulated_scan_clock * sc = (struct simulated_scan_clock *)clock;
+	struct timespec until;
+	int result = -1;
+	int i;
+
+	if(timeout < 0 && !sc->have_wakeup)
+	{
+		errno = EDEADLK;
+		goto out;
+	}
+
+	until = sc->now;
+
+	if(timeout > 0)
+	{
+		until.tv_sec += timeout / 1000;
+		until.tv_nsec += (timeout % 1000) * 1000000L;
+
+		if(until.tv_nsec >= 1000000000L)
+		{
+			until.tv_sec++;
+			until.tv_nsec -= 1000000000L;
+		}
+	}
+
+	if(sc->have_wakeup && (timeout < 0 || !is_earlier(&until,&sc->wakeup)))
+	{
+		advance_simulated_scan_clock(sc,&sc->wakeup);
+
+		sc->have_wakeup = false;
+
+		for(i = 0 ; i < num_fds ; i++)
+			pfd[i].revents = (pfd[i].fd >= 0) ? (pfd[i].events & POLLIN) : 0;
+
+		result = num_fds;
+	}
+	else
+	{
+		advance_simulated_scan_clock(sc,&until);
+
+		for(i = 0 ; i < num_fds ; i++)
+			pfd[i].revents = 0;
+
+		result = 0;
+	}
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Set up a simulated clock which starts at the given time of day. Its
+ * monotonic time starts at 0.
+ */
+void
+init_simulated_scan_clock(struct simulated_scan_clock * sc,const struct timeval * time_of_day)
+{
+	memset(sc,0,sizeof(*sc));
+
+	sc->clock.name					= "simulated";
+	sc->clock.get_monotonic_time	= simulated_get_monotonic_time;
+	sc->clock.get_time_of_day		= simulated_get_time_of_day;
+	sc->clock.poll					= simulated_poll;
+
+	sc->time_of_day_start = (*time_of_day);
+}
+
+/****************************************************************************/
+
+/* Move the clock forward to the given time. It never goes backwards. */
+void
+advance_simulated_scan_clock(struct simulated_scan_clock * sc,const struct timespec * until)
+{
+	if(is_earlier(&sc->now,until))
+		sc->now = (*until);
+}
+
+/****************************************************************************/
+
+/* Have the next wait end at the given time, with the file descriptors
+ * ready to be read, unless its timeout elapses earlier.
+ */
+void
+set_simulated_scan_clock_wakeup(struct simulated_scan_clock * sc,const struct timespec * when)
+{
+	sc->wakeup = (*when);
+	sc->have_wakeup = true;
+}
+
+/****************************************************************************/
+
+/* Let the next wait last until its timeout has elapsed. */
+void
+clear_simulated_scan_clock_wakeup(struct simulated_scan_clock * sc)
+{
+	sc->have_wakeup = false;
+}
@@ -0,0 +1,79 @@
+/*
+ * Where scans get the time from, and how they wait for it to pass.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#ifndef _SCAN_CLOCK_H
+#define _SCAN_CLOCK_H
+
+/****************************************************************************/
+
+#include <sys/time.h>
+
+#include <stdbool.h>
+#include <poll.h>
+#include <time.h>
+
+/****************************************************************************/
+
+/* The operations every clock supports. */
+struct scan_clock
+{
+	const char * name;
+
+	/* The time which timeouts are measured against, which never goes
+	 * backwards.
+	 */
+	void (*get_monotonic_time)(struct scan_clock *clock, struct timespec *now);
+
+	/* The time of day, which the offers received are stamped with. */
+	void (*get_time_of_day)(struct scan_clock *clock, struct timeval *now);
+
+	/* Wait for up to timeout milliseconds (or without a time limit if
+	 * negative) for the file descriptors to become ready, like poll().
+	 */
+	int (*poll)(struct scan_clock *clock, struct pollfd *pfd, int num_fds, int timeout);
+};
+
+/****************************************************************************/
+
+/* The clock which scans use unless told otherwise. */
+extern struct scan_clock system_scan_clock;
+
+/****************************************************************************/
+
+int get_scan_clock_milliseconds_until(struct scan_clock *clock, const struct timespec *when);
+
+/****************************************************************************/
+
+/* A clock which only moves forward when it is told to, or when a scan
+ * waits for it. Waiting takes no time at all: the clock skips ahead to
+ * the end of the timeout, or to the wakeup time if that comes first, in
+ * which case all the file descriptors are reported to be ready. This is
+ * how the frames which a scan receives may be scripted to arrive at
+ * given times.
+ */
+struct simulated_scan_clock
+{
+	struct scan_clock	clock;				/* Must come first */
+
+	struct timespec		now;
+	struct timeval		time_of_day_start;	/* Time of day at the start */
+
+	struct timespec		wakeup;
+	bool				have_wakeup;
+};
+
+/****************************************************************************/
+
+void init_simulated_scan_clock(struct simulated_scan_clock *sc, const struct timeval *time_of_day);
+void advance_simulated_scan_clock(struct simulated_scan_clock *sc, const struct timespec *until);
+void set_simulated_scan_clock_wakeup(struct simulated_scan_clock *sc, const struct timespec *when);
+void clear_simulated_scan_clock_wakeup(struct simulated_scan_clock *sc);
+
+/****************************************************************************/
+
+#endif /* _SCAN_CLOCK_H */
@@ -0,0 +1,431 @@
+/*
+ * Run scans on many network interfaces, only so many at a time.
+ *
+ * Sending DHCP DISCOVER messages through thousands of VLAN interfaces at
+ * once floods the DHCP relays and servers, which then fail to respond to
+ * some of them. Scanning one interface after the other, on the other hand,
+ * takes hours. Instead, up to a given number of scans are kept running.
+ * As soon as one of them is done, which may be well before its timeout has
+ * elapsed if it was told to stop after so many responses, the next one is
+ * started. The scans may also be spaced out by a minimum interval, so that
+ * the DHCP DISCOVER messages do not all go out in the same instant.
+ *
+ * The capture of each scan is closed as soon as it is done, so that only
+ * the scans which are running tie down capture buffers and file
+ * descriptors. The offers recorded remain with the scans.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <time.h>
+
+/****************************************************************************/
+
+#include "scan_scheduler.h"
+#include "dhcp_offer.h"
+
+/****************************************************************************/
+
+struct scan_scheduler
+{
+	int						max_running;	/* 0 for no limit */
+	int						pace;			/* Milliseconds between two scans being started */
+
+	scan_schedule_function	function;
+	void *					user_data;
+
+	struct scan_clock *		clock;
+
+	/* What the current schedule covers. */
+	struct dhcp_scan * const *	scans;
+	int						num_scans;
+	uint32_t				transaction_id;
+	int						timeout;
+
+	int						next_scan;		/* Next one to be started */
+	struct timespec			next_start;		/* Not before this time */
+
+	/* The scans which are running right now. */
+	int *					running;
+	struct timespec *		started;
+	struct timeval *		discover_sent;
+	int						num_running;
+	int						running_size;
+
+	struct timespec			schedule_began;
+	struct timespec			schedule_ended;
+};
+
+/****************************************************************************/
+
+/* The number of seconds between two points in time. */
+static double
+get_seconds_between(const struct timespec * from,const struct timespec * to)
+{
+	double result;
+
+	result = (to->tv_sec - from->tv_sec) + (to->tv_nsec - from->tv_nsec) / 1000000000.0;
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Tell the caller how a scan went, and close its capture. The scan is
+ * no longer counted among those which are running.
+ */
+static void
+finish_scan(struct scan_scheduler * scheduler,int slot,const char * error)
+{
+	struct dhcp_scan * scan = scheduler->scans[scheduler->running[slot]];
+	struct scheduled_scan_report report;
+	const struct dhcp_offer * first_offer;
+	struct timespec now;
+
+	(*scheduler->clock->get_monotonic_time)(scheduler->clock,&now);
+
+	memset(&report,0,sizeof(report));
+
+	report.scan		= scan;
+	report.started	= scheduler->discover_sent[slot];
+	report.duration	= get_seconds_between(&scheduler->started[slot],&now);
+	report.error	= error;
+
+	/* The offers are listed in the order in which they arrived. */
+	first_offer = (const struct dhcp_offer *)get_list_head(get_dhcp_scan_offers(scan));
+	if(first_offer != NULL && error == NULL)
+	{
+		report.have_first_offer = true;
+		report.first_offer_latency =
+			(first_offer->stamp.tv_sec - report.started.tv_sec) +
+			(first_offer->stamp.tv_usec - report.started.tv_usec) / 1000000.0;
+	}
+
+	release_dhcp_scan_capture(scan);
+
+	/* The last slot takes the place of this one. */
+	scheduler->num_running--;
+
+	if(slot != scheduler->num_running)
+	{
+		scheduler->running[slot]		= scheduler->running[scheduler->num_running];
+		scheduler->started[slot]		= scheduler->started[scheduler->num_running];
+		scheduler->discover_sent[slot]	= scheduler->discover_sent[scheduler->num_running];
+	}
+
+	if(is_scan_schedule_done(scheduler))
+		scheduler->schedule_ended = now;
+
+	if(scheduler->function != NULL)
+		(*scheduler->function)(&report,scheduler->user_data);
+}
+
+/****************************************************************************/
+
+/* Start as many scans as the limit and the pace permit. */
+static void
+start_scans(struct scan_scheduler * scheduler)
+{
+	struct dhcp_scan * scan;
+	int slot;
+	int i;
+
+	while(scheduler->next_scan < scheduler->num_scans &&
+	      (scheduler->max_running == 0 || scheduler->num_running < scheduler->max_running) &&
+	      get_scan_clock_milliseconds_until(scheduler->clock,&scheduler->next_start) == 0)
+	{
+		i = scheduler->next_scan++;
+
+		scan = scheduler->scans[i];
+
+		slot = scheduler->num_running++;
+
+		scheduler->running[slot] = i;
+
+		(*scheduler->clock->get_monotonic_time)(scheduler->clock,&scheduler->started[slot]);
+		(*scheduler->clock->get_time_of_day)(scheduler->clock,&scheduler->discover_sent[slot]);
+
+		if(start_dhcp_scan(scan,scheduler->transaction_id + (uint32_t)i,scheduler->timeout) < 0)
+			finish_scan(scheduler,slot,get_dhcp_scan_error(scan));
+
+		if(scheduler->pace > 0)
+		{
+			(*scheduler->clock->get_monotonic_time)(scheduler->clock,&scheduler->next_start);
+
+			scheduler->next_start.tv_sec += scheduler->pace / 1000;
+			scheduler->next_start.tv_nsec += (scheduler->pace % 1000) * 1000000L;
+
+			if(scheduler->next_start.tv_nsec >= 1000000000L)
+			{
+				scheduler->next_start.tv_sec++;
+				scheduler->next_start.tv_nsec -= 1000000000L;
+			}
+		}
+	}
+}
+
+/****************************************************************************/
+
+/* Release the resources allocated by create_scan_scheduler(). The scans
+ * themselves belong to the caller. This is safe to call with a NULL
+ * parameter.
+ */
+void
+delete_scan_scheduler(struct scan_scheduler * scheduler)
+{
+	if(scheduler != NULL)
+	{
+		free(scheduler->running);
+		free(scheduler->started);
+		free(scheduler->discover_sent);
+
+		free(scheduler);
+	}
+}
+
+/****************************************************************************/
+
+/* Set up for running up to max_running scans at the same time, or all of
+ * them if 0, starting one scan no sooner than pace milliseconds after the
+ * previous one. The function is invoked as soon as a scan is done, and
+ * may be NULL. Returns NULL if not enough memory is available.
+ */
+struct scan_scheduler *
+create_scan_scheduler(int max_running,int pace,scan_schedule_function function,void * user_data)
+{
+	struct scan_scheduler * scheduler;
+
+	scheduler = calloc(1,sizeof(*scheduler));
+	if(scheduler != NULL)
+	{
+		scheduler->max_running	= (max_running > 0) ? max_running : 0;
+		scheduler->pace			= (pace > 0) ? pace : 0;
+		scheduler->function		= function;
+		scheduler->user_data	= user_data;
+		scheduler->clock		= &system_scan_clock;
+	}
+
+	return(scheduler);
+}
+
+/****************************************************************************/
+
+/* Use a different clock than the system clock for timing the scans and
+ * pacing them. This should be the same clock which the scans use, or
+ * else the time until the first offer arrived cannot be told.
+ */
+void
+set_scan_scheduler_clock(struct scan_scheduler * scheduler,struct scan_clock * clock)
+{
+	scheduler->clock = (clock != NULL) ? clock : &system_scan_clock;
+}
+
+/****************************************************************************/
+
+/* The clock in use, which is also what the caller should wait with for
+ * the file descriptors filled in by fill_scan_scheduler_pollfds().
+ */
+struct scan_clock *
+get_scan_scheduler_clock(const struct scan_scheduler * scheduler)
+{
+	return(scheduler->clock);
+}
+
+/****************************************************************************/
+
+/* Begin scanning all the network interfaces given, starting with the
+ * first ones right away. Each scan uses its own transaction number,
+ * counting up from the one given, and waits for up to timeout seconds.
+ * The table must remain valid until the schedule is done. Returns -1 if
+ * not enough memory is available, 0 otherwise.
+ */
+int
+begin_scan_schedule(struct scan_scheduler * scheduler,struct dhcp_scan * const * scans,int num_scans,
+	uint32_t transaction_id,int timeout)
+{
+	int result = -1;
+	void * table;
+	int size;
+
+	size = (scheduler->max_running > 0 && scheduler->max_running < num_scans) ? scheduler->max_running : num_scans;
+
+	if(size > scheduler->running_size)
+	{
+		table = realloc(scheduler->running,size * sizeof(*scheduler->running));
+		if(table == NULL)
+			goto out;
+
+		scheduler->running = table;
+
+		table = realloc(scheduler->started,size * sizeof(*scheduler->started));
+		if(table == NULL)
+			goto out;
+
+		scheduler->started = table;
+
+		table = realloc(scheduler->discover_sent,size * sizeof(*scheduler->discover_sent));
+		if(table == NULL)
+			goto out;
+
+		scheduler->discover_sent = table;
+
+		scheduler->running_size = size;
+	}
+
+	scheduler->scans			= scans;
+	scheduler->num_scans		= num_scans;
+	scheduler->transaction_id	= transaction_id;
+	scheduler->timeout			= timeout;
+	scheduler->next_scan		= 0;
+	scheduler->num_running		= 0;
+
+	(*scheduler->clock->get_monotonic_time)(scheduler->clock,&scheduler->schedule_began);
+
+	scheduler->next_start = scheduler->schedule_began;
+	scheduler->schedule_ended = scheduler->schedule_began;
+
+	start_scans(scheduler);
+
+	result = 0;
+
+ out:
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* The number of poll() table entries which fill_scan_scheduler_pollfds()
+ * may need for the current schedule.
+ */
+int
+get_scan_scheduler_num_fds(const struct scan_scheduler * scheduler)
+{
+	return(scheduler->running_size);
+}
+
+/****************************************************************************/
+
+/* Fill in the poll() table entries for the scans which are running.
+ * There must be room for get_scan_scheduler_num_fds() entries. Returns
+ * the number of entries filled in.
+ */
+int
+fill_scan_scheduler_pollfds(const struct scan_scheduler * scheduler,struct pollfd * pfd)
+{
+	int i;
+
+	for(i = 0 ; i < scheduler->num_running ; i++)
+	{
+		pfd[i].fd = get_dhcp_scan_fd(scheduler->scans[scheduler->running[i]]);
+		pfd[i].events = POLLIN;
+		pfd[i].revents = 0;
+	}
+
+	return(scheduler->num_running);
+}
+
+/****************************************************************************/
+
+/* How long to wait (in milliseconds) before calling
+ * dispatch_scan_scheduler(), either for one of the scans or for the
+ * next one to be started. Returns -1 if there is nothing to wait for.
+ */
+int
+get_scan_scheduler_poll_timeout(const struct scan_scheduler * scheduler)
+{
+	int result = -1;
+	int timeout;
+	int i;
+
+	for(i = 0 ; i < scheduler->num_running ; i++)
+	{
+		timeout = get_dhcp_scan_poll_timeout(scheduler->scans[scheduler->running[i]]);
+		if(result < 0 || timeout < result)
+			result = timeout;
+	}
+
+	/* Is there room for another scan? */
+	if(scheduler->next_scan < scheduler->num_scans &&
+	   (scheduler->max_running == 0 || scheduler->num_running < scheduler->max_running))
+	{
+		timeout = get_scan_clock_milliseconds_until(scheduler->clock,&scheduler->next_start);
+		if(result < 0 || timeout < result)
+			result = timeout;
+	}
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Process the frames captured by the scans which are running, and start
+ * the next scans in place of those which are done. A scan whose capture
+ * could not be read counts as done, and the error is reported along with
+ * it.
+ */
+void
+dispatch_scan_scheduler(struct scan_scheduler * scheduler)
+{
+	struct dhcp_scan * scan;
+	int i;
+
+	/* The slots of the scans which are done are filled by the last
+	 * ones, which is why this counts down.
+	 */
+	for(i = scheduler->num_running - 1 ; i >= 0 ; i--)
+	{
+		scan = scheduler->scans[scheduler->running[i]];
+
+		if(dispatch_dhcp_scan(scan) < 0)
+			finish_scan(scheduler,i,get_dhcp_scan_error(scan));
+		else if (is_dhcp_scan_done(scan))
+			finish_scan(scheduler,i,NULL);
+	}
+
+	start_scans(scheduler);
+}
+
+/****************************************************************************/
+
+/* Check if all the scans are done. */
+bool
+is_scan_schedule_done(const struct scan_scheduler * scheduler)
+{
+	bool result;
+
+	result = (scheduler->next_scan == scheduler->num_scans && scheduler->num_running == 0);
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* How long (in seconds) it took to complete all the scans, or how long
+ * they have been running so far.
+ */
+double
+get_scan_schedule_duration(const struct scan_scheduler * scheduler)
+{
+	struct timespec now;
+	double result;
+
+	if(is_scan_schedule_done(scheduler))
+	{
+		result = get_seconds_between(&scheduler->schedule_began,&scheduler->schedule_ended);
+	}
+	else
+	{
+		(*scheduler->clock->get_monotonic_time)(scheduler->clock,&now);
+
+		result = get_seconds_between(&scheduler->schedule_began,&now);
+	}
+
+	return(result);
+}
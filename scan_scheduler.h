@@ -0,0 +1,65 @@
+/*
+ * Run scans on many network interfaces, only so many at a time.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#ifndef _SCAN_SCHEDULER_H
+#define _SCAN_SCHEDULER_H
+
+/****************************************************************************/
+
+#include <sys/time.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <poll.h>
+
+/****************************************************************************/
+
+#include "dhcp_scan.h"
+
+/****************************************************************************/
+
+/* How many scans may be running at the same time by default. */
+#define SCAN_SCHEDULER_DEFAULT_MAX_RUNNING 64
+
+/****************************************************************************/
+
+/* How one of the scans went. */
+struct scheduled_scan_report
+{
+	struct dhcp_scan *	scan;
+	struct timeval		started;				/* When the DHCP DISCOVER went out */
+	double				duration;				/* Seconds until the scan was done */
+	bool				have_first_offer;
+	double				first_offer_latency;	/* Seconds until the first offer arrived */
+	const char *		error;					/* NULL unless the scan could not be started */
+};
+
+/* Invoked as soon as one of the scans is done. */
+typedef void (*scan_schedule_function)(const struct scheduled_scan_report *report, void *user_data);
+
+/****************************************************************************/
+
+struct scan_scheduler;
+
+/****************************************************************************/
+
+struct scan_scheduler *create_scan_scheduler(int max_running, int pace, scan_schedule_function function, void *user_data);
+void delete_scan_scheduler(struct scan_scheduler *scheduler);
+void set_scan_scheduler_clock(struct scan_scheduler *scheduler, struct scan_clock *clock);
+struct scan_clock *get_scan_scheduler_clock(const struct scan_scheduler *scheduler);
+int begin_scan_schedule(struct scan_scheduler *scheduler, struct dhcp_scan * const *scans, int num_scans, uint32_t transaction_id, int timeout);
+int get_scan_scheduler_num_fds(const struct scan_scheduler *scheduler);
+int fill_scan_scheduler_pollfds(const struct scan_scheduler *scheduler, struct pollfd *pfd);
+int get_scan_scheduler_poll_timeout(const struct scan_scheduler *scheduler);
+void dispatch_scan_scheduler(struct scan_scheduler *scheduler);
+bool is_scan_schedule_done(const struct scan_scheduler *scheduler);
+double get_scan_schedule_duration(const struct scan_scheduler *scheduler);
+
+/****************************************************************************/
+
+#endif /* _SCAN_SCHEDULER_H */
@@ -0,0 +1,328 @@
+/*
+ * The DHCP servers found by the most recent scan, published in a POSIX
+ * shared memory object for other processes to read without locking.
+ *
+ * The shared memory object consists of a header followed by an array of
+ * server entries. Updates are protected by a sequence lock: the publisher
+ * increments the sequence number before and after changing the contents,
+ * so that it is odd while an update is in progress. A reader copies the
+ * contents and then checks if the sequence number is still the same, even
+ * number it found before it began; if not, the copy may be inconsistent
+ * and the reader tries again. Readers never block the publisher, and there
+ * is only ever one publisher.
+ *
+ * The shared memory object is left in place when the publisher exits, so
+ * that readers can tell from the publisher's process ID and the time of
+ * the last update whether the information is still current.
+ *
+ * The memory ordering is implemented with the GCC/clang __atomic builtin
+ * functions.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <unistd.h>
+
+/****************************************************************************/
+
+#include "shared_results.h"
+
+/****************************************************************************/
+
+#define SHARED_RESULTS_MAGIC	"DHCPSHMR"
+#define SHARED_RESULTS_VERSION	1
+
+/* How often a reader tries to get a consistent copy before it gives up,
+ * e.g. because the publisher stopped in the middle of an update.
+ */
+#define MAXIMUM_READ_ATTEMPTS	100000
+
+/****************************************************************************/
+
+struct shared_results_header
+{
+	char		magic[8];
+	uint32_t	version;
+	uint32_t	capacity;
+	uint32_t	entry_size;
+	uint32_t	sequence;			/* Odd while an update is in progress */
+	uint32_t	num_servers;
+	uint32_t	num_servers_found;
+	int64_t		updated;
+	uint64_t	generation;
+	uint32_t	publisher_pid;
+	uint8_t		reserved[12];
+};
+
+/* This is what the shared memory object contains. */
+struct shared_results_layout
+{
+	struct shared_results_header	header;
+	struct shared_server			servers[SHARED_RESULTS_CAPACITY];
+};
+
+/****************************************************************************/
+
+struct shared_results
+{
+	struct shared_results_layout *	layout;
+};
+
+/****************************************************************************/
+
+/* Map the shared memory object into memory. Returns NULL in case of
+ * error, with errno set.
+ */
+static struct shared_results *
+map_shared_results(const char * name,bool publisher)
+{
+	struct shared_results * result = NULL;
+	struct shared_results * shared_results;
+	void * map = MAP_FAILED;
+	struct stat st;
+	int fd = -1;
+
+	shared_results = calloc(1,sizeof(*shared_results));
+	if(shared_results == NULL)
+		goto out;
+
+	if(publisher)
+		fd = shm_open(name,O_RDWR|O_CREAT,0644);
+	else
+		fd = shm_open(name,O_RDONLY,0);
+
+	if(fd < 0)
+		goto out;
+
+	if(fstat(fd,&st) < 0)
+		goto out;
+
+	if(st.st_size != sizeof(struct shared_results_layout))
+	{
+		if(!publisher)
+		{
+			errno = EINVAL;
+			goto out;
+		}
+
+		if(ftruncate(fd,sizeof(struct shared_results_layout)) < 0)
+			goto out;
+	}
+
+	map = mmap(NULL,sizeof(struct shared_results_layout),publisher ? PROT_READ|PROT_WRITE : PROT_READ,MAP_SHARED,fd,0);
+	if(map == MAP_FAILED)
+		goto out;
+
+	shared_results->layout = map;
+
+	result = shared_results;
+	shared_results = NULL;
+
+ out:
+
+	if(fd >= 0)
+		close(fd);
+
+	if(shared_results != NULL)
+		free(shared_results);
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Release the resources allocated by create_shared_results() or by
+ * attach_shared_results(). The shared memory object itself remains in
+ * place. This is safe to call with a NULL parameter.
+ */
+void
+delete_shared_results(struct shared_results * shared_results)
+{
+	if(shared_results != NULL)
+	{
+		munmap(shared_results->layout,sizeof(*shared_results->layout));
+
+		free(shared_results);
+	}
+}
+
+/****************************************************************************/
+
+/* Start an update; readers will retry until it is finished. */
+static void
+begin_update(struct shared_results_header * header)
+{
+	uint32_t sequence = header->sequence;
+
+	/* If a previous publisher stopped in the middle of an
+	 * update, the sequence number is odd already.
+	 */
+	if((sequence % 2) == 0)
+		__atomic_store_n(&header->sequence,sequence + 1,__ATOMIC_RELAXED);
+
+	/* The sequence number must change before the contents do. */
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/****************************************************************************/
+
+/* Finish an update. */
+static void
+end_update(struct shared_results_header * header)
+{
+	/* The contents must change before the sequence number does. */
+	__atomic_store_n(&header->sequence,header->sequence + 1,__ATOMIC_RELEASE);
+}
+
+/****************************************************************************/
+
+/* Create the shared memory object with the given name (which should begin
+ * with a '/' character), or take over an existing one. Returns NULL in case
+ * of error, with errno set.
+ */
+struct shared_results *
+create_shared_results(const char * name)
+{
+	struct shared_results_header * header;
+	struct shared_results * result;
+
+	result = map_shared_results(name,true);
+	if(result != NULL)
+	{
+		header = &result->layout->header;
+
+		begin_update(header);
+
+		memmove(header->magic,SHARED_RESULTS_MAGIC,sizeof(header->magic));
+		header->version = SHARED_RESULTS_VERSION;
+		header->capacity = SHARED_RESULTS_CAPACITY;
+		header->entry_size = sizeof(struct shared_server);
+		header->num_servers = 0;
+		header->num_servers_found = 0;
+		header->updated = 0;
+		header->generation = 0;
+		header->publisher_pid = (uint32_t)getpid();
+
+		end_update(header);
+	}
+
+	return(result);
+}
+
+/****************************************************************************/
+
+/* Attach to an existing shared memory object for reading. Returns NULL
+ * in case of error, with errno set.
+ */
+struct shared_results *
+attach_shared_results(const char * name)
+{
+	return(map_shared_results(name,false));
+}
+
+/****************************************************************************/
+
+/* Replace the published servers. If there are more servers than will
+ * fit, only the first SHARED_RESULTS_CAPACITY of them are published.
+ */
+void
+publish_shared_results(struct shared_results * shared_results,const struct shared_server * servers,size_t num_servers,time_t updated)
+{
+	struct shared_results_layout * layout = shared_results->layout;
+	size_t num_published;
+
+	num_published = (num_servers < SHARED_RESULTS_CAPACITY) ? num_servers : SHARED_RESULTS_CAPACITY;
+
+	begin_update(&layout->header);
+
+	memmove(layout->servers,servers,num_published * sizeof(*servers));
+
+	layout->header.num_servers = (uint32_t)num_published;
+	layout->header.num_servers_found = (uint32_t)num_servers;
+	layout->header.updated = updated;
+	layout->header.generation++;
+
+	end_update(&layout->header);
+}
+
+/****************************************************************************/
+
+/* Make a consistent copy of what was published. Returns -1 in case of
+ * error, with errno set to EINVAL if the shared memory object is not
+ * in the expected format, or EBUSY if no consistent copy could be
+ * made. Returns 0 otherwise.
+ */
+int
+read_shared_results(const struct shared_results * shared_results,struct shared_snapshot * snapshot)
+{
+	const struct shared_results_layout * layout = shared_results->layout;
+	uint32_t sequence,num_servers;
+	int result = -1;
+	int attempt;
+
+	for(attempt = 0 ; attempt < MAXIMUM_READ_ATTEMPTS ; attempt++)
+	{
+		sequence = __atomic_load_n(&layout->header.sequence,__ATOMIC_ACQUIRE);
+
+		/* An update is in progress. */
+		if((sequence % 2) != 0)
+		{
+			sched_yield();
+			continue;
+		}
+
+		if(memcmp(layout->header.magic,SHARED_RESULTS_MAGIC,sizeof(layout->header.magic)) != 0 ||
+		   layout->header.version != SHARED_RESULTS_VERSION ||
+		   layout->header.capacity != SHARED_RESULTS_CAPACITY ||
+		   layout->header.entry_size != sizeof(struct shared_server))
+		{
+			/* The publisher may be setting up the header. */
+			if(__atomic_load_n(&layout->header.sequence,__ATOMIC_ACQUIRE) != sequence)
+				continue;
+
+			errno = EINVAL;
+			goto out;
+		}
+
+		num_servers = layout->header.num_servers;
+		if(num_servers > SHARED_RESULTS_CAPACITY)
+			num_servers = SHARED_RESULTS_CAPACITY;
+
+		snapshot->generation		= layout->header.generation;
+		snapshot->updated			= (time_t)layout->header.updated;
+		snapshot->publisher_pid		= (pid_t)layout->header.publisher_pid;
+		snapshot->num_servers		= num_servers;
+		snapshot->num_servers_found	= layout->header.num_servers_found;
+
+		memmove(snapshot->servers,layout->servers,num_servers * sizeof(*snapshot->servers));
+
+		/* The copy must be complete before the sequence number
+		 * is checked again.
+		 */
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+		if(__atomic_load_n(&layout->header.sequence,__ATOMIC_RELAXED) == sequence)
+		{
+			result = 0;
+			goto out;
+		}
+	}
+
+	errno = EBUSY;
+
+ out:
+
+	return(result);
+}
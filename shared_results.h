@@ -0,0 +1,66 @@
+/*
+ * The DHCP servers found by the most recent scan, published in a POSIX
+ * shared memory object for other processes to read without locking.
+ *
+ * License : BSD
+ *
+ * :ts=4
+ */
+
+#ifndef _SHARED_RESULTS_H
+#define _SHARED_RESULTS_H
+
+/****************************************************************************/
+
+#include <sys/types.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+/****************************************************************************/
+
+/* Maximum number of servers which can be published. */
+#define SHARED_RESULTS_CAPACITY 256
+
+/****************************************************************************/
+
+/* A DHCP server as published in the shared memory object. */
+struct shared_server
+{
+	uint8_t		server_ipv4_address[4];
+	uint8_t		server_mac_address[6];
+	uint8_t		reserved1[2];
+	uint8_t		offered_ipv4_address[4];
+	char		interface_name[16];
+	uint32_t	reserved2;
+	int64_t		time_received;
+	uint64_t	offer_hash;
+};
+
+/* A consistent copy of what was published. */
+struct shared_snapshot
+{
+	uint64_t				generation;			/* Number of scans published */
+	time_t					updated;			/* When it was published */
+	pid_t					publisher_pid;
+	uint32_t				num_servers;		/* Number of entries in the servers[] array */
+	uint32_t				num_servers_found;	/* May be larger than num_servers */
+	struct shared_server	servers[SHARED_RESULTS_CAPACITY];
+};
+
+/****************************************************************************/
+
+struct shared_results;
+
+/****************************************************************************/
+
+struct shared_results *create_shared_results(const char *name);
+struct shared_results *attach_shared_results(const char *name);
+void delete_shared_results(struct shared_results *shared_results);
+void publish_shared_results(struct shared_results *shared_results, const struct shared_server *servers, size_t num_servers, time_t updated);
+int read_shared_results(const struct shared_results *shared_results, struct shared_snapshot *snapshot);
+
+/****************************************************************************/
+
+#endif /* _SHARED_RESULTS_H */